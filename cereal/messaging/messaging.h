@@ -50,6 +50,8 @@ private:
 class MessageBuilder : public capnp::MallocMessageBuilder {
 public:
   MessageBuilder() = default;
+  // Builds in firstSegment until it is full. It must be zeroed, and is zeroed again when the builder is destroyed.
+  explicit MessageBuilder(kj::ArrayPtr<capnp::word> firstSegment) : capnp::MallocMessageBuilder(firstSegment) {}
 
   cereal::Event::Builder initEvent(bool valid = true) {
     cereal::Event::Builder event = initRoot<cereal::Event>();
@@ -85,12 +87,20 @@ private:
 class PubMaster {
 public:
   PubMaster(const std::vector<const char *> &service_list);
-  inline int send(const char *name, capnp::byte *data, size_t size) { return sockets_.at(name)->send((char *)data, size); }
+  int send(const char *name, capnp::byte *data, size_t size);
   int send(const char *name, MessageBuilder &msg);
+  // Returns an empty builder for name, valid until the next call. It builds in memory kept between
+  // messages and is sent from there without being copied, so it doesn't allocate once that memory
+  // has grown to the size of the messages.
+  MessageBuilder &builder(const char *name);
+  bool allReadersUpdated(const char *name);
+  size_t numReaders(const char *name);
   ~PubMaster();
 
 private:
-  std::map<std::string, PubSocket *> sockets_;
+  struct Publisher;
+  Publisher *publisher(const char *name);
+  std::map<std::string, Publisher *, std::less<>> publishers_;
 };
 
 class AlignedBuffer {
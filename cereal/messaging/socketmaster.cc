@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
 
 #include "cereal/services.h"
 #include "cereal/messaging/messaging.h"
@@ -192,20 +194,82 @@ SubMaster::~SubMaster() {
   }
 }
 
+struct PubMaster::Publisher {
+  PubSocket *socket = nullptr;
+  // the first segment of builder, after a word for the segment table
+  kj::Array<capnp::word> arena;
+  std::optional<MessageBuilder> builder;
+  // for messages from other builders
+  kj::Array<capnp::byte> buffer;
+};
+
 PubMaster::PubMaster(const std::vector<const char *> &service_list) {
   for (auto name : service_list) {
     assert(services.count(name) > 0);
     PubSocket *socket = PubSocket::create(message_context.context(), name);
     assert(socket);
-    sockets_[name] = socket;
+    publishers_[name] = new Publisher{.socket = socket};
+  }
+}
+
+PubMaster::Publisher *PubMaster::publisher(const char *name) {
+  auto it = publishers_.find(name);
+  if (it == publishers_.end()) throw std::out_of_range(name);
+  return it->second;
+}
+
+MessageBuilder &PubMaster::builder(const char *name) {
+  Publisher *p = publisher(name);
+  size_t words = 1024;
+  if (p->builder) {
+    // grow the arena if the last message didn't fit in it
+    auto segments = p->builder->getSegmentsForOutput();
+    if (segments.size() > 1) {
+      words = 0;
+      for (auto segment : segments) words += segment.size();
+    }
+    p->builder.reset();
   }
+  if (p->arena.size() < words + 1) {
+    p->arena = kj::heapArray<capnp::word>(words + words / 2 + 1);
+    memset(p->arena.begin(), 0, p->arena.asBytes().size());
+  }
+  return p->builder.emplace(p->arena.slice(1, p->arena.size()));
+}
+
+int PubMaster::send(const char *name, capnp::byte *data, size_t size) {
+  return publisher(name)->socket->send((char *)data, size);
 }
 
 int PubMaster::send(const char *name, MessageBuilder &msg) {
-  auto bytes = msg.toBytes();
-  return send(name, bytes.begin(), bytes.size());
+  Publisher *p = publisher(name);
+  auto segments = msg.getSegmentsForOutput();
+  if (p->builder && &msg == &*p->builder && segments.size() == 1) {
+    // the message is the arena, once the segment table is written in front of it
+    uint32_t table[2] = {0, (uint32_t)segments[0].size()};
+    memcpy(p->arena.begin(), table, sizeof(table));
+    return p->socket->send((char *)p->arena.begin(), (segments[0].size() + 1) * sizeof(capnp::word));
+  }
+
+  const size_t size = msg.getSerializedSize();
+  if (p->buffer.size() < size) {
+    p->buffer = kj::heapArray<capnp::byte>(size + size / 2);
+  }
+  msg.serializeToBuffer(p->buffer.begin(), size);
+  return p->socket->send((char *)p->buffer.begin(), size);
+}
+
+bool PubMaster::allReadersUpdated(const char *name) {
+  return publisher(name)->socket->all_readers_updated();
+}
+
+size_t PubMaster::numReaders(const char *name) {
+  return publisher(name)->socket->num_readers();
 }
 
 PubMaster::~PubMaster() {
-  for (auto s : sockets_) delete s.second;
+  for (auto &[name, p] : publishers_) {
+    delete p->socket;
+    delete p;
+  }
 }
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+
+#include "cereal/messaging/messaging.h"
+
+// Measures the time and the heap allocations it takes to build and publish can messages
+// of a few sizes, with a new MessageBuilder each time and with PubMaster::builder.
+
+static std::atomic<uint64_t> allocations = 0;
+
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) { allocations++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { allocations++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { allocations++; return __libc_realloc(p, size); }
+}
+
+static uint64_t nanos() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void fill(MessageBuilder &msg, int frames) {
+  auto can = msg.initEvent().initCan(frames);
+  for (int i = 0; i < frames; ++i) {
+    uint8_t dat[8] = {(uint8_t)i};
+    can[i].setAddress(i);
+    can[i].setSrc(i % 3);
+    can[i].setDat(kj::arrayPtr(dat, sizeof(dat)));
+  }
+}
+
+template <typename F>
+static void run(const char *name, int frames, SubSocket *sock, F publish) {
+  const int n = 2000;
+  // the first messages grow the buffers
+  for (int i = 0; i < 10; ++i) publish();
+
+  const uint64_t start_allocations = allocations;
+  const uint64_t start = nanos();
+  for (int i = 0; i < n; ++i) publish();
+  const double ns = double(nanos() - start) / n;
+  const double allocs = double(allocations - start_allocations) / n;
+
+  // check what the subscriber gets
+  std::unique_ptr<Message> last;
+  while (Message *m = sock->receive(true)) last.reset(m);
+  assert(last);
+  AlignedBuffer aligned_buf;
+  capnp::FlatArrayMessageReader reader(aligned_buf.align(last.get()));
+  assert(reader.getRoot<cereal::Event>().getCan().size() == frames);
+
+  printf("  %-26s %9.0f ns/msg %6.2f allocations/msg\n", name, ns, allocs);
+}
+
+int main() {
+  PubMaster pm({"can"});
+  std::unique_ptr<Context> context(Context::create());
+  std::unique_ptr<SubSocket> sock(SubSocket::create(context.get(), "can"));
+
+  for (int frames : {1, 100, 1000, 5000}) {
+    MessageBuilder sizing;
+    fill(sizing, frames);
+    printf("%d frames, %zu bytes:\n", frames, sizing.getSerializedSize());
+
+    run("new builder, toBytes", frames, sock.get(), [&] {
+      MessageBuilder msg;
+      fill(msg, frames);
+      auto bytes = msg.toBytes();
+      pm.send("can", bytes.begin(), bytes.size());
+    });
+    run("new builder", frames, sock.get(), [&] {
+      MessageBuilder msg;
+      fill(msg, frames);
+      pm.send("can", msg);
+    });
+    run("PubMaster::builder", frames, sock.get(), [&] {
+      MessageBuilder &msg = pm.builder("can");
+      fill(msg, frames);
+      pm.send("can", msg);
+    });
+  }
+  return 0;
+}
@@ -16,6 +16,7 @@ _services: dict[str, tuple] = {
   "gyroscope2": (True, 100., 100),
   "accelerometer": (True, 104., 104),
   "accelerometer2": (True, 100., 100),
+  "sensorEvents": (True, 26., 26),
   "magnetometer": (True, 25., 25),
   "lightSensor": (True, 100., 100),
   "temperatureSensor": (True, 2., 200),
@@ -34,7 +35,7 @@ _services: dict[str, tuple] = {
   "errorLogMessage": (True, 0., 1),
   "liveCalibration": (True, 4., 4),
   "liveTorqueParameters": (True, 4., 1),
-  "androidLog": (True, 0.),
+  "androidLogs": (True, 0.),
   "carState": (True, 100., 10),
   "carControl": (True, 100., 10),
   "carOutput": (True, 100., 10),
@@ -16,6 +16,7 @@
 #ifdef QCOM2
 // TODO: decide if we want to install libi2c-dev everywhere
 extern "C" {
+  #include <linux/i2c.h>
   #include <linux/i2c-dev.h>
   #include <i2c/smbus.h>
 }
@@ -66,6 +67,28 @@ fail:
   return ret;
 }
 
+int I2CBus::read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, size_t len) {
+  std::lock_guard lk(m);
+
+  // register address write and the read, with a repeated start in between
+  uint8_t reg = register_address;
+  struct i2c_msg msgs[2] = {};
+  msgs[0].addr = device_address;
+  msgs[0].len = 1;
+  msgs[0].buf = &reg;
+  msgs[1].addr = device_address;
+  msgs[1].flags = I2C_M_RD;
+  msgs[1].len = len;
+  msgs[1].buf = buffer;
+
+  struct i2c_rdwr_ioctl_data data = {};
+  data.msgs = msgs;
+  data.nmsgs = 2;
+
+  int ret = HANDLE_EINTR(ioctl(i2c_fd, I2C_RDWR, &data));
+  return ret < 0 ? ret : (int)len;
+}
+
 #else
 
 I2CBus::I2CBus(uint8_t bus_id) {
@@ -89,4 +112,12 @@ int I2CBus::set_register(uint8_t device_address, uint register_address, uint8_t
   UNUSED(data);
   return -1;
 }
+
+int I2CBus::read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, size_t len) {
+  UNUSED(device_address);
+  UNUSED(register_address);
+  UNUSED(buffer);
+  UNUSED(len);
+  return -1;
+}
 #endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <mutex>
 
@@ -10,10 +11,16 @@ class I2CBus {
     int i2c_fd;
     std::mutex m;
 
+  protected:
+    // a bus without a device, for the mocks of tests
+    I2CBus() : i2c_fd(-1) {}
+
   public:
     I2CBus(uint8_t bus_id);
-    ~I2CBus();
+    virtual ~I2CBus();
 
-    int read_register(uint8_t device_address, uint register_address, uint8_t *buffer, uint8_t len);
-    int set_register(uint8_t device_address, uint register_address, uint8_t data);
+    virtual int read_register(uint8_t device_address, uint register_address, uint8_t *buffer, uint8_t len);
+    virtual int set_register(uint8_t device_address, uint register_address, uint8_t data);
+    // Reads len bytes from a register in one combined transfer, without the 32 byte limit of read_register
+    virtual int read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, size_t len);
 };
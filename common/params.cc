@@ -6,8 +6,11 @@
 #include <algorithm>
 #include <cassert>
 #include <csignal>
+#include <cstring>
+#include <mutex>
 #include <unordered_map>
 
+#include "common/params_store.h"
 #include "common/queue.h"
 #include "common/swaglog.h"
 #include "common/util.h"
@@ -486,12 +489,102 @@ std::unordered_map<std::string, uint32_t> keys = {
     {"WheelSpeed", PERSISTENT | FROGPILOT_STORAGE | FROGPILOT_VISUALS},
 };
 
+// Journal of a transaction: magic, count, then op, key and value of every entry, and
+// the hash of all of it, so a journal that wasn't fully written is never applied.
+constexpr uint32_t TXN_MAGIC = 0x4e585450;  // "PTXN"
+
+uint64_t txn_hash(const char *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+template <typename T>
+void txn_append(std::string &out, T val) {
+  out.append((const char *)&val, sizeof(val));
+}
+
+std::string serialize_txn(const std::map<std::string, std::optional<std::string>> &values) {
+  std::string out;
+  txn_append(out, TXN_MAGIC);
+  txn_append(out, (uint32_t)values.size());
+  for (const auto &[key, val] : values) {
+    txn_append(out, (uint8_t)val.has_value());
+    txn_append(out, (uint32_t)key.size());
+    out += key;
+    txn_append(out, (uint32_t)val.value_or("").size());
+    out += val.value_or("");
+  }
+  txn_append(out, txn_hash(out.data(), out.size()));
+  return out;
+}
+
+bool parse_txn(const std::string &data, std::map<std::string, std::optional<std::string>> &values) {
+  size_t pos = 0;
+  auto read = [&](auto &val) {
+    if (data.size() - pos < sizeof(val)) return false;
+    memcpy(&val, data.data() + pos, sizeof(val));
+    pos += sizeof(val);
+    return true;
+  };
+  auto read_str = [&](std::string &str) {
+    uint32_t size = 0;
+    if (!read(size) || data.size() - pos < size) return false;
+    str.assign(data, pos, size);
+    pos += size;
+    return true;
+  };
+
+  uint64_t hash = 0;
+  if (data.size() < sizeof(hash)) return false;
+  memcpy(&hash, data.data() + data.size() - sizeof(hash), sizeof(hash));
+  if (hash != txn_hash(data.data(), data.size() - sizeof(hash))) return false;
+
+  uint32_t magic = 0, count = 0;
+  if (!read(magic) || magic != TXN_MAGIC || !read(count)) return false;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint8_t has_value = 0;
+    std::string key, val;
+    if (!read(has_value) || !read_str(key) || !read_str(val)) return false;
+    values[key] = has_value ? std::make_optional(val) : std::nullopt;
+  }
+  return true;
+}
+
+// the slots of the shared memory store are in key order
+const std::vector<std::string> &sorted_keys() {
+  static const std::vector<std::string> sorted = []() {
+    std::vector<std::string> ret;
+    for (const auto &[key, _] : keys) {
+      ret.push_back(key);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }();
+  return sorted;
+}
+
 } // namespace
 
 
 Params::Params(const std::string &path) {
   params_prefix = "/" + util::getenv("OPENPILOT_PREFIX", "d");
   params_path = ensure_params_path(params_prefix, path);
+
+  // open the store and finish an interrupted transaction once per directory and process
+  static std::mutex opened_lock;
+  static std::map<std::string, std::shared_ptr<ParamsStore>> opened;
+  std::lock_guard lk(opened_lock);
+  if (auto it = opened.find(getParamPath()); it != opened.end()) {
+    store = it->second;
+  } else {
+    store = ParamsStore::open(getParamPath(), sorted_keys());
+    FileLock file_lock(params_path + "/.lock");
+    finishTransaction();
+    opened[getParamPath()] = store;
+  }
 }
 
 Params::~Params() {
@@ -541,9 +634,11 @@ int Params::put(const char* key, const char* value, size_t value_size) {
     if ((result = fsync(tmp_fd)) < 0) break;
 
     FileLock file_lock(params_path + "/.lock");
+    finishTransaction();
 
     // Move temp into place.
     if ((result = rename(tmp_path.c_str(), getParamPath(key).c_str())) < 0) break;
+    if (store) store->changed(key);
 
     // fsync parent directory
     result = fsync_dir(getParamPath());
@@ -558,16 +653,132 @@ int Params::put(const char* key, const char* value, size_t value_size) {
 
 int Params::remove(const std::string &key) {
   FileLock file_lock(params_path + "/.lock");
+  finishTransaction();
   int result = unlink(getParamPath(key).c_str());
+  if (store && (result == 0 || errno == ENOENT)) store->changed(key);
   if (result != 0) {
     return result;
   }
   return fsync_dir(getParamPath());
 }
 
+int Params::commit(const ParamsTransaction &txn) {
+  // 1) write the journal of the transaction to a temp file and fsync it
+  // 2) move it into place, from now on the transaction is finished by the next write or
+  //    process that opens params if we crash
+  // 3) apply the values, see applyTransaction()
+  // The key directory is the only one fsynced. This relies on the filesystem persisting
+  // renames in the order they were made, as ext4 does with its journal: the renames of
+  // the values never outlive a crash without the rename of the journal before them.
+  if (txn.empty()) return 0;
+
+  std::string tmp_path = params_path + "/.tmp_txn_XXXXXX";
+  int tmp_fd = mkstemp((char*)tmp_path.c_str());
+  if (tmp_fd < 0) return -1;
+
+  const std::string journal = serialize_txn(txn.values);
+  int result = -1;
+  do {
+    ssize_t bytes_written = HANDLE_EINTR(write(tmp_fd, journal.data(), journal.size()));
+    if (bytes_written < 0 || (size_t)bytes_written != journal.size()) {
+      result = -20;
+      break;
+    }
+    if ((result = fsync(tmp_fd)) < 0) break;
+
+    FileLock file_lock(params_path + "/.lock");
+    finishTransaction();
+    if ((result = rename(tmp_path.c_str(), journalPath().c_str())) < 0) break;
+    result = applyTransaction(txn.values);
+  } while (false);
+
+  close(tmp_fd);
+  ::unlink(tmp_path.c_str());
+  return result;
+}
+
+void Params::finishTransaction() {
+  // Called with the lock held, before anything is written over the values of a
+  // transaction that was interrupted by a crash.
+  if (util::file_exists(journalPath())) {
+    std::map<std::string, std::optional<std::string>> values;
+    if (parse_txn(util::read_file(journalPath()), values)) {
+      applyTransaction(values);
+    } else if (unlink(journalPath().c_str()) == 0) {
+      fsync_dir(params_path);
+    }
+  }
+}
+
+int Params::applyTransaction(const std::map<std::string, std::optional<std::string>> &values) {
+  // Called with the lock held and the journal in place. Every value is written to its
+  // temp file first, if that fails nothing was changed yet and the journal is dropped.
+  std::vector<std::pair<std::string, std::string>> tmp_files;  // tmp path, key
+  std::vector<std::string> changed;
+  int result = 0;
+  bool renamed = false;
+  for (const auto &[key, val] : values) {
+    changed.push_back(key);
+    if (!val) continue;
+
+    std::string tmp_path = params_path + "/.tmp_value_XXXXXX";
+    int tmp_fd = mkstemp((char*)tmp_path.c_str());
+    if (tmp_fd < 0) {
+      result = -1;
+      break;
+    }
+    tmp_files.emplace_back(tmp_path, key);
+    ssize_t bytes_written = HANDLE_EINTR(write(tmp_fd, val->data(), val->size()));
+    if (bytes_written < 0 || (size_t)bytes_written != val->size()) {
+      result = -20;
+    } else {
+      result = fsync(tmp_fd);
+    }
+    close(tmp_fd);
+    if (result != 0) break;
+  }
+
+  if (result == 0) {
+    // a failed rename leaves the journal in place to be retried
+    auto write_files = [&]() {
+      renamed = true;
+      for (const auto &[tmp_path, key] : tmp_files) {
+        if (rename(tmp_path.c_str(), getParamPath(key).c_str()) != 0) result = -1;
+      }
+      for (const auto &[key, val] : values) {
+        if (!val && unlink(getParamPath(key).c_str()) != 0 && errno != ENOENT) result = -1;
+      }
+    };
+    if (store) {
+      store->changed(changed, write_files);
+    } else {
+      write_files();
+    }
+    if (int sync_result = fsync_dir(getParamPath()); result == 0) {
+      result = sync_result;
+    }
+  }
+
+  if (result != 0) {
+    for (const auto &[tmp_path, key] : tmp_files) {
+      ::unlink(tmp_path.c_str());
+    }
+  }
+  // Not fsynced: the unlink is persisted before any later write of the params is, and until
+  // then replaying the journal writes the values it already wrote.
+  if (result == 0 || !renamed) {
+    unlink(journalPath().c_str());
+  }
+  return result;
+}
+
 std::string Params::get(const std::string &key, bool block) {
+  auto read = [&]() {
+    return store ? store->get(key, getParamPath(key)) : util::read_file(getParamPath(key));
+  };
+
   if (!block) {
-    return util::read_file(getParamPath(key));
+    return read();
   } else {
     // blocking read until successful
     params_do_exit = 0;
@@ -575,11 +786,12 @@ std::string Params::get(const std::string &key, bool block) {
     void (*prev_handler_sigterm)(int) = std::signal(SIGTERM, params_sig_handler);
 
     std::string value;
+    uint32_t gen = generation();
     while (!params_do_exit) {
-      if (value = util::read_file(getParamPath(key)); !value.empty()) {
+      if (value = read(); !value.empty()) {
         break;
       }
-      util::sleep_for(100);  // 0.1 s
+      gen = waitForChange(gen, 100);  // 0.1 s
     }
 
     std::signal(SIGINT, prev_handler_sigint);
@@ -595,6 +807,7 @@ std::map<std::string, std::string> Params::readAll() {
 
 void Params::clearAll(ParamKeyType key_type) {
   FileLock file_lock(params_path + "/.lock");
+  finishTransaction();
 
   // 1) delete params of key_type
   // 2) delete files that are not defined in the keys.
@@ -612,10 +825,17 @@ void Params::clearAll(ParamKeyType key_type) {
   }
 
   fsync_dir(getParamPath());
+  if (store) store->invalidate();
 }
 
 void Params::putNonBlocking(const std::string &key, const std::string &val) {
-   queue.push(std::make_pair(key, val));
+  ParamsTransaction txn;
+  txn.put(key, val);
+  commitNonBlocking(txn);
+}
+
+void Params::commitNonBlocking(const ParamsTransaction &txn) {
+  queue.push(txn);
   // start thread on demand
   if (!future.valid() || future.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready) {
     future = std::async(std::launch::async, &Params::asyncWriteThread, this);
@@ -624,9 +844,30 @@ void Params::putNonBlocking(const std::string &key, const std::string &val) {
 
 void Params::asyncWriteThread() {
   // TODO: write the latest one if a key has multiple values in the queue.
-  std::pair<std::string, std::string> p;
-  while (queue.try_pop(p, 0)) {
-    // Params::put is Thread-Safe
-    put(p.first, p.second);
+  ParamsTransaction txn;
+  while (queue.try_pop(txn, 0)) {
+    // Params::put and Params::commit are Thread-Safe, a single value doesn't need a journal
+    if (txn.values.size() == 1 && txn.values.begin()->second) {
+      put(txn.values.begin()->first, *txn.values.begin()->second);
+    } else {
+      commit(txn);
+    }
+  }
+}
+
+uint32_t Params::generation() {
+  static std::atomic<uint32_t> untracked_generation = 0;
+  return store ? store->generation() : ++untracked_generation;
+}
+
+uint32_t Params::waitForChange(uint32_t generation, int timeout_ms) {
+  if (!store) {
+    util::sleep_for(timeout_ms);
+    return this->generation();
   }
+  return store->waitForChange(generation, timeout_ms);
+}
+
+void Params::invalidate() {
+  if (store) store->invalidate();
 }
@@ -2,6 +2,8 @@
 
 #include <future>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -9,6 +11,8 @@
 
 #include "common/queue.h"
 
+class ParamsStore;
+
 enum ParamKeyType {
   PERSISTENT = 0x02,
   CLEAR_ON_MANAGER_START = 0x04,
@@ -25,6 +29,19 @@ enum ParamKeyType {
   ALL = 0xFFFFFFFF
 };
 
+// Values staged to be written together by Params::commit().
+class ParamsTransaction {
+public:
+  inline void put(const std::string &key, const std::string &val) { values[key] = val; }
+  inline void putBool(const std::string &key, bool val) { put(key, val ? "1" : "0"); }
+  inline void putInt(const std::string &key, int val) { put(key, std::to_string(val)); }
+  inline void putFloat(const std::string &key, float val) { put(key, std::to_string(val)); }
+  inline void remove(const std::string &key) { values[key] = std::nullopt; }
+  inline bool empty() const { return values.empty(); }
+
+  std::map<std::string, std::optional<std::string>> values;
+};
+
 class Params {
 public:
   explicit Params(const std::string &path = {});
@@ -73,6 +90,12 @@ public:
   inline int putFloat(const std::string &key, float val) {
     return put(key.c_str(), std::to_string(val).c_str(), std::to_string(val).size());
   }
+  // Writes all values of the transaction under one lock. Readers of the shared memory store
+  // see all of them at once, and after a crash either all or none of them are applied.
+  // Costs an fsync per value and one directory fsync.
+  int commit(const ParamsTransaction &txn);
+  // Commits the transaction in the thread of the nonblocking puts, in order with them
+  void commitNonBlocking(const ParamsTransaction &txn);
   void putNonBlocking(const std::string &key, const std::string &val);
   inline void putBoolNonBlocking(const std::string &key, bool val) {
     putNonBlocking(key, val ? "1" : "0");
@@ -86,13 +109,27 @@ public:
     putNonBlocking(key, std::to_string(val));
   }
 
+  // change notifications
+  // The generation changes every time a value is written. Without the shared memory
+  // store (e.g. on macOS) it changes on every call, as changes can't be tracked.
+  uint32_t generation();
+  // Blocks until the generation is different from the given one or timeout_ms passed.
+  uint32_t waitForChange(uint32_t generation, int timeout_ms);
+  // Reread every value from its file.
+  void invalidate();
+
 private:
   void asyncWriteThread();
+  inline std::string journalPath() { return params_path + "/.txn_" + params_prefix.substr(1); }
+  void finishTransaction();
+  int applyTransaction(const std::map<std::string, std::optional<std::string>> &values);
 
   std::string params_path;
   std::string params_prefix;
 
+  std::shared_ptr<ParamsStore> store;
+
   // for nonblocking write
   std::future<void> future;
-  SafeQueue<std::pair<std::string, std::string>> queue;
+  SafeQueue<ParamsTransaction> queue;
 };
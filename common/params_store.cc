@@ -0,0 +1,361 @@
+#include "common/params_store.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "common/swaglog.h"
+#include "common/timing.h"
+#include "common/util.h"
+
+namespace {
+
+constexpr uint32_t STORE_MAGIC = 0x50535433;  // "PST3"
+// a slot held longer than this is taken over if the process holding it is gone
+constexpr double STALE_LOCK_MS = 100;
+// File times advance in ticks of a few ms, a file written this recently may be written
+// again without its mtime changing, so it isn't cached yet.
+constexpr int64_t RECENT_WRITE_NS = 20 * 1000000LL;
+
+enum SlotState : uint32_t {
+  NOT_CACHED = 0,
+  CACHED = 1,
+  TOO_LARGE = 2,
+};
+
+uint64_t fnv1a(const std::vector<std::string> &keys) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const auto &key : keys) {
+    for (char c : key + '\0') {
+      hash = (hash ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+  }
+  return hash;
+}
+
+int64_t mtime_ns(const struct stat &st) {
+  return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+// false once pid exited, even if it wasn't reaped yet
+bool process_alive(pid_t pid) {
+  if (kill(pid, 0) != 0 && errno != EPERM) return false;
+  const std::string stat = util::read_file(util::string_format("/proc/%d/stat", pid));
+  const size_t comm_end = stat.rfind(')');
+  return comm_end == std::string::npos || comm_end + 2 >= stat.size() ||
+         (stat[comm_end + 2] != 'Z' && stat[comm_end + 2] != 'X');
+}
+
+}  // namespace
+
+struct ParamsStore::Header {
+  uint32_t magic;
+  uint32_t num_slots;
+  uint64_t keys_hash;
+  uint64_t dir_dev;
+  uint64_t dir_ino;
+  std::atomic<uint32_t> generation;
+  std::atomic<uint32_t> waiters;
+  uint8_t padding[SLOT_SIZE - 40];
+};
+
+struct ParamsStore::Slot {
+  std::atomic<uint32_t> owner;  // pid of the process that locked the slot, 0 if unlocked
+  std::atomic<uint32_t> seq;    // odd while the slot is being written
+  std::atomic<uint32_t> state;
+  std::atomic<uint32_t> size;
+  uint64_t ino;  // of the file the value was read from, 0 if there was no file
+  int64_t mtime_ns;
+  char data[SLOT_SIZE - 32];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+
+std::shared_ptr<ParamsStore> ParamsStore::open(const std::string &key_path, const std::vector<std::string> &keys) {
+#ifdef __linux__
+  struct stat st;
+  if (stat(key_path.c_str(), &st) != 0) return nullptr;
+
+  static std::mutex lock;
+  static std::map<std::string, std::weak_ptr<ParamsStore>> stores;
+  std::lock_guard lk(lock);
+  if (auto store = stores[key_path].lock()) {
+    if (store->header->dir_dev == st.st_dev && store->header->dir_ino == st.st_ino) {
+      return store;
+    }
+  }
+
+  // keep the stores of a prefix in its shm directory, so they are removed along with it
+  std::string shm_dir = "/dev/shm";
+  if (auto prefix = util::getenv("OPENPILOT_PREFIX", ""); !prefix.empty() && util::file_exists(shm_dir + "/" + prefix)) {
+    shm_dir += "/" + prefix;
+  }
+  const std::string shm_path = util::string_format("%s/.params_store_%016llx", shm_dir.c_str(), (unsigned long long)fnv1a({key_path}));
+  std::shared_ptr<ParamsStore> store(new ParamsStore());
+  if (!store->map(shm_path, keys, st.st_dev, st.st_ino)) {
+    return nullptr;
+  }
+  stores[key_path] = store;
+  return store;
+#else
+  return nullptr;
+#endif
+}
+
+bool ParamsStore::map(const std::string &shm_path, const std::vector<std::string> &keys, uint64_t dir_dev, uint64_t dir_ino) {
+  const uint64_t keys_hash = fnv1a(keys);
+  const size_t size = sizeof(Header) + keys.size() * sizeof(Slot);
+
+  int fd = -1;
+  struct stat fd_st, path_st;
+  while (true) {
+    fd = HANDLE_EINTR(::open(shm_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666));
+    if (fd < 0 || HANDLE_EINTR(flock(fd, LOCK_EX)) < 0) {
+      LOGE("Failed to open params store %s, errno=%d", shm_path.c_str(), errno);
+      if (fd >= 0) close(fd);
+      return false;
+    }
+    // another process may have replaced the file while we were waiting for the lock
+    if (fstat(fd, &fd_st) == 0 && stat(shm_path.c_str(), &path_st) == 0 && fd_st.st_ino == path_st.st_ino) {
+      break;
+    }
+    close(fd);
+  }
+
+  Header existing = {};
+  bool valid = (size_t)fd_st.st_size == size && pread(fd, &existing, offsetof(Header, generation), 0) == offsetof(Header, generation) &&
+               existing.magic == STORE_MAGIC && existing.num_slots == keys.size() && existing.keys_hash == keys_hash &&
+               existing.dir_dev == dir_dev && existing.dir_ino == dir_ino;
+  if (!valid) {
+    // Start over in a new file, processes that mapped the old one keep their copy.
+    unlink(shm_path.c_str());
+    int new_fd = HANDLE_EINTR(::open(shm_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666));
+    if (new_fd < 0 || HANDLE_EINTR(flock(new_fd, LOCK_EX)) < 0 || ftruncate(new_fd, size) != 0) {
+      LOGE("Failed to create params store %s, errno=%d", shm_path.c_str(), errno);
+      if (new_fd >= 0) close(new_fd);
+      close(fd);
+      return false;
+    }
+    close(fd);
+    fd = new_fd;
+  }
+
+  void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr != MAP_FAILED) {
+    header = (Header *)addr;
+    slots = (Slot *)((uint8_t *)addr + sizeof(Header));
+    mapped_size = size;
+    if (!valid) {
+      // the file is zero filled, so every slot starts as not cached
+      header->num_slots = keys.size();
+      header->keys_hash = keys_hash;
+      header->dir_dev = dir_dev;
+      header->dir_ino = dir_ino;
+      std::atomic_thread_fence(std::memory_order_release);
+      header->magic = STORE_MAGIC;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+      slot_index[keys[i]] = i;
+    }
+  } else {
+    LOGE("Failed to map params store %s, errno=%d", shm_path.c_str(), errno);
+  }
+  close(fd);  // also releases the lock
+  return header != nullptr;
+}
+
+ParamsStore::~ParamsStore() {
+  if (header) {
+    munmap(header, mapped_size);
+  }
+}
+
+std::string ParamsStore::get(const std::string &key, const std::string &path) {
+  auto it = slot_index.find(key);
+  if (it == slot_index.end()) return util::read_file(path);
+
+  struct stat st = {};
+  const bool exists = stat(path.c_str(), &st) == 0;
+  Slot &slot = slots[it->second];
+  double locked_ts = 0;
+  std::string value;
+  while (true) {
+    const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      // don't wait on a writer that died with the slot locked
+      if (locked_ts == 0) {
+        locked_ts = millis_since_boot();
+      } else if (millis_since_boot() - locked_ts > STALE_LOCK_MS) {
+        return util::read_file(path);
+      }
+      std::this_thread::yield();
+      continue;
+    }
+
+    const uint32_t state = slot.state.load(std::memory_order_relaxed);
+    const uint32_t size = slot.size.load(std::memory_order_relaxed);
+    const bool matches = state == CACHED && (exists ? slot.ino == st.st_ino && slot.mtime_ns == mtime_ns(st) && size == st.st_size
+                                                    : slot.ino == 0);
+    if (matches) {
+      value.assign(slot.data, std::min<size_t>(size, sizeof(slot.data)));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+    if (matches) return value;
+    if (state == TOO_LARGE) return util::read_file(path);
+
+    // Cache the file along with its inode and mtime, unless the slot is locked or was
+    // written since we looked at it: the file we read may be older than the one a writer
+    // just moved into place.
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    struct stat read_st = {};
+    value.clear();
+    if (int fd = HANDLE_EINTR(::open(path.c_str(), O_RDONLY | O_CLOEXEC)); fd >= 0) {
+      if (fstat(fd, &read_st) == 0) {
+        value.resize(read_st.st_size);
+        ssize_t n = HANDLE_EINTR(pread(fd, value.data(), value.size(), 0));
+        value.resize(std::max<ssize_t>(n, 0));
+      }
+      close(fd);
+      if ((size_t)read_st.st_size != value.size() || now.tv_sec * 1000000000LL + now.tv_nsec - mtime_ns(read_st) < RECENT_WRITE_NS) {
+        return value;
+      }
+    } else if (errno != ENOENT) {
+      return value;
+    }
+
+    uint32_t no_owner = 0;
+    if (slot.owner.compare_exchange_strong(no_owner, getpid(), std::memory_order_acquire)) {
+      if (slot.seq.load(std::memory_order_relaxed) == seq) {
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        writeSlot(slot, seq, value.size() <= sizeof(slot.data) ? CACHED : TOO_LARGE, value, &read_st);
+      } else {
+        slot.owner.store(0, std::memory_order_release);
+      }
+    }
+    return value;
+  }
+}
+
+uint32_t ParamsStore::lockSlot(Slot &slot, double start_ts) {
+  // the owner is the lock, seq is only changed by the process that holds it
+  const uint32_t pid = getpid();
+  while (true) {
+    uint32_t owner = slot.owner.load(std::memory_order_relaxed);
+    if (owner == 0) {
+      if (slot.owner.compare_exchange_weak(owner, pid, std::memory_order_acquire)) break;
+    } else if (millis_since_boot() - start_ts > STALE_LOCK_MS) {
+      if (process_alive(owner)) {
+        util::sleep_for(1);
+        continue;
+      }
+      if (slot.owner.compare_exchange_strong(owner, pid, std::memory_order_acquire)) {
+        LOGW("params store: taking over a slot locked by pid %u, which exited", owner);
+        break;
+      }
+    }
+    std::this_thread::yield();
+  }
+
+  const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+  if (seq & 1) {
+    // the previous owner died in the middle of a write, the slot stays odd until we are done
+    return seq - 1;
+  }
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  return seq;
+}
+
+void ParamsStore::writeSlot(Slot &slot, uint32_t seq, uint32_t state, const std::string &value, const struct stat *st) {
+  std::atomic_thread_fence(std::memory_order_release);
+  if (state == CACHED) {
+    memcpy(slot.data, value.data(), value.size());
+    slot.ino = st->st_ino;
+    slot.mtime_ns = st->st_ino != 0 ? mtime_ns(*st) : 0;
+  }
+  slot.size.store(value.size(), std::memory_order_relaxed);
+  slot.state.store(state, std::memory_order_relaxed);
+  slot.seq.store(seq + 2, std::memory_order_release);
+  slot.owner.store(0, std::memory_order_release);
+}
+
+void ParamsStore::changed(const std::string &key) {
+  if (auto it = slot_index.find(key); it != slot_index.end()) {
+    Slot &slot = slots[it->second];
+    writeSlot(slot, lockSlot(slot, millis_since_boot()), NOT_CACHED);
+  }
+  notify();
+}
+
+void ParamsStore::changed(const std::vector<std::string> &keys, const std::function<void()> &write_files) {
+  // lock in slot order, the same for every writer
+  std::vector<int> locked;
+  for (const auto &key : keys) {
+    if (auto it = slot_index.find(key); it != slot_index.end()) {
+      locked.push_back(it->second);
+    }
+  }
+  std::sort(locked.begin(), locked.end());
+  locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+  const double start_ts = millis_since_boot();
+  std::vector<uint32_t> seqs;
+  seqs.reserve(locked.size());
+  for (int index : locked) {
+    seqs.push_back(lockSlot(slots[index], start_ts));
+  }
+  write_files();
+  for (size_t i = 0; i < locked.size(); ++i) {
+    writeSlot(slots[locked[i]], seqs[i], NOT_CACHED);
+  }
+  notify();
+}
+
+void ParamsStore::invalidate() {
+  for (uint32_t i = 0; i < header->num_slots; ++i) {
+    Slot &slot = slots[i];
+    writeSlot(slot, lockSlot(slot, millis_since_boot()), NOT_CACHED);
+  }
+  notify();
+}
+
+uint32_t ParamsStore::generation() const {
+  return header->generation.load(std::memory_order_acquire);
+}
+
+void ParamsStore::notify() {
+  header->generation.fetch_add(1, std::memory_order_acq_rel);
+#ifdef __linux__
+  if (header->waiters.load(std::memory_order_acquire) > 0) {
+    syscall(SYS_futex, (uint32_t *)&header->generation, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+  }
+#endif
+}
+
+uint32_t ParamsStore::waitForChange(uint32_t generation, int timeout_ms) const {
+#ifdef __linux__
+  if (header->generation.load(std::memory_order_acquire) == generation) {
+    struct timespec ts = {.tv_sec = timeout_ms / 1000, .tv_nsec = (timeout_ms % 1000) * 1000000L};
+    header->waiters.fetch_add(1, std::memory_order_acq_rel);
+    syscall(SYS_futex, (uint32_t *)&header->generation, FUTEX_WAIT, generation, &ts, nullptr, 0);
+    header->waiters.fetch_sub(1, std::memory_order_acq_rel);
+  }
+#endif
+  return header->generation.load(std::memory_order_acquire);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shared memory copy of the values of a params directory, so that reading a param
+// costs a stat instead of opening and reading its file. Every known key has a fixed
+// size slot guarded by a seqlock: readers copy the value without locking and retry if
+// a writer changed it meanwhile. A slot is filled from its file on read, along with the
+// inode, mtime and size of the file, and only used while the file still matches them,
+// so writes that don't go through Params are seen too. Params writes empty the slots
+// they change. Values that don't fit in a slot are always read from their file. Each
+// write bumps a generation counter that readers can wait on.
+class ParamsStore {
+public:
+  // Maps the store of the params directory key_path, creating it if it doesn't exist
+  // or if it was made for another directory or set of keys. Returns nullptr if shared
+  // memory isn't available. Stores are shared by all the Params of a process.
+  static std::shared_ptr<ParamsStore> open(const std::string &key_path, const std::vector<std::string> &keys);
+  ~ParamsStore();
+
+  // Returns the value of key stored in the file at path, from its slot if the file didn't change.
+  std::string get(const std::string &key, const std::string &path);
+  // Empties the slot of key, after Params wrote or removed its file.
+  void changed(const std::string &key);
+  // Empties the slots of several keys at once. They stay locked while write_files runs,
+  // so no reader sees some of the new values without the others.
+  void changed(const std::vector<std::string> &keys, const std::function<void()> &write_files);
+  // Empties every slot.
+  void invalidate();
+
+  uint32_t generation() const;
+  // Blocks until the generation is different from the given one or timeout_ms passed.
+  uint32_t waitForChange(uint32_t generation, int timeout_ms) const;
+
+  static constexpr size_t SLOT_SIZE = 4096;
+
+private:
+  struct Header;
+  struct Slot;
+  ParamsStore() = default;
+  bool map(const std::string &shm_path, const std::vector<std::string> &keys, uint64_t dir_dev, uint64_t dir_ino);
+  uint32_t lockSlot(Slot &slot, double start_ts);
+  void writeSlot(Slot &slot, uint32_t seq, uint32_t state, const std::string &value = {}, const struct stat *st = nullptr);
+  void notify();
+
+  Header *header = nullptr;
+  Slot *slots = nullptr;
+  size_t mapped_size = 0;
+  std::unordered_map<std::string, int> slot_index;
+};
@@ -4,17 +4,306 @@
 
 #include "common/swaglog.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include <zmq.h>
 #include <stdarg.h>
 #include "third_party/json11/json11.hpp"
+#include "common/util.h"
 #include "common/version.h"
 #include "system/hardware/hw.h"
 
+namespace {
+
+constexpr size_t RING_SIZE = 1 << 16;  // bytes per logging thread
+constexpr size_t MAX_ENTRY_SIZE = 4096;
+constexpr size_t MAX_STRING_ARG = 1024;
+constexpr char TRUNCATED_MARKER[] = "...";
+uint32_t NO_FRAME_ID = std::numeric_limits<uint32_t>::max();
+
+// A log call as recorded by the calling thread: fmt is kept as is, the filename and
+// function follow as strings, then the arguments as 8 byte values, or as a length and
+// the characters for strings. Callers may pass a filename and function they free after.
+struct Entry {
+  uint32_t size;  // of the whole entry, 0 marks the unused end of the ring
+  int32_t levelnum;
+  int32_t lineno;
+  uint32_t frame_id;
+  const char *fmt;
+  double created;
+  uint64_t timestamp;  // nanos_since_boot of a LOGT event, 0 for other messages
+};
+
+// One printf conversion of a format string.
+struct FormatSpec {
+  const char *begin, *end;  // from the '%' to past the conversion character
+  std::string flags;
+  int width = -1, precision = -1;
+  bool width_arg = false, precision_arg = false;
+  std::string length;
+  char conversion = 0;
+};
+
+// Advances p to past the next conversion of fmt. Returns false at the end or at a malformed conversion.
+bool next_spec(const char *&p, FormatSpec &spec) {
+  while (*p) {
+    if (*p != '%') { ++p; continue; }
+    if (p[1] == '%') { p += 2; continue; }
+
+    spec = {};
+    spec.begin = p++;
+    while (*p && strchr("-+ #0'", *p)) spec.flags += *p++;
+    if (*p == '*') {
+      spec.width_arg = true;
+      ++p;
+    } else if (isdigit(*p)) {
+      spec.width = strtol(p, (char **)&p, 10);
+    }
+    if (*p == '.') {
+      ++p;
+      if (*p == '*') {
+        spec.precision_arg = true;
+        ++p;
+      } else {
+        spec.precision = strtol(p, (char **)&p, 10);
+      }
+    }
+    while (*p && strchr("hljztL", *p)) spec.length += *p++;
+    if (!*p || !strchr("diuoxXcspnfFeEgGaA", *p)) return false;
+    spec.conversion = *p++;
+    spec.end = p;
+    return true;
+  }
+  return false;
+}
+
+class EntryWriter {
+public:
+  EntryWriter(char *buf) : buf(buf) {}
+  template <typename T>
+  bool put(T val) {
+    static_assert(sizeof(T) == 8);
+    if (size + 8 > MAX_ENTRY_SIZE) return false;
+    memcpy(buf + size, &val, 8);
+    size += 8;
+    return true;
+  }
+  // Strings longer than MAX_STRING_ARG, or than what's left of the entry, end in TRUNCATED_MARKER
+  bool putString(const char *str, int precision) {
+    if (!str) str = "(null)";
+    const size_t max_len = std::min(MAX_STRING_ARG, MAX_ENTRY_SIZE - std::min(MAX_ENTRY_SIZE, size + 8));
+    uint64_t len = strnlen(str, precision >= 0 ? std::min<size_t>(max_len, precision) : max_len);
+    const bool truncated = len == max_len && (precision < 0 || (size_t)precision > max_len) && str[len] != '\0';
+    const size_t marker_len = truncated ? std::min(len, sizeof(TRUNCATED_MARKER) - 1) : 0;
+    if (!put(len)) return false;
+    memcpy(buf + size, str, len - marker_len);
+    memcpy(buf + size + len - marker_len, TRUNCATED_MARKER, marker_len);
+    size += (len + 7) & ~7;
+    return true;
+  }
+  char *buf;
+  size_t size = sizeof(Entry);
+};
+
+// Copies the arguments of fmt, the strings included, so they can be formatted after the call returned.
+void capture_args(EntryWriter &w, const char *fmt, va_list args) {
+  FormatSpec spec;
+  bool ok = true;
+  for (const char *p = fmt; ok && next_spec(p, spec);) {
+    int precision = spec.precision;
+    if (spec.width_arg) ok = w.put((int64_t)va_arg(args, int));
+    if (spec.precision_arg) ok = w.put((int64_t)(precision = va_arg(args, int)));
+    const std::string &l = spec.length;
+    switch (spec.conversion) {
+      case 'd': case 'i':
+        if (l == "hh") ok = w.put((int64_t)(signed char)va_arg(args, int));
+        else if (l == "h") ok = w.put((int64_t)(short)va_arg(args, int));
+        else if (l == "l") ok = w.put((int64_t)va_arg(args, long));
+        else if (l == "ll") ok = w.put((int64_t)va_arg(args, long long));
+        else if (l == "j") ok = w.put((int64_t)va_arg(args, intmax_t));
+        else if (l == "z") ok = w.put((int64_t)va_arg(args, ssize_t));
+        else if (l == "t") ok = w.put((int64_t)va_arg(args, ptrdiff_t));
+        else ok = w.put((int64_t)va_arg(args, int));
+        break;
+      case 'u': case 'o': case 'x': case 'X':
+        if (l == "hh") ok = w.put((uint64_t)(unsigned char)va_arg(args, unsigned int));
+        else if (l == "h") ok = w.put((uint64_t)(unsigned short)va_arg(args, unsigned int));
+        else if (l == "l") ok = w.put((uint64_t)va_arg(args, unsigned long));
+        else if (l == "ll") ok = w.put((uint64_t)va_arg(args, unsigned long long));
+        else if (l == "j") ok = w.put((uint64_t)va_arg(args, uintmax_t));
+        else if (l == "z") ok = w.put((uint64_t)va_arg(args, size_t));
+        else if (l == "t") ok = w.put((uint64_t)va_arg(args, ptrdiff_t));
+        else ok = w.put((uint64_t)va_arg(args, unsigned int));
+        break;
+      case 'c':
+        ok = w.put((int64_t)va_arg(args, int));
+        break;
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        ok = w.put(l == "L" ? (double)va_arg(args, long double) : va_arg(args, double));
+        break;
+      case 's':
+        ok = w.putString(va_arg(args, const char *), precision);
+        break;
+      case 'p':
+        ok = w.put((uint64_t)(uintptr_t)va_arg(args, void *));
+        break;
+      case 'n':
+        va_arg(args, void *);
+        break;
+    }
+  }
+}
+
+// Reads a string captured by EntryWriter::putString at pos, and advances pos past it.
+std::string get_string(const char *data, size_t size, size_t &pos) {
+  uint64_t len = 0;
+  if (pos + 8 <= size) memcpy(&len, data + pos, 8);
+  pos += 8;
+  len = std::min<uint64_t>(len, size - std::min(size, pos));
+  std::string str(data + std::min(size, pos), len);
+  pos += (len + 7) & ~7;
+  return str;
+}
+
+// Formats the arguments of a captured entry, from pos, the way vsnprintf would have
+// formatted the original call.
+std::string format_entry(const char *data, size_t size, size_t pos) {
+  const Entry *e = (const Entry *)data;
+  auto get = [&](auto &val) {
+    if (pos + 8 <= size) memcpy(&val, data + pos, 8);
+    pos += 8;
+  };
+
+  std::string out;
+  char buf[MAX_ENTRY_SIZE + 64];
+  FormatSpec spec;
+  const char *literal = e->fmt;
+  for (const char *p = e->fmt; next_spec(p, spec);) {
+    for (; literal < spec.begin; ++literal) {
+      out += *literal;
+      if (literal[0] == '%' && literal[1] == '%') ++literal;
+    }
+    literal = spec.end;
+
+    int64_t width = spec.width, precision = spec.precision;
+    if (spec.width_arg) get(width);
+    if (spec.precision_arg) get(precision);
+    std::string f = "%" + spec.flags;
+    if (width >= 0) f += std::to_string(width);
+    else if (spec.width_arg) f = "%-" + spec.flags + std::to_string(-width);
+    if (precision >= 0) f += "." + std::to_string(precision);
+
+    int n = 0;
+    switch (spec.conversion) {
+      case 'd': case 'i': {
+        int64_t val = 0;
+        get(val);
+        n = snprintf(buf, sizeof(buf), (f + "ll" + spec.conversion).c_str(), (long long)val);
+        break;
+      }
+      case 'u': case 'o': case 'x': case 'X': {
+        uint64_t val = 0;
+        get(val);
+        n = snprintf(buf, sizeof(buf), (f + "ll" + spec.conversion).c_str(), (unsigned long long)val);
+        break;
+      }
+      case 'c': {
+        int64_t val = 0;
+        get(val);
+        n = snprintf(buf, sizeof(buf), (f + 'c').c_str(), (int)val);
+        break;
+      }
+      case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+        double val = 0;
+        get(val);
+        n = snprintf(buf, sizeof(buf), (f + spec.conversion).c_str(), val);
+        break;
+      }
+      case 's': {
+        const std::string str = get_string(data, size, pos);
+        n = snprintf(buf, sizeof(buf), (f + 's').c_str(), str.c_str());
+        break;
+      }
+      case 'p': {
+        uint64_t val = 0;
+        get(val);
+        n = snprintf(buf, sizeof(buf), (f + 'p').c_str(), (void *)(uintptr_t)val);
+        break;
+      }
+    }
+    out.append(buf, std::clamp<int>(n, 0, sizeof(buf) - 1));
+  }
+  for (; *literal; ++literal) {
+    out += *literal;
+    if (literal[0] == '%' && literal[1] == '%') ++literal;
+  }
+  return out;
+}
+
+// Entries of one logging thread, written by that thread and read by the drain thread.
+struct LogRing {
+  bool push(const char *entry, uint32_t size) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    const uint64_t t = tail.load(std::memory_order_acquire);
+    const size_t pos = h % RING_SIZE, contiguous = RING_SIZE - pos;
+    const size_t needed = size + (contiguous < size ? contiguous : 0);
+    if (RING_SIZE - (h - t) < needed) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (contiguous < size) {
+      memset(buf + pos, 0, sizeof(uint32_t));
+      h += contiguous;
+    }
+    memcpy(buf + h % RING_SIZE, entry, size);
+    head.store(h + size, std::memory_order_release);
+    return true;
+  }
+
+  template <typename F>
+  void pop(F &&callback) {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    const uint64_t h = head.load(std::memory_order_acquire);
+    while (t != h) {
+      const size_t pos = t % RING_SIZE;
+      uint32_t size;
+      memcpy(&size, buf + pos, sizeof(size));
+      if (size == 0) {
+        t += RING_SIZE - pos;
+        continue;
+      }
+      callback(buf + pos, size);
+      t += size;
+    }
+    tail.store(t, std::memory_order_release);
+  }
+
+  alignas(64) std::atomic<uint64_t> head = 0;
+  alignas(64) std::atomic<uint64_t> tail = 0;
+  std::atomic<uint32_t> dropped = 0;
+  std::atomic<bool> closed = false;
+  alignas(8) char buf[RING_SIZE];
+};
+
+}  // namespace
+
 class SwaglogState {
 public:
   SwaglogState() {
@@ -56,17 +345,165 @@ public:
     ctx_j["version"] = COMMA_VERSION;
     ctx_j["dirty"] = !getenv("CLEAN");
     ctx_j["device"] = Hardware::get_name();
+
+    // the drain thread doesn't exist in a forked child
+    sync = getenv("SWAGLOG_SYNC");
+    pthread_atfork(nullptr, nullptr, []() { instance().sync = true; });
+    if (!sync) {
+      drain_thread = std::thread(&SwaglogState::drainThread, this);
+    }
   }
 
   ~SwaglogState() {
+    if (drain_thread.joinable()) {
+      do_exit = true;
+      wake();
+      drain_thread.join();
+    }
     zmq_close(sock);
     zmq_ctx_destroy(zctx);
   }
 
-  void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const std::string& log_s) {
-    std::lock_guard lk(lock);
-    if (levelnum >= print_level) {
-      printf("%s: %s\n", filename, msg);
+  static SwaglogState &instance() {
+    static SwaglogState s;
+    return s;
+  }
+
+  void log(const char *entry, uint32_t size) {
+    if (sync) {
+      std::lock_guard lk(lock);
+      send(entry, size);
+      return;
+    }
+    if (((const Entry *)entry)->levelnum >= CLOUDLOG_ERROR) {
+      // errors are often the last thing logged before an abort, so they are sent before
+      // returning, after everything that was logged before them
+      std::lock_guard lk(lock);
+      drain();
+      send(entry, size);
+      return;
+    }
+
+    thread_local RingHolder holder;
+    if (!holder.ring) {
+      holder.ring = std::make_shared<LogRing>();
+      std::lock_guard lk(rings_lock);
+      rings.push_back(holder.ring);
+    }
+    holder.ring->push(entry, size);
+
+    // wake up the drain thread if it's waiting for new entries
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pending.load(std::memory_order_relaxed) == 0 && pending.exchange(1) == 0) {
+      wake();
+    }
+  }
+
+private:
+  struct RingHolder {
+    ~RingHolder() {
+      if (ring) ring->closed = true;
+    }
+    std::shared_ptr<LogRing> ring;
+  };
+
+  void wake() {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *)&pending, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+  }
+
+  void drainThread() {
+    while (true) {
+      const bool exiting = do_exit;
+      pending.store(0);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      {
+        std::lock_guard lk(lock);
+        drain();
+      }
+
+      if (exiting) break;
+#ifdef __linux__
+      if (pending.load() == 0) {
+        struct timespec ts = {.tv_sec = 1, .tv_nsec = 0};
+        syscall(SYS_futex, (uint32_t *)&pending, FUTEX_WAIT, 0, &ts, nullptr, 0);
+      }
+#else
+      util::sleep_for(10);
+#endif
+    }
+  }
+
+  // Sends the entries of all rings. Call with lock held, it is the only reader of the rings.
+  void drain() {
+    {
+      std::lock_guard lk(rings_lock);
+      // rings of threads that are gone are dropped once they are empty
+      rings.erase(std::remove_if(rings.begin(), rings.end(), [](auto &r) {
+        return r->closed && r->head.load(std::memory_order_acquire) == r->tail.load(std::memory_order_relaxed);
+      }), rings.end());
+      drained = rings;
+    }
+
+    // messages of different threads are sent in the order they were logged
+    uint32_t dropped = 0;
+    for (auto &ring : drained) {
+      ring->pop([&](const char *entry, uint32_t size) {
+        messages.emplace_back(((const Entry *)entry)->created, std::string(entry, size));
+      });
+      dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    std::stable_sort(messages.begin(), messages.end(), [](auto &a, auto &b) { return a.first < b.first; });
+    for (auto &[_, entry] : messages) {
+      send(entry.data(), entry.size());
+    }
+    messages.clear();
+    if (dropped > 0) {
+      alignas(8) char entry[MAX_ENTRY_SIZE];
+      EntryWriter w(entry);
+      w.putString(__FILE__, -1);
+      w.putString(__func__, -1);
+      w.put((uint64_t)dropped);
+      *(Entry *)entry = {(uint32_t)w.size, CLOUDLOG_WARNING, __LINE__, NO_FRAME_ID,
+                         "swaglog: %lu messages dropped", seconds_since_epoch(), 0};
+      send(entry, w.size);
+    }
+  }
+
+  void send(const char *data, uint32_t size) {
+    const Entry *e = (const Entry *)data;
+    size_t pos = sizeof(Entry);
+    const std::string filename = get_string(data, size, pos);
+    const std::string func = get_string(data, size, pos);
+    const std::string msg = format_entry(data, size, pos);
+
+    json11::Json::object log_j = json11::Json::object {
+      {"ctx", ctx_j},
+      {"levelnum", e->levelnum},
+      {"filename", filename},
+      {"lineno", e->lineno},
+      {"funcname", func},
+      {"created", e->created}
+    };
+    if (e->timestamp == 0) {
+      log_j["msg"] = msg;
+    } else {
+      json11::Json::object tspt_j = json11::Json::object{
+        {"event", msg},
+        {"time", std::to_string(e->timestamp)}
+      };
+      if (e->frame_id < NO_FRAME_ID) {
+        tspt_j["frame_id"] = std::to_string(e->frame_id);
+      }
+      log_j["msg"] = json11::Json::object{{"timestamp", tspt_j}};
+    }
+
+    std::string log_s;
+    log_s += (char)e->levelnum;
+    ((json11::Json)log_j).dump(log_s);
+    if (e->levelnum >= print_level) {
+      printf("%s: %s\n", filename.c_str(), msg.c_str());
     }
     zmq_send(sock, log_s.data(), log_s.length(), ZMQ_NOBLOCK);
   }
@@ -76,63 +513,43 @@ public:
   void* sock = nullptr;
   int print_level;
   json11::Json::object ctx_j;
+
+  bool sync = false;
+  std::atomic<bool> do_exit = false;
+  std::atomic<uint32_t> pending = 0;
+  std::mutex rings_lock;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  // used by drain(), with lock held
+  std::vector<std::shared_ptr<LogRing>> drained;
+  std::vector<std::pair<double, std::string>> messages;
+  std::thread drain_thread;
 };
 
 bool LOG_TIMESTAMPS = getenv("LOG_TIMESTAMPS");
-uint32_t NO_FRAME_ID = std::numeric_limits<uint32_t>::max();
 
 static void cloudlog_common(int levelnum, const char* filename, int lineno, const char* func,
-                            char* msg_buf, const json11::Json::object &msg_j={}) {
-  static SwaglogState s;
-
-  json11::Json::object log_j = json11::Json::object {
-    {"ctx", s.ctx_j},
-    {"levelnum", levelnum},
-    {"filename", filename},
-    {"lineno", lineno},
-    {"funcname", func},
-    {"created", seconds_since_epoch()}
-  };
-  if (msg_j.empty()) {
-    log_j["msg"] = msg_buf;
-  } else {
-    log_j["msg"] = msg_j;
-  }
-
-  std::string log_s;
-  log_s += (char)levelnum;
-  ((json11::Json)log_j).dump(log_s);
-  s.log(levelnum, filename, lineno, func, msg_buf, log_s);
-
-  free(msg_buf);
+                            uint32_t frame_id, uint64_t timestamp, const char* fmt, va_list args) {
+  alignas(8) char entry[MAX_ENTRY_SIZE];
+  EntryWriter w(entry);
+  w.putString(filename, -1);
+  w.putString(func, -1);
+  capture_args(w, fmt, args);
+  *(Entry *)entry = {(uint32_t)w.size, levelnum, lineno, frame_id, fmt, seconds_since_epoch(), timestamp};
+  SwaglogState::instance().log(entry, w.size);
 }
 
 void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
                 const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  char* msg_buf = nullptr;
-  int ret = vasprintf(&msg_buf, fmt, args);
+  cloudlog_common(levelnum, filename, lineno, func, NO_FRAME_ID, 0, fmt, args);
   va_end(args);
-  if (ret <= 0 || !msg_buf) return;
-  cloudlog_common(levelnum, filename, lineno, func, msg_buf);
 }
 
 void cloudlog_t_common(int levelnum, const char* filename, int lineno, const char* func,
                        uint32_t frame_id, const char* fmt, va_list args) {
   if (!LOG_TIMESTAMPS) return;
-  char* msg_buf = nullptr;
-  int ret = vasprintf(&msg_buf, fmt, args);
-  if (ret <= 0 || !msg_buf) return;
-  json11::Json::object tspt_j = json11::Json::object{
-    {"event", msg_buf},
-    {"time", std::to_string(nanos_since_boot())}
-  };
-  if (frame_id < NO_FRAME_ID) {
-    tspt_j["frame_id"] = std::to_string(frame_id);
-  }
-  tspt_j = json11::Json::object{{"timestamp", tspt_j}};
-  cloudlog_common(levelnum, filename, lineno, func, msg_buf, tspt_j);
+  cloudlog_common(levelnum, filename, lineno, func, frame_id, nanos_since_boot(), fmt, args);
 }
 
 
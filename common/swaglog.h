@@ -15,6 +15,12 @@
 #define SWAG_LOG_CHECK_FMT(a, b)
 #endif
 
+// Log calls only copy fmt and the arguments into a ring of the calling thread, a
+// background thread formats and sends them. fmt is kept by pointer, so it must be a
+// string literal. The filename, func and string arguments are copied, strings longer
+// than 1 KiB are cut off and end in "...". Errors and critical messages are sent from
+// the calling thread before the call returns, along with everything logged before them.
+// Run with SWAGLOG_SYNC=1 to send every message from the calling thread.
 void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
                 const char* fmt, ...) SWAG_LOG_CHECK_FMT(5, 6);
 
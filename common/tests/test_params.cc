@@ -1,6 +1,12 @@
+#include <sys/wait.h>
+
+#include <csignal>
+#include <random>
+
 #include "catch2/catch.hpp"
 #define private public
 #include "common/params.h"
+#include "common/params_store.h"
 #include "common/util.h"
 
 TEST_CASE("params_nonblocking_put") {
@@ -25,3 +31,186 @@ TEST_CASE("params_nonblocking_put") {
     REQUIRE(p.get(name) == "1");
   }
 }
+
+TEST_CASE("params_nonblocking_commit") {
+  char tmp_path[] = "/tmp/asyncWriter_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  {
+    Params params(param_path);
+    params.putBool("IsMetric", true);
+    params.putNonBlocking("CarParams", "1");
+    ParamsTransaction txn;
+    txn.put("CarParams", "2");
+    txn.put("DongleId", "2");
+    txn.remove("IsMetric");
+    params.commitNonBlocking(txn);
+  }
+  // written in order, after the put
+  Params p(param_path);
+  REQUIRE(p.get("CarParams") == "2");
+  REQUIRE(p.get("DongleId") == "2");
+  REQUIRE(p.get("IsMetric").empty());
+}
+
+TEST_CASE("params_store") {
+  char tmp_path[] = "/tmp/paramsStore_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  Params writer(param_path), reader(param_path);
+  REQUIRE(writer.store != nullptr);
+  REQUIRE(writer.store == reader.store);
+
+  SECTION("reads what was written") {
+    REQUIRE(reader.get("CarParams").empty());
+    uint32_t gen = reader.generation();
+    writer.put("CarParams", "1");
+    REQUIRE(reader.generation() != gen);
+    REQUIRE(reader.get("CarParams") == "1");
+    writer.remove("CarParams");
+    REQUIRE(reader.get("CarParams").empty());
+  }
+
+  SECTION("values larger than a slot are read from the file") {
+    std::string large(ParamsStore::SLOT_SIZE * 2, 'x');
+    writer.put("CarParams", large);
+    REQUIRE(reader.get("CarParams") == large);
+  }
+
+  SECTION("sees files changed without Params") {
+    writer.put("IsMetric", "0");
+    util::sleep_for(50);  // old enough to be cached
+    REQUIRE(reader.get("IsMetric") == "0");
+    // rewritten in place, the size stays the same
+    util::write_file(writer.getParamPath("IsMetric").c_str(), (void *)"1", 1);
+    REQUIRE(reader.get("IsMetric") == "1");
+    // replaced right after, in the same tick of the file times
+    util::write_file(writer.getParamPath("IsMetric").c_str(), (void *)"2", 1);
+    REQUIRE(reader.get("IsMetric") == "2");
+    unlink(writer.getParamPath("IsMetric").c_str());
+    REQUIRE(reader.get("IsMetric").empty());
+    util::write_file(writer.getParamPath("IsMetric").c_str(), (void *)"3", 1, O_WRONLY | O_CREAT);
+    REQUIRE(reader.get("IsMetric") == "3");
+  }
+
+  SECTION("waitForChange wakes up on put") {
+    uint32_t gen = reader.generation();
+    auto wait = std::async(std::launch::async, [&]() { return reader.waitForChange(gen, 5000); });
+    util::sleep_for(50);
+    writer.putBool("IsMetric", true);
+    REQUIRE(wait.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+    REQUIRE(wait.get() != gen);
+  }
+
+  SECTION("a slot is only taken over once its owner exited") {
+    int locked[2];
+    REQUIRE(pipe(locked) == 0);
+    pid_t pid = fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+      // the slots of a transaction stay locked while its files are written
+      writer.store->changed({"IsMetric"}, [&]() {
+        (void)write(locked[1], "1", 1);
+        pause();
+      });
+    }
+    char c;
+    REQUIRE(read(locked[0], &c, 1) == 1);
+
+    auto put = std::async(std::launch::async, [&]() { writer.put("IsMetric", "1"); });
+    CHECK(put.wait_for(std::chrono::milliseconds(500)) == std::future_status::timeout);
+    // not reaped yet
+    kill(pid, SIGKILL);
+    REQUIRE(put.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+    waitpid(pid, nullptr, 0);
+    REQUIRE(reader.get("IsMetric") == "1");
+    close(locked[0]);
+    close(locked[1]);
+  }
+}
+
+TEST_CASE("params_transaction") {
+  char tmp_path[] = "/tmp/paramsTransaction_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  const std::vector<std::string> group = {"AlwaysOnDM", "BootCount", "DongleId", "GitBranch", "IsMetric"};
+  // the last value doesn't fit in a store slot
+  auto make_transaction = [&](int i) {
+    ParamsTransaction txn;
+    for (const auto &key : group) {
+      txn.put(key, std::to_string(i));
+    }
+    txn.put("CarParams", std::string(ParamsStore::SLOT_SIZE * 2, '0' + i % 10));
+    return txn;
+  };
+  auto require_consistent = [&](Params &params) {
+    const std::string first = params.get(group[0]);
+    for (const auto &key : group) {
+      REQUIRE(params.get(key) == first);
+    }
+    const std::string car_params = params.get("CarParams");
+    REQUIRE(car_params == (first.empty() ? "" : std::string(ParamsStore::SLOT_SIZE * 2, first.back())));
+  };
+
+  SECTION("commit writes and removes") {
+    Params params(param_path);
+    REQUIRE(params.commit(make_transaction(1)) == 0);
+    require_consistent(params);
+    REQUIRE(params.get("IsMetric") == "1");
+
+    ParamsTransaction txn;
+    txn.remove("IsMetric");
+    txn.putBool("LongitudinalPersonality", true);
+    REQUIRE(params.commit(txn) == 0);
+    REQUIRE(params.get("IsMetric").empty());
+    REQUIRE(params.get("LongitudinalPersonality") == "1");
+    REQUIRE(!util::file_exists(params.journalPath()));
+  }
+
+  SECTION("all or nothing when killed in the middle of a commit") {
+    std::mt19937 rng(0);
+    for (int run = 0; run < 20; ++run) {
+      pid_t pid = fork();
+      REQUIRE(pid >= 0);
+      if (pid == 0) {
+        Params params(param_path);
+        for (int i = 0;; ++i) {
+          params.commit(make_transaction(i));
+        }
+      }
+      util::sleep_for(std::uniform_int_distribution<int>(5, 50)(rng));
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+
+      // the next write finishes the interrupted transaction
+      Params params(param_path);
+      params.remove("GithubUsername");
+      REQUIRE(!util::file_exists(params.journalPath()));
+      require_consistent(params);
+      params.invalidate();
+      require_consistent(params);
+    }
+  }
+}
+
+TEST_CASE("params_store_benchmark", "[.][benchmark]") {
+  char tmp_path[] = "/tmp/paramsBenchmark_XXXXXX";
+  const std::string param_path = mkdtemp(tmp_path);
+  Params params(param_path);
+  const auto keys = params.allKeys();
+  for (const auto &key : keys) {
+    params.put(key, "1");
+  }
+
+  BENCHMARK("read all keys from files") {
+    size_t n = 0;
+    for (const auto &key : keys) {
+      n += util::read_file(params.getParamPath(key)).size();
+    }
+    return n;
+  };
+  BENCHMARK("read all keys from the store") {
+    size_t n = 0;
+    for (const auto &key : keys) {
+      n += params.get(key).size();
+    }
+    return n;
+  };
+}
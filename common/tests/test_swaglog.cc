@@ -1,5 +1,6 @@
 #include <zmq.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include "catch2/catch.hpp"
@@ -86,3 +87,115 @@ TEST_CASE("swaglog") {
 
   recv_log(thread_cnt, thread_msg_cnt);
 }
+
+std::vector<json11::Json> recv_msgs(const std::string &funcname, size_t count) {
+  void *zctx = zmq_ctx_new();
+  void *sock = zmq_socket(zctx, ZMQ_PULL);
+  zmq_bind(sock, Path::swaglog_ipc().c_str());
+  std::vector<json11::Json> msgs;
+  for (auto start = std::chrono::steady_clock::now();
+       msgs.size() < count && std::chrono::steady_clock::now() < start + std::chrono::seconds{1};) {
+    char buf[4096] = {};
+    if (zmq_recv(sock, buf, sizeof(buf), ZMQ_DONTWAIT) <= 0) continue;
+    std::string err;
+    auto msg = json11::Json::parse(buf + 1, err);
+    if (msg["funcname"].string_value() == funcname) {
+      msgs.push_back(msg);
+    }
+  }
+  zmq_close(sock);
+  zmq_ctx_destroy(zctx);
+  return msgs;
+}
+
+TEST_CASE("swaglog formats the arguments after the call") {
+  std::vector<std::string> expected;
+  char str[] = "string argument";
+#define LOG_AND_FORMAT(fmt, ...)                                       \
+  LOGD(fmt, ## __VA_ARGS__);                                           \
+  expected.push_back(util::string_format(fmt, ## __VA_ARGS__));
+
+  LOG_AND_FORMAT("no arguments, 100%% literal");
+  LOG_AND_FORMAT("%d %i %5d %-5d| %+d %05d", -1, 2, 3, 4, 5, -6);
+  LOG_AND_FORMAT("%u %x %X %#o %lu %llx %zu", 1u, 255u, 255u, 8u, (unsigned long)-1, (unsigned long long)-1, (size_t)42);
+  LOG_AND_FORMAT("%hhd %hd %ld %lld %jd %zd %td", (signed char)-3, (short)-300, -1l, -1ll, (intmax_t)-7, (ssize_t)-8, (ptrdiff_t)-9);
+  LOG_AND_FORMAT("%f %.2f %10.3e %g %G %a %Lf", 3.14159, 2.5, 12345.678, 1e-10, 1e20, 1.0, (long double)0.5);
+  LOG_AND_FORMAT("%s|%10s|%-10s|%.3s|%*s|%.*s|%c", str, "abc", "abc", "abcdef", 6, "ab", 2, "abcdef", 'x');
+  LOG_AND_FORMAT("%*d|%-*d|%*.*f", -5, 1, 4, 2, 8, 2, 1.5);
+  LOG_AND_FORMAT("%s", std::string(2000, 'x').c_str());
+#undef LOG_AND_FORMAT
+  // strings are copied when logging
+  strcpy(str, "overwritten");
+
+  auto msgs = recv_msgs(__func__, expected.size());
+  REQUIRE(msgs.size() == expected.size());
+  for (size_t i = 0; i < msgs.size(); ++i) {
+    INFO("message " << i);
+    if (i == msgs.size() - 1) {
+      // long strings are truncated, and marked
+      REQUIRE(msgs[i]["msg"].string_value() == std::string(1021, 'x') + "...");
+    } else {
+      REQUIRE(msgs[i]["msg"].string_value() == expected[i]);
+    }
+  }
+}
+
+TEST_CASE("swaglog copies the filename and function") {
+  // like the Qt message handler, which passes strings it frees right after
+  {
+    std::string file = "qt_file.cc", function = "qt_function";
+    cloudlog_e(CLOUDLOG_DEBUG, file.c_str(), 42, function.c_str(), "%s", "from qt");
+    file.assign(file.size(), '?');
+    function.assign(function.size(), '?');
+  }
+
+  auto msgs = recv_msgs("qt_function", 1);
+  REQUIRE(msgs.size() == 1);
+  REQUIRE(msgs[0]["filename"].string_value() == "qt_file.cc");
+  REQUIRE(msgs[0]["lineno"].int_value() == 42);
+  REQUIRE(msgs[0]["msg"].string_value() == "from qt");
+}
+
+TEST_CASE("swaglog sends errors after what was logged before them") {
+  auto log_thread = [](int n, bool error) {
+    for (int i = 0; i < n; ++i) {
+      LOGD("%d", i);
+    }
+    if (error) LOGE("%d", n);
+  };
+  std::thread(log_thread, 100, false).join();
+  log_thread(100, true);
+
+  auto msgs = recv_msgs("operator()", 201);
+  REQUIRE(msgs.size() == 201);
+  REQUIRE(msgs.back()["levelnum"].int_value() == CLOUDLOG_ERROR);
+  REQUIRE(msgs.back()["msg"].string_value() == "100");
+}
+
+TEST_CASE("swaglog_benchmark", "[.][benchmark]") {
+  const int msg_cnt = 100000;
+  for (int thread_cnt : {1, 4, 8}) {
+    std::vector<std::vector<uint64_t>> latencies(thread_cnt, std::vector<uint64_t>(msg_cnt));
+    std::vector<std::thread> threads;
+    const uint64_t start = nanos_since_boot();
+    for (int i = 0; i < thread_cnt; ++i) {
+      threads.emplace_back([&latencies, i]() {
+        for (int j = 0; j < msg_cnt; ++j) {
+          const uint64_t t = nanos_since_boot();
+          LOGD("thread %d message %d value %.3f name %s", i, j, j * 0.5, "benchmark");
+          latencies[i][j] = nanos_since_boot() - t;
+        }
+      });
+    }
+    for (auto &t : threads) t.join();
+    const double seconds = (nanos_since_boot() - start) * 1e-9;
+
+    std::vector<uint64_t> all;
+    for (auto &l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, size_t(p * all.size()))]; };
+    printf("%d threads: %.0f msgs/s, latency p50 %lu ns, p99 %lu ns, p99.9 %lu ns, max %lu ns\n",
+           thread_cnt, all.size() / seconds, percentile(0.5), percentile(0.99), percentile(0.999), all.back());
+    util::sleep_for(500);  // let the drain thread catch up
+  }
+}
@@ -2,8 +2,10 @@
 
 #include "common/transformations/coordinates.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <iostream>
 #include <eigen3/Eigen/Dense>
 
 double a = 6378137; // lgtm [cpp/short-global-name]
@@ -11,6 +13,21 @@ double b = 6356752.3142; // lgtm [cpp/short-global-name]
 double esq = 6.69437999014 * 0.001; // lgtm [cpp/short-global-name]
 double e1sq = 6.73949674228 * 0.001;
 
+// Batches are transformed in blocks of columns small enough for their intermediates to stay on the stack
+static constexpr Eigen::Index BLOCK_SIZE = 64;
+typedef Eigen::Array<double, 1, Eigen::Dynamic, Eigen::RowMajor, 1, BLOCK_SIZE> Row;
+typedef Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::ColMajor, 3, BLOCK_SIZE> Block;
+
+// In one loop, for the compiler to take both with a single sincos
+static void sin_cos(const Row &x, Row &sin_x, Row &cos_x) {
+  sin_x.resize(x.size());
+  cos_x.resize(x.size());
+  for (Eigen::Index i = 0; i < x.size(); ++i) {
+    sin_x(i) = sin(x(i));
+    cos_x(i) = cos(x(i));
+  }
+}
+
 
 static Geodetic to_degrees(Geodetic geodetic){
   geodetic.lat = RAD2DEG(geodetic.lat);
@@ -27,7 +44,7 @@ static Geodetic to_radians(Geodetic geodetic){
 
 ECEF geodetic2ecef(Geodetic g){
   g = to_radians(g);
-  double xi = sqrt(1.0 - esq * pow(sin(g.lat), 2));
+  double xi = sqrt(1.0 - esq * sin(g.lat) * sin(g.lat));
   double x = (a / xi + g.alt) * cos(g.lat) * cos(g.lon);
   double y = (a / xi + g.alt) * cos(g.lat) * sin(g.lon);
   double z = (a / xi * (1.0 - esq) + g.alt) * sin(g.lat);
@@ -61,6 +78,59 @@ Geodetic ecef2geodetic(ECEF e){
   return to_degrees({lat, lon, h});
 }
 
+void geodetic2ecef(const Eigen::Ref<const Eigen::Matrix3Xd> &geodetic, Eigen::Ref<Eigen::Matrix3Xd> ecef) {
+  assert(geodetic.cols() == ecef.cols());
+  for (Eigen::Index i = 0; i < geodetic.cols(); i += BLOCK_SIZE) {
+    const Eigen::Index n = std::min(BLOCK_SIZE, geodetic.cols() - i);
+    const Row lat = geodetic.block(0, i, 1, n).array() * M_PI / 180.0;
+    const Row lon = geodetic.block(1, i, 1, n).array() * M_PI / 180.0;
+    const Row alt = geodetic.block(2, i, 1, n).array();
+
+    Row sin_lat, cos_lat, sin_lon, cos_lon;
+    sin_cos(lat, sin_lat, cos_lat);
+    sin_cos(lon, sin_lon, cos_lon);
+    const Row xi = (1.0 - esq * sin_lat * sin_lat).sqrt();
+    ecef.block(0, i, 1, n) = ((a / xi + alt) * cos_lat * cos_lon).matrix();
+    ecef.block(1, i, 1, n) = ((a / xi + alt) * cos_lat * sin_lon).matrix();
+    ecef.block(2, i, 1, n) = ((a / xi * (1.0 - esq) + alt) * sin_lat).matrix();
+  }
+}
+
+void ecef2geodetic(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef, Eigen::Ref<Eigen::Matrix3Xd> geodetic) {
+  // Ferrari's solution as above, closed form with no iterations. The latitude is taken
+  // with atan2 to also be defined on the polar axis.
+  assert(ecef.cols() == geodetic.cols());
+  const double Esq = a * a - b * b;
+  for (Eigen::Index i = 0; i < ecef.cols(); i += BLOCK_SIZE) {
+    const Eigen::Index n = std::min(BLOCK_SIZE, ecef.cols() - i);
+    const Row x = ecef.block(0, i, 1, n).array();
+    const Row y = ecef.block(1, i, 1, n).array();
+    const Row z = ecef.block(2, i, 1, n).array();
+
+    const Row r2 = x * x + y * y;
+    const Row r = r2.sqrt();
+    const Row z2 = z * z;
+    const Row F = 54 * b * b * z2;
+    const Row G = r2 + (1 - esq) * z2 - esq * Esq;
+    const Row C = (esq * esq * F * r2) / (G * G * G);
+    const Row S = (1.0 + C + (C * C + 2.0 * C).sqrt()).unaryExpr([](double v) { return std::cbrt(v); });
+    const Row P = F / (3.0 * (S + 1.0 / S + 1.0).square() * G * G);
+    const Row Q = (1.0 + 2 * esq * esq * P).sqrt();
+    const Row r_0 = -(P * esq * r) / (1.0 + Q) + (0.5 * a * a * (1.0 + 1.0 / Q) - P * (1 - esq) * z2 / (Q * (1.0 + Q)) - 0.5 * P * r2).sqrt();
+    const Row t = (r - esq * r_0).square();
+    const Row U = (t + z2).sqrt();
+    const Row V = (t + (1 - esq) * z2).sqrt();
+    const Row Z_0 = b * b * z / (a * V);
+    const Row h = U * (1.0 - b * b / (a * V));
+
+    const Row lat = (z + e1sq * Z_0).binaryExpr(r, [](double num, double den) { return std::atan2(num, den); });
+    const Row lon = y.binaryExpr(x, [](double num, double den) { return std::atan2(num, den); });
+    geodetic.block(0, i, 1, n) = (lat * 180.0 / M_PI).matrix();
+    geodetic.block(1, i, 1, n) = (lon * 180.0 / M_PI).matrix();
+    geodetic.block(2, i, 1, n) = h.matrix();
+  }
+}
+
 LocalCoord::LocalCoord(Geodetic g, ECEF e){
   init_ecef <<  e.x, e.y, e.z;
 
@@ -98,3 +168,31 @@ Geodetic LocalCoord::ned2geodetic(NED n){
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+void LocalCoord::ecef2ned(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef, Eigen::Ref<Eigen::Matrix3Xd> ned) const {
+  assert(ecef.cols() == ned.cols());
+  for (Eigen::Index i = 0; i < ecef.cols(); i += BLOCK_SIZE) {
+    const Eigen::Index n = std::min(BLOCK_SIZE, ecef.cols() - i);
+    const Block offset = ecef.middleCols(i, n).colwise() - init_ecef;
+    ned.middleCols(i, n).noalias() = ecef2ned_matrix.lazyProduct(offset);
+  }
+}
+
+void LocalCoord::ned2ecef(const Eigen::Ref<const Eigen::Matrix3Xd> &ned, Eigen::Ref<Eigen::Matrix3Xd> ecef) const {
+  assert(ned.cols() == ecef.cols());
+  for (Eigen::Index i = 0; i < ned.cols(); i += BLOCK_SIZE) {
+    const Eigen::Index n = std::min(BLOCK_SIZE, ned.cols() - i);
+    const Block rotated = ned2ecef_matrix.lazyProduct(ned.middleCols(i, n));
+    ecef.middleCols(i, n) = rotated.colwise() + init_ecef;
+  }
+}
+
+void LocalCoord::geodetic2ned(const Eigen::Ref<const Eigen::Matrix3Xd> &geodetic, Eigen::Ref<Eigen::Matrix3Xd> ned) const {
+  ::geodetic2ecef(geodetic, ned);
+  ecef2ned(ned, ned);
+}
+
+void LocalCoord::ned2geodetic(const Eigen::Ref<const Eigen::Matrix3Xd> &ned, Eigen::Ref<Eigen::Matrix3Xd> geodetic) const {
+  ned2ecef(ned, geodetic);
+  ::ecef2geodetic(geodetic, geodetic);
+}
@@ -27,6 +27,11 @@ struct Geodetic {
 ECEF geodetic2ecef(Geodetic g);
 Geodetic ecef2geodetic(ECEF e);
 
+// Batch versions over the columns of 3 x n matrices, the layout of (n, 3) row-major arrays.
+// Geodetic columns are (lat, lon, alt) in degrees. The output may be the input.
+void geodetic2ecef(const Eigen::Ref<const Eigen::Matrix3Xd> &geodetic, Eigen::Ref<Eigen::Matrix3Xd> ecef);
+void ecef2geodetic(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef, Eigen::Ref<Eigen::Matrix3Xd> geodetic);
+
 class LocalCoord {
 public:
   Eigen::Matrix3d ned2ecef_matrix;
@@ -40,4 +45,9 @@ public:
   ECEF ned2ecef(NED n);
   NED geodetic2ned(Geodetic g);
   Geodetic ned2geodetic(NED n);
+
+  void ecef2ned(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef, Eigen::Ref<Eigen::Matrix3Xd> ned) const;
+  void ned2ecef(const Eigen::Ref<const Eigen::Matrix3Xd> &ned, Eigen::Ref<Eigen::Matrix3Xd> ecef) const;
+  void geodetic2ned(const Eigen::Ref<const Eigen::Matrix3Xd> &geodetic, Eigen::Ref<Eigen::Matrix3Xd> ned) const;
+  void ned2geodetic(const Eigen::Ref<const Eigen::Matrix3Xd> &ned, Eigen::Ref<Eigen::Matrix3Xd> geodetic) const;
 };
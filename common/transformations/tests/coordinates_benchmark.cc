@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+#include "common/timing.h"
+#include "common/transformations/coordinates.hpp"
+
+// Transforms points all over the globe one at a time and in a batch, and reports the time
+// per point and the largest difference between the two.
+//
+// usage: coordinates_benchmark [points]   (a million by default)
+
+static void run(const char *name, const Eigen::Matrix3Xd &in, std::function<Eigen::Vector3d(const Eigen::Vector3d &)> single,
+                std::function<void(const Eigen::Matrix3Xd &, Eigen::Matrix3Xd &)> batch) {
+  Eigen::Matrix3Xd out_single(3, in.cols()), out_batch(3, in.cols());
+
+  uint64_t start = nanos_since_boot();
+  for (Eigen::Index i = 0; i < in.cols(); ++i) {
+    out_single.col(i) = single(in.col(i));
+  }
+  const uint64_t single_ns = nanos_since_boot() - start;
+
+  start = nanos_since_boot();
+  batch(in, out_batch);
+  const uint64_t batch_ns = nanos_since_boot() - start;
+
+  const Eigen::Vector3d diff = (out_single - out_batch).cwiseAbs().rowwise().maxCoeff();
+  printf("%-14s %8.1f %8.1f %8.2fx  %9.3g %9.3g %9.3g\n", name, double(single_ns) / in.cols(), double(batch_ns) / in.cols(),
+         double(single_ns) / batch_ns, diff(0), diff(1), diff(2));
+}
+
+int main(int argc, char *argv[]) {
+  const int n = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> lat(-90, 90), lon(-180, 180), alt(-500, 50000);
+  Eigen::Matrix3Xd geodetic(3, n);
+  for (int i = 0; i < n; ++i) {
+    geodetic.col(i) << lat(gen), lon(gen), alt(gen);
+  }
+  Eigen::Matrix3Xd ecef(3, n);
+  geodetic2ecef(geodetic, ecef);
+
+  LocalCoord local(Geodetic{37.7610403, -122.4778699, 115});
+  Eigen::Matrix3Xd ned(3, n);
+  local.ecef2ned(ecef, ned);
+
+  printf("%d points\n%-14s %8s %8s %9s  %9s %9s %9s\n", n, "", "single", "batch", "", "max diff", "", "");
+  run("geodetic2ecef", geodetic, [](const Eigen::Vector3d &g) { return geodetic2ecef(Geodetic{g(0), g(1), g(2)}).to_vector(); },
+      [](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { geodetic2ecef(in, out); });
+  run("ecef2geodetic", ecef, [](const Eigen::Vector3d &e) {
+        Geodetic g = ecef2geodetic(ECEF{e(0), e(1), e(2)});
+        return Eigen::Vector3d(g.lat, g.lon, g.alt);
+      },
+      [](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { ecef2geodetic(in, out); });
+  run("ecef2ned", ecef, [&](const Eigen::Vector3d &e) { return local.ecef2ned(ECEF{e(0), e(1), e(2)}).to_vector(); },
+      [&](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { local.ecef2ned(in, out); });
+  run("ned2ecef", ned, [&](const Eigen::Vector3d &v) { return local.ned2ecef(NED{v(0), v(1), v(2)}).to_vector(); },
+      [&](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { local.ned2ecef(in, out); });
+  run("geodetic2ned", geodetic, [&](const Eigen::Vector3d &g) { return local.geodetic2ned(Geodetic{g(0), g(1), g(2)}).to_vector(); },
+      [&](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { local.geodetic2ned(in, out); });
+  run("ned2geodetic", ned, [&](const Eigen::Vector3d &v) {
+        Geodetic g = local.ned2geodetic(NED{v(0), v(1), v(2)});
+        return Eigen::Vector3d(g.lat, g.lon, g.alt);
+      },
+      [&](const Eigen::Matrix3Xd &in, Eigen::Matrix3Xd &out) { local.ned2geodetic(in, out); });
+  return 0;
+}
@@ -1,6 +1,7 @@
 import numpy as np
 
 import openpilot.common.transformations.coordinates as coord
+from openpilot.common.transformations.transformations import ecef2geodetic_single, geodetic2ecef_single
 
 geodetic_positions = np.array([[37.7610403, -122.4778699, 115],
                                  [27.4840915, -68.5867592, 2380],
@@ -102,3 +103,36 @@ class TestNED:
     np.testing.assert_allclose(converter.ned2ecef(ned_offsets_batch),
                                                            ecef_positions_offset_batch,
                                                            rtol=1e-9, atol=1e-7)
+
+  def test_batch_matches_single(self):
+    # more points than a block of the batch transforms, all over the globe
+    rng = np.random.default_rng(0)
+    geodetic = np.column_stack([rng.uniform(-90, 90, 1000), rng.uniform(-180, 180, 1000), rng.uniform(-500, 50000, 1000)])
+    ecef = coord.geodetic2ecef(geodetic)
+    np.testing.assert_allclose(ecef, [geodetic2ecef_single(g) for g in geodetic], rtol=1e-12)
+
+    geodetic_converted = coord.ecef2geodetic(ecef)
+    geodetic_single = np.array([ecef2geodetic_single(e) for e in ecef])
+    np.testing.assert_allclose(geodetic_converted[:, :2], geodetic_single[:, :2], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(geodetic_converted[:, 2], geodetic_single[:, 2], rtol=0, atol=1e-6)
+
+    converter = coord.LocalCoord.from_geodetic(geodetic_positions[0])
+    ned = converter.geodetic2ned(geodetic)
+    np.testing.assert_allclose(ned, [converter.geodetic2ned_single(g) for g in geodetic], rtol=1e-9, atol=1e-6)
+    np.testing.assert_allclose(converter.ecef2ned(ecef), [converter.ecef2ned_single(e) for e in ecef], rtol=1e-9, atol=1e-6)
+    np.testing.assert_allclose(converter.ned2ecef(ned), [converter.ned2ecef_single(n) for n in ned], rtol=1e-12)
+    ned_converted = converter.ned2geodetic(ned)
+    ned_single = np.array([converter.ned2geodetic_single(n) for n in ned])
+    np.testing.assert_allclose(ned_converted[:, :2], ned_single[:, :2], rtol=0, atol=1e-9)
+    np.testing.assert_allclose(ned_converted[:, 2], ned_single[:, 2], rtol=0, atol=1e-6)
+
+  def test_batch_shapes(self):
+    assert coord.geodetic2ecef(np.zeros((0, 3))).shape == (0, 3)
+    assert coord.ecef2geodetic(ecef_positions[0].tolist()).shape == (3,)
+    assert coord.LocalCoord.from_ecef(ecef_init_batch).ned2ecef(ned_offsets_batch.T.copy().T).shape == (5, 3)
+
+  def test_ecef2geodetic_poles(self):
+    b = 6356752.3142
+    poles = coord.ecef2geodetic([[0, 0, b], [0, 0, -b - 100]])
+    np.testing.assert_allclose(poles[:, 0], [90, -90])
+    np.testing.assert_allclose(poles[:, 2], [0, 100], atol=1e-3)
@@ -24,6 +24,9 @@ cdef extern from "orientation.hpp":
 
     double operator()(int, int)
 
+  cdef cppclass Matrix3X "Eigen::Map<Eigen::Matrix3Xd>":
+    Matrix3X(double*, int, int)
+
   Quaternion euler2quat(Vector3)
   Vector3 quat2euler(Quaternion)
   Matrix3 quat2rot(Quaternion)
@@ -54,6 +57,8 @@ cdef extern from "coordinates.cc":
 
   ECEF geodetic2ecef(Geodetic)
   Geodetic ecef2geodetic(ECEF)
+  void geodetic2ecef_batch "geodetic2ecef"(Matrix3X, Matrix3X)
+  void ecef2geodetic_batch "ecef2geodetic"(Matrix3X, Matrix3X)
 
   cdef cppclass LocalCoord_c "LocalCoord":
     Matrix3 ned2ecef_matrix
@@ -67,6 +72,10 @@ cdef extern from "coordinates.cc":
     ECEF ned2ecef(NED)
     NED geodetic2ned(Geodetic)
     Geodetic ned2geodetic(NED)
+    void ecef2ned_batch "ecef2ned"(Matrix3X, Matrix3X)
+    void ned2ecef_batch "ned2ecef"(Matrix3X, Matrix3X)
+    void geodetic2ned_batch "geodetic2ned"(Matrix3X, Matrix3X)
+    void ned2geodetic_batch "ned2geodetic"(Matrix3X, Matrix3X)
 
 cdef extern from "coordinates.hpp":
   pass
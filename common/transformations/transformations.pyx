@@ -1,6 +1,6 @@
 # distutils: language = c++
 # cython: language_level = 3
-from openpilot.common.transformations.transformations cimport Matrix3, Vector3, Quaternion
+from openpilot.common.transformations.transformations cimport Matrix3, Matrix3X, Vector3, Quaternion
 from openpilot.common.transformations.transformations cimport ECEF, NED, Geodetic
 
 from openpilot.common.transformations.transformations cimport euler2quat as euler2quat_c
@@ -14,7 +14,10 @@ from openpilot.common.transformations.transformations cimport ecef_euler_from_ne
 from openpilot.common.transformations.transformations cimport ned_euler_from_ecef as ned_euler_from_ecef_c
 from openpilot.common.transformations.transformations cimport geodetic2ecef as geodetic2ecef_c
 from openpilot.common.transformations.transformations cimport ecef2geodetic as ecef2geodetic_c
+from openpilot.common.transformations.transformations cimport geodetic2ecef_batch as geodetic2ecef_batch_c
+from openpilot.common.transformations.transformations cimport ecef2geodetic_batch as ecef2geodetic_batch_c
 from openpilot.common.transformations.transformations cimport LocalCoord_c
+from cython.operator cimport dereference as deref
 
 
 import numpy as np
@@ -53,6 +56,11 @@ cdef Geodetic list2geodetic(geodetic):
     g.alt = geodetic[2]
     return g
 
+cdef Matrix3X* points2matrix(np.ndarray[double, ndim=2, mode="c"] p):
+    # an (n, 3) row-major array is a column-major 3 x n matrix
+    assert p.shape[1] == 3
+    return new Matrix3X(<double*>p.data, 3, p.shape[0])
+
 def euler2quat_single(euler):
     cdef Vector3 e = Vector3(euler[0], euler[1], euler[2])
     cdef Quaternion q = euler2quat_c(e)
@@ -110,6 +118,24 @@ def ecef2geodetic_single(ecef):
     cdef Geodetic g = ecef2geodetic_c(e)
     return [g.lat, g.lon, g.alt]
 
+def geodetic2ecef_batch(geodetic):
+    geodetic = np.ascontiguousarray(geodetic, dtype=np.double)
+    ecef = np.empty_like(geodetic)
+    cdef Matrix3X *g = points2matrix(geodetic)
+    cdef Matrix3X *e = points2matrix(ecef)
+    geodetic2ecef_batch_c(deref(g), deref(e))
+    del g, e
+    return ecef
+
+def ecef2geodetic_batch(ecef):
+    ecef = np.ascontiguousarray(ecef, dtype=np.double)
+    geodetic = np.empty_like(ecef)
+    cdef Matrix3X *e = points2matrix(ecef)
+    cdef Matrix3X *g = points2matrix(geodetic)
+    ecef2geodetic_batch_c(deref(e), deref(g))
+    del e, g
+    return geodetic
+
 
 cdef class LocalCoord:
     cdef LocalCoord_c * lc
@@ -169,5 +195,45 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, ecef):
+        assert self.lc
+        ecef = np.ascontiguousarray(ecef, dtype=np.double)
+        ned = np.empty_like(ecef)
+        cdef Matrix3X *e = points2matrix(ecef)
+        cdef Matrix3X *n = points2matrix(ned)
+        self.lc.ecef2ned_batch(deref(e), deref(n))
+        del e, n
+        return ned
+
+    def ned2ecef_batch(self, ned):
+        assert self.lc
+        ned = np.ascontiguousarray(ned, dtype=np.double)
+        ecef = np.empty_like(ned)
+        cdef Matrix3X *n = points2matrix(ned)
+        cdef Matrix3X *e = points2matrix(ecef)
+        self.lc.ned2ecef_batch(deref(n), deref(e))
+        del n, e
+        return ecef
+
+    def geodetic2ned_batch(self, geodetic):
+        assert self.lc
+        geodetic = np.ascontiguousarray(geodetic, dtype=np.double)
+        ned = np.empty_like(geodetic)
+        cdef Matrix3X *g = points2matrix(geodetic)
+        cdef Matrix3X *n = points2matrix(ned)
+        self.lc.geodetic2ned_batch(deref(g), deref(n))
+        del g, n
+        return ned
+
+    def ned2geodetic_batch(self, ned):
+        assert self.lc
+        ned = np.ascontiguousarray(ned, dtype=np.double)
+        geodetic = np.empty_like(ned)
+        cdef Matrix3X *n = points2matrix(ned)
+        cdef Matrix3X *g = points2matrix(geodetic)
+        self.lc.ned2geodetic_batch(deref(n), deref(g))
+        del n, g
+        return geodetic
+
     def __dealloc__(self):
         del self.lc
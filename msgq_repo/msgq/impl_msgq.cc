@@ -177,6 +177,10 @@ bool MSGQPubSocket::all_readers_updated() {
   return msgq_all_readers_updated(q);
 }
 
+size_t MSGQPubSocket::num_readers() {
+  return msgq_num_readers(q);
+}
+
 MSGQPubSocket::~MSGQPubSocket(){
   if (q != NULL){
     msgq_close_queue(q);
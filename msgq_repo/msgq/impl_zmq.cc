@@ -136,6 +136,11 @@ bool ZMQPubSocket::all_readers_updated() {
   return false;
 }
 
+size_t ZMQPubSocket::num_readers() {
+  assert(false); // not available with ZMQ, replay rejects --lockstep
+  return 0;
+}
+
 ZMQPubSocket::~ZMQPubSocket(){
   zmq_close(sock);
 }
@@ -52,6 +52,7 @@ public:
   int sendMessage(Message *message);
   int send(char *data, size_t size);
   bool all_readers_updated();
+  size_t num_readers();
   ~ZMQPubSocket();
 };
 
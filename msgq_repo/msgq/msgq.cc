@@ -466,3 +466,7 @@ bool msgq_all_readers_updated(msgq_queue_t *q) {
   }
   return num_readers > 0;
 }
+
+uint64_t msgq_num_readers(msgq_queue_t *q) {
+  return *q->num_readers;
+}
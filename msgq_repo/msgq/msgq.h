@@ -68,3 +68,4 @@ int msgq_msg_ready(msgq_queue_t * q);
 int msgq_poll(msgq_pollitem_t * items, size_t nitems, int timeout);
 
 bool msgq_all_readers_updated(msgq_queue_t *q);
+uint64_t msgq_num_readers(msgq_queue_t *q);
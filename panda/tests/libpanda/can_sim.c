@@ -0,0 +1,420 @@
+// Deterministic simulation of the CAN path of the firmware: frames from the other nodes on
+// three buses are received into can_rx_q as by the RX interrupt, the host reads them with
+// comms_can_read in USB packets or SPI transfers and writes frames with comms_can_write,
+// and the TX queues drain through the single element TX FIFO of the H7 FDCAN as by the TX
+// interrupt. It reports the occupancy of the queues, the overflows and the latency of the
+// frames from the bus to the host and from the host to the bus, over a range of bus loads.
+//
+// usage: can_sim [-i usb|spi] [-d] [-l load] [-t seconds] [-r rx queue size] [-p poll ms] [-x tx frames/s per bus] [-f]
+//   -d  CAN-FD buses at 500k/2M with 8 to 64 byte frames, instead of CAN at 500k with 8 byte frames
+//   -l  one bus load in (0, 1], instead of a sweep from 25% to saturation
+//   -r  size of can_rx_q, up to CAN_RX_BUFFER_SIZE
+//   -f  forward bus 0 to 2 and 2 to 0, as the ALLOUTPUT passthrough does
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "panda.c"
+
+// host interfaces
+#define USB_PACKET_SIZE 0x40U
+#define USB_PACKET_NS (1000000U / 19U)      // full speed bulk, at most 19 packets per 1ms frame
+#define USB_TRANSFER_SIZE 16384U            // bulk read size of the host
+#define SPI_BUF_SIZE_H7 2048U               // SPI_BUF_SIZE of the H7 in drivers/spi.h
+#define SPI_MAX_DATA (SPI_BUF_SIZE_H7 - 8U)  // less the header and checksum
+#define SPI_NS_PER_BYTE 160U                // 50MHz clock
+#define SPI_TRANSFER_NS 50000U              // header, ack and turnaround of a transaction
+
+#define SIM_CAN_BUSES 3U
+#define NS_PER_S 1000000000ULL
+
+typedef struct {
+  bool spi;
+  bool canfd;
+  bool passthrough;
+  double load;
+  double seconds;
+  uint32_t rx_queue_size;
+  uint64_t poll_ns;
+  uint32_t tx_fps;
+} sim_config;
+
+typedef struct {
+  // the frame on the bus and when it ends
+  bool busy;
+  bool busy_tx;
+  uint64_t busy_until;
+  CANPacket_t frame;
+
+  // the next frame of the other nodes, and when it tries to start
+  uint64_t next_rx;
+  CANPacket_t next_frame;
+
+  // FDCAN TX FIFO, FDCAN_TX_FIFO_EL_CNT is 1 on the H7
+  bool mailbox_full;
+  CANPacket_t mailbox;
+
+  double tx_due;
+} sim_bus;
+
+typedef struct {
+  uint64_t *v;
+  uint32_t n;
+} samples;
+
+typedef enum {
+  HOST_IDLE,
+  HOST_WRITE,
+  HOST_READ,
+} host_state;
+
+static uint64_t rng = 0x2545F4914F6CDD1DULL;
+
+static uint32_t sim_rand(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (uint32_t)(rng >> 16);
+}
+
+// time on the bus of a frame, with the average bit stuffing and the interframe space
+static uint64_t frame_ns(const sim_config *cfg, uint8_t data_len_code) {
+  uint64_t len = dlc_to_len[data_len_code];
+  uint64_t ns;
+  if (cfg->canfd) {
+    // arbitration and end of frame at 500k, the data phase at 2M
+    uint64_t data_bits = (8U * len) + ((len > 16U) ? 21U : 17U) + 10U;
+    ns = ((33U * NS_PER_S) / 500000U) + ((data_bits * 11U * NS_PER_S) / (10U * 2000000U));
+  } else {
+    uint64_t bits = 47U + (8U * len);
+    ns = (((bits * 11U) / 10U) + 3U) * NS_PER_S / 500000U;
+  }
+  return ns;
+}
+
+static uint8_t random_dlc(const sim_config *cfg) {
+  return cfg->canfd ? (uint8_t)(8U + (sim_rand() % 8U)) : 8U;
+}
+
+// frames carry their id in the first four bytes of data
+static void make_frame(CANPacket_t *p, uint8_t bus, uint32_t addr, uint8_t data_len_code, uint32_t id) {
+  memset(p, 0, sizeof(*p));
+  p->bus = bus;
+  p->addr = addr;
+  p->data_len_code = data_len_code;
+  for (uint32_t i = 0U; i < dlc_to_len[data_len_code]; i++) {
+    p->data[i] = (uint8_t)sim_rand();
+  }
+  WORD_TO_BYTE_ARRAY(p->data, id);
+  can_set_checksum(p);
+}
+
+static uint32_t frame_id(const CANPacket_t *p) {
+  uint32_t id;
+  BYTE_ARRAY_TO_WORD(id, p->data);
+  return id;
+}
+
+static uint32_t queue_used(const can_ring *q) {
+  return q->fifo_size - 1U - can_slots_empty(q);
+}
+
+// process_can of drivers/fdcan.h: into the TX FIFO if it is free, and back to the host
+static void sim_process_can(sim_bus *bus, uint8_t bus_number) {
+  CANPacket_t to_send;
+  if (!bus->mailbox_full && can_pop(can_queues[bus_number], &to_send)) {
+    if (can_check_checksum(&to_send)) {
+      bus->mailbox = to_send;
+      bus->mailbox_full = true;
+
+      CANPacket_t to_push = to_send;
+      to_push.returned = 1U;
+      to_push.rejected = 0U;
+      to_push.bus = bus_number;
+      can_set_checksum(&to_push);
+      rx_buffer_overflow += can_push(&can_rx_q, &to_push) ? 0U : 1U;
+    }
+    refresh_can_tx_slots_available();
+  }
+}
+
+// can_rx of drivers/fdcan.h, for one frame
+static void sim_can_rx(const CANPacket_t *frame, uint8_t bus_number) {
+  CANPacket_t to_push = *frame;
+  to_push.returned = 0U;
+  to_push.rejected = 0U;
+  to_push.bus = bus_number;
+  can_set_checksum(&to_push);
+
+  int bus_fwd_num = safety_fwd_hook(bus_number, to_push.addr);
+  if (bus_fwd_num != -1) {
+    CANPacket_t to_send = to_push;
+    can_set_checksum(&to_send);
+    can_send(&to_send, bus_fwd_num, true);
+  }
+
+  safety_rx_invalid += safety_rx_hook(&to_push) ? 0U : 1U;
+  ignition_can_hook(&to_push);
+  rx_buffer_overflow += can_push(&can_rx_q, &to_push) ? 0U : 1U;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile_us(samples *s, double p) {
+  double ret = 0.0;
+  if (s->n > 0U) {
+    ret = s->v[MIN((uint32_t)(p * s->n), s->n - 1U)] * 1e-3;
+  }
+  return ret;
+}
+
+static void run(const sim_config *cfg) {
+  // reset the firmware state
+  set_safety_hooks(SAFETY_ALLOUTPUT, cfg->passthrough ? ALLOUTPUT_PARAM_PASSTHROUGH : 0U);
+  can_rx_q.fifo_size = cfg->rx_queue_size;
+  can_clear(&can_rx_q);
+  for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+    can_clear(can_queues[b]);
+  }
+  comms_can_reset();
+  rx_buffer_overflow = 0U;
+  tx_buffer_overflow = 0U;
+  safety_rx_invalid = 0U;
+  safety_tx_blocked = 0U;
+  rng = 0x2545F4914F6CDD1DULL;
+
+  const uint64_t end = (uint64_t)(cfg->seconds * NS_PER_S);
+  // frames of the other nodes at saturation with the shortest frames, and those of the host
+  const uint32_t max_ids = (uint32_t)((end / frame_ns(cfg, 8U)) * SIM_CAN_BUSES) + ((uint32_t)(cfg->seconds * cfg->tx_fps) * SIM_CAN_BUSES) + 1024U;
+  uint64_t *sent_at = calloc(max_ids, sizeof(uint64_t));
+  samples rx_latency = {.v = calloc(max_ids, sizeof(uint64_t)), .n = 0U};
+  samples tx_latency = {.v = calloc(max_ids, sizeof(uint64_t)), .n = 0U};
+  uint32_t next_id = 0U;
+
+  sim_bus buses[SIM_CAN_BUSES];
+  for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+    memset(&buses[b], 0, sizeof(sim_bus));
+    make_frame(&buses[b].next_frame, b, 0x100U + (sim_rand() % 0x600U), random_dlc(cfg), next_id++);
+    buses[b].next_rx = sim_rand() % 1000000U;
+  }
+
+  // host
+  host_state state = HOST_IDLE;
+  uint64_t host_next = cfg->poll_ns;
+  uint64_t last_poll = 0U;
+  static uint8_t tx_buf[1U << 20];
+  uint32_t tx_len = 0U;
+  uint32_t tx_pos = 0U;
+  uint32_t chunk_len = 0U;
+  static uint8_t rx_buf[SPI_MAX_DATA];
+  uint8_t partial[sizeof(CANPacket_t)];
+  uint32_t partial_len = 0U;
+  uint32_t usb_transfer_len = 0U;
+  const uint32_t write_gate = cfg->spi ? MAX_CAN_MSGS_PER_SPI_BULK_TRANSFER : MAX_CAN_MSGS_PER_USB_BULK_TRANSFER;
+
+  uint64_t bus_frames = 0U, host_bytes = 0U, checksum_errors = 0U;
+  uint64_t rx_occupancy = 0U;
+  uint32_t rx_max = 0U, tx_max = 0U;
+
+  uint64_t now = 0U;
+  while (now < end) {
+    // next event: a frame ends or starts on a bus, or the host finishes a transfer
+    uint64_t next = host_next;
+    for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+      const sim_bus *bus = &buses[b];
+      uint64_t t = bus->busy ? bus->busy_until : (bus->mailbox_full ? now : bus->next_rx);
+      next = MIN(next, MAX(t, now));
+    }
+    rx_occupancy += (uint64_t)queue_used(&can_rx_q) * (next - now);
+    now = next;
+
+    for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+      sim_bus *bus = &buses[b];
+      if (bus->busy && (bus->busy_until <= now)) {
+        bus->busy = false;
+        if (bus->busy_tx) {
+          // TX complete interrupt
+          uint32_t id = frame_id(&bus->frame);
+          tx_latency.v[tx_latency.n++] = now - sent_at[id];
+          sim_process_can(bus, b);
+        } else {
+          uint32_t id = frame_id(&bus->frame);
+          sent_at[id] = now;
+          bus_frames++;
+          sim_can_rx(&bus->frame, b);
+
+          // next frame of the other nodes, spaced for the bus load on average
+          uint8_t dlc = random_dlc(cfg);
+          uint64_t gap = (uint64_t)((double)frame_ns(cfg, dlc) * ((1.0 - cfg->load) / cfg->load) * ((sim_rand() % 2048U) / 1024.0));
+          make_frame(&bus->next_frame, b, 0x100U + (sim_rand() % 0x600U), dlc, next_id++);
+          bus->next_rx = now + gap;
+        }
+      }
+
+      // start the next frame when the bus is idle, the lowest address wins the arbitration
+      if (!bus->busy) {
+        bool rx_ready = bus->next_rx <= now;
+        if (bus->mailbox_full && (!rx_ready || (bus->mailbox.addr < bus->next_frame.addr))) {
+          bus->frame = bus->mailbox;
+          bus->mailbox_full = false;
+          bus->busy_tx = true;
+        } else if (rx_ready) {
+          bus->frame = bus->next_frame;
+          bus->busy_tx = false;
+        } else {
+          continue;
+        }
+        bus->busy = true;
+        bus->busy_until = now + frame_ns(cfg, bus->frame.data_len_code);
+      }
+    }
+
+    if (host_next <= now) {
+      if (state == HOST_IDLE) {
+        // the frames the host sends since the last poll, one transfer per poll
+        for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+          buses[b].tx_due += cfg->tx_fps * (double)(now - last_poll) / NS_PER_S;
+          while ((buses[b].tx_due >= 1.0) && ((tx_len + sizeof(CANPacket_t)) <= sizeof(tx_buf))) {
+            CANPacket_t p;
+            make_frame(&p, b, 0x20U + (sim_rand() % 0x40U), random_dlc(cfg), next_id);
+            sent_at[next_id++] = now;
+            uint32_t len = CANPACKET_HEAD_SIZE + dlc_to_len[p.data_len_code];
+            memcpy(&tx_buf[tx_len], &p, len);
+            tx_len += len;
+            buses[b].tx_due -= 1.0;
+          }
+        }
+        last_poll = now;
+        state = HOST_WRITE;
+        chunk_len = 0U;
+        usb_transfer_len = 0U;
+      } else if (state == HOST_WRITE) {
+        if (chunk_len > 0U) {
+          comms_can_write(&tx_buf[tx_pos], chunk_len);
+          for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+            sim_process_can(&buses[b], b);
+          }
+          tx_pos += chunk_len;
+          chunk_len = 0U;
+        }
+      } else {
+        // HOST_READ, the read was done at the start of the transfer
+      }
+
+      if (state == HOST_WRITE) {
+        // the panda NAKs writes until its TX queues have room for a whole transfer
+        if ((tx_pos < tx_len) && can_tx_check_min_slots_free(write_gate)) {
+          chunk_len = MIN(tx_len - tx_pos, cfg->spi ? SPI_MAX_DATA : USB_PACKET_SIZE);
+          host_next = now + (cfg->spi ? (SPI_TRANSFER_NS + (chunk_len * SPI_NS_PER_BYTE)) : USB_PACKET_NS);
+        } else {
+          // what could not be written waits for the next poll
+          for (uint32_t i = tx_pos; i < tx_len; i++) {
+            tx_buf[i - tx_pos] = tx_buf[i];
+          }
+          tx_len -= tx_pos;
+          tx_pos = 0U;
+          state = HOST_READ;
+        }
+      }
+
+      if (state == HOST_READ) {
+        const uint32_t max_len = cfg->spi ? SPI_MAX_DATA : USB_PACKET_SIZE;
+        uint32_t len = comms_can_read(rx_buf, max_len);
+        uint64_t done = now + (cfg->spi ? (SPI_TRANSFER_NS + (len * SPI_NS_PER_BYTE)) : USB_PACKET_NS);
+        host_bytes += len;
+        usb_transfer_len += len;
+
+        // reassemble the frames, which can span transfers
+        for (uint32_t i = 0U; i < len; i++) {
+          partial[partial_len++] = rx_buf[i];
+          if (partial_len == (CANPACKET_HEAD_SIZE + dlc_to_len[partial[0] >> 4U])) {
+            CANPacket_t p;
+            memset(&p, 0, sizeof(p));
+            memcpy(&p, partial, partial_len);
+            partial_len = 0U;
+            if (!can_check_checksum(&p)) {
+              checksum_errors++;
+            } else if (p.returned == 0U) {
+              rx_latency.v[rx_latency.n++] = done - sent_at[frame_id(&p)];
+            } else {
+              // echo of a frame sent
+            }
+          }
+        }
+
+        // a short packet or transfer ends the read, or a full USB transfer
+        if ((len < max_len) || (!cfg->spi && (usb_transfer_len >= USB_TRANSFER_SIZE))) {
+          state = HOST_IDLE;
+          host_next = MAX(done, last_poll + cfg->poll_ns);
+        } else {
+          host_next = done;
+        }
+      }
+    }
+
+    rx_max = MAX(rx_max, queue_used(&can_rx_q));
+    for (uint8_t b = 0U; b < SIM_CAN_BUSES; b++) {
+      tx_max = MAX(tx_max, queue_used(can_queues[b]));
+    }
+  }
+
+  qsort(rx_latency.v, rx_latency.n, sizeof(uint64_t), cmp_u64);
+  qsort(tx_latency.v, tx_latency.n, sizeof(uint64_t), cmp_u64);
+  printf("%-4s %-3s %5.0f%% %8.0f %6.2f %6u %8.1f %6u %8u %8u %5lu %8.0f %8.0f %8.0f %8.0f %8.0f %8.0f\n",
+         cfg->spi ? "spi" : "usb", cfg->canfd ? "fd" : "can", cfg->load * 100.0, bus_frames / cfg->seconds,
+         host_bytes / cfg->seconds * 1e-6, rx_max, (double)rx_occupancy / now, tx_max, rx_buffer_overflow, tx_buffer_overflow,
+         (unsigned long)checksum_errors, percentile_us(&rx_latency, 0.5), percentile_us(&rx_latency, 0.99), percentile_us(&rx_latency, 1.0),
+         percentile_us(&tx_latency, 0.5), percentile_us(&tx_latency, 0.99), percentile_us(&tx_latency, 1.0));
+
+  free(sent_at);
+  free(rx_latency.v);
+  free(tx_latency.v);
+}
+
+int main(int argc, char *argv[]) {
+  sim_config cfg = {
+    .spi = false,
+    .canfd = false,
+    .passthrough = false,
+    .load = 0.0,
+    .seconds = 2.0,
+    .rx_queue_size = CAN_RX_BUFFER_SIZE,
+    .poll_ns = 10000000U,
+    .tx_fps = 300U,
+  };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "i:dl:t:r:p:x:f")) != -1) {
+    switch (opt) {
+      case 'i': cfg.spi = optarg[0] == 's'; break;
+      case 'd': cfg.canfd = true; break;
+      case 'l': cfg.load = atof(optarg); break;
+      case 't': cfg.seconds = atof(optarg); break;
+      case 'r': cfg.rx_queue_size = CLAMP((uint32_t)atoi(optarg), 2U, CAN_RX_BUFFER_SIZE); break;
+      case 'p': cfg.poll_ns = (uint64_t)(atof(optarg) * 1e6); break;
+      case 'x': cfg.tx_fps = (uint32_t)atoi(optarg); break;
+      case 'f': cfg.passthrough = true; break;
+      default:
+        printf("usage: %s [-i usb|spi] [-d] [-l load] [-t seconds] [-r rx queue size] [-p poll ms] [-x tx frames/s per bus] [-f]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  printf("%u element rx queue, %.1f ms polls, %u frames/s per bus from the host\n", cfg.rx_queue_size, cfg.poll_ns * 1e-6, cfg.tx_fps);
+  printf("%-4s %-3s %6s %8s %6s %6s %8s %6s %8s %8s %5s %8s %8s %8s %8s %8s %8s\n", "if", "bus", "load", "frames/s", "MB/s",
+         "rx max", "rx mean", "tx max", "rx ovf", "tx ovf", "csum", "rx p50", "rx p99", "rx max", "tx p50", "tx p99", "tx max");
+  const double loads[] = {0.25, 0.5, 0.75, 0.9, 1.0};
+  for (uint32_t i = 0U; i < (sizeof(loads) / sizeof(loads[0])); i++) {
+    sim_config c = cfg;
+    c.load = (cfg.load > 0.0) ? MIN(cfg.load, 1.0) : loads[i];
+    run(&c);
+    if (cfg.load > 0.0) {
+      break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+// Pushes frames through the rx and tx hooks of every safety mode, and reports the time and
+// host cycles they take per frame. Half the frames are of the mode's tx and rx check messages,
+// the rest of other addresses, like the traffic of a car.
+//
+// usage: safety_benchmark [frames]   (4096 by default, few enough to stay in cache)
+
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "panda.c"
+
+static uint64_t nanos(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000000000ULL) + (uint64_t)t.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0U;
+#endif
+}
+
+static void make_frame(CANPacket_t *p, int addr, int bus, int len) {
+  memset(p, 0, sizeof(*p));
+  p->addr = addr;
+  p->bus = bus;
+  for (uint8_t dlc = 0U; dlc < 16U; dlc++) {
+    if (dlc_to_len[dlc] == len) {
+      p->data_len_code = dlc;
+    }
+  }
+  for (int i = 0; i < len; i++) {
+    p->data[i] = rand() & 0xFF;
+  }
+}
+
+#define MAX_FRAMES 65536
+
+static CANPacket_t frames[MAX_FRAMES];
+
+int main(int argc, char *argv[]) {
+  const int n_frames = CLAMP((argc > 1) ? atoi(argv[1]) : 4096, 1, MAX_FRAMES);
+
+  printf("%-6s %10s %10s %10s %10s\n", "mode", "rx ns", "rx cycles", "tx ns", "tx cycles");
+  const int n_modes = sizeof(safety_hook_registry) / sizeof(safety_hook_config);
+  for (int m = 0; m < n_modes; m++) {
+    set_safety_hooks(safety_hook_registry[m].id, 0U);
+    const safety_config cfg = current_safety_config;
+
+    srand(m);
+    for (int i = 0; i < n_frames; i++) {
+      int r = rand() % 4;
+      if ((r == 0) && (cfg.tx_msgs_len > 0)) {
+        const CanMsg *msg = &cfg.tx_msgs[rand() % cfg.tx_msgs_len];
+        make_frame(&frames[i], msg->addr, msg->bus, msg->len);
+      } else if ((r == 1) && (cfg.rx_checks_len > 0)) {
+        const CanMsgCheck *msg = &cfg.rx_checks[rand() % cfg.rx_checks_len].msg[0];
+        make_frame(&frames[i], msg->addr, msg->bus, msg->len);
+      } else {
+        make_frame(&frames[i], rand() % 0x800, rand() % 3, 8);
+      }
+    }
+
+    uint64_t start_ns = nanos();
+    uint64_t start_cycles = cycles();
+    int valid = 0;
+    for (int i = 0; i < n_frames; i++) {
+      valid += safety_rx_hook(&frames[i]) ? 1 : 0;
+    }
+    const uint64_t rx_cycles = cycles() - start_cycles;
+    const uint64_t rx_ns = nanos() - start_ns;
+
+    start_ns = nanos();
+    start_cycles = cycles();
+    int allowed = 0;
+    for (int i = 0; i < n_frames; i++) {
+      controls_allowed = true;
+      allowed += safety_tx_hook(&frames[i]) ? 1 : 0;
+    }
+    const uint64_t tx_cycles = cycles() - start_cycles;
+    const uint64_t tx_ns = nanos() - start_ns;
+
+    printf("%-6d %10.1f %10.1f %10.1f %10.1f  (%d valid, %d allowed)\n", safety_hook_registry[m].id,
+           (double)rx_ns / n_frames, (double)rx_cycles / n_frames, (double)tx_ns / n_frames, (double)tx_cycles / n_frames,
+           valid, allowed);
+  }
+
+  return 0;
+}
@@ -14,6 +14,7 @@
 
 #include "ekf.h"
 #include "ekf_load.h"
+#include "rednose/logger/logger.h"
 
 #define REWIND_TO_KEEP 512
 
@@ -41,17 +42,24 @@ typedef struct Estimate {
   std::vector<std::vector<double>> extra_args;
 } Estimate;
 
-class EKFSym {
+// The filter, with the state and error state dimensions known at compile time, or
+// Eigen::Dynamic to take them from the initial state.
+template <int DIM, int EDIM>
+class EKFSymCore {
 public:
-  EKFSym(std::string name, Eigen::Map<MatrixXdr> Q, Eigen::Map<Eigen::VectorXd> x_initial,
-      Eigen::Map<MatrixXdr> P_initial, int dim_main, int dim_main_err, int N = 0, int dim_augment = 0,
-      int dim_augment_err = 0, std::vector<int> maha_test_kinds = std::vector<int>(),
-      std::vector<int> quaternion_idxs = std::vector<int>(),
+  typedef Eigen::Matrix<double, DIM, 1> StateVector;
+  typedef Eigen::Matrix<double, EDIM, EDIM, Eigen::RowMajor> CovMatrix;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  EKFSymCore(const EKF *ekf, const CovMatrix &Q, const StateVector &x_initial, const CovMatrix &P_initial, int dim_main,
+      int dim_main_err, int N = 0, int dim_augment = 0, int dim_augment_err = 0,
+      std::vector<int> maha_test_kinds = std::vector<int>(), std::vector<int> quaternion_idxs = std::vector<int>(),
       std::vector<std::string> global_vars = std::vector<std::string>(), double max_rewind_age = 1.0);
-  void init_state(Eigen::Map<Eigen::VectorXd> state, Eigen::Map<MatrixXdr> covs, double filter_time);
+  void init_state(const StateVector &state, const CovMatrix &covs, double filter_time);
 
-  Eigen::VectorXd state();
-  MatrixXdr covs();
+  const StateVector &state();
+  const CovMatrix &covs();
   void set_filter_time(double t);
   double get_filter_time();
   void normalize_quaternions();
@@ -60,23 +68,38 @@ public:
   void reset_rewind();
 
   void predict(double t);
-  std::optional<Estimate> predict_and_update_batch(double t, int kind, std::vector<Eigen::Map<Eigen::VectorXd>> z,
-      std::vector<Eigen::Map<MatrixXdr>> R, std::vector<std::vector<double>> extra_args = {{}}, bool augment = false);
+  std::optional<Estimate> predict_and_update_batch(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z,
+      const std::vector<Eigen::Map<MatrixXdr>> &R, const std::vector<std::vector<double>> &extra_args = {{}}, bool augment = false);
+  // same without building the estimate, returns false if the observation is too old
+  bool predict_and_update(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z,
+      const std::vector<Eigen::Map<MatrixXdr>> &R, const std::vector<std::vector<double>> &extra_args);
 
   extra_routine_t get_extra_routine(const std::string& routine);
 
 private:
-  std::deque<Observation> rewind(double t);
-  void checkpoint(Observation& obs);
+  // an observation and the filter state right after it
+  typedef struct RewindSlot {
+    double t;
+    StateVector x;
+    CovMatrix P;
+    Observation obs;
 
-  Estimate predict_and_update_batch(Observation& obs, bool augment);
-  Eigen::VectorXd update(int kind, Eigen::VectorXd z, MatrixXdr R, std::vector<double> extra_args);
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  } RewindSlot;
+
+  RewindSlot& rewind_slot(size_t i);
+  size_t rewind(double t);
+
+  bool observe(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z, const std::vector<Eigen::Map<MatrixXdr>> &R,
+      const std::vector<std::vector<double>> &extra_args, bool augment, Estimate *res);
+  void predict_and_update_slot(size_t i, Estimate *res, bool augment);
+  Eigen::VectorXd::SegmentReturnType update(int kind, const Eigen::VectorXd& z, const MatrixXdr& R, const std::vector<double>& extra_args);
 
   // stuct with linked sympy generated functions
   const EKF *ekf = NULL;
 
-  Eigen::VectorXd x;  // state
-  MatrixXdr P;  // covs
+  StateVector x;  // state
+  CovMatrix P;  // covs
 
   bool msckf;
   int N;
@@ -97,17 +120,299 @@ private:
   std::vector<std::string> global_vars;
 
   // process noise
-  MatrixXdr Q;
+  CovMatrix Q;
 
-  // rewind stuff
+  // rewind stuff, a ring of REWIND_TO_KEEP preallocated slots ordered by time
   double max_rewind_age;
-  std::deque<double> rewind_t;
-  std::deque<std::pair<Eigen::VectorXd, MatrixXdr>> rewind_states;
-  std::deque<Observation> rewind_obscache;
+  std::vector<RewindSlot, Eigen::aligned_allocator<RewindSlot>> rewind_slots;
+  size_t rewind_head = 0;
+  size_t rewind_size = 0;
+
+  // residual of the last update
+  Eigen::VectorXd y;
 
   Eigen::VectorXd augment_times;
 
   std::vector<int> feature_track_kinds;
 };
 
+// The filter with the dimensions of the initial state, looked up by name.
+class EKFSym : public EKFSymCore<Eigen::Dynamic, Eigen::Dynamic> {
+public:
+  EKFSym(std::string name, Eigen::Map<MatrixXdr> Q, Eigen::Map<Eigen::VectorXd> x_initial,
+      Eigen::Map<MatrixXdr> P_initial, int dim_main, int dim_main_err, int N = 0, int dim_augment = 0,
+      int dim_augment_err = 0, std::vector<int> maha_test_kinds = std::vector<int>(),
+      std::vector<int> quaternion_idxs = std::vector<int>(),
+      std::vector<std::string> global_vars = std::vector<std::string>(), double max_rewind_age = 1.0);
+};
+
+template <int DIM, int EDIM>
+EKFSymCore<DIM, EDIM>::EKFSymCore(const EKF *ekf, const CovMatrix &Q, const StateVector &x_initial, const CovMatrix &P_initial,
+    int dim_main, int dim_main_err, int N, int dim_augment, int dim_augment_err, std::vector<int> maha_test_kinds,
+    std::vector<int> quaternion_idxs, std::vector<std::string> global_vars, double max_rewind_age)
+{
+  // TODO: add logger
+  this->ekf = ekf;
+  assert(this->ekf);
+
+  this->msckf = N > 0;
+  this->N = N;
+  this->dim_augment = dim_augment;
+  this->dim_augment_err = dim_augment_err;
+  this->dim_main = dim_main;
+  this->dim_main_err = dim_main_err;
+
+  this->dim_x = x_initial.rows();
+  this->dim_err = P_initial.rows();
+
+  assert(dim_main + dim_augment * N == dim_x);
+  assert(dim_main_err + dim_augment_err * N == this->dim_err);
+  assert(Q.rows() == P_initial.rows() && Q.cols() == P_initial.cols());
+
+  // kinds that should get mahalanobis distance
+  // tested for outlier rejection
+  this->maha_test_kinds = maha_test_kinds;
+
+  // quaternions need normalization
+  this->quaternion_idxs = quaternion_idxs;
+
+  this->global_vars = global_vars;
+
+  // Process noise
+  this->Q = Q;
+
+  this->max_rewind_age = max_rewind_age;
+  this->rewind_slots.resize(REWIND_TO_KEEP);
+  for (RewindSlot &slot : this->rewind_slots) {
+    slot.x.resize(this->dim_x);
+    slot.P.resize(this->dim_err, this->dim_err);
+  }
+  this->init_state(x_initial, P_initial, NAN);
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::init_state(const StateVector &state, const CovMatrix &covs, double init_filter_time) {
+  this->x = state;
+  this->P = covs;
+  this->filter_time = init_filter_time;
+  this->augment_times = Eigen::VectorXd::Zero(this->N);
+  this->reset_rewind();
+}
+
+template <int DIM, int EDIM>
+const typename EKFSymCore<DIM, EDIM>::StateVector &EKFSymCore<DIM, EDIM>::state() {
+  return this->x;
+}
+
+template <int DIM, int EDIM>
+const typename EKFSymCore<DIM, EDIM>::CovMatrix &EKFSymCore<DIM, EDIM>::covs() {
+  return this->P;
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::set_filter_time(double t) {
+  this->filter_time = t;
+}
+
+template <int DIM, int EDIM>
+double EKFSymCore<DIM, EDIM>::get_filter_time() {
+  return this->filter_time;
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::normalize_quaternions() {
+  for(std::size_t i = 0; i < this->quaternion_idxs.size(); ++i) {
+    this->normalize_slice(this->quaternion_idxs[i], this->quaternion_idxs[i] + 4);
+  }
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::normalize_slice(int slice_start, int slice_end_ex) {
+  this->x.segment(slice_start, slice_end_ex - slice_start).normalize();
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::set_global(std::string global_var, double val) {
+  this->ekf->sets.at(global_var)(val);
+}
+
+template <int DIM, int EDIM>
+std::optional<Estimate> EKFSymCore<DIM, EDIM>::predict_and_update_batch(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z,
+    const std::vector<Eigen::Map<MatrixXdr>> &R, const std::vector<std::vector<double>> &extra_args, bool augment)
+{
+  std::optional<Estimate> res = std::make_optional<Estimate>();
+  if (!this->observe(t, kind, z, R, extra_args, augment, &res.value())) {
+    return std::nullopt;
+  }
+  return res;
+}
+
+template <int DIM, int EDIM>
+bool EKFSymCore<DIM, EDIM>::predict_and_update(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z,
+    const std::vector<Eigen::Map<MatrixXdr>> &R, const std::vector<std::vector<double>> &extra_args)
+{
+  return this->observe(t, kind, z, R, extra_args, false, nullptr);
+}
+
+template <int DIM, int EDIM>
+bool EKFSymCore<DIM, EDIM>::observe(double t, int kind, const std::vector<Eigen::Map<Eigen::VectorXd>> &z_map,
+    const std::vector<Eigen::Map<MatrixXdr>> &R_map, const std::vector<std::vector<double>> &extra_args, bool augment, Estimate *res)
+{
+  // TODO handle rewinding at this level
+
+  size_t idx = this->rewind_size;
+  if (!std::isnan(this->filter_time) && t < this->filter_time) {
+    if (this->rewind_size == 0 || t < this->rewind_slot(0).t || t < this->rewind_slot(this->rewind_size - 1).t - this->max_rewind_age) {
+      LOGD("observation too old at %f with filter at %f, ignoring!", t, this->filter_time);
+      return false;
+    }
+    idx = this->rewind(t);
+  }
+
+  // only keep a certain number around
+  if (this->rewind_size == this->rewind_slots.size()) {
+    this->rewind_head = (this->rewind_head + 1) % this->rewind_slots.size();
+    this->rewind_size--;
+    idx--;
+  }
+
+  // take the free slot at the end, and move it in front of the rewound observations
+  this->rewind_size++;
+  for (size_t i = this->rewind_size - 1; i > idx; i--) {
+    std::swap(this->rewind_slot(i), this->rewind_slot(i - 1));
+  }
+
+  Observation &obs = this->rewind_slot(idx).obs;
+  obs.t = t;
+  obs.kind = kind;
+  obs.extra_args = extra_args;
+  obs.z.resize(z_map.size());
+  for (int i = 0; i < z_map.size(); i++) {
+    obs.z[i] = z_map[i];
+  }
+  obs.R.resize(R_map.size());
+  for (int i = 0; i < R_map.size(); i++) {
+    obs.R[i] = R_map[i];
+  }
+
+  this->predict_and_update_slot(idx, res, augment);
+
+  // optional fast forward
+  for (size_t i = idx + 1; i < this->rewind_size; i++) {
+    this->predict_and_update_slot(i, nullptr, false);
+  }
+
+  return true;
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::reset_rewind() {
+  this->rewind_head = 0;
+  this->rewind_size = 0;
+}
+
+template <int DIM, int EDIM>
+typename EKFSymCore<DIM, EDIM>::RewindSlot& EKFSymCore<DIM, EDIM>::rewind_slot(size_t i) {
+  return this->rewind_slots[(this->rewind_head + i) % this->rewind_slots.size()];
+}
+
+template <int DIM, int EDIM>
+size_t EKFSymCore<DIM, EDIM>::rewind(double t) {
+  // rewind observations until t is after previous observation
+  size_t idx = this->rewind_size;
+  while (this->rewind_slot(idx - 1).t > t) {
+    idx--;
+  }
+
+  // set the state to the time right before that
+  const RewindSlot &slot = this->rewind_slot(idx - 1);
+  this->filter_time = slot.t;
+  this->x = slot.x;
+  this->P = slot.P;
+
+  return idx;
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::predict_and_update_slot(size_t i, Estimate *res, bool augment) {
+  RewindSlot &slot = this->rewind_slot(i);
+  const Observation &obs = slot.obs;
+  assert(obs.z.size() == obs.R.size());
+  assert(obs.z.size() == obs.extra_args.size());
+
+  this->predict(obs.t);
+
+  if (res) {
+    res->t = obs.t;
+    res->kind = obs.kind;
+    res->z = obs.z;
+    res->extra_args = obs.extra_args;
+    res->xk1 = this->x;
+    res->Pk1 = this->P;
+  }
+
+  // update batch
+  for (int j = 0; j < obs.z.size(); j++) {
+    assert(obs.z[j].rows() == obs.R[j].rows());
+    assert(obs.z[j].rows() == obs.R[j].cols());
+
+    // update state
+    auto y = this->update(obs.kind, obs.z[j], obs.R[j], obs.extra_args[j]);
+    if (res) {
+      res->y.push_back(y);
+    }
+  }
+
+  if (res) {
+    res->xk = this->x;
+    res->Pk = this->P;
+  }
+
+  assert(!augment); // TODO
+  // if (augment) {
+  //   this->augment();
+  // }
+
+  // checkpoint, the slot is overwritten in place
+  slot.t = this->filter_time;
+  slot.x = this->x;
+  slot.P = this->P;
+}
+
+template <int DIM, int EDIM>
+void EKFSymCore<DIM, EDIM>::predict(double t) {
+  // initialize time
+  if (std::isnan(this->filter_time)) {
+    this->filter_time = t;
+  }
+
+  // predict
+  double dt = t - this->filter_time;
+  assert(dt >= 0.0);
+
+  this->ekf->predict(this->x.data(), this->P.data(), this->Q.data(), dt);
+  this->normalize_quaternions();
+  this->filter_time = t;
+}
+
+template <int DIM, int EDIM>
+Eigen::VectorXd::SegmentReturnType EKFSymCore<DIM, EDIM>::update(int kind, const Eigen::VectorXd& z, const MatrixXdr& R, const std::vector<double>& extra_args) {
+  // the update writes the residual over z, R and extra_args are only read
+  this->y = z;
+  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), this->y.data(), (double*)R.data(), (double*)extra_args.data());
+  this->normalize_quaternions();
+
+  if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), kind) != this->feature_track_kinds.end()) {
+    return this->y.head(this->y.rows() - extra_args.size());
+  }
+  return this->y.head(this->y.rows());
+}
+
+template <int DIM, int EDIM>
+extra_routine_t EKFSymCore<DIM, EDIM>::get_extra_routine(const std::string& routine) {
+  return this->ekf->extra_routines.at(routine);
+}
+
+extern template class EKFSymCore<Eigen::Dynamic, Eigen::Dynamic>;
+
 }
@@ -117,6 +117,8 @@ def gen_code(folder, name, f_sym, dt_sym, x_sym, obs_eqs, dim_x, dim_err, eskf_p
 
   header = "#pragma once\n"
   header += "#include \"rednose/helpers/ekf.h\"\n"
+  header += f"#define {name.upper()}_DIM {dim_x}\n"
+  header += f"#define {name.upper()}_EDIM {dim_err}\n"
   header += "extern \"C\" {\n"
 
   pre_code = f"#include \"{name}.h\"\n"
@@ -32,61 +32,29 @@ void predict(double *in_x, double *in_P, double *in_Q, double dt) {
   memcpy(in_P, P.data(), EDIM * EDIM * sizeof(double));
 }
 
-// note: extra_args dim only correct when null space projecting
-// otherwise 1
-template <int ZDIM, int EADIM, bool MAHA_TEST>
-void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, double *in_z, double *in_R, double *in_ea, double MAHA_THRESHOLD) {
-  typedef Eigen::Matrix<double, ZDIM, ZDIM, Eigen::RowMajor> ZZM;
-  typedef Eigen::Matrix<double, ZDIM, DIM, Eigen::RowMajor> ZDM;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, EDIM, Eigen::RowMajor> XEM;
-  //typedef Eigen::Matrix<double, EDIM, ZDIM, Eigen::RowMajor> EZM;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, 1> X1M;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> XXM;
+// kalman update with the residual y, the observation jacobian H and the observation noise R,
+// of fixed size unless they are projected on the null space of the extra args
+template <int YDIM, bool MAHA_TEST>
+void update_state(double *in_x, double *in_P, const Eigen::Matrix<double, YDIM, 1> &y,
+                  const Eigen::Matrix<double, YDIM, DIM, Eigen::RowMajor> &H, Eigen::Matrix<double, YDIM, YDIM, Eigen::RowMajor> R,
+                  double *in_z, double MAHA_THRESHOLD) {
+  typedef Eigen::Matrix<double, YDIM, YDIM, Eigen::RowMajor> YYM;
+  typedef Eigen::Matrix<double, YDIM, EDIM, Eigen::RowMajor> YEM;
 
-  double in_hx[ZDIM] = {0};
-  double in_H[ZDIM * DIM] = {0};
   double in_H_mod[EDIM * DIM] = {0};
   double delta_x[EDIM] = {0};
   double x_new[DIM] = {0};
 
-
-  // state x, P
-  Eigen::Matrix<double, ZDIM, 1> z(in_z);
   EEM P(in_P);
-  ZZM pre_R(in_R);
-
-  // functions from sympy
-  h_fun(in_x, in_ea, in_hx);
-  H_fun(in_x, in_ea, in_H);
-  ZDM pre_H(in_H);
-
-  // get y (y = z - hx)
-  Eigen::Matrix<double, ZDIM, 1> pre_y(in_hx); pre_y = z - pre_y;
-  X1M y; XXM H; XXM R;
-  if (Hea_fun){
-    typedef Eigen::Matrix<double, ZDIM, EADIM, Eigen::RowMajor> ZAM;
-    double in_Hea[ZDIM * EADIM] = {0};
-    Hea_fun(in_x, in_ea, in_Hea);
-    ZAM Hea(in_Hea);
-    XXM A = Hea.transpose().fullPivLu().kernel();
 
-
-    y = A.transpose() * pre_y;
-    H = A.transpose() * pre_H;
-    R = A.transpose() * pre_R * A;
-  } else {
-    y = pre_y;
-    H = pre_H;
-    R = pre_R;
-  }
   // get modified H
   H_mod_fun(in_x, in_H_mod);
   DEM H_mod(in_H_mod);
-  XEM H_err = H * H_mod;
+  YEM H_err = H * H_mod;
 
   // Do mahalobis distance test
   if (MAHA_TEST){
-    XXM a = (H_err * P * H_err.transpose() + R).inverse();
+    YYM a = (H_err * P * H_err.transpose() + R).inverse();
     double maha_dist = y.transpose() * a * y;
     if (maha_dist > MAHA_THRESHOLD){
       R = 1.0e16 * R;
@@ -97,8 +65,8 @@ void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, do
   double weight = 1;//(1.5)/(1 + y.squaredNorm()/R.sum());
 
   // kalman gains and I_KH
-  XXM S = ((H_err * P) * H_err.transpose()) + R/weight;
-  XEM KT = S.fullPivLu().solve(H_err * P.transpose());
+  YYM S = ((H_err * P) * H_err.transpose()) + R/weight;
+  YEM KT = S.fullPivLu().solve(H_err * P.transpose());
   //EZM K = KT.transpose(); TODO: WHY DOES THIS NOT COMPILE?
   //EZM K = S.fullPivLu().solve(H_err * P.transpose()).transpose();
   //std::cout << "Here is the matrix rot:\n" << K << std::endl;
@@ -120,4 +88,42 @@ void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, do
   memcpy(in_z, y.data(), y.rows() * sizeof(double));
 }
 
+// note: extra_args dim only correct when null space projecting
+// otherwise 1
+template <int ZDIM, int EADIM, bool MAHA_TEST>
+void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, double *in_z, double *in_R, double *in_ea, double MAHA_THRESHOLD) {
+  typedef Eigen::Matrix<double, ZDIM, ZDIM, Eigen::RowMajor> ZZM;
+  typedef Eigen::Matrix<double, ZDIM, DIM, Eigen::RowMajor> ZDM;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, DIM, Eigen::RowMajor> XDM;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1> X1M;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> XXM;
+
+  double in_hx[ZDIM] = {0};
+  double in_H[ZDIM * DIM] = {0};
+
+  // state x, P
+  Eigen::Matrix<double, ZDIM, 1> z(in_z);
+  ZZM pre_R(in_R);
 
+  // functions from sympy
+  h_fun(in_x, in_ea, in_hx);
+  H_fun(in_x, in_ea, in_H);
+  ZDM pre_H(in_H);
+
+  // get y (y = z - hx)
+  Eigen::Matrix<double, ZDIM, 1> pre_y(in_hx); pre_y = z - pre_y;
+  if (Hea_fun){
+    typedef Eigen::Matrix<double, ZDIM, EADIM, Eigen::RowMajor> ZAM;
+    double in_Hea[ZDIM * EADIM] = {0};
+    Hea_fun(in_x, in_ea, in_Hea);
+    ZAM Hea(in_Hea);
+    XXM A = Hea.transpose().fullPivLu().kernel();
+
+    X1M y = A.transpose() * pre_y;
+    XDM H = A.transpose() * pre_H;
+    XXM R = A.transpose() * pre_R * A;
+    update_state<Eigen::Dynamic, MAHA_TEST>(in_x, in_P, y, H, R, in_z, MAHA_THRESHOLD);
+  } else {
+    update_state<ZDIM, MAHA_TEST>(in_x, in_P, pre_y, pre_H, pre_R, in_z, MAHA_THRESHOLD);
+  }
+}
@@ -89,10 +89,10 @@ class Controls:
     # Setup sockets
     self.pm = messaging.PubMaster(['controlsState', 'carControl', 'onroadEvents', 'frogpilotCarControl'])
 
-    self.sensor_packets = ["accelerometer", "gyroscope"]
+    self.sensor_packets = ["accelerometer", "gyroscope", "sensorEvents"]
     self.camera_packets = ["roadCameraState", "driverCameraState", "wideRoadCameraState"]
 
-    self.log_sock = messaging.sub_sock('androidLog')
+    self.log_sock = messaging.sub_sock('androidLogs')
 
     # TODO: de-couple controlsd with card/conflate on carState without introducing controls mismatches
     self.car_state_sock = messaging.sub_sock('carState', timeout=20)
@@ -402,7 +402,9 @@ class Controls:
         self.events.add(EventName.paramsdTemporaryError)
 
     # conservative HW alert. if the data or frequency are off, locationd will throw an error
-    if any((self.sm.frame - self.sm.recv_frame[s])*DT_CTRL > 10. for s in self.sensor_packets):
+    # the IMU comes in batches of sensorEvents, or a message per sample from older sensord
+    sensors_stale = {s: (self.sm.frame - self.sm.recv_frame[s])*DT_CTRL > 10. for s in self.sensor_packets}
+    if sensors_stale['sensorEvents'] and (sensors_stale['accelerometer'] or sensors_stale['gyroscope']):
       self.events.add(EventName.sensorDataInvalid)
 
     if not REPLAY:
@@ -425,15 +427,16 @@ class Controls:
       self.random_event_triggered = True
 
     for m in messaging.drain_sock(self.log_sock, wait_for_one=False):
-      try:
-        msg = m.androidLog.message
-        if any(err in msg for err in ("ERROR_CRC", "ERROR_ECC", "ERROR_STREAM_UNDERFLOW", "APPLY FAILED")):
-          csid = msg.split("CSID:")[-1].split(" ")[0]
-          evt = CSID_MAP.get(csid, None)
-          if evt is not None:
-            self.events.add(evt)
-      except UnicodeDecodeError:
-        pass
+      for log in m.androidLogs:
+        try:
+          msg = log.message
+          if any(err in msg for err in ("ERROR_CRC", "ERROR_ECC", "ERROR_STREAM_UNDERFLOW", "APPLY FAILED")):
+            csid = msg.split("CSID:")[-1].split(" ")[0]
+            evt = CSID_MAP.get(csid, None)
+            if evt is not None:
+              self.events.add(evt)
+        except UnicodeDecodeError:
+          pass
 
     # TODO: fix simulator
     if not SIMULATION or REPLAY:
@@ -67,13 +67,17 @@ if __name__ == "__main__":
           print_logmessage(m.logMonoTime-st, m.errorLogMessage, min_level)
         elif m.which() == 'androidLog':
           print_androidlog(m.logMonoTime-st, m.androidLog)
+        elif m.which() == 'androidLogs':
+          for log in m.androidLogs:
+            print_androidlog(m.logMonoTime-st, log)
   else:
-    sm = messaging.SubMaster(['logMessage', 'androidLog'], addr=args.addr)
+    sm = messaging.SubMaster(['logMessage', 'androidLogs'], addr=args.addr)
     while True:
       sm.update()
 
       if sm.updated['logMessage']:
         print_logmessage(sm.logMonoTime['logMessage'], sm['logMessage'], min_level)
 
-      if sm.updated['androidLog']:
-        print_androidlog(sm.logMonoTime['androidLog'], sm['androidLog'])
+      if sm.updated['androidLogs']:
+        for log in sm['androidLogs']:
+          print_androidlog(sm.logMonoTime['androidLogs'], log)
@@ -41,7 +41,8 @@ if __name__ == "__main__":
   total_times = [0.]*8
   busy_times = [0.]*8
 
-  prev_proclog: capnp._DynamicStructReader | None = None
+  # procLog only has the processes that changed since the last one, and all of them every 20s
+  last_procs: dict[int, tuple[int, capnp._DynamicStructReader]] = {}
   prev_proclog_t: int | None = None
 
   while True:
@@ -74,27 +75,27 @@ if __name__ == "__main__":
 
       print(f"CPU {100.0 * mean(cores):.2f}% - RAM: {last_mem:.2f}% - Temp {last_temp:.2f}C")
 
-      if args.cpu and prev_proclog is not None and prev_proclog_t is not None:
+      log_t = sm.logMonoTime['procLog']
+      if args.cpu and prev_proclog_t is not None:
         procs: dict[str, float] = defaultdict(float)
-        dt = (sm.logMonoTime['procLog'] - prev_proclog_t) / 1e9
+        dt = (log_t - prev_proclog_t) / 1e9
         for proc in m.procs:
-          try:
-            name = proc_name(proc)
-            prev_proc = [p for p in prev_proclog.procs if proc.pid == p.pid][0]
-            cpu_time = proc_cputime_total(proc) - proc_cputime_total(prev_proc)
-            cpu_usage = cpu_time / dt * 100.
-            procs[name] += cpu_usage
-          except IndexError:
-            pass
+          if proc.pid in last_procs:
+            cpu_time = proc_cputime_total(proc) - proc_cputime_total(last_procs[proc.pid][1])
+            procs[proc_name(proc)] += cpu_time / dt * 100.
 
         print("Top CPU usage:")
         for k, v in sorted(procs.items(), key=lambda item: item[1], reverse=True)[:10]:
           print(f"{k.rjust(70)}   {v:.2f} %")
         print()
 
+      for proc in m.procs:
+        last_procs[proc.pid] = (log_t, proc)
+      last_procs = {pid: p for pid, p in last_procs.items() if log_t - p[0] < 25e9}
+
       if args.mem:
         mems = {}
-        for proc in m.procs:
+        for _, proc in last_procs.values():
           name = proc_name(proc)
           mems[name] = float(proc.memRss) / 1e6
         print("Top memory usage:")
@@ -102,5 +103,4 @@ if __name__ == "__main__":
           print(f"{k.rjust(70)}   {v:.2f} MB")
         print()
 
-      prev_proclog = m
-      prev_proclog_t = sm.logMonoTime['procLog']
+      prev_proclog_t = log_t
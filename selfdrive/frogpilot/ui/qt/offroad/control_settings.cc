@@ -878,10 +878,12 @@ FrogPilotControlsPanel::FrogPilotControlsPanel(SettingsWindow *parent) : FrogPil
 
   QObject::connect(trafficResetButton, &FrogPilotButtonsControl::buttonClicked, this, [=]() {
     if (FrogPilotConfirmationDialog::yesorno(tr("Are you sure you want to completely reset your settings for the 'Traffic Mode' personality?"), this)) {
-      params.putFloat("TrafficFollow", 0.5);
-      params.putFloat("TrafficJerkAcceleration", 50);
-      params.putFloat("TrafficJerkDanger", 100);
-      params.putFloat("TrafficJerkSpeed", 50);
+      ParamsTransaction txn;
+      txn.putFloat("TrafficFollow", 0.5);
+      txn.putFloat("TrafficJerkAcceleration", 50);
+      txn.putFloat("TrafficJerkDanger", 100);
+      txn.putFloat("TrafficJerkSpeed", 50);
+      params.commit(txn);
       trafficFollowToggle->refresh();
       trafficAccelerationToggle->refresh();
       trafficDangerToggle->refresh();
@@ -898,10 +900,12 @@ FrogPilotControlsPanel::FrogPilotControlsPanel(SettingsWindow *parent) : FrogPil
 
   QObject::connect(aggressiveResetButton, &FrogPilotButtonsControl::buttonClicked, this, [=]() {
     if (FrogPilotConfirmationDialog::yesorno(tr("Are you sure you want to completely reset your settings for the 'Aggressive' personality?"), this)) {
-      params.putFloat("AggressiveFollow", 1.25);
-      params.putFloat("AggressiveJerkAcceleration", 50);
-      params.putFloat("AggressiveJerkDanger", 100);
-      params.putFloat("AggressiveJerkSpeed", 50);
+      ParamsTransaction txn;
+      txn.putFloat("AggressiveFollow", 1.25);
+      txn.putFloat("AggressiveJerkAcceleration", 50);
+      txn.putFloat("AggressiveJerkDanger", 100);
+      txn.putFloat("AggressiveJerkSpeed", 50);
+      params.commit(txn);
       aggressiveFollowToggle->refresh();
       aggressiveAccelerationToggle->refresh();
       aggressiveDangerToggle->refresh();
@@ -918,10 +922,12 @@ FrogPilotControlsPanel::FrogPilotControlsPanel(SettingsWindow *parent) : FrogPil
 
   QObject::connect(standardResetButton, &FrogPilotButtonsControl::buttonClicked, this, [=]() {
     if (FrogPilotConfirmationDialog::yesorno(tr("Are you sure you want to completely reset your settings for the 'Standard' personality?"), this)) {
-      params.putFloat("StandardFollow", 1.45);
-      params.putFloat("StandardJerkAcceleration", 100);
-      params.putFloat("StandardJerkDanger", 100);
-      params.putFloat("StandardJerkSpeed", 100);
+      ParamsTransaction txn;
+      txn.putFloat("StandardFollow", 1.45);
+      txn.putFloat("StandardJerkAcceleration", 100);
+      txn.putFloat("StandardJerkDanger", 100);
+      txn.putFloat("StandardJerkSpeed", 100);
+      params.commit(txn);
       standardFollowToggle->refresh();
       standardAccelerationToggle->refresh();
       standardDangerToggle->refresh();
@@ -938,10 +944,12 @@ FrogPilotControlsPanel::FrogPilotControlsPanel(SettingsWindow *parent) : FrogPil
 
   QObject::connect(relaxedResetButton, &FrogPilotButtonsControl::buttonClicked, this, [=]() {
     if (FrogPilotConfirmationDialog::yesorno(tr("Are you sure you want to completely reset your settings for the 'Relaxed' personality?"), this)) {
-      params.putFloat("RelaxedFollow", 1.75);
-      params.putFloat("RelaxedJerkAcceleration", 100);
-      params.putFloat("RelaxedJerkDanger", 100);
-      params.putFloat("RelaxedJerkSpeed", 100);
+      ParamsTransaction txn;
+      txn.putFloat("RelaxedFollow", 1.75);
+      txn.putFloat("RelaxedJerkAcceleration", 100);
+      txn.putFloat("RelaxedJerkDanger", 100);
+      txn.putFloat("RelaxedJerkSpeed", 100);
+      params.commit(txn);
       relaxedFollowToggle->refresh();
       relaxedAccelerationToggle->refresh();
       relaxedDangerToggle->refresh();
@@ -954,8 +962,10 @@ FrogPilotControlsPanel::FrogPilotControlsPanel(SettingsWindow *parent) : FrogPil
   steerRatioToggle = static_cast<FrogPilotParamValueToggleControl*>(toggles["SteerRatio"]);
 
   QObject::connect(steerRatioToggle, &FrogPilotParamValueToggleControl::buttonClicked, this, [this]() {
-    params.putFloat("SteerRatio", steerRatioStock);
-    params.putBool("ResetSteerRatio", false);
+    ParamsTransaction txn;
+    txn.putFloat("SteerRatio", steerRatioStock);
+    txn.putBool("ResetSteerRatio", false);
+    params.commit(txn);
     steerRatioToggle->refresh();
     updateFrogPilotToggles();
   });
@@ -1031,22 +1041,25 @@ void FrogPilotControlsPanel::updateMetric() {
     double distanceConversion = isMetric ? FOOT_TO_METER : METER_TO_FOOT;
     double speedConversion = isMetric ? MILE_TO_KM : KM_TO_MILE;
 
-    params.putIntNonBlocking("LaneDetectionWidth", std::nearbyint(params.getInt("LaneDetectionWidth") * distanceConversion));
-    params.putIntNonBlocking("StoppingDistance", std::nearbyint(params.getInt("StoppingDistance") * distanceConversion));
-
-    params.putIntNonBlocking("CESpeed", std::nearbyint(params.getInt("CESpeed") * speedConversion));
-    params.putIntNonBlocking("CESpeedLead", std::nearbyint(params.getInt("CESpeedLead") * speedConversion));
-    params.putIntNonBlocking("CustomCruise", std::nearbyint(params.getInt("CustomCruise") * speedConversion));
-    params.putIntNonBlocking("CustomCruiseLong", std::nearbyint(params.getInt("CustomCruiseLong") * speedConversion));
-    params.putIntNonBlocking("MinimumLaneChangeSpeed", std::nearbyint(params.getInt("MinimumLaneChangeSpeed") * speedConversion));
-    params.putIntNonBlocking("Offset1", std::nearbyint(params.getInt("Offset1") * speedConversion));
-    params.putIntNonBlocking("Offset2", std::nearbyint(params.getInt("Offset2") * speedConversion));
-    params.putIntNonBlocking("Offset3", std::nearbyint(params.getInt("Offset3") * speedConversion));
-    params.putIntNonBlocking("Offset4", std::nearbyint(params.getInt("Offset4") * speedConversion));
-    params.putIntNonBlocking("PauseAOLOnBrake", std::nearbyint(params.getInt("PauseAOLOnBrake") * speedConversion));
-    params.putIntNonBlocking("PauseLateralOnSignal", std::nearbyint(params.getInt("PauseLateralOnSignal") * speedConversion));
-    params.putIntNonBlocking("PauseLateralSpeed", std::nearbyint(params.getInt("PauseLateralSpeed") * speedConversion));
-    params.putIntNonBlocking("SetSpeedOffset", std::nearbyint(params.getInt("SetSpeedOffset") * speedConversion));
+    // convert all of them or none, a crash must not leave them in mixed units
+    ParamsTransaction txn;
+    txn.putInt("LaneDetectionWidth", std::nearbyint(params.getInt("LaneDetectionWidth") * distanceConversion));
+    txn.putInt("StoppingDistance", std::nearbyint(params.getInt("StoppingDistance") * distanceConversion));
+
+    txn.putInt("CESpeed", std::nearbyint(params.getInt("CESpeed") * speedConversion));
+    txn.putInt("CESpeedLead", std::nearbyint(params.getInt("CESpeedLead") * speedConversion));
+    txn.putInt("CustomCruise", std::nearbyint(params.getInt("CustomCruise") * speedConversion));
+    txn.putInt("CustomCruiseLong", std::nearbyint(params.getInt("CustomCruiseLong") * speedConversion));
+    txn.putInt("MinimumLaneChangeSpeed", std::nearbyint(params.getInt("MinimumLaneChangeSpeed") * speedConversion));
+    txn.putInt("Offset1", std::nearbyint(params.getInt("Offset1") * speedConversion));
+    txn.putInt("Offset2", std::nearbyint(params.getInt("Offset2") * speedConversion));
+    txn.putInt("Offset3", std::nearbyint(params.getInt("Offset3") * speedConversion));
+    txn.putInt("Offset4", std::nearbyint(params.getInt("Offset4") * speedConversion));
+    txn.putInt("PauseAOLOnBrake", std::nearbyint(params.getInt("PauseAOLOnBrake") * speedConversion));
+    txn.putInt("PauseLateralOnSignal", std::nearbyint(params.getInt("PauseLateralOnSignal") * speedConversion));
+    txn.putInt("PauseLateralSpeed", std::nearbyint(params.getInt("PauseLateralSpeed") * speedConversion));
+    txn.putInt("SetSpeedOffset", std::nearbyint(params.getInt("SetSpeedOffset") * speedConversion));
+    params.commitNonBlocking(txn);
   }
 
   FrogPilotParamValueControl *customCruiseToggle = static_cast<FrogPilotParamValueControl*>(toggles["CustomCruise"]);
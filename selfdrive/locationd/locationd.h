@@ -6,6 +6,7 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "cereal/messaging/messaging.h"
 #include "common/transformations/coordinates.hpp"
@@ -22,6 +23,9 @@
 
 #define POSENET_STD_HIST_HALF 20
 
+// inputs that make liveLocationKalman.inputsOK false while their values are invalid
+const std::vector<const char *> CRITICAL_INPUT_SERVICES = {"cameraOdometry", "liveCalibration", "accelerometer", "gyroscope"};
+
 enum LocalizerGnssSource {
   UBLOX, QCOM
 };
@@ -30,6 +34,7 @@ class Localizer {
 public:
   Localizer(LocalizerGnssSource gnss_source = LocalizerGnssSource::UBLOX);
 
+  // publishes liveLocationKalman from the msgq inputs until exit, see main.cc
   int locationd_thread();
 
   void reset_kalman(double current_time = NAN);
@@ -42,6 +47,7 @@ public:
   bool critical_services_valid(const std::map<std::string, double> &critical_services);
   bool is_timestamp_valid(double current_time);
   void determine_gps_mode(double current_time);
+  void update_time_to_first_fix(double current_time);
   bool are_inputs_ok();
   void observation_timings_invalid_reset();
 
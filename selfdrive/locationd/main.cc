@@ -0,0 +1,79 @@
+#include "selfdrive/locationd/locationd.h"
+
+#include "common/util.h"
+
+using namespace Eigen;
+
+ExitHandler do_exit;
+
+int Localizer::locationd_thread() {
+  Params params;
+  LocalizerGnssSource source;
+  const char* gps_location_socket;
+  if (params.getBool("UbloxAvailable")) {
+    source = LocalizerGnssSource::UBLOX;
+    gps_location_socket = "gpsLocationExternal";
+  } else {
+    source = LocalizerGnssSource::QCOM;
+    gps_location_socket = "gpsLocation";
+  }
+
+  this->configure_gnss_source(source);
+  const std::initializer_list<const char *> service_list = {gps_location_socket, "cameraOdometry", "liveCalibration",
+                                                          "carState", "accelerometer", "gyroscope", "sensorEvents"};
+
+  // sensord sends the IMU in batches of sensorEvents, older logs have a message per sample
+  SubMaster sm(service_list, {}, nullptr, {gps_location_socket, "accelerometer", "gyroscope", "sensorEvents"});
+  auto sensors_ok = [&sm]() {
+    auto ok = [&sm](const char *service) { return sm.alive(service) && sm.valid(service); };
+    return ok("sensorEvents") || (ok("accelerometer") && ok("gyroscope"));
+  };
+  PubMaster pm({"liveLocationKalman"});
+
+  uint64_t cnt = 0;
+  bool filterInitialized = false;
+  while (!do_exit) {
+    sm.update();
+    if (filterInitialized){
+      this->observation_timings_invalid_reset();
+      for (const char* service : service_list) {
+        if (sm.updated(service) && sm.valid(service)){
+          const cereal::Event::Reader log = sm[service];
+          this->handle_msg(log);
+        }
+      }
+    } else {
+      filterInitialized = sm.allAliveAndValid() && sensors_ok();
+    }
+
+    const char* trigger_msg = "cameraOdometry";
+    if (sm.updated(trigger_msg)) {
+      bool inputsOK = sm.allValid() && this->are_inputs_ok();
+      bool gpsOK = this->is_gps_ok();
+      bool sensorsOK = sensors_ok();
+
+      // Log time to first fix
+      this->update_time_to_first_fix(sm[trigger_msg].getLogMonoTime() * 1e-9);
+
+      MessageBuilder msg_builder;
+      kj::ArrayPtr<capnp::byte> bytes = this->get_message_bytes(msg_builder, inputsOK, sensorsOK, gpsOK, filterInitialized);
+      pm.send("liveLocationKalman", bytes.begin(), bytes.size());
+
+      if (cnt % 1200 == 0 && gpsOK) {  // once a minute
+        VectorXd posGeo = this->get_position_geodetic();
+        std::string lastGPSPosJSON = util::string_format(
+          "{\"latitude\": %.15f, \"longitude\": %.15f, \"altitude\": %.15f}", posGeo(0), posGeo(1), posGeo(2));
+        params.putNonBlocking("LastGPSPosition", lastGPSPosJSON);
+      }
+      cnt++;
+    }
+  }
+  return 0;
+}
+
+int main() {
+  util::set_realtime_priority(5);
+
+  Localizer localizer;
+  return localizer.locationd_thread();
+}
@@ -42,23 +42,22 @@ LiveKalman::LiveKalman() {
   }
 
   // init filter
-  this->filter = std::make_shared<EKFSym>(this->name, get_mapmat(this->Q), get_mapvec(this->initial_x),
-    get_mapmat(initial_P), this->dim_state, this->dim_state_err, 0, 0, 0, std::vector<int>(),
+  this->filter = std::make_shared<EKFSymCore<LIVE_DIM, LIVE_EDIM>>(ekf_lookup(this->name), this->Q, this->initial_x,
+    this->initial_P, this->dim_state, this->dim_state_err, 0, 0, 0, std::vector<int>(),
     std::vector<int>{3}, std::vector<std::string>(), 0.8);
 }
 
 void LiveKalman::init_state(const VectorXd &state, const VectorXd &covs_diag, double filter_time) {
   MatrixXdr covs = covs_diag.asDiagonal();
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  this->filter->init_state(state, covs, filter_time);
 }
 
 void LiveKalman::init_state(const VectorXd &state, const MatrixXdr &covs, double filter_time) {
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  this->filter->init_state(state, covs, filter_time);
 }
 
 void LiveKalman::init_state(const VectorXd &state, double filter_time) {
-  MatrixXdr covs = this->filter->covs();
-  this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
+  this->filter->init_state(state, this->filter->covs(), filter_time);
 }
 
 VectorXd LiveKalman::get_x() {
@@ -81,13 +80,16 @@ std::vector<MatrixXdr> LiveKalman::get_R(int kind, int n) {
   return R;
 }
 
-std::optional<Estimate> LiveKalman::predict_and_observe(double t, int kind, const std::vector<VectorXd> &meas, std::vector<MatrixXdr> R) {
-  std::optional<Estimate> r;
-  if (R.size() == 0) {
-    R = this->get_R(kind, meas.size());
+bool LiveKalman::predict_and_observe(double t, int kind, const std::vector<VectorXd> &meas, const std::vector<MatrixXdr> &R) {
+  // the observation noise of the kind is used unless R is given
+  this->z_maps.clear();
+  this->R_maps.clear();
+  for (int i = 0; i < meas.size(); i++) {
+    this->z_maps.push_back(get_mapvec(meas[i]));
+    this->R_maps.push_back(get_mapmat(R.empty() ? this->obs_noise[kind] : R[i]));
   }
-  r = this->filter->predict_and_update_batch(t, kind, get_vec_mapvec(meas), get_vec_mapmat(R));
-  return r;
+  this->extra_args.resize(meas.size());
+  return this->filter->predict_and_update(t, kind, this->z_maps, this->R_maps, this->extra_args);
 }
 
 void LiveKalman::predict(double t) {
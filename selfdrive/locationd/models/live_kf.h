@@ -9,6 +9,7 @@
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/Dense>
 
+#include "generated/live.h"
 #include "generated/live_kf_constants.h"
 #include "rednose/helpers/ekf_sym.h"
 
@@ -34,7 +35,8 @@ public:
   double get_filter_time();
   std::vector<MatrixXdr> get_R(int kind, int n);
 
-  std::optional<Estimate> predict_and_observe(double t, int kind, const std::vector<Eigen::VectorXd> &meas, std::vector<MatrixXdr> R = {});
+  // returns false if the observation is too old to be used
+  bool predict_and_observe(double t, int kind, const std::vector<Eigen::VectorXd> &meas, const std::vector<MatrixXdr> &R = {});
   std::optional<Estimate> predict_and_update_odo_speed(std::vector<Eigen::VectorXd> speed, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_trans(std::vector<Eigen::VectorXd> trans, double t, int kind);
   std::optional<Estimate> predict_and_update_odo_rot(std::vector<Eigen::VectorXd> rot, double t, int kind);
@@ -51,7 +53,7 @@ public:
 private:
   std::string name = "live";
 
-  std::shared_ptr<EKFSym> filter;
+  std::shared_ptr<EKFSymCore<LIVE_DIM, LIVE_EDIM>> filter;
 
   int dim_state;
   int dim_state_err;
@@ -63,4 +65,9 @@ private:
   MatrixXdr reset_orientation_P;
   MatrixXdr Q;  // process noise
   std::unordered_map<int, MatrixXdr> obs_noise;
+
+  // reused for each observation
+  std::vector<Eigen::Map<Eigen::VectorXd>> z_maps;
+  std::vector<Eigen::Map<MatrixXdr>> R_maps;
+  std::vector<std::vector<double>> extra_args;
 };
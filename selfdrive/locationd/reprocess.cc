@@ -0,0 +1,404 @@
+#include <bzlib.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <capnp/dynamic.h>
+
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/locationd/locationd.h"
+
+// Reprocesses rlogs through the Localizer offline. The inputs locationd subscribes to are
+// fed in log time order, without msgq, and the liveLocationKalman it would have published
+// after each cameraOdometry is written to <out_dir>/<segment>.npz, one array per field.
+// Every segment starts with a fresh filter, so segments are reprocessed in parallel.
+//
+// With --check, each output is compared against the liveLocationKalman recorded after the
+// same cameraOdometry, with the tolerance process replay uses, and any mismatch fails the run,
+// as does a segment without anything to compare.
+// Logs from process replay match exactly, logs from a device differ where locationd saw its
+// inputs in a different order.
+//
+// usage: reprocess [-j jobs] [-o out_dir] [--check] [--tolerance tol] rlog...
+
+const double NUMPY_TOLERANCE = 1e-7;
+
+struct Field {
+  std::string name;
+  char type;  // 'f' float, 'i' integer or enum, 'b' bool
+  std::vector<double> values;
+};
+
+// one row of the output: the liveLocationKalman fields in schema order, measurements
+// split into their value, std and valid
+static std::vector<Field> flatten(uint64_t log_mono_time, bool valid, cereal::LiveLocationKalman::Reader llk) {
+  std::vector<Field> row = {{"logMonoTime", 'i', {(double)log_mono_time}}, {"valid", 'b', {(double)valid}}};
+  capnp::DynamicStruct::Reader dyn = llk;
+  for (auto field : dyn.getSchema().getFields()) {
+    if (!dyn.has(field)) continue;
+
+    std::string name = field.getProto().getName();
+    capnp::DynamicValue::Reader value = dyn.get(field);
+    switch (field.getType().which()) {
+      case capnp::schema::Type::STRUCT: {
+        auto meas = value.as<cereal::LiveLocationKalman::Measurement>();
+        row.push_back({name, 'f', std::vector<double>(meas.getValue().begin(), meas.getValue().end())});
+        row.push_back({name + "_std", 'f', std::vector<double>(meas.getStd().begin(), meas.getStd().end())});
+        row.push_back({name + "_valid", 'b', {(double)meas.getValid()}});
+        break;
+      }
+      case capnp::schema::Type::BOOL:
+        row.push_back({name, 'b', {(double)value.as<bool>()}});
+        break;
+      case capnp::schema::Type::FLOAT32:
+      case capnp::schema::Type::FLOAT64:
+        row.push_back({name, 'f', {value.as<double>()}});
+        break;
+      case capnp::schema::Type::ENUM:
+        row.push_back({name, 'i', {(double)value.as<capnp::DynamicEnum>().getRaw()}});
+        break;
+      default:
+        row.push_back({name, 'i', {(double)value.as<int64_t>()}});
+        break;
+    }
+  }
+  return row;
+}
+
+// name of the first field that differs, like selfdrive/test/process_replay/compare_logs.py
+static std::string compare(const std::vector<Field> &a, const std::vector<Field> &b, double tolerance) {
+  for (size_t i = 0; i < std::max(a.size(), b.size()); ++i) {
+    if (i >= a.size() || i >= b.size() || a[i].name != b[i].name || a[i].values.size() != b[i].values.size()) {
+      return i < a.size() ? a[i].name : b[i].name;
+    }
+    if (a[i].name == "logMonoTime") continue;
+
+    for (size_t j = 0; j < a[i].values.size(); ++j) {
+      double x = a[i].values[j], y = b[i].values[j];
+      if (std::isnan(x) && std::isnan(y)) continue;
+      if (!(std::abs(x - y) <= std::max(tolerance, tolerance * std::max(std::abs(x), std::abs(y))))) {
+        return a[i].name;
+      }
+    }
+  }
+  return "";
+}
+
+class Columns {
+public:
+  void append(const std::vector<Field> &row) {
+    if (columns.empty()) {
+      for (const Field &f : row) columns.push_back({f.name, f.type, (int)f.values.size()});
+    }
+    assert(row.size() == columns.size());
+    for (size_t i = 0; i < row.size(); ++i) {
+      Column &c = columns[i];
+      assert(row[i].name == c.name && row[i].values.size() == c.width);
+      for (double v : row[i].values) {
+        if (c.type == 'f') {
+          c.data.append((const char *)&v, sizeof(v));
+        } else if (c.type == 'i') {
+          int64_t n = v;
+          c.data.append((const char *)&n, sizeof(n));
+        } else {
+          c.data.push_back(v != 0);
+        }
+      }
+    }
+    rows++;
+  }
+
+  // numpy's npz: an uncompressed zip of one .npy per column
+  bool write_npz(const std::string &path) const {
+    std::string zip, central;
+    for (const Column &c : columns) {
+      std::string name = c.name + ".npy";
+      std::string npy = to_npy(c);
+      uint32_t crc = crc32(0, (const Bytef *)npy.data(), npy.size());
+      uint32_t offset = zip.size();
+
+      put(zip, 4, 0x04034b50); put(zip, 2, 20); put(zip, 2, 0); put(zip, 2, 0); put(zip, 2, 0); put(zip, 2, 0x21);
+      put(zip, 4, crc); put(zip, 4, npy.size()); put(zip, 4, npy.size()); put(zip, 2, name.size()); put(zip, 2, 0);
+      zip += name + npy;
+
+      put(central, 4, 0x02014b50); put(central, 2, 20); put(central, 2, 20); put(central, 2, 0); put(central, 2, 0);
+      put(central, 2, 0); put(central, 2, 0x21); put(central, 4, crc); put(central, 4, npy.size()); put(central, 4, npy.size());
+      put(central, 2, name.size()); put(central, 2, 0); put(central, 2, 0); put(central, 2, 0); put(central, 2, 0);
+      put(central, 4, 0); put(central, 4, offset);
+      central += name;
+    }
+    uint32_t central_offset = zip.size();
+    zip += central;
+    put(zip, 4, 0x06054b50); put(zip, 2, 0); put(zip, 2, 0); put(zip, 2, columns.size()); put(zip, 2, columns.size());
+    put(zip, 4, central.size()); put(zip, 4, central_offset); put(zip, 2, 0);
+    return util::write_file(path.c_str(), zip.data(), zip.size(), O_WRONLY | O_CREAT | O_TRUNC) == 0;
+  }
+
+  size_t rows = 0;
+
+private:
+  struct Column {
+    std::string name;
+    char type;
+    int width;
+    std::string data;
+  };
+
+  static void put(std::string &s, int bytes, uint32_t v) {
+    for (int i = 0; i < bytes; ++i) s.push_back((v >> (8 * i)) & 0xff);
+  }
+
+  std::string to_npy(const Column &c) const {
+    const char *descr = c.type == 'f' ? "<f8" : c.type == 'i' ? "<i8" : "|b1";
+    std::string shape = c.width == 1 ? util::string_format("(%zu,)", rows) : util::string_format("(%zu, %d)", rows, c.width);
+    std::string header = util::string_format("{'descr': '%s', 'fortran_order': False, 'shape': %s, }", descr, shape.c_str());
+    // magic, version and header length take 10 bytes, the data starts 64 byte aligned
+    header.append(63 - (10 + header.size()) % 64, ' ');
+    header += '\n';
+
+    std::string npy = "\x93NUMPY\x01";
+    npy.push_back('\0');
+    put(npy, 2, header.size());
+    return npy + header + c.data;
+  }
+
+  std::vector<Column> columns;
+};
+
+static std::string decompress_bz2(const std::string &in) {
+  if (in.empty()) return {};
+
+  bz_stream strm = {};
+  if (BZ2_bzDecompressInit(&strm, 0, 0) != BZ_OK) return {};
+
+  std::string out(in.size() * 5, '\0');
+  strm.next_in = (char *)in.data();
+  strm.avail_in = in.size();
+  int err = BZ_OK;
+  while (err == BZ_OK) {
+    if (strm.total_out_lo32 == out.size()) out.resize(out.size() * 2);
+    strm.next_out = &out[strm.total_out_lo32];
+    strm.avail_out = out.size() - strm.total_out_lo32;
+    err = BZ2_bzDecompress(&strm);
+    if (err == BZ_OK && strm.avail_in == 0 && strm.avail_out > 0) break;  // truncated
+  }
+  out.resize(strm.total_out_lo32);
+  BZ2_bzDecompressEnd(&strm);
+  return out;
+}
+
+struct Event {
+  uint64_t mono_time;
+  cereal::Event::Which which;
+  kj::ArrayPtr<const capnp::word> data;
+};
+
+struct Segment {
+  std::string path, name;
+  bool ok = false;
+  size_t events = 0, outputs = 0, compared = 0, mismatched = 0;
+  std::map<std::string, size_t> mismatched_fields;
+  std::string error;
+};
+
+static void reprocess(Segment &seg, const std::string &out_dir, bool check, double tolerance) {
+  std::string raw = util::read_file(seg.path);
+  if (util::ends_with(seg.path, ".bz2")) {
+    raw = decompress_bz2(raw);
+  }
+  if (raw.empty()) {
+    seg.error = "failed to read";
+    return;
+  }
+
+  kj::Array<capnp::word> words = kj::heapArray<capnp::word>(raw.size() / sizeof(capnp::word));
+  memcpy(words.begin(), raw.data(), words.size() * sizeof(capnp::word));
+  raw = {};
+
+  std::vector<Event> events;
+  bool ublox = false;
+  try {
+    kj::ArrayPtr<const capnp::word> rest = words;
+    while (rest.size() > 0) {
+      capnp::FlatArrayMessageReader reader(rest);
+      auto event = reader.getRoot<cereal::Event>();
+      events.push_back({event.getLogMonoTime(), event.which(), kj::arrayPtr(rest.begin(), reader.getEnd())});
+      ublox |= event.which() == cereal::Event::GPS_LOCATION_EXTERNAL;
+      rest = kj::arrayPtr(reader.getEnd(), rest.end());
+    }
+  } catch (const kj::Exception &e) {
+    // the last message of a log that was cut off
+  }
+  std::stable_sort(events.begin(), events.end(), [](auto &a, auto &b) { return a.mono_time < b.mono_time; });
+  seg.events = events.size();
+
+  // the services locationd subscribes to, with the gps it would pick, see main.cc
+  const auto gps = ublox ? cereal::Event::GPS_LOCATION_EXTERNAL : cereal::Event::GPS_LOCATION;
+  struct State {
+    bool alive = false, valid = true;
+  };
+  std::unordered_map<int, State> services = {
+    {gps, {true, true}}, {cereal::Event::CAMERA_ODOMETRY, {}}, {cereal::Event::LIVE_CALIBRATION, {}},
+    {cereal::Event::CAR_STATE, {}}, {cereal::Event::ACCELEROMETER, {}}, {cereal::Event::GYROSCOPE, {}},
+    {cereal::Event::SENSOR_EVENTS, {}},
+  };
+  auto all_alive_and_valid = [&](std::initializer_list<int> which) {
+    return std::all_of(which.begin(), which.end(), [&](int w) { return services[w].alive && services[w].valid; });
+  };
+  // the IMU in batches, or a message per sample in older logs
+  auto sensors_ok = [&]() {
+    return all_alive_and_valid({cereal::Event::SENSOR_EVENTS}) ||
+           all_alive_and_valid({cereal::Event::ACCELEROMETER, cereal::Event::GYROSCOPE});
+  };
+
+  Localizer localizer(ublox ? LocalizerGnssSource::UBLOX : LocalizerGnssSource::QCOM);
+  Columns columns;
+  std::vector<Field> unmatched;
+  bool initialized = false;
+  for (const Event &e : events) {
+    capnp::FlatArrayMessageReader reader(e.data);
+    auto event = reader.getRoot<cereal::Event>();
+
+    if (e.which == cereal::Event::LIVE_LOCATION_KALMAN) {
+      if (check && !unmatched.empty()) {
+        std::string field = compare(unmatched, flatten(e.mono_time, event.getValid(), event.getLiveLocationKalman()), tolerance);
+        seg.compared++;
+        if (!field.empty()) {
+          seg.mismatched++;
+          seg.mismatched_fields[field]++;
+        }
+        unmatched.clear();
+      }
+      continue;
+    }
+
+    auto it = services.find(e.which);
+    if (it == services.end()) continue;
+    it->second = {true, event.getValid()};
+
+    if (initialized) {
+      localizer.observation_timings_invalid_reset();
+      if (event.getValid()) {
+        localizer.handle_msg(event);
+      }
+    } else {
+      initialized = all_alive_and_valid({gps, cereal::Event::CAMERA_ODOMETRY, cereal::Event::LIVE_CALIBRATION,
+                                         cereal::Event::CAR_STATE}) && sensors_ok();
+    }
+
+    if (e.which == cereal::Event::CAMERA_ODOMETRY) {
+      bool all_valid = std::all_of(services.begin(), services.end(), [](auto &s) { return s.second.valid; });
+      bool inputs_ok = all_valid && localizer.are_inputs_ok();
+      bool gps_ok = localizer.is_gps_ok();
+      localizer.update_time_to_first_fix(e.mono_time * 1e-9);
+
+      MessageBuilder msg;
+      localizer.get_message_bytes(msg, inputs_ok, sensors_ok(), gps_ok, initialized);
+      auto out = msg.getRoot<cereal::Event>().asReader();
+      std::vector<Field> row = flatten(e.mono_time, out.getValid(), out.getLiveLocationKalman());
+      columns.append(row);
+      unmatched = std::move(row);
+    }
+  }
+  seg.outputs = columns.rows;
+
+  if (!out_dir.empty() && columns.rows > 0 && !columns.write_npz(out_dir + "/" + seg.name + ".npz")) {
+    seg.error = "failed to write " + seg.name + ".npz";
+    return;
+  }
+  seg.ok = true;
+}
+
+static std::string segment_name(const std::string &path) {
+  // <route>--<segment>/rlog.bz2 is named after its directory
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  name = name.substr(0, name.find('.'));
+  if (name == "rlog" && path.find('/') != std::string::npos) {
+    std::string dir = path.substr(0, path.find_last_of('/'));
+    name = dir.substr(dir.find_last_of('/') + 1);
+  }
+  return name;
+}
+
+int main(int argc, char *argv[]) {
+  int jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string out_dir;
+  bool check = false;
+  double tolerance = NUMPY_TOLERANCE;
+  std::vector<Segment> segments;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      jobs = std::max(1, atoi(argv[++i]));
+    } else if (arg == "-o" && i + 1 < argc) {
+      out_dir = argv[++i];
+    } else if (arg == "--check") {
+      check = true;
+    } else if (arg == "--tolerance" && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (arg[0] != '-') {
+      segments.push_back({arg, segment_name(arg)});
+    } else {
+      segments.clear();
+      break;
+    }
+  }
+  if (segments.empty()) {
+    fprintf(stderr, "usage: %s [-j jobs] [-o out_dir] [--check] [--tolerance tol] rlog...\n", argv[0]);
+    return 1;
+  }
+  if (!out_dir.empty() && !util::create_directories(out_dir, 0775)) {
+    fprintf(stderr, "failed to create %s\n", out_dir.c_str());
+    return 1;
+  }
+
+  const uint64_t start = nanos_since_boot();
+  std::atomic<size_t> next = 0;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min<int>(jobs, segments.size()); ++i) {
+    threads.emplace_back([&]() {
+      for (size_t j = next++; j < segments.size(); j = next++) {
+        reprocess(segments[j], out_dir, check, tolerance);
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+  const double seconds = (nanos_since_boot() - start) * 1e-9;
+
+  bool ok = true;
+  size_t events = 0;
+  for (const Segment &seg : segments) {
+    events += seg.events;
+    if (!seg.ok) {
+      printf("%s: %s\n", seg.name.c_str(), seg.error.c_str());
+      ok = false;
+      continue;
+    }
+
+    printf("%s: %zu events, %zu outputs", seg.name.c_str(), seg.events, seg.outputs);
+    if (check) {
+      printf(", %zu/%zu match the log", seg.compared - seg.mismatched, seg.compared);
+      for (auto &[field, count] : seg.mismatched_fields) {
+        printf(", %s differs %zu times", field.c_str(), count);
+      }
+      if (seg.compared == 0) {
+        printf(", no output to compare against a liveLocationKalman of the log");
+      }
+      ok &= seg.compared > 0 && seg.mismatched == 0;
+    }
+    printf("\n");
+  }
+  printf("%zu segments, %zu events in %.1f s with %d jobs\n", segments.size(), events, seconds, jobs);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/locationd/models/live_kf.h"
+#include "system/sensord/sensors/constants.h"
+
+// Replays the imu, camera odometry and standstill observations of a log through the live
+// filter, with their arrival delayed by a random jitter so the filter has to rewind, and
+// measures what an update costs with the dimensions known at compile time and at runtime.
+//
+// usage: ekf_rewind_benchmark <rlog>   (uncompressed)
+
+using namespace Eigen;
+
+static std::atomic<uint64_t> allocations = 0;
+
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) { allocations++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { allocations++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { allocations++; return __libc_realloc(p, size); }
+}
+
+struct Input {
+  double t;
+  int kind;
+  VectorXd meas;
+  MatrixXdr R;
+};
+
+static VectorXd floatlist2vector(const capnp::List<float, capnp::Kind::PRIMITIVE>::Reader &floatlist) {
+  VectorXd res(floatlist.size());
+  for (int i = 0; i < floatlist.size(); i++) {
+    res[i] = floatlist[i];
+  }
+  return res;
+}
+
+static void add_sensor(std::vector<Input> &inputs, const cereal::SensorEventData::Reader &log) {
+  if (log.getTimestamp() == 0 || log.getSource() == cereal::SensorEventData::SensorSource::BMX055) {
+    return;
+  }
+
+  double t = 1e-9 * log.getTimestamp();
+  if (log.getSensor() == SENSOR_GYRO_UNCALIBRATED && log.getType() == SENSOR_TYPE_GYROSCOPE_UNCALIBRATED) {
+    auto v = log.getGyroUncalibrated().getV();
+    inputs.push_back({t, OBSERVATION_PHONE_GYRO, Vector3d(-v[2], -v[1], -v[0])});
+  } else if (log.getSensor() == SENSOR_ACCELEROMETER && log.getType() == SENSOR_TYPE_ACCELEROMETER) {
+    auto v = log.getAcceleration().getV();
+    inputs.push_back({t, OBSERVATION_PHONE_ACCEL, Vector3d(-v[2], -v[1], -v[0])});
+  }
+}
+
+static std::vector<Input> read_inputs(const std::string &data) {
+  std::vector<Input> inputs;
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)data.data(), data.size() / sizeof(capnp::word));
+  while (words.size() > 0) {
+    capnp::FlatArrayMessageReader reader(words);
+    words = kj::arrayPtr(reader.getEnd(), words.end());
+
+    auto event = reader.getRoot<cereal::Event>();
+    double t = event.getLogMonoTime() * 1e-9;
+    if (event.isAccelerometer()) {
+      add_sensor(inputs, event.getAccelerometer());
+    } else if (event.isGyroscope()) {
+      add_sensor(inputs, event.getGyroscope());
+    } else if (event.isCameraOdometry()) {
+      // the odometry is in the calibrated frame, which is close enough to the device frame here
+      auto odo = event.getCameraOdometry();
+      MatrixXdr rot_R = (10.0 * floatlist2vector(odo.getRotStd())).array().square().matrix().asDiagonal();
+      MatrixXdr trans_R = (10.0 * floatlist2vector(odo.getTransStd())).array().square().matrix().asDiagonal();
+      inputs.push_back({t, OBSERVATION_CAMERA_ODO_ROTATION, floatlist2vector(odo.getRot()), rot_R});
+      inputs.push_back({t, OBSERVATION_CAMERA_ODO_TRANSLATION, floatlist2vector(odo.getTrans()), trans_R});
+    } else if (event.isCarState() && event.getCarState().getStandstill()) {
+      inputs.push_back({t, OBSERVATION_NO_ROT, Vector3d::Zero()});
+      inputs.push_back({t, OBSERVATION_NO_ACCEL, Vector3d::Zero()});
+    }
+  }
+
+  std::stable_sort(inputs.begin(), inputs.end(), [](auto &a, auto &b) { return a.t < b.t; });
+  return inputs;
+}
+
+template <typename Filter>
+static void run(const char *name, Filter &ekf, const std::vector<Input> &inputs, double jitter) {
+  // each observation arrives up to jitter seconds late
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> delay(0.0, jitter);
+  std::vector<std::pair<double, const Input *>> arrivals;
+  for (const Input &in : inputs) {
+    arrivals.push_back({in.t + delay(rng), &in});
+  }
+  std::stable_sort(arrivals.begin(), arrivals.end(), [](auto &a, auto &b) { return a.first < b.first; });
+
+  std::unordered_map<int, MatrixXdr> obs_noise;
+  for (auto &[kind, noise] : live_obs_noise_diag) {
+    obs_noise[kind] = noise.asDiagonal();
+  }
+  ekf.init_state(live_initial_x, MatrixXdr(live_initial_P_diag.asDiagonal()), inputs.front().t);
+
+  std::vector<Map<VectorXd>> z;
+  std::vector<Map<MatrixXdr>> R;
+  std::vector<std::vector<double>> extra_args = {{}};
+  std::vector<double> ns;
+  ns.reserve(arrivals.size());
+  uint64_t rewound = 0, dropped = 0, allocs = 0;
+  for (auto &[arrival, in] : arrivals) {
+    const MatrixXdr &in_R = in->R.size() > 0 ? in->R : obs_noise[in->kind];
+    z.clear();
+    z.push_back(Map<VectorXd>((double *)in->meas.data(), in->meas.rows()));
+    R.clear();
+    R.push_back(Map<MatrixXdr>((double *)in_R.data(), in_R.rows(), in_R.cols()));
+    rewound += in->t < ekf.get_filter_time();
+
+    const uint64_t start_allocations = allocations;
+    const uint64_t start = nanos_since_boot();
+    dropped += !ekf.predict_and_update(in->t, in->kind, z, R, extra_args);
+    ns.push_back(nanos_since_boot() - start);
+    allocs += allocations - start_allocations;
+  }
+
+  std::sort(ns.begin(), ns.end());
+  double mean = 0;
+  for (double n : ns) mean += n / ns.size();
+  printf("%-8s jitter %4.0f ms: %zu updates, %5.1f%% out of order, %lu too old, %7.0f ns mean, %7.0f ns p50, %7.0f ns p99, %6.2f allocations/update\n",
+         name, jitter * 1e3, ns.size(), 100.0 * rewound / ns.size(), dropped, mean, ns[ns.size() / 2], ns[ns.size() * 99 / 100], double(allocs) / ns.size());
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <rlog>\n", argv[0]);
+    return 1;
+  }
+
+  std::string data = util::read_file(argv[1]);
+  std::vector<Input> inputs = read_inputs(data);
+  if (inputs.empty()) {
+    fprintf(stderr, "no locationd inputs in %s\n", argv[1]);
+    return 1;
+  }
+
+  // the filter as LiveKalman sets it up
+  const VectorXd x = live_initial_x;
+  const MatrixXdr P = live_initial_P_diag.asDiagonal();
+  const MatrixXdr Q = live_Q_diag.asDiagonal();
+  auto fixed = std::make_unique<EKFSymCore<LIVE_DIM, LIVE_EDIM>>(ekf_lookup("live"), Q, x, P, x.rows(), P.rows(), 0, 0, 0,
+                                                                 std::vector<int>(), std::vector<int>{3}, std::vector<std::string>(), 0.8);
+  auto dynamic = std::make_unique<EKFSym>("live", get_mapmat(Q), get_mapvec(x), get_mapmat(P), x.rows(), P.rows(), 0, 0, 0,
+                                          std::vector<int>(), std::vector<int>{3}, std::vector<std::string>(), 0.8);
+  for (double jitter : {0.0, 0.01, 0.05, 0.2, 0.5}) {
+    run("fixed", *fixed, inputs, jitter);
+    run("dynamic", *dynamic, inputs, jitter);
+  }
+  return 0;
+}
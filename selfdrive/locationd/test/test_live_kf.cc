@@ -0,0 +1,130 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "selfdrive/locationd/models/live_kf.h"
+
+using namespace Eigen;
+
+static const EKF *live_ekf() {
+  const EKF *ekf = ekf_lookup("live");
+  REQUIRE(ekf);
+  return ekf;
+}
+
+static MatrixXdr obs_noise(int kind) {
+  auto it = live_obs_noise_diag.find(kind);
+  return it != live_obs_noise_diag.end() ? MatrixXdr(it->second.asDiagonal()) : MatrixXdr(Vector3d(0.1, 0.1, 0.1).asDiagonal());
+}
+
+static void require_close(const MatrixXdr &a, const MatrixXdr &b, double tolerance) {
+  REQUIRE(a.rows() == b.rows());
+  REQUIRE(a.cols() == b.cols());
+  REQUIRE((a - b).cwiseAbs().maxCoeff() <= tolerance * std::max(1.0, b.cwiseAbs().maxCoeff()));
+}
+
+// the update with dynamically sized matrices, as the generated filters did it before
+// the observation size was known at compile time
+static VectorXd reference_update(const EKF *ekf, int kind, VectorXd &x, MatrixXdr &P, const VectorXd &z, const MatrixXdr &R) {
+  double ea = 0;
+  VectorXd hx(z.rows());
+  MatrixXdr H(z.rows(), x.rows()), H_mod(x.rows(), P.rows());
+  ekf->hs.at(kind)(x.data(), &ea, hx.data());
+  ekf->Hs.at(kind)(x.data(), &ea, H.data());
+  ekf->H_mod_fun(x.data(), H_mod.data());
+
+  VectorXd y = z - hx;
+  MatrixXdr H_err = H * H_mod;
+  MatrixXdr S = ((H_err * P) * H_err.transpose()) + R;
+  MatrixXdr KT = S.fullPivLu().solve(H_err * P.transpose());
+  MatrixXdr I_KH = MatrixXdr::Identity(P.rows(), P.cols()) - (KT.transpose() * H_err);
+
+  VectorXd dx = KT.transpose() * y;
+  VectorXd x_new(x.rows());
+  ekf->err_fun(x.data(), dx.data(), x_new.data());
+  x = x_new;
+  P = ((I_KH * P) * I_KH.transpose()) + ((KT.transpose() * R) * KT);
+  return y;
+}
+
+TEST_CASE("fixed size updates match the dynamic reference") {
+  const EKF *ekf = live_ekf();
+  std::mt19937 rng(0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  for (int kind : ekf->kinds) {
+    SECTION("kind " + std::to_string(kind)) {
+      VectorXd x = live_initial_x;
+      for (int i = STATE_ECEF_VELOCITY_START; i < x.rows(); i++) {
+        x[i] += 0.1 * noise(rng);
+      }
+      MatrixXdr P = live_initial_P_diag.asDiagonal();
+      const MatrixXdr R = obs_noise(kind);
+      VectorXd z(R.rows());
+      for (int i = 0; i < z.rows(); i++) {
+        z[i] = noise(rng);
+      }
+
+      VectorXd ref_x = x, y = z;
+      MatrixXdr ref_P = P;
+      VectorXd ref_y = reference_update(ekf, kind, ref_x, ref_P, z, R);
+      ekf->updates.at(kind)(x.data(), P.data(), y.data(), (double *)R.data(), nullptr);
+
+      require_close(x, ref_x, 1e-9);
+      require_close(P, ref_P, 1e-9);
+      require_close(y, ref_y, 1e-9);
+    }
+  }
+}
+
+TEST_CASE("fixed and dynamic filters agree on out of order observations") {
+  const VectorXd x = live_initial_x;
+  const MatrixXdr P = live_initial_P_diag.asDiagonal();
+  const MatrixXdr Q = live_Q_diag.asDiagonal();
+  auto fixed = std::make_unique<EKFSymCore<LIVE_DIM, LIVE_EDIM>>(live_ekf(), Q, x, P, x.rows(), P.rows(), 0, 0, 0,
+                                                                 std::vector<int>(), std::vector<int>{3}, std::vector<std::string>(), 0.8);
+  auto dynamic = std::make_unique<EKFSym>("live", get_mapmat(Q), get_mapvec(x), get_mapmat(P), x.rows(), P.rows(), 0, 0, 0,
+                                          std::vector<int>(), std::vector<int>{3}, std::vector<std::string>(), 0.8);
+  fixed->init_state(x, P, 100.0);
+  dynamic->init_state(get_mapvec(x), get_mapmat(P), 100.0);
+
+  // imu at 100 Hz and camera odometry at 20 Hz, arriving up to 50 ms late
+  struct Observation {
+    double arrival, t;
+    int kind;
+    VectorXd z;
+  };
+  std::mt19937 rng(0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::uniform_real_distribution<double> delay(0.0, 0.05);
+  std::vector<Observation> observations;
+  for (int i = 1; i < 1000; i++) {
+    double t = 100.0 + i * 0.01;
+    observations.push_back({t + delay(rng), t, OBSERVATION_PHONE_GYRO, Vector3d(0.01 * noise(rng), 0.01 * noise(rng), 0.1 * sin(t))});
+    observations.push_back({t + delay(rng), t, OBSERVATION_PHONE_ACCEL, Vector3d(9.81 + 0.1 * noise(rng), 0.1 * noise(rng), cos(t))});
+    if (i % 5 == 0) {
+      observations.push_back({t + delay(rng), t, OBSERVATION_CAMERA_ODO_TRANSLATION, Vector3d(20.0 + noise(rng), 0.1 * noise(rng), 0.0)});
+    }
+  }
+  std::stable_sort(observations.begin(), observations.end(), [](auto &a, auto &b) { return a.arrival < b.arrival; });
+
+  std::vector<std::vector<double>> extra_args = {{}};
+  int out_of_order = 0;
+  for (Observation &obs : observations) {
+    MatrixXdr R = obs_noise(obs.kind);
+    std::vector<Map<VectorXd>> z = {get_mapvec(obs.z)};
+    std::vector<Map<MatrixXdr>> R_map = {get_mapmat(R)};
+    out_of_order += obs.t < fixed->get_filter_time();
+
+    bool fixed_used = fixed->predict_and_update(obs.t, obs.kind, z, R_map, extra_args);
+    auto estimate = dynamic->predict_and_update_batch(obs.t, obs.kind, z, R_map, extra_args);
+    REQUIRE(fixed_used == estimate.has_value());
+    REQUIRE(fixed->get_filter_time() == dynamic->get_filter_time());
+    require_close(fixed->state(), dynamic->state(), 1e-12);
+    require_close(fixed->covs(), dynamic->covs(), 1e-12);
+  }
+  REQUIRE(out_of_order > 100);
+}
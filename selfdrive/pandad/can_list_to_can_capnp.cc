@@ -2,7 +2,18 @@
 #include "selfdrive/pandad/panda.h"
 
 void can_list_to_can_capnp_cpp(const std::vector<can_frame> &can_list, std::string &out, bool sendCan, bool valid) {
-  MessageBuilder msg;
+  // words taken by the event and the list, and by each CanData and its dat
+  size_t words = 32;
+  for (const auto &f : can_list) {
+    words += 2 + (f.dat.size() + sizeof(capnp::word) - 1) / sizeof(capnp::word);
+  }
+  thread_local kj::Array<capnp::word> scratch;
+  if (scratch.size() < words) {
+    scratch = kj::heapArray<capnp::word>(words * 2);
+    memset(scratch.begin(), 0, scratch.asBytes().size());
+  }
+
+  MessageBuilder msg(scratch);
   auto event = msg.initEvent(valid);
 
   auto canData = sendCan ? event.initSendcan(can_list.size()) : event.initCan(can_list.size());
@@ -11,11 +22,10 @@ void can_list_to_can_capnp_cpp(const std::vector<can_frame> &can_list, std::stri
     auto c = canData[j];
     c.setAddress(it->address);
     c.setBusTime(it->busTime);
-    c.setDat(kj::arrayPtr((uint8_t*)it->dat.data(), it->dat.size()));
+    c.setDat(kj::arrayPtr(it->dat.data(), it->dat.size()));
     c.setSrc(it->src);
   }
-  const uint64_t msg_size = capnp::computeSerializedSizeInWords(msg) * sizeof(capnp::word);
+  const uint64_t msg_size = msg.getSerializedSize();
   out.resize(msg_size);
-  kj::ArrayOutputStream output_stream(kj::ArrayPtr<capnp::byte>((unsigned char *)out.data(), msg_size));
-  capnp::writeMessage(output_stream, msg);
+  msg.serializeToBuffer((unsigned char *)out.data(), msg_size);
 }
@@ -30,6 +30,11 @@ Panda::Panda(std::string serial, uint32_t bus_offset) : bus_offset(bus_offset) {
   return;
 }
 
+Panda::Panda(std::unique_ptr<PandaCommsHandle> handle, uint32_t bus_offset) : handle(std::move(handle)), bus_offset(bus_offset) {
+  hw_type = get_hw_type();
+  can_reset_communications();
+}
+
 bool Panda::connected() {
   return handle->connected;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <ctime>
 #include <functional>
 #include <list>
@@ -36,13 +38,34 @@ struct __attribute__((packed)) can_header {
   uint8_t checksum : 8;
 };
 
+// The data of a CAN (FD) frame, stored inline so that filling a reused
+// vector of frames doesn't allocate.
+struct can_frame_data {
+  static constexpr size_t CAPACITY = 64;
+
+  const uint8_t *data() const { return bytes; }
+  size_t size() const { return len; }
+  void assign(const char *src, size_t n) {
+    assert(n <= CAPACITY);
+    memcpy(bytes, src, n);
+    len = n;
+  }
+
+private:
+  uint8_t len = 0;
+  uint8_t bytes[CAPACITY];
+};
+
 struct can_frame {
   long address;
-  std::string dat;
+  can_frame_data dat;
   long busTime;
   long src;
 };
 
+// Serializes can_list into out as a can or sendcan event. Apart from growing out,
+// this doesn't allocate: the message is built in a scratch segment of the thread.
+void can_list_to_can_capnp_cpp(const std::vector<can_frame> &can_list, std::string &out, bool sendCan, bool valid);
 
 class Panda {
 private:
@@ -90,6 +113,7 @@ protected:
   uint32_t receive_buffer_size = 0;
 
   Panda(uint32_t bus_offset) : bus_offset(bus_offset) {}
+  Panda(std::unique_ptr<PandaCommsHandle> handle, uint32_t bus_offset);
   void pack_can_buffer(const capnp::List<cereal::CanData>::Reader &can_data_list,
                          std::function<void(uint8_t *, size_t)> write_func);
   bool unpack_can_buffer(uint8_t *data, uint32_t &size, std::vector<can_frame> &out_vec);
@@ -7,3 +7,5 @@
 
 bool safety_setter_thread(std::vector<Panda *> pandas);
 void pandad_main_thread(std::vector<std::string> serials);
+void can_send_thread(std::vector<Panda *> pandas, bool fake_send);
+void can_recv_thread(std::vector<Panda *> pandas);
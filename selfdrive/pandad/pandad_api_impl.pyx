@@ -5,9 +5,12 @@ from libcpp.string cimport string
 from libcpp cimport bool
 
 cdef extern from "panda.h":
+  cdef cppclass can_frame_data:
+    void assign(const char *src, size_t size)
+
   cdef struct can_frame:
     long address
-    string dat
+    can_frame_data dat
     long busTime
     long src
 
@@ -17,13 +20,17 @@ cdef extern from "can_list_to_can_capnp.cc":
 def can_list_to_can_capnp(can_msgs, msgtype='can', valid=True):
   cdef can_frame *f
   cdef vector[can_frame] can_list
+  cdef const char *dat
 
   can_list.reserve(len(can_msgs))
   for can_msg in can_msgs:
+    if len(can_msg[2]) > 64:
+      raise ValueError(f"CAN data longer than 64 bytes: {len(can_msg[2])}")
     f = &(can_list.emplace_back())
     f.address = can_msg[0]
     f.busTime = can_msg[1]
-    f.dat = can_msg[2]
+    dat = can_msg[2]
+    f.dat.assign(dat, len(can_msg[2]))
     f.src = can_msg[3]
 
   cdef string out
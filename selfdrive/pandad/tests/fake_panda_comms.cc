@@ -0,0 +1,206 @@
+#include "selfdrive/pandad/tests/fake_panda_comms.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/timing.h"
+
+static uint8_t checksum(const uint8_t *data, uint32_t len) {
+  uint8_t c = 0U;
+  for (uint32_t i = 0U; i < len; i++) {
+    c ^= data[i];
+  }
+  return c;
+}
+
+uint32_t FakePandaHandle::Packet::size() const {
+  return sizeof(can_header) + dlc_to_len[data[0] >> 4U];
+}
+
+FakePandaHandle::FakePandaHandle(const Config &config) : PandaCommsHandle("fake"), config(config), rng(config.seed), loopback(config.loopback) {
+  hw_serial = "fake";
+  last_arrival = nanos_since_boot();
+}
+
+int FakePandaHandle::control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout) {
+  std::lock_guard lk(lock);
+  if (request == 0xc0) {
+    // comms_can_reset
+    read_buffer = {};
+    write_buffer = {};
+  } else if (request == 0xe5) {
+    loopback = param1;
+  }
+  return 0;
+}
+
+int FakePandaHandle::control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout) {
+  memset(data, 0, length);
+  if (request == 0xc1 && length > 0) {
+    data[0] = (uint8_t)config.hw_type;
+  }
+  return length;
+}
+
+int FakePandaHandle::bulk_write(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  if (!connected) {
+    return 0;
+  }
+
+  std::lock_guard lk(lock);
+  for (int pos = 0; pos < length; pos += config.chunk_size) {
+    comms_can_write(&data[pos], std::min<uint32_t>(config.chunk_size, length - pos));
+  }
+  return length;
+}
+
+int FakePandaHandle::bulk_read(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout) {
+  if (!connected) {
+    return 0;
+  }
+
+  std::lock_guard lk(lock);
+  arrive(nanos_since_boot());
+
+  // the host reads chunks until one comes back short
+  int pos = 0;
+  while (pos < length) {
+    if (chance(config.short_read_rate)) {
+      short_reads++;
+      break;
+    }
+    const uint32_t chunk = std::min<uint32_t>(config.chunk_size, length - pos);
+    const uint32_t n = comms_can_read(&data[pos], chunk);
+    pos += n;
+    if (n < chunk) break;
+  }
+
+  if (pos > 0 && chance(config.corrupt_rate)) {
+    corruptions++;
+    data[std::uniform_int_distribution<int>(0, pos - 1)(rng)] ^= 1U << std::uniform_int_distribution<int>(0, 7)(rng);
+  }
+  return pos;
+}
+
+// queues the frames that arrived on the buses since the last read
+void FakePandaHandle::arrive(uint64_t now) {
+  arrival_remainder += (now - last_arrival) * 1e-9 * config.rx_rate;
+  last_arrival = now;
+
+  const uint32_t now_us = now / 1000;
+  for (; arrival_remainder >= 1.0; arrival_remainder -= 1.0) {
+    const uint8_t dlc = config.can_fd ? std::uniform_int_distribution<int>(8, 15)(rng) : 8;
+    Packet p = {};
+    can_header header = {};
+    header.bus = rx_count % 3;
+    header.data_len_code = dlc;
+    header.addr = 0x100 + rx_count % 0x400;
+    memcpy(p.data, &header, sizeof(header));
+    memcpy(&p.data[sizeof(can_header)], &rx_count, sizeof(rx_count));
+    memcpy(&p.data[sizeof(can_header) + sizeof(rx_count)], &now_us, sizeof(now_us));
+    rx_count++;
+    push_rx(p);
+  }
+}
+
+void FakePandaHandle::push_rx(Packet &p) {
+  can_header *header = (can_header *)p.data;
+  header->checksum = 0;
+  header->checksum = checksum(p.data, p.size());
+  if (rx_q.size() < config.rx_queue_size) {
+    rx_q.push_back(p);
+    rx_frames++;
+  } else {
+    rx_dropped++;
+  }
+}
+
+int FakePandaHandle::comms_can_read(uint8_t *data, uint32_t max_len) {
+  uint32_t pos = 0U;
+
+  // send tail of previous message if it is in buffer
+  if (read_buffer.ptr > 0U) {
+    uint32_t overflow_len = std::min(max_len - pos, read_buffer.ptr);
+    memcpy(&data[pos], read_buffer.data, overflow_len);
+    pos += overflow_len;
+    memmove(read_buffer.data, &read_buffer.data[overflow_len], read_buffer.ptr - overflow_len);
+    read_buffer.ptr -= overflow_len;
+  }
+
+  if (read_buffer.ptr == 0U) {
+    // fill rest of buffer with new data
+    while ((pos < max_len) && !rx_q.empty()) {
+      const Packet p = rx_q.front();
+      rx_q.pop_front();
+      uint32_t pckt_len = p.size();
+      if ((pos + pckt_len) <= max_len) {
+        memcpy(&data[pos], p.data, pckt_len);
+        pos += pckt_len;
+      } else {
+        memcpy(&data[pos], p.data, max_len - pos);
+        read_buffer.ptr += pckt_len - (max_len - pos);
+        memcpy(read_buffer.data, &p.data[max_len - pos], read_buffer.ptr);
+        pos = max_len;
+      }
+    }
+  }
+
+  return pos;
+}
+
+void FakePandaHandle::comms_can_write(const uint8_t *data, uint32_t len) {
+  uint32_t pos = 0U;
+
+  // assembling can message with data from buffer
+  if (write_buffer.ptr != 0U) {
+    if (write_buffer.tail_size <= (len - pos)) {
+      // we have enough data to complete the buffer
+      Packet to_push = {};
+      memcpy(&write_buffer.data[write_buffer.ptr], &data[pos], write_buffer.tail_size);
+      write_buffer.ptr += write_buffer.tail_size;
+      pos += write_buffer.tail_size;
+
+      memcpy(to_push.data, write_buffer.data, write_buffer.ptr);
+      can_send(to_push);
+
+      write_buffer.ptr = 0U;
+      write_buffer.tail_size = 0U;
+    } else {
+      // maybe next time
+      uint32_t data_size = len - pos;
+      memcpy(&write_buffer.data[write_buffer.ptr], &data[pos], data_size);
+      write_buffer.tail_size -= data_size;
+      write_buffer.ptr += data_size;
+      pos += data_size;
+    }
+  }
+
+  // rest of the message
+  while (pos < len) {
+    uint32_t pckt_len = sizeof(can_header) + dlc_to_len[(data[pos] >> 4U)];
+    if ((pos + pckt_len) <= len) {
+      Packet to_push = {};
+      memcpy(to_push.data, &data[pos], pckt_len);
+      can_send(to_push);
+      pos += pckt_len;
+    } else {
+      memcpy(write_buffer.data, &data[pos], len - pos);
+      write_buffer.ptr = len - pos;
+      write_buffer.tail_size = pckt_len - write_buffer.ptr;
+      pos += write_buffer.ptr;
+    }
+  }
+}
+
+void FakePandaHandle::can_send(const Packet &p) {
+  tx_frames++;
+  const can_header *header = (const can_header *)p.data;
+  if (on_send) {
+    on_send(*header, &p.data[sizeof(can_header)]);
+  }
+  if (loopback) {
+    Packet echo = p;
+    ((can_header *)echo.data)->returned = 1;
+    push_rx(echo);
+  }
+}
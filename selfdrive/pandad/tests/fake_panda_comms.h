@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "cereal/gen/cpp/log.capnp.h"
+#include "selfdrive/pandad/panda.h"
+
+// An in-process panda for driving pandad without hardware. Bulk transfers are cut into
+// chunks and (re)assembled the way the firmware's comms_can_read and comms_can_write
+// in panda/board/can_comms.h do, so a frame can span two transfers.
+//
+// Frames arrive on the buses at rx_rate, and start with the number of the frame and
+// the time it arrived in us since boot, both uint32_t. Sent frames are passed to
+// on_send, and with loopback they come back like on a panda in loopback mode.
+class FakePandaHandle : public PandaCommsHandle {
+public:
+  struct Config {
+    cereal::PandaState::PandaType hw_type = cereal::PandaState::PandaType::RED_PANDA;
+    // size of the chunks the firmware reads and writes: 0x40 for USB packets
+    uint32_t chunk_size = USBPACKET_MAX_SIZE;
+    // frames per second arriving on buses 0-2, 0 for none
+    double rx_rate = 0;
+    // size of the firmware's can_rx_q, frames past it are dropped
+    size_t rx_queue_size = 4096;
+    bool can_fd = false;
+    // initial loopback mode, set_loopback changes it
+    bool loopback = false;
+    // chance of a bulk read ending early, like on a timeout
+    double short_read_rate = 0;
+    // chance of a bit of a bulk read being flipped
+    double corrupt_rate = 0;
+    uint32_t seed = 0;
+  };
+
+  FakePandaHandle(const Config &config);
+  void cleanup() {}
+
+  int control_write(uint8_t request, uint16_t param1, uint16_t param2, unsigned int timeout=TIMEOUT);
+  int control_read(uint8_t request, uint16_t param1, uint16_t param2, unsigned char *data, uint16_t length, unsigned int timeout=TIMEOUT);
+  int bulk_write(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout=TIMEOUT);
+  int bulk_read(unsigned char endpoint, unsigned char *data, int length, unsigned int timeout=TIMEOUT);
+
+  std::function<void(const can_header &header, const uint8_t *dat)> on_send;
+
+  std::atomic<uint64_t> rx_frames = 0;
+  std::atomic<uint64_t> rx_dropped = 0;
+  std::atomic<uint64_t> tx_frames = 0;
+  std::atomic<uint64_t> short_reads = 0;
+  std::atomic<uint64_t> corruptions = 0;
+
+private:
+  struct Packet {
+    uint8_t data[sizeof(can_header) + 64];
+    uint32_t size() const;
+  };
+  // the overflow buffers of can_comms.h
+  struct AsmBuffer {
+    uint32_t ptr = 0;
+    uint32_t tail_size = 0;
+    uint8_t data[sizeof(Packet)];
+  };
+
+  void arrive(uint64_t now);
+  void push_rx(Packet &p);
+  int comms_can_read(uint8_t *data, uint32_t max_len);
+  void comms_can_write(const uint8_t *data, uint32_t len);
+  void can_send(const Packet &p);
+  bool chance(double p) { return p > 0 && std::uniform_real_distribution<>(0, 1)(rng) < p; }
+
+  const Config config;
+  std::mutex lock;
+  std::mt19937 rng;
+  std::deque<Packet> rx_q;
+  AsmBuffer read_buffer, write_buffer;
+  uint64_t last_arrival = 0;
+  double arrival_remainder = 0;
+  uint32_t rx_count = 0;
+  bool loopback;
+};
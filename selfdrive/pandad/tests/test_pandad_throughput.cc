@@ -0,0 +1,179 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "selfdrive/pandad/pandad.h"
+#include "selfdrive/pandad/tests/fake_panda_comms.h"
+
+struct FakePanda : public Panda {
+  FakePanda(const FakePandaHandle::Config &config, uint32_t bus_offset = 0) : FakePanda(new FakePandaHandle(config), bus_offset) {}
+  FakePandaHandle *fake;
+
+private:
+  FakePanda(FakePandaHandle *h, uint32_t bus_offset) : Panda(std::unique_ptr<PandaCommsHandle>(h), bus_offset), fake(h) {}
+};
+
+static uint32_t frame_number(const can_frame &f) {
+  uint32_t n;
+  memcpy(&n, f.dat.data(), sizeof(n));
+  return n;
+}
+
+TEST_CASE("fake panda loops back sent frames") {
+  auto chunk_size = GENERATE(USBPACKET_MAX_SIZE, SPI_BUF_SIZE - 0x40);
+  FakePandaHandle::Config config;
+  config.chunk_size = chunk_size;
+  config.loopback = true;
+  config.can_fd = true;
+  FakePanda panda(config);
+  REQUIRE(panda.hw_type == cereal::PandaState::PandaType::RED_PANDA);
+
+  MessageBuilder msg;
+  auto can_list = msg.initEvent().initSendcan(300);
+  for (int i = 0; i < can_list.size(); ++i) {
+    std::vector<uint8_t> dat(dlc_to_len[i % 16], i);
+    can_list[i].setAddress(i);
+    can_list[i].setSrc(i % 3);
+    can_list[i].setDat(kj::ArrayPtr(dat.data(), dat.size()));
+  }
+  panda.can_send(can_list.asReader());
+  REQUIRE(panda.fake->tx_frames == can_list.size());
+
+  std::vector<can_frame> frames;
+  for (int i = 0; i < 10 && frames.size() < can_list.size(); ++i) {
+    REQUIRE(panda.can_receive(frames));
+  }
+  REQUIRE(frames.size() == can_list.size());
+  for (int i = 0; i < frames.size(); ++i) {
+    REQUIRE(frames[i].address == i);
+    REQUIRE(frames[i].src == i % 3 + CAN_RETURNED_BUS_OFFSET);
+    REQUIRE(frames[i].dat.size() == dlc_to_len[i % 16]);
+    REQUIRE(std::all_of(frames[i].dat.data(), frames[i].dat.data() + frames[i].dat.size(), [=](uint8_t b) { return b == (uint8_t)i; }));
+  }
+}
+
+TEST_CASE("pandad recovers from bad transfers") {
+  FakePandaHandle::Config config;
+  config.rx_rate = 20000;
+  config.short_read_rate = 0.05;
+  config.corrupt_rate = 0.05;
+  FakePanda panda(config);
+
+  int failures = 0;
+  std::vector<can_frame> frames;
+  for (int i = 0; i < 200; ++i) {
+    frames.clear();
+    failures += !panda.can_receive(frames);
+    // frames arrive in order, the ones around a bad transfer are lost
+    for (int j = 1; j < frames.size(); ++j) {
+      REQUIRE(frame_number(frames[j]) > frame_number(frames[j - 1]));
+    }
+    util::sleep_for(1);
+  }
+  REQUIRE(panda.fake->corruptions > 0);
+  REQUIRE(panda.fake->short_reads > 0);
+  REQUIRE(failures > 0);
+  REQUIRE(failures < 200);
+}
+
+struct Latencies {
+  std::vector<double> ms;
+  void print(const char *name, uint64_t frames, uint64_t dropped) {
+    std::sort(ms.begin(), ms.end());
+    auto p = [&](double q) { return ms.empty() ? 0 : ms[std::min<size_t>(ms.size() * q, ms.size() - 1)]; };
+    printf("  %s: %lu frames, %lu dropped, latency p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           name, frames, dropped, p(0.5), p(0.95), p(0.99), ms.empty() ? 0 : ms.back());
+  }
+};
+
+static double since_ms(uint32_t us) {
+  return (uint32_t)(nanos_since_boot() / 1000 - us) / 1000.0;
+}
+
+// Runs can_recv_thread and can_send_thread against a fake panda with the given load,
+// and measures how long frames take from arriving on the bus to the can socket,
+// and from the sendcan socket to the bus.
+static void run_pandad(double rx_rate, int tx_rate, double seconds) {
+  FakePandaHandle::Config config;
+  config.rx_rate = rx_rate;
+  config.can_fd = true;
+  FakePanda panda(config);
+
+  Latencies tx;
+  panda.fake->on_send = [&](const can_header &header, const uint8_t *dat) {
+    uint32_t us;
+    memcpy(&us, dat + sizeof(uint32_t), sizeof(us));
+    tx.ms.push_back(since_ms(us));
+  };
+
+  std::unique_ptr<Context> context(Context::create());
+  std::unique_ptr<SubSocket> can_sock(SubSocket::create(context.get(), "can"));
+  can_sock->setTimeout(10);
+  PubMaster pm({"sendcan"});
+
+  // a previous run left do_exit set
+  ExitHandler do_exit;
+  do_exit = false;
+  std::thread recv_thread(can_recv_thread, std::vector<Panda *>{&panda});
+  std::thread send_thread(can_send_thread, std::vector<Panda *>{&panda}, false);
+  util::sleep_for(200);
+
+  Latencies rx;
+  uint64_t rx_received = 0, rx_lost = 0, tx_sent = 0;
+  uint32_t next = 0;
+  AlignedBuffer aligned_buf;
+  const double start = millis_since_boot();
+  double next_send = start;
+  while (millis_since_boot() - start < seconds * 1000) {
+    // sendcan comes in at 100 Hz
+    if (tx_rate > 0 && millis_since_boot() >= next_send) {
+      next_send += 10;
+      MessageBuilder msg;
+      auto can_list = msg.initEvent().initSendcan(tx_rate / 100);
+      const uint32_t us = nanos_since_boot() / 1000;
+      for (int i = 0; i < can_list.size(); ++i, ++tx_sent) {
+        uint32_t dat[2] = {(uint32_t)tx_sent, us};
+        can_list[i].setAddress(0x200 + i);
+        can_list[i].setSrc(i % 3);
+        can_list[i].setDat(kj::ArrayPtr((uint8_t *)dat, sizeof(dat)));
+      }
+      pm.send("sendcan", msg);
+    }
+
+    std::unique_ptr<Message> m(can_sock->receive());
+    if (!m) continue;
+    capnp::FlatArrayMessageReader cmsg(aligned_buf.align(m.get()));
+    for (auto c : cmsg.getRoot<cereal::Event>().getCan()) {
+      uint32_t dat[2];
+      memcpy(dat, c.getDat().begin(), sizeof(dat));
+      rx_lost += dat[0] - next;
+      next = dat[0] + 1;
+      rx_received++;
+      rx.ms.push_back(since_ms(dat[1]));
+    }
+  }
+
+  // disconnecting stops the threads
+  panda.fake->connected = false;
+  recv_thread.join();
+  send_thread.join();
+
+  printf("rx %.0f frames/s, tx %d frames/s:\n", rx_rate, tx_rate);
+  rx.print("can", rx_received, rx_lost);
+  tx.print("sendcan", panda.fake->tx_frames, tx_sent - panda.fake->tx_frames);
+  printf("  fake panda queue dropped %lu frames\n", (uint64_t)panda.fake->rx_dropped);
+}
+
+TEST_CASE("pandad_throughput", "[.][benchmark]") {
+  for (auto [rx_rate, tx_rate] : {std::make_pair(2000.0, 500), std::make_pair(10000.0, 2000), std::make_pair(50000.0, 10000)}) {
+    run_pandad(rx_rate, tx_rate, 5);
+  }
+}
@@ -1,16 +1,35 @@
 #define CATCH_CONFIG_MAIN
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
 #include "catch2/catch.hpp"
 #include "cereal/messaging/messaging.h"
 #include "common/util.h"
 #include "selfdrive/pandad/panda.h"
 
+static std::atomic<size_t> allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *p = malloc(size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+
 struct PandaTest : public Panda {
   PandaTest(uint32_t bus_offset, int can_list_size, cereal::PandaState::PandaType hw_type);
   void test_can_send();
   void test_can_recv(uint32_t chunk_size = 0);
   void test_chunked_can_recv();
+  size_t count_recv_allocations(int cycles);
+
+  using Panda::pack_can_buffer;
+  using Panda::unpack_can_buffer;
+  using Panda::receive_buffer;
+  using Panda::receive_buffer_size;
 
   std::map<int, std::string> test_data;
   int can_list_size = 0;
@@ -102,6 +121,33 @@ void PandaTest::test_can_recv(uint32_t rx_chunk_size) {
   }
 }
 
+// Receives the same bulk transfers for a number of cycles, the way can_recv_thread does,
+// and returns how many allocations unpacking and serializing took after the first cycle.
+size_t PandaTest::count_recv_allocations(int cycles) {
+  std::vector<std::vector<uint8_t>> transfers;
+  this->pack_can_buffer(can_data_list, [&](uint8_t *data, uint32_t size) {
+    transfers.emplace_back(data, data + size);
+  });
+
+  std::vector<can_frame> frames;
+  std::string out;
+  size_t count = 0;
+  for (int i = 0; i <= cycles; ++i) {
+    const size_t start = allocations;
+    frames.clear();
+    for (const auto &t : transfers) {
+      memcpy(&this->receive_buffer[this->receive_buffer_size], t.data(), t.size());
+      this->receive_buffer_size += t.size();
+      this->unpack_can_buffer(this->receive_buffer, this->receive_buffer_size, frames);
+    }
+    can_list_to_can_capnp_cpp(frames, out, false, true);
+    // the first cycle grows the buffers
+    if (i > 0) count += allocations - start;
+  }
+  REQUIRE(frames.size() == can_list_size);
+  return count;
+}
+
 TEST_CASE("send/recv CAN 2.0 packets") {
   auto bus_offset = GENERATE(0, 4);
   auto can_list_size = GENERATE(1, 3, 5, 10, 30, 60, 100, 200);
@@ -116,6 +162,9 @@ TEST_CASE("send/recv CAN 2.0 packets") {
   SECTION("chunked_can_receive") {
     test.test_can_recv(0x40);
   }
+  SECTION("can_receive doesn't allocate") {
+    REQUIRE(test.count_recv_allocations(10) == 0);
+  }
 }
 
 TEST_CASE("send/recv CAN FD packets") {
@@ -132,4 +181,28 @@ TEST_CASE("send/recv CAN FD packets") {
   SECTION("chunked_can_receive") {
     test.test_can_recv(0x40);
   }
+  SECTION("can_receive doesn't allocate") {
+    REQUIRE(test.count_recv_allocations(10) == 0);
+  }
+}
+
+TEST_CASE("can_recv_benchmark", "[.][benchmark]") {
+  auto hw_type = GENERATE(cereal::PandaState::PandaType::DOS, cereal::PandaState::PandaType::RED_PANDA);
+  PandaTest test(0, 200, hw_type);
+  std::vector<uint8_t> transfer;
+  test.pack_can_buffer(test.can_data_list, [&](uint8_t *data, uint32_t size) {
+    transfer.insert(transfer.end(), data, data + size);
+  });
+
+  std::vector<can_frame> frames;
+  std::string out;
+  BENCHMARK("unpack and serialize 200 frames") {
+    frames.clear();
+    memcpy(test.receive_buffer, transfer.data(), transfer.size());
+    test.receive_buffer_size = transfer.size();
+    test.unpack_can_buffer(test.receive_buffer, test.receive_buffer_size, frames);
+    can_list_to_can_capnp_cpp(frames, out, false, true);
+    return out.size();
+  };
+  printf("allocations per frame: %.3f\n", test.count_recv_allocations(100) / (100.0 * 200));
 }
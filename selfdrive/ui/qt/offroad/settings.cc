@@ -436,6 +436,8 @@ DevicePanel::DevicePanel(SettingsWindow *parent) : ListWidget(parent) {
           int result = std::system(command.c_str());
 
           if (result == 0) {
+            // the files were replaced behind Params' back
+            Params().invalidate();
             toggleBackup->setValue(tr("Success!"));
             updateFrogPilotToggles();
           } else {
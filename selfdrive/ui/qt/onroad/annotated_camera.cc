@@ -46,6 +46,12 @@ AnnotatedCameraWidget::AnnotatedCameraWidget(VisionStreamType type, QWidget* par
   initializeFrogPilotWidgets();
 }
 
+AnnotatedCameraWidget::~AnnotatedCameraWidget() {
+  makeCurrent();
+  model_overlay.reset();
+  doneCurrent();
+}
+
 void AnnotatedCameraWidget::updateState(const UIState &s) {
   const int SET_SPEED_NA = 255;
   const SubMaster &sm = *(s.sm);
@@ -293,6 +299,15 @@ void AnnotatedCameraWidget::initializeGL() {
 
   prev_draw_t = millis_since_boot();
   setBackgroundColor(bg_colors[STATUS_DISENGAGED]);
+
+  // UI_NO_GL_OVERLAY=1 draws the model with QPainter, for comparison
+  if (!getenv("UI_NO_GL_OVERLAY")) {
+    model_overlay = std::make_unique<ModelOverlay>(OVERLAY_STRIP_COUNT);
+    if (!model_overlay->initialize()) {
+      model_overlay.reset();
+    }
+  }
+  model_geometry_key = {};
 }
 
 void AnnotatedCameraWidget::updateFrameMat() {
@@ -313,34 +328,76 @@ void AnnotatedCameraWidget::updateFrameMat() {
       .translate(-intrinsic_matrix.v[2], -intrinsic_matrix.v[5]);
 }
 
+void AnnotatedCameraWidget::updateModelOverlay(const UIScene &scene) {
+  for (int i = 0; i < std::size(scene.lane_line_vertices); ++i) {
+    model_overlay->setStrip(LANE_LINE + i, scene.lane_line_vertices[i]);
+  }
+  for (int i = 0; i < std::size(scene.road_edge_vertices); ++i) {
+    model_overlay->setStrip(ROAD_EDGE + i, scene.road_edge_vertices[i]);
+  }
+  model_overlay->setStrip(PATH, scene.track_vertices);
+  model_overlay->setStrip(BLIND_SPOT_LEFT, scene.track_adjacent_vertices[4]);
+  model_overlay->setStrip(BLIND_SPOT_RIGHT, scene.track_adjacent_vertices[5]);
+  model_overlay->setStrip(ADJACENT_LEFT, scene.track_adjacent_vertices[4]);
+  model_overlay->setStrip(ADJACENT_RIGHT, scene.track_adjacent_vertices[5]);
+  path_edge_ring = model_overlay->setRing(PATH_EDGE, scene.track_edge_vertices, scene.track_vertices);
+}
+
 void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, const float v_ego) {
   painter.save();
 
   const UIScene &scene = s->scene;
   SubMaster &sm = *(s->sm);
 
+  // With the GL overlay the fills only pick the gradient of their strip and are drawn
+  // together by flushOverlay, otherwise they are painted one by one. Anything painted
+  // on top of a fill flushes the strips up to it first, so that the stacking is the same.
+  std::vector<QGradientStops> overlay_gradients(OVERLAY_STRIP_COUNT);
+  auto fill = [&](int strip, const QPolygonF &polygon, const QBrush &brush) {
+    if (model_overlay) {
+      overlay_gradients[strip] = brush.gradient() ? brush.gradient()->stops() : QGradientStops{{0.0, brush.color()}, {1.0, brush.color()}};
+    } else {
+      painter.setBrush(brush);
+      painter.drawPolygon(polygon);
+    }
+  };
+  int overlay_drawn = 0;
+  auto flushOverlay = [&](int last) {
+    if (!model_overlay || overlay_drawn >= last) return;
+    // only the gradients that changed since the last frame are uploaded
+    for (int i = overlay_drawn; i < last; ++i) {
+      model_overlay->setGradient(i, overlay_gradients[i]);
+    }
+    painter.beginNativePainting();
+    model_overlay->draw(width(), height(), devicePixelRatio(), overlay_drawn, last);
+    painter.endNativePainting();
+    overlay_drawn = last;
+  };
+
   // lanelines
   for (int i = 0; i < std::size(scene.lane_line_vertices); ++i) {
+    QBrush brush;
     if (currentHolidayTheme != 0) {
-      painter.setBrush(std::get<2>(holidayThemeConfiguration[currentHolidayTheme]).begin()->second);
+      brush = std::get<2>(holidayThemeConfiguration[currentHolidayTheme]).begin()->second;
     } else if (customColors != 0) {
-      painter.setBrush(std::get<2>(themeConfiguration[customColors]).begin()->second);
+      brush = std::get<2>(themeConfiguration[customColors]).begin()->second;
     } else {
-      painter.setBrush(QColor::fromRgbF(1.0, 1.0, 1.0, std::clamp<float>(scene.lane_line_probs[i], 0.0, 0.7)));
+      brush = QColor::fromRgbF(1.0, 1.0, 1.0, std::clamp<float>(scene.lane_line_probs[i], 0.0, 0.7));
     }
-    painter.drawPolygon(scene.lane_line_vertices[i]);
+    fill(LANE_LINE + i, scene.lane_line_vertices[i], brush);
   }
 
   // road edges
   for (int i = 0; i < std::size(scene.road_edge_vertices); ++i) {
+    QBrush brush;
     if (currentHolidayTheme != 0) {
-      painter.setBrush(std::get<2>(holidayThemeConfiguration[currentHolidayTheme]).begin()->second);
+      brush = std::get<2>(holidayThemeConfiguration[currentHolidayTheme]).begin()->second;
     } else if (customColors != 0) {
-      painter.setBrush(std::get<2>(themeConfiguration[customColors]).begin()->second);
+      brush = std::get<2>(themeConfiguration[customColors]).begin()->second;
     } else {
-      painter.setBrush(QColor::fromRgbF(1.0, 0, 0, std::clamp<float>(1.0 - scene.road_edge_stds[i], 0.0, 1.0)));
+      brush = QColor::fromRgbF(1.0, 0, 0, std::clamp<float>(1.0 - scene.road_edge_stds[i], 0.0, 1.0));
     }
-    painter.drawPolygon(scene.road_edge_vertices[i]);
+    fill(ROAD_EDGE + i, scene.road_edge_vertices[i], brush);
   }
 
   // paint path
@@ -407,8 +464,7 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
     bg.setColorAt(1.0, QColor::fromHslF(112 / 360., 1.0, 0.68, 0.0));
   }
 
-  painter.setBrush(bg);
-  painter.drawPolygon(scene.track_vertices);
+  fill(PATH, scene.track_vertices, bg);
 
   if (scene.show_stopping_point) {
     bool curve_detected = sqrt(1.0 / scene.road_curvature) < v_ego;
@@ -416,6 +472,7 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
     bool model_stopping = scene.model_length < v_ego * (10 - 3);
 
     if (model_stopping && !curve_detected && !following_lead) {
+      flushOverlay(PATH + 1);
       QPointF last_point = scene.track_vertices.last();
 
       QPointF adjusted_point = last_point - QPointF(stopSignImg.width() / 2, stopSignImg.height());
@@ -445,12 +502,11 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
     bs.setColorAt(0.5, QColor::fromHslF(0 / 360., 0.75, 0.50, 0.4));
     bs.setColorAt(1.0, QColor::fromHslF(0 / 360., 0.75, 0.50, 0.2));
 
-    painter.setBrush(bs);
     if (blindSpotLeft) {
-      painter.drawPolygon(scene.track_adjacent_vertices[4]);
+      fill(BLIND_SPOT_LEFT, scene.track_adjacent_vertices[4], bs);
     }
     if (blindSpotRight) {
-      painter.drawPolygon(scene.track_adjacent_vertices[5]);
+      fill(BLIND_SPOT_RIGHT, scene.track_adjacent_vertices[5], bs);
     }
   }
 
@@ -459,7 +515,7 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
     const float minLaneWidth = laneDetectionWidth * 0.5f;
     const float maxLaneWidth = laneDetectionWidth * 1.5f;
 
-    auto paintLane = [&](const QPolygonF &lane, float laneWidth, bool blindspot) {
+    auto paintLane = [&](int strip, const QPolygonF &lane, float laneWidth, bool blindspot) {
       QLinearGradient gradient(0, height(), 0, 0);
 
       bool redPath = laneWidth < minLaneWidth || laneWidth > maxLaneWidth || blindspot;
@@ -470,10 +526,10 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
       gradient.setColorAt(0.5, QColor::fromHslF(hueF, 0.75f, 0.50f, 0.4f));
       gradient.setColorAt(1.0, QColor::fromHslF(hueF, 0.75f, 0.50f, 0.2f));
 
-      painter.setBrush(gradient);
-      painter.drawPolygon(lane);
+      fill(strip, lane, gradient);
 
       if (scene.adjacent_path_metrics) {
+        flushOverlay(strip + 1);
         painter.setFont(InterFont(30, QFont::DemiBold));
         painter.setPen(Qt::white);
 
@@ -485,8 +541,8 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
       }
     };
 
-    paintLane(scene.track_adjacent_vertices[4], laneWidthLeft, blindSpotLeft);
-    paintLane(scene.track_adjacent_vertices[5], laneWidthRight, blindSpotRight);
+    paintLane(ADJACENT_LEFT, scene.track_adjacent_vertices[4], laneWidthLeft, blindSpotLeft);
+    paintLane(ADJACENT_RIGHT, scene.track_adjacent_vertices[5], laneWidthRight, blindSpotRight);
   }
 
   // Paint path edges
@@ -526,12 +582,19 @@ void AnnotatedCameraWidget::drawLaneLines(QPainter &painter, const UIState *s, c
     pe.setColorAt(1.0, QColor::fromHslF(112 / 360., 1.00, 0.68, 0.1));
   }
 
-  QPainterPath path;
-  path.addPolygon(scene.track_vertices);
-  path.addPolygon(scene.track_edge_vertices);
+  if (model_overlay && path_edge_ring) {
+    overlay_gradients[PATH_EDGE] = pe.stops();
+  }
+  flushOverlay(OVERLAY_STRIP_COUNT);
+
+  if (!model_overlay || !path_edge_ring) {
+    QPainterPath path;
+    path.addPolygon(scene.track_vertices);
+    path.addPolygon(scene.track_edge_vertices);
 
-  painter.setBrush(pe);
-  painter.drawPath(path);
+    painter.setBrush(pe);
+    painter.drawPath(path);
+  }
 
   painter.restore();
 }
@@ -703,7 +766,16 @@ void AnnotatedCameraWidget::paintEvent(QPaintEvent *event) {
   painter.setPen(Qt::NoPen);
 
   if (s->scene.world_objects_visible) {
-    update_model(s, model, sm["uiPlan"].getUiPlan());
+    // the model is only projected again when it or the view changed
+    auto geometry_key = std::make_tuple(sm.rcv_frame("modelV2"), sm.rcv_frame("uiPlan"), sm.rcv_frame("liveCalibration"),
+                                        s->scene.wide_cam, s->scene.enabled, s->scene.always_on_lateral_active, s->car_space_transform);
+    if (geometry_key != model_geometry_key) {
+      model_geometry_key = geometry_key;
+      update_model(s, model, sm["uiPlan"].getUiPlan());
+      if (model_overlay) {
+        updateModelOverlay(s->scene);
+      }
+    }
     drawLaneLines(painter, s, v_ego);
 
     if (s->scene.longitudinal_control && sm.rcv_frame("modelV2") > s->scene.started_frame && !s->scene.hide_lead_marker) {
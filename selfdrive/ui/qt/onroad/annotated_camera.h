@@ -2,8 +2,10 @@
 
 #include <QVBoxLayout>
 #include <memory>
+#include <tuple>
 
 #include "selfdrive/ui/qt/onroad/buttons.h"
+#include "selfdrive/ui/qt/onroad/model_overlay.h"
 #include "selfdrive/ui/qt/widgets/cameraview.h"
 
 #include "selfdrive/frogpilot/screenrecorder/screenrecorder.h"
@@ -59,6 +61,7 @@ class AnnotatedCameraWidget : public CameraWidget {
 
 public:
   explicit AnnotatedCameraWidget(VisionStreamType type, QWidget* parent = 0);
+  ~AnnotatedCameraWidget();
   void updateState(const UIState &s);
 
   MapSettingsButton *map_settings_btn;
@@ -89,6 +92,24 @@ private:
   int skip_frame_count = 0;
   bool wide_cam_requested = false;
 
+  // strips of the model overlay
+  enum OverlayStrip {
+    LANE_LINE = 0,  // four lane lines
+    ROAD_EDGE = 4,  // two road edges
+    PATH = 6,
+    BLIND_SPOT_LEFT,
+    BLIND_SPOT_RIGHT,
+    ADJACENT_LEFT,
+    ADJACENT_RIGHT,
+    PATH_EDGE,
+    OVERLAY_STRIP_COUNT,
+  };
+  void updateModelOverlay(const UIScene &scene);
+
+  std::unique_ptr<ModelOverlay> model_overlay;  // nullptr if the overlays are drawn with QPainter
+  bool path_edge_ring = false;
+  std::tuple<uint64_t, uint64_t, uint64_t, bool, bool, bool, QTransform> model_geometry_key;
+
   // FrogPilot widgets
   void initializeFrogPilotWidgets();
   void paintFrogPilotWidgets(QPainter &painter, const UIScene &scene);
@@ -0,0 +1,231 @@
+#include "selfdrive/ui/qt/onroad/model_overlay.h"
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include <QColor>
+#include <QDebug>
+
+namespace {
+
+const char overlay_vertex_shader[] =
+#ifdef __APPLE__
+  "#version 330 core\n"
+#else
+  "#version 300 es\n"
+#endif
+  "layout(location = 0) in vec2 aPosition;\n"
+  "layout(location = 1) in float aRow;\n"
+  "uniform vec2 uSize;\n"
+  "out float vT;\n"
+  "out float vRow;\n"
+  "void main() {\n"
+  "  gl_Position = vec4(aPosition.x / uSize.x * 2.0 - 1.0, 1.0 - aPosition.y / uSize.y * 2.0, 0.0, 1.0);\n"
+  "  vT = 1.0 - aPosition.y / uSize.y;\n"
+  "  vRow = aRow;\n"
+  "}\n";
+
+const char overlay_fragment_shader[] =
+#ifdef __APPLE__
+  "#version 330 core\n"
+#else
+  "#version 300 es\n"
+  "precision mediump float;\n"
+#endif
+  "uniform sampler2D uGradients;\n"
+  "uniform float uRows;\n"
+  "in float vT;\n"
+  "in float vRow;\n"
+  "out vec4 colorOut;\n"
+  "void main() {\n"
+  "  colorOut = texture(uGradients, vec2(clamp(vT, 0.0, 1.0), (vRow + 0.5) / uRows));\n"
+  "}\n";
+
+struct Vertex {
+  float x, y, row;
+};
+
+// premultiplied RGBA, interpolated between the stops and padded with the first and last one like QLinearGradient
+void fill_gradient(const QGradientStops &stops, uint32_t *texels) {
+  auto premultiplied = [](const QColor &c) {
+    return std::array<float, 4>{(float)(c.redF() * c.alphaF()), (float)(c.greenF() * c.alphaF()), (float)(c.blueF() * c.alphaF()), (float)c.alphaF()};
+  };
+  for (int x = 0; x < ModelOverlay::GRADIENT_SIZE; ++x) {
+    std::array<float, 4> color = {};
+    if (!stops.isEmpty()) {
+      const double t = (double)x / (ModelOverlay::GRADIENT_SIZE - 1);
+      auto next = std::find_if(stops.begin(), stops.end(), [t](const QGradientStop &s) { return s.first >= t; });
+      if (next == stops.begin()) {
+        color = premultiplied(stops.first().second);
+      } else if (next == stops.end()) {
+        color = premultiplied(stops.last().second);
+      } else {
+        auto prev = std::prev(next);
+        const float f = next->first > prev->first ? (t - prev->first) / (next->first - prev->first) : 1.0;
+        auto a = premultiplied(prev->second), b = premultiplied(next->second);
+        for (int c = 0; c < 4; ++c) color[c] = a[c] + (b[c] - a[c]) * f;
+      }
+    }
+    uint32_t texel = 0;
+    for (int c = 0; c < 4; ++c) {
+      texel |= (uint32_t)std::clamp<int>(color[c] * 255.0f + 0.5f, 0, 255) << (c * 8);
+    }
+    texels[x] = texel;
+  }
+}
+
+} // namespace
+
+ModelOverlay::ModelOverlay(int strip_count) : strips(strip_count), gradients(strip_count),
+                                              gradient_texels(strip_count * GRADIENT_SIZE),
+                                              strip_offsets(strip_count + 1) {}
+
+ModelOverlay::~ModelOverlay() {
+  if (program) {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteTextures(1, &gradient_texture);
+  }
+}
+
+bool ModelOverlay::initialize() {
+  program = std::make_unique<QOpenGLShaderProgram>();
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, overlay_vertex_shader) ||
+      !program->addShaderFromSourceCode(QOpenGLShader::Fragment, overlay_fragment_shader) ||
+      !program->link()) {
+    qWarning() << "failed to build the model overlay shaders, drawing them with QPainter";
+    program.reset();
+    return false;
+  }
+
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void *)offsetof(Vertex, row));
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+
+  glGenTextures(1, &gradient_texture);
+  glBindTexture(GL_TEXTURE_2D, gradient_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GRADIENT_SIZE, strips.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  assert(glGetError() == GL_NO_ERROR);
+  return true;
+}
+
+void ModelOverlay::setStrip(int i, const QPolygonF &polygon) {
+  const int half = polygon.size() / 2;
+  strips[i].clear();
+  for (int j = 0; j < half; ++j) {
+    strips[i].push_back(polygon[half + j]);
+    strips[i].push_back(polygon[half - 1 - j]);
+  }
+  strips_changed = true;
+}
+
+bool ModelOverlay::setRing(int i, const QPolygonF &outer, const QPolygonF &inner) {
+  strips[i].clear();
+  strips_changed = true;
+  const int half = outer.size() / 2;
+  if (half < 2 || outer.size() != inner.size()) return false;
+
+  // up the left side, across the far end, down the right side and across the near end
+  for (int j = 0; j < half; ++j) {
+    strips[i].push_back(outer[half + j]);
+    strips[i].push_back(inner[half + j]);
+  }
+  for (int j = 0; j < half; ++j) {
+    strips[i].push_back(outer[j]);
+    strips[i].push_back(inner[j]);
+  }
+  strips[i].push_back(outer[half]);
+  strips[i].push_back(inner[half]);
+  return true;
+}
+
+void ModelOverlay::setGradient(int i, const QGradientStops &stops) {
+  if (gradients[i] != stops) {
+    gradients[i] = stops;
+    fill_gradient(stops, &gradient_texels[i * GRADIENT_SIZE]);
+    gradients_changed = true;
+  }
+}
+
+void ModelOverlay::clearGradients() {
+  for (int i = 0; i < gradients.size(); ++i) {
+    setGradient(i, {});
+  }
+}
+
+void ModelOverlay::upload() {
+  if (strips_changed) {
+    // all strips are joined into one with degenerate triangles
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < strips.size(); ++i) {
+      strip_offsets[i] = vertices.size();
+      if (strips[i].empty()) continue;
+      if (!vertices.empty()) {
+        vertices.push_back(vertices.back());
+        vertices.push_back({(float)strips[i].front().x(), (float)strips[i].front().y(), (float)i});
+      }
+      for (const QPointF &p : strips[i]) {
+        vertices.push_back({(float)p.x(), (float)p.y(), (float)i});
+      }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    strip_offsets[strips.size()] = vertices.size();
+    strips_changed = false;
+  }
+  if (gradients_changed) {
+    glBindTexture(GL_TEXTURE_2D, gradient_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GRADIENT_SIZE, strips.size(), GL_RGBA, GL_UNSIGNED_BYTE, gradient_texels.data());
+    gradients_changed = false;
+  }
+}
+
+void ModelOverlay::draw(int width, int height, qreal device_pixel_ratio, int first, int last) {
+  if (!program || width <= 0 || height <= 0) return;
+
+  upload();
+  // a range starts with the degenerate triangles joining it to the previous strip
+  const int vertex_count = strip_offsets[last] - strip_offsets[first];
+  if (vertex_count <= 0) return;
+
+  glViewport(0, 0, width * device_pixel_ratio, height * device_pixel_ratio);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glDisable(GL_SCISSOR_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  glUseProgram(program->programId());
+  glUniform2f(program->uniformLocation("uSize"), width, height);
+  glUniform1f(program->uniformLocation("uRows"), strips.size());
+  glUniform1i(program->uniformLocation("uGradients"), 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, gradient_texture);
+  glBindVertexArray(vao);
+  glDrawArrays(GL_TRIANGLE_STRIP, strip_offsets[first], vertex_count);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glUseProgram(0);
+  glDisable(GL_BLEND);
+}
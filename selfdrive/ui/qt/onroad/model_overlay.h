@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <QBrush>
+#include <QOpenGLShaderProgram>
+#include <QPolygonF>
+#include <qopengl.h>
+
+// Fills the model overlays of the onroad view with a single draw call. The polygons
+// made by update_line_data are turned into triangle strips that only need to be
+// rebuilt when the polygons change, their vertical gradients are each a row of a
+// lookup texture. Coordinates are widget pixels, like those of QPainter.
+class ModelOverlay {
+public:
+  ModelOverlay(int strip_count);
+  ~ModelOverlay();
+  // Call with the GL context current. Returns false if the overlays can't be drawn with GL.
+  bool initialize();
+
+  // Sets strip i from a polygon of update_line_data: the right side reversed, then the left side.
+  void setStrip(int i, const QPolygonF &polygon);
+  // Sets strip i to the area between the outer and the inner polygon. Returns false,
+  // and clears the strip, if their sides don't have the same number of points.
+  bool setRing(int i, const QPolygonF &outer, const QPolygonF &inner);
+  // Sets the gradient from the bottom (0) to the top (1) of the widget. Strips without stops aren't drawn.
+  void setGradient(int i, const QGradientStops &stops);
+  void clearGradients();
+
+  // Draws strips [first, last). Call between QPainter::beginNativePainting() and endNativePainting().
+  void draw(int width, int height, qreal device_pixel_ratio, int first, int last);
+
+  static constexpr int GRADIENT_SIZE = 256;
+
+private:
+  void upload();
+
+  std::vector<std::vector<QPointF>> strips;
+  std::vector<QGradientStops> gradients;
+  std::vector<uint32_t> gradient_texels;
+  std::vector<int> strip_offsets;  // first vertex of each strip in the buffer, and the vertex count
+  bool strips_changed = true;
+  bool gradients_changed = true;
+
+  std::unique_ptr<QOpenGLShaderProgram> program;
+  GLuint vao = 0, vbo = 0, gradient_texture = 0;
+};
@@ -15,6 +15,8 @@
 #include <QOpenGLBuffer>
 #include <QOffscreenSurface>
 
+#include "common/timing.h"
+
 namespace {
 
 const char frame_vertex_shader[] =
@@ -116,6 +118,7 @@ CameraWidget::~CameraWidget() {
     glDeleteBuffers(1, &frame_vbo);
     glDeleteBuffers(1, &frame_ibo);
     glDeleteBuffers(2, textures);
+    deleteUploadBuffers();
   }
   doneCurrent();
 }
@@ -306,18 +309,7 @@ void CameraWidget::paintGL() {
   glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, egl_images[frame->idx]);
   assert(glGetError() == GL_NO_ERROR);
 #else
-  // fallback to copy
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textures[0]);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width, stream_height, GL_RED, GL_UNSIGNED_BYTE, frame->y);
-  assert(glGetError() == GL_NO_ERROR);
-
-  glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride/2);
-  glActiveTexture(GL_TEXTURE0 + 1);
-  glBindTexture(GL_TEXTURE_2D, textures[1]);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width/2, stream_height/2, GL_RG, GL_UNSIGNED_BYTE, frame->uv);
-  assert(glGetError() == GL_NO_ERROR);
+  uploadFrame(frame);
 #endif
 
   glUniformMatrix4fv(program->uniformLocation("uTransform"), 1, GL_TRUE, frame_mat.v);
@@ -378,9 +370,162 @@ void CameraWidget::vipcConnected(VisionIpcClient *vipc_client) {
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, stream_width/2, stream_height/2, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
   assert(glGetError() == GL_NO_ERROR);
+
+  createUploadBuffers();
 #endif
 }
 
+void CameraWidget::createUploadBuffers() {
+  deleteUploadBuffers();
+  if (getenv("CAMERA_NO_PBO")) return;
+
+  const size_t size = stream_stride * stream_height * 3 / 2;
+  upload_buffers.resize(UPLOAD_BUFFER_COUNT);
+  for (int i = 0; i < (int)upload_buffers.size(); ++i) {
+    glGenBuffers(1, &upload_buffers[i].pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_buffers[i].pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    if (!mapUploadBuffer(i)) {
+      qWarning() << "failed to map pixel buffer, uploading frames directly";
+      deleteUploadBuffers();
+      break;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void CameraWidget::deleteUploadBuffers() {
+  // vipcThread is stopped or waiting on vipcConnected, so no buffer is being filled
+  std::lock_guard lk(frame_lock);
+  for (auto &b : upload_buffers) {
+    if (b.ptr) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    if (b.fence) {
+      glDeleteSync(b.fence);
+    }
+    glDeleteBuffers(1, &b.pbo);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  upload_buffers.clear();
+}
+
+bool CameraWidget::mapUploadBuffer(int i) {
+  // the fence of the last upload has signaled, so the buffer can be mapped without synchronizing
+  auto &b = upload_buffers[i];
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+  b.ptr = (uint8_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, stream_stride * stream_height * 3 / 2,
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  b.state = UploadBuffer::FREE;
+  return b.ptr != nullptr;
+}
+
+void CameraWidget::copyToUploadBuffer(const VisionBuf *buf) {
+  UploadBuffer *target = nullptr;
+  {
+    std::lock_guard lk(frame_lock);
+    // take a free buffer, or replace the oldest frame that wasn't uploaded yet
+    for (auto &b : upload_buffers) {
+      if (b.state == UploadBuffer::FREE && b.ptr) {
+        target = &b;
+        break;
+      } else if (b.state == UploadBuffer::FILLED && (!target || b.seq < target->seq)) {
+        target = &b;
+      }
+    }
+    if (!target) {
+      ++upload_stats.dropped;
+      return;
+    }
+    if (target->state == UploadBuffer::FILLED) {
+      ++upload_stats.dropped;
+    }
+    target->state = UploadBuffer::FILLING;
+  }
+
+  const double start_ts = millis_since_boot();
+  const size_t y_size = stream_stride * stream_height;
+  memcpy(target->ptr, buf->y, y_size);
+  memcpy(target->ptr + y_size, buf->uv, y_size / 2);
+
+  std::lock_guard lk(frame_lock);
+  target->state = UploadBuffer::FILLED;
+  target->seq = ++upload_seq;
+  upload_stats.copy_ms += millis_since_boot() - start_ts;
+}
+
+void CameraWidget::uploadFrame(const VisionBuf *frame) {
+  const double start_ts = millis_since_boot();
+  UploadBuffer *latest = nullptr;
+  upload_stats.queue_depth = 0;
+  for (int i = 0; i < (int)upload_buffers.size(); ++i) {
+    auto &b = upload_buffers[i];
+    if (b.state == UploadBuffer::UPLOADING && glClientWaitSync(b.fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+      glDeleteSync(b.fence);
+      b.fence = nullptr;
+      mapUploadBuffer(i);
+    } else if (b.state == UploadBuffer::FILLED) {
+      ++upload_stats.queue_depth;
+      if (!latest || b.seq > latest->seq) latest = &b;
+    }
+  }
+
+  if (upload_buffers.empty()) {
+    // fallback to copy
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width, stream_height, GL_RED, GL_UNSIGNED_BYTE, frame->y);
+    assert(glGetError() == GL_NO_ERROR);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride/2);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width/2, stream_height/2, GL_RG, GL_UNSIGNED_BYTE, frame->uv);
+    assert(glGetError() == GL_NO_ERROR);
+  } else if (latest) {
+    // older frames are skipped, their buffers can be filled again right away
+    for (auto &b : upload_buffers) {
+      if (b.state == UploadBuffer::FILLED && &b != latest) {
+        b.state = UploadBuffer::FREE;
+        ++upload_stats.dropped;
+      }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, latest->pbo);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    latest->ptr = nullptr;
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textures[0]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width, stream_height, GL_RED, GL_UNSIGNED_BYTE, (const void *)0);
+    assert(glGetError() == GL_NO_ERROR);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stream_stride/2);
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_2D, textures[1]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stream_width/2, stream_height/2, GL_RG, GL_UNSIGNED_BYTE,
+                    (const void *)(uintptr_t)(stream_stride * stream_height));
+    assert(glGetError() == GL_NO_ERROR);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    latest->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    latest->state = UploadBuffer::UPLOADING;
+  } else {
+    // no new frame, the textures still hold the last one
+    return;
+  }
+
+  upload_stats.upload_ms += millis_since_boot() - start_ts;
+  if (++upload_stats.frames % 100 == 0 && getenv("CAMERA_UPLOAD_STATS")) {
+    qDebug().nospace() << stream_name.c_str() << " upload: " << upload_stats.frames << " frames, " << upload_stats.dropped << " dropped, "
+                       << upload_stats.copy_ms / upload_stats.frames << " ms copy, " << upload_stats.upload_ms / upload_stats.frames
+                       << " ms upload per frame, queue depth " << upload_stats.queue_depth;
+  }
+}
+
 void CameraWidget::vipcFrameReceived() {
   update();
 }
@@ -416,6 +561,9 @@ void CameraWidget::vipcThread() {
     }
 
     if (VisionBuf *buf = vipc_client->recv(&meta_main, 1000)) {
+#ifndef QCOM2
+      copyToUploadBuffer(buf);
+#endif
       {
         std::lock_guard lk(frame_lock);
         frames.push_back(std::make_pair(meta_main.frame_id, buf));
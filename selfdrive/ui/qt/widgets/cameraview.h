@@ -7,6 +7,7 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
@@ -28,6 +29,7 @@
 
 const int FRAME_BUFFER_SIZE = 5;
 static_assert(FRAME_BUFFER_SIZE <= YUV_BUFFER_COUNT);
+const int UPLOAD_BUFFER_COUNT = 3;
 
 class CameraWidget : public QOpenGLWidget, protected QOpenGLFunctions {
   Q_OBJECT
@@ -42,6 +44,18 @@ public:
   VisionStreamType getStreamType() { return active_stream_type; }
   void stopVipcThread();
 
+  struct UploadStats {
+    uint64_t frames = 0;   // frames uploaded to the textures
+    uint64_t dropped = 0;  // frames overwritten before they were uploaded
+    double copy_ms = 0;    // total time vipcThread spent copying frames
+    double upload_ms = 0;  // total time paintGL spent uploading frames
+    int queue_depth = 0;   // frames waiting for upload at the last paint
+  };
+  UploadStats uploadStats() {
+    std::lock_guard lk(frame_lock);
+    return upload_stats;
+  }
+
 signals:
   void clicked();
   void vipcThreadConnected(VisionIpcClient *);
@@ -58,6 +72,11 @@ protected:
   void updateCalibration(const mat3 &calib);
   void vipcThread();
   void clearFrames();
+  void createUploadBuffers();
+  void deleteUploadBuffers();
+  bool mapUploadBuffer(int i);
+  void copyToUploadBuffer(const VisionBuf *buf);
+  void uploadFrame(const VisionBuf *frame);
 
   int glWidth();
   int glHeight();
@@ -94,6 +113,20 @@ protected:
   uint32_t draw_frame_id = 0;
   uint32_t prev_frame_id = 0;
 
+  // Frames are copied by vipcThread into mapped pixel buffers, paintGL uploads
+  // the textures from them without waiting for the copy.
+  struct UploadBuffer {
+    enum State { FREE, FILLING, FILLED, UPLOADING };
+    State state = FREE;
+    GLuint pbo = 0;
+    uint8_t *ptr = nullptr;  // mapped while FREE or FILLING
+    GLsync fence = nullptr;  // signaled once the upload from the buffer is done
+    uint64_t seq = 0;
+  };
+  std::vector<UploadBuffer> upload_buffers;
+  uint64_t upload_seq = 0;
+  UploadStats upload_stats;
+
 protected slots:
   void vipcConnected(VisionIpcClient *vipc_client);
   void vipcFrameReceived();
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+
+#include "common/timing.h"
+#include "selfdrive/ui/qt/onroad/annotated_camera.h"
+#include "selfdrive/ui/qt/util.h"
+#include "selfdrive/ui/ui.h"
+
+// Measures how long AnnotatedCameraWidget takes to paint the recorded model outputs.
+// Run it next to a replay of a route, which publishes modelV2 at 20 Hz:
+//   tools/replay/replay --demo &
+//   selfdrive/ui/tests/ui_paint_benchmark -s 60
+// and with UI_NO_GL_OVERLAY=1 to compare with the QPainter fills.
+
+class TimedCameraWidget : public AnnotatedCameraWidget {
+public:
+  TimedCameraWidget() : AnnotatedCameraWidget(VISION_STREAM_ROAD) {}
+  std::vector<double> paint_ms;
+
+protected:
+  void paintEvent(QPaintEvent *event) override {
+    const double start = millis_since_boot();
+    AnnotatedCameraWidget::paintEvent(event);
+    if (uiState()->scene.world_objects_visible) {
+      paint_ms.push_back(millis_since_boot() - start);
+    }
+  }
+};
+
+int main(int argc, char *argv[]) {
+  initApp(argc, argv);
+
+  QApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Benchmark painting the model overlays of the onroad view.");
+  parser.addHelpOption();
+  parser.addOption(QCommandLineOption(QStringList() << "s" << "seconds", "How long to measure, defaults to 30.", "seconds", "30"));
+  parser.process(app);
+
+  TimedCameraWidget w;
+  w.setFixedSize(2160, 1080);
+  w.show();
+
+  // paint every UI update, so each model frame is painted at least once
+  QObject::connect(uiState(), &UIState::uiUpdate, [&](const UIState &s) {
+    w.updateState(s);
+    w.update();
+  });
+
+  QTimer::singleShot(parser.value("seconds").toInt() * 1000, [&]() {
+    auto &ms = w.paint_ms;
+    if (ms.empty()) {
+      fprintf(stderr, "nothing painted, is a route being replayed?\n");
+      app.exit(1);
+      return;
+    }
+    std::sort(ms.begin(), ms.end());
+    double sum = 0;
+    for (double t : ms) sum += t;
+    printf("%s: %zu paints, mean %.3f ms, p50 %.3f ms, p95 %.3f ms, max %.3f ms\n",
+           getenv("UI_NO_GL_OVERLAY") ? "QPainter" : "GL overlay", ms.size(), sum / ms.size(),
+           ms[ms.size() / 2], ms[ms.size() * 95 / 100], ms.back());
+    app.quit();
+  });
+
+  return app.exec();
+}
@@ -518,20 +518,26 @@ void UIState::update() {
   }
   emit uiUpdate(*this);
 
-  // Update FrogPilot parameters
+  // Update FrogPilot parameters, the memory params are only read again after one of them changed
   static bool update_toggles = false;
 
-  if (paramsMemory.getBool("FrogPilotTogglesUpdated")) {
-    update_toggles = true;
-  } else if (update_toggles) {
-    ui_update_frogpilot_params(this);
-    update_toggles = false;
+  if (uint32_t generation = paramsMemory.generation(); generation != params_memory_generation) {
+    params_memory_generation = generation;
+    if (paramsMemory.getBool("FrogPilotTogglesUpdated")) {
+      update_toggles = true;
+    } else if (update_toggles) {
+      ui_update_frogpilot_params(this);
+      update_toggles = false;
+    }
+    ce_status = paramsMemory.getInt("CEStatus");
+    holiday_theme = paramsMemory.getInt("CurrentHolidayTheme");
+    random_event = paramsMemory.getInt("CurrentRandomEvent");
   }
 
   // FrogPilot variables that need to be constantly updated
-  scene.conditional_status = scene.conditional_experimental && scene.enabled ? paramsMemory.getInt("CEStatus") : 0;
-  scene.current_holiday_theme = scene.holiday_themes ? paramsMemory.getInt("CurrentHolidayTheme") : 0;
-  scene.current_random_event = scene.random_events ? paramsMemory.getInt("CurrentRandomEvent") : 0;
+  scene.conditional_status = scene.conditional_experimental && scene.enabled ? ce_status : 0;
+  scene.current_holiday_theme = scene.holiday_themes ? holiday_theme : 0;
+  scene.current_random_event = scene.random_events ? random_event : 0;
   scene.driver_camera_timer = scene.driver_camera && scene.reverse ? scene.driver_camera_timer + 1 : 0;
   scene.started_timer = scene.started ? scene.started_timer + 1 : 0;
 }
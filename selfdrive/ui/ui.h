@@ -309,6 +309,10 @@ private:
 
   // FrogPilot variables
   Params paramsMemory{"/dev/shm/params"};
+  uint32_t params_memory_generation = UINT32_MAX;
+  int ce_status = 0;
+  int holiday_theme = 0;
+  int random_event = 0;
 };
 
 UIState *uiState();
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include "third_party/libyuv/include/libyuv.h"
 #include <jpeglib.h>
@@ -11,6 +12,7 @@
 #include "third_party/linux/include/msm_media_info.h"
 
 #include "system/camerad/cameras/camera_qcom2.h"
+#include "system/camerad/cameras/image_kernels.h"
 #ifdef QCOM2
 #include "CL/cl_ext_qcom.h"
 #endif
@@ -115,6 +117,10 @@ bool CameraBuf::acquire() {
   cur_yuv_buf = vipc_server->get_buffer(stream_type);
   cur_camera_buf = &camera_bufs[cur_buf_idx];
 
+  // void the leases on the frame this buffer held before
+  cur_yuv_buf->set_frame_id(-1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
   double start_time = millis_since_boot();
   cl_event event;
   imgproc->queue(q, camera_bufs[cur_buf_idx].buf_cl, cur_yuv_buf->buf_cl, rgb_width, rgb_height, &event, cur_frame_data.integ_lines);
@@ -151,7 +157,9 @@ void fill_frame_data(cereal::FrameData::Builder &framed, const FrameMetadata &fr
   framed.setTargetGreyFraction(frame_data.target_grey_fraction);
   framed.setProcessingTime(frame_data.processing_time);
 
+  c->exp_lock.lock();
   const float ev = c->cur_ev[frame_data.frame_id % 3];
+  c->exp_lock.unlock();
   const float perc = util::map_val(ev, c->ci->min_ev, c->ci->max_ev, 0.0f, 100.0f);
   framed.setExposureValPercent(perc);
   framed.setSensor(c->ci->image_sensor);
@@ -168,32 +176,8 @@ kj::Array<uint8_t> get_raw_frame_image(const CameraBuf *b) {
   return kj::mv(frame_image);
 }
 
-static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_width, int thumbnail_height) {
-  int downscale = b->cur_yuv_buf->width / thumbnail_width;
-  assert(downscale * thumbnail_height == b->cur_yuv_buf->height);
-  int in_stride = b->cur_yuv_buf->stride;
-
-  // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
-  std::unique_ptr<uint8[]> buf(new uint8_t[(thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2]);
-  uint8_t *y_plane = buf.get();
-  uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
-  uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
-  {
-    // subsampled conversion from nv12 to yuv
-    for (int hy = 0; hy < thumbnail_height/2; hy++) {
-      for (int hx = 0; hx < thumbnail_width/2; hx++) {
-        int ix = hx * downscale + (downscale-1)/2;
-        int iy = hy * downscale + (downscale-1)/2;
-        y_plane[(hy*2 + 0)*thumbnail_width + (hx*2 + 0)] = b->cur_yuv_buf->y[(iy*2 + 0) * in_stride + ix*2 + 0];
-        y_plane[(hy*2 + 0)*thumbnail_width + (hx*2 + 1)] = b->cur_yuv_buf->y[(iy*2 + 0) * in_stride + ix*2 + 1];
-        y_plane[(hy*2 + 1)*thumbnail_width + (hx*2 + 0)] = b->cur_yuv_buf->y[(iy*2 + 1) * in_stride + ix*2 + 0];
-        y_plane[(hy*2 + 1)*thumbnail_width + (hx*2 + 1)] = b->cur_yuv_buf->y[(iy*2 + 1) * in_stride + ix*2 + 1];
-        u_plane[hy*thumbnail_width/2 + hx] = b->cur_yuv_buf->uv[iy*in_stride + ix*2 + 0];
-        v_plane[hy*thumbnail_width/2 + hx] = b->cur_yuv_buf->uv[iy*in_stride + ix*2 + 1];
-      }
-    }
-  }
-
+// y_plane, u_plane and v_plane are consecutive, with room for 16-pixel aligned rows of y
+static kj::Array<capnp::byte> yuv420_to_jpeg(uint8_t *y_plane, uint8_t *u_plane, uint8_t *v_plane, int thumbnail_width, int thumbnail_height) {
   struct jpeg_compress_struct cinfo;
   struct jpeg_error_mgr jerr;
   cinfo.err = jpeg_std_error(&jerr);
@@ -244,31 +228,27 @@ static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_w
   return dat;
 }
 
-static void publish_thumbnail(PubMaster *pm, const CameraBuf *b) {
-  auto thumbnail = yuv420_to_jpeg(b, b->rgb_width / 4, b->rgb_height / 4);
+static void publish_thumbnail(PubMaster *pm, uint8_t *planes, int width, int height, const FrameMetadata &frame_data) {
+  auto thumbnail = yuv420_to_jpeg(planes, planes + width * height, planes + width * height * 5 / 4, width, height);
   if (thumbnail.size() == 0) return;
 
   MessageBuilder msg;
   auto thumbnaild = msg.initEvent().initThumbnail();
-  thumbnaild.setFrameId(b->cur_frame_data.frame_id);
-  thumbnaild.setTimestampEof(b->cur_frame_data.timestamp_eof);
+  thumbnaild.setFrameId(frame_data.frame_id);
+  thumbnaild.setTimestampEof(frame_data.timestamp_eof);
   thumbnaild.setThumbnail(thumbnail);
 
   pm->send("thumbnail", msg);
 }
 
-float set_exposure_target(const CameraBuf *b, Rect ae_xywh, int x_skip, int y_skip) {
+static float set_exposure_target(const uint8_t *y, int stride, Rect ae_xywh, int x_skip, int y_skip) {
   int lum_med;
   uint32_t lum_binning[256] = {0};
-  const uint8_t *pix_ptr = b->cur_yuv_buf->y;
+  luma_histogram(y, stride, ae_xywh, x_skip, y_skip, lum_binning);
 
   unsigned int lum_total = 0;
-  for (int y = ae_xywh.y; y < ae_xywh.y + ae_xywh.h; y += y_skip) {
-    for (int x = ae_xywh.x; x < ae_xywh.x + ae_xywh.w; x += x_skip) {
-      uint8_t lum = pix_ptr[(y * b->rgb_width) + x];
-      lum_binning[lum]++;
-      lum_total += 1;
-    }
+  for (uint32_t count : lum_binning) {
+    lum_total += count;
   }
 
   // Find mean lumimance value
@@ -284,6 +264,78 @@ float set_exposure_target(const CameraBuf *b, Rect ae_xywh, int x_skip, int y_sk
   return lum_med / 256.0;
 }
 
+float set_exposure_target(const CameraBuf *b, Rect ae_xywh, int x_skip, int y_skip) {
+  return set_exposure_target(b->cur_yuv_buf->y, b->rgb_width, ae_xywh, x_skip, y_skip);
+}
+
+FrameWorker::FrameWorker(MultiCameraState *cameras, CameraState *cs, const char *thread_name)
+    : cameras(cameras), cs(cs), thread(&FrameWorker::run, this, thread_name) {}
+
+FrameWorker::~FrameWorker() {
+  {
+    std::lock_guard lk(lock);
+    stopping = true;
+  }
+  cv.notify_one();
+  thread.join();
+}
+
+void FrameWorker::submit(const CameraBuf &b, bool thumbnail) {
+  {
+    std::lock_guard lk(lock);
+    if (pending) {
+      ++dropped;
+      thumbnail = thumbnail || pending->thumbnail;
+    }
+    pending = Job{b.cur_yuv_buf, b.cur_frame_data, thumbnail};
+  }
+  cv.notify_one();
+}
+
+void FrameWorker::run(const char *thread_name) {
+  util::set_thread_name(thread_name);
+
+  const CameraBuf &b = cs->buf;
+  const int thumbnail_width = b.rgb_width / 4, thumbnail_height = b.rgb_height / 4;
+  // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
+  std::vector<uint8_t> thumbnail((thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2);
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lk(lock);
+      cv.wait(lk, [this] { return stopping || pending; });
+      if (stopping) break;
+      job = *pending;
+      pending.reset();
+    }
+
+    // read the frame, then make sure it wasn't rewritten meanwhile
+    const float grey_frac = set_exposure_target(job.yuv_buf->y, b.rgb_width, cs->ae_xywh, cs->ae_x_skip, cs->ae_y_skip);
+    if (job.thumbnail) {
+      assert(thumbnail_width * 4 == job.yuv_buf->width && thumbnail_height * 4 == job.yuv_buf->height);
+      uint8_t *y_plane = thumbnail.data();
+      uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
+      uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
+      nv12_to_i420_subsample(job.yuv_buf->y, job.yuv_buf->uv, job.yuv_buf->stride, 4, thumbnail_width, thumbnail_height, y_plane, u_plane, v_plane);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (job.yuv_buf->get_frame_id() != job.frame_data.frame_id) {
+      LOGW("%s: frame %d was overwritten before it was processed", thread_name, job.frame_data.frame_id);
+      continue;
+    }
+
+    cs->set_camera_exposure(grey_frac, job.frame_data);
+    if (job.thumbnail && cameras->pm) {
+      publish_thumbnail(cameras->pm, thumbnail.data(), thumbnail_width, thumbnail_height, job.frame_data);
+    }
+
+    if (uint32_t n = dropped.exchange(0)) {
+      LOGD("%s: skipped %u frames", thread_name, n);
+    }
+  }
+}
+
 void *processing_thread(MultiCameraState *cameras, CameraState *cs, process_thread_cb callback) {
   const char *thread_name = nullptr;
   if (cs == &cameras->road_cam) {
@@ -295,16 +347,14 @@ void *processing_thread(MultiCameraState *cameras, CameraState *cs, process_thre
   }
   util::set_thread_name(thread_name);
 
+  FrameWorker worker(cameras, cs, cs == &cameras->road_cam ? "RoadCamWorker" :
+                                  cs == &cameras->driver_cam ? "DriverCamWorker" : "WideCamWorker");
   uint32_t cnt = 0;
   while (!do_exit) {
     if (!cs->buf.acquire()) continue;
 
     callback(cameras, cs, cnt);
-
-    if (cs == &(cameras->road_cam) && cameras->pm && cnt % 100 == 3) {
-      // this takes 10ms???
-      publish_thumbnail(cameras->pm, &(cs->buf));
-    }
+    worker.submit(cs->buf, cs == &(cameras->road_cam) && cnt % 100 == 3);
     ++cnt;
   }
   return NULL;
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <fcntl.h>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <thread>
 
 #include "cereal/messaging/messaging.h"
@@ -74,6 +78,34 @@ public:
 
 typedef void (*process_thread_cb)(MultiCameraState *s, CameraState *c, int cnt);
 
+// Runs the auto exposure and the thumbnail of a camera on their own thread, so that its
+// processing thread never waits for them. A job leases the YUV buffer of its frame until
+// camerad reuses the buffer, a job that read the buffer while it was rewritten is dropped.
+class FrameWorker {
+public:
+  FrameWorker(MultiCameraState *cameras, CameraState *cs, const char *thread_name);
+  ~FrameWorker();
+  // Hands the current frame of b to the worker, replacing the frame it didn't get to yet. Never blocks.
+  void submit(const CameraBuf &b, bool thumbnail);
+
+private:
+  struct Job {
+    VisionBuf *yuv_buf;
+    FrameMetadata frame_data;
+    bool thumbnail;
+  };
+  void run(const char *thread_name);
+
+  MultiCameraState *cameras;
+  CameraState *cs;
+  std::mutex lock;
+  std::condition_variable cv;
+  std::optional<Job> pending;
+  std::atomic<uint32_t> dropped = 0;
+  bool stopping = false;
+  std::thread thread;
+};
+
 void fill_frame_data(cereal::FrameData::Builder &framed, const FrameMetadata &frame_data, CameraState *c);
 kj::Array<uint8_t> get_raw_frame_image(const CameraBuf *b);
 float set_exposure_target(const CameraBuf *b, Rect ae_xywh, int x_skip, int y_skip);
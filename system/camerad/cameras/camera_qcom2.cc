@@ -422,6 +422,9 @@ void CameraState::set_exposure_rect() {
     std::min((int)(fl_pix / fl_ref * xywh_ref.w), buf.rgb_width / 2 + (int)(fl_pix / fl_ref * xywh_ref.w / 2)),
     std::min((int)(fl_pix / fl_ref * xywh_ref.h), buf.rgb_height / 2 + (int)(fl_pix / fl_ref * (h_ref / 2 - xywh_ref.y)))
   };
+  // every other pixel, and only every fourth row of the driver camera
+  ae_x_skip = 2;
+  ae_y_skip = camera_num == 2 ? 4 : 2;
 }
 
 void CameraState::sensor_set_parameters() {
@@ -825,7 +828,7 @@ void CameraState::update_exposure_score(float desired_ev, int exp_t, int exp_g_i
   }
 }
 
-void CameraState::set_camera_exposure(float grey_frac) {
+void CameraState::set_camera_exposure(float grey_frac, const FrameMetadata &frame_data) {
   if (!enabled) return;
   const float dt = 0.05;
 
@@ -840,7 +843,7 @@ void CameraState::set_camera_exposure(float grey_frac) {
   // Therefore we use the target EV from 3 frames ago, the grey fraction that was just measured was the result of that control action.
   // TODO: Lower latency to 2 frames, by using the histogram outputted by the sensor we can do AE before the debayering is complete
 
-  const float cur_ev_ = cur_ev[buf.cur_frame_data.frame_id % 3];
+  const float cur_ev_ = cur_ev[frame_data.frame_id % 3];
 
   // Scale target grey between 0.1 and 0.4 depending on lighting conditions
   float new_target_grey = std::clamp(0.4 - 0.3 * log2(1.0 + ci->target_grey_factor*cur_ev_) / log2(6000.0), 0.1, 0.4);
@@ -911,25 +914,23 @@ void CameraState::set_camera_exposure(float grey_frac) {
   dc_gain_enabled = enable_dc_gain;
 
   float gain = analog_gain_frac * (1 + dc_gain_weight * (ci->dc_gain_factor-1) / ci->dc_gain_max_weight);
-  cur_ev[buf.cur_frame_data.frame_id % 3] = exposure_time * gain;
+  cur_ev[frame_data.frame_id % 3] = exposure_time * gain;
 
   exp_lock.unlock();
 
   // Processing a frame takes right about 50ms, so we need to wait a few ms
   // so we don't send i2c commands around the frame start.
-  int ms = (nanos_since_boot() - buf.cur_frame_data.timestamp_sof) / 1000000;
+  int ms = (nanos_since_boot() - frame_data.timestamp_sof) / 1000000;
   if (ms < 60) {
     util::sleep_for(60 - ms);
   }
-  // LOGE("ae - camera %d, cur_t %.5f, sof %.5f, dt %.5f", camera_num, 1e-9 * nanos_since_boot(), 1e-9 * buf.cur_frame_data.timestamp_sof, 1e-9 * (nanos_since_boot() - buf.cur_frame_data.timestamp_sof));
+  // LOGE("ae - camera %d, cur_t %.5f, sof %.5f, dt %.5f", camera_num, 1e-9 * nanos_since_boot(), 1e-9 * frame_data.timestamp_sof, 1e-9 * (nanos_since_boot() - frame_data.timestamp_sof));
 
   auto exp_reg_array = ci->getExposureRegisters(exposure_time, new_exp_g, dc_gain_enabled);
   sensors_i2c(exp_reg_array.data(), exp_reg_array.size(), CAM_SENSOR_PACKET_OPCODE_SENSOR_CONFIG, ci->data_word);
 }
 
 static void process_driver_camera(MultiCameraState *s, CameraState *c, int cnt) {
-  c->set_camera_exposure(set_exposure_target(&c->buf, c->ae_xywh, 2, 4));
-
   MessageBuilder msg;
   auto framed = msg.initEvent().initDriverCameraState();
   framed.setFrameType(cereal::FrameData::FrameType::FRONT);
@@ -952,9 +953,6 @@ void process_road_camera(MultiCameraState *s, CameraState *c, int cnt) {
 
   c->ci->processRegisters(c, framed);
   s->pm->send(c == &s->road_cam ? "roadCameraState" : "wideRoadCameraState", msg);
-
-  const int skip = 2;
-  c->set_camera_exposure(set_exposure_target(b, c->ae_xywh, skip, skip));
 }
 
 void cameras_run(MultiCameraState *s) {
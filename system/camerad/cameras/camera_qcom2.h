@@ -35,6 +35,7 @@ public:
   int new_exp_t;
 
   Rect ae_xywh;
+  int ae_x_skip, ae_y_skip;
   float measured_grey_fraction;
   float target_grey_fraction;
 
@@ -46,7 +47,7 @@ public:
 
   void handle_camera_event(void *evdat);
   void update_exposure_score(float desired_ev, int exp_t, int exp_g_idx, float exp_gain);
-  void set_camera_exposure(float grey_frac);
+  void set_camera_exposure(float grey_frac, const FrameMetadata &frame_data);
 
   void sensors_start();
 
@@ -0,0 +1,106 @@
+#include "system/camerad/cameras/image_kernels.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_KERNELS_NEON
+#elif defined(__SSE2__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define IMAGE_KERNELS_SSE2
+#endif
+
+namespace {
+
+// dst[i] = src[i * step + offset] for n pairs of bytes
+void pick_pairs(const uint8_t *src, uint8_t *dst, int n, int step, int offset) {
+  int i = 0;
+  if (step == 4 && offset == 1) {
+#if defined(IMAGE_KERNELS_NEON)
+    for (; i + 8 <= n; i += 8) {
+      uint16x8x4_t v = vld4q_u16((const uint16_t *)(src + i * 8));
+      vst1q_u16((uint16_t *)(dst + i * 2), v.val[1]);
+    }
+#elif defined(IMAGE_KERNELS_SSE2)
+    for (; i + 8 <= n; i += 8) {
+      __m128i t[4];
+      for (int j = 0; j < 4; ++j) {
+        // the pair we want is the second of each group of 4, move it to the bottom of 32 bit lanes 0 and 1
+        __m128i v = _mm_srli_epi64(_mm_loadu_si128((const __m128i *)(src + i * 8 + j * 16)), 16);
+        t[j] = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 1, 2, 0));
+      }
+      __m128i lo = _mm_unpacklo_epi64(t[0], t[1]);
+      __m128i hi = _mm_unpacklo_epi64(t[2], t[3]);
+      // sign extend the pairs so that the signed saturation of packs leaves them alone
+      lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+      hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+      _mm_storeu_si128((__m128i *)(dst + i * 2), _mm_packs_epi32(lo, hi));
+    }
+#endif
+  }
+  for (; i < n; ++i) {
+    memcpy(dst + i * 2, src + (i * step + offset) * 2, 2);
+  }
+}
+
+// splits n interleaved uv pairs
+void split_uv(const uint8_t *uv, uint8_t *u, uint8_t *v, int n) {
+  int i = 0;
+#if defined(IMAGE_KERNELS_NEON)
+  for (; i + 16 <= n; i += 16) {
+    uint8x16x2_t p = vld2q_u8(uv + i * 2);
+    vst1q_u8(u + i, p.val[0]);
+    vst1q_u8(v + i, p.val[1]);
+  }
+#elif defined(IMAGE_KERNELS_SSE2)
+  const __m128i mask = _mm_set1_epi16(0xff);
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(uv + i * 2));
+    __m128i b = _mm_loadu_si128((const __m128i *)(uv + i * 2 + 16));
+    _mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+    _mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+  }
+#endif
+  for (; i < n; ++i) {
+    u[i] = uv[i * 2];
+    v[i] = uv[i * 2 + 1];
+  }
+}
+
+}  // namespace
+
+void nv12_to_i420_subsample(const uint8_t *y, const uint8_t *uv, int stride, int downscale, int width, int height,
+                            uint8_t *y_out, uint8_t *u_out, uint8_t *v_out) {
+  // luma is taken in 2x2 blocks, so rows are picked as pairs of bytes
+  const int half_width = width / 2;
+  const int offset = (downscale - 1) / 2;
+  std::vector<uint8_t> uv_row(half_width * 2);
+  for (int hy = 0; hy < height / 2; hy++) {
+    const int iy = hy * downscale + offset;
+    pick_pairs(y + (iy * 2 + 0) * stride, y_out + (hy * 2 + 0) * width, half_width, downscale, offset);
+    pick_pairs(y + (iy * 2 + 1) * stride, y_out + (hy * 2 + 1) * width, half_width, downscale, offset);
+    pick_pairs(uv + iy * stride, uv_row.data(), half_width, downscale, offset);
+    split_uv(uv_row.data(), u_out + hy * half_width, v_out + hy * half_width, half_width);
+  }
+}
+
+void luma_histogram(const uint8_t *y, int stride, const Rect &rect, int x_skip, int y_skip, uint32_t hist[256]) {
+  // Scattered increments don't map onto SSE2 or NEON, but counting neighbouring pixels
+  // in two histograms keeps runs of the same value from waiting on each other's increment.
+  uint32_t sub[2][256] = {};
+  for (int row = rect.y; row < rect.y + rect.h; row += y_skip) {
+    const uint8_t *p = y + row * stride + rect.x;
+    int x = 0;
+    for (; x + x_skip < rect.w; x += 2 * x_skip) {
+      sub[0][p[x]]++;
+      sub[1][p[x + x_skip]]++;
+    }
+    for (; x < rect.w; x += x_skip) {
+      sub[0][p[x]]++;
+    }
+  }
+  for (int i = 0; i < 256; ++i) {
+    hist[i] += sub[0][i] + sub[1][i];
+  }
+}
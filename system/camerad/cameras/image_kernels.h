@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common/util.h"
+
+// Kernels for the CPU side of camerad, vectorized with NEON or SSE2 where that helps.
+// Their output is the same, bit for bit, as the plain loops they replace.
+
+// Subsamples an NV12 frame by downscale into the I420 planes of a width x height image.
+// Each 2x2 luma block and chroma sample is taken from the middle of its downscale x downscale block.
+void nv12_to_i420_subsample(const uint8_t *y, const uint8_t *uv, int stride, int downscale, int width, int height,
+                            uint8_t *y_out, uint8_t *u_out, uint8_t *v_out);
+
+// Adds the luma of every x_skip-th pixel of every y_skip-th row of rect to hist.
+void luma_histogram(const uint8_t *y, int stride, const Rect &rect, int x_skip, int y_skip, uint32_t hist[256]);
@@ -0,0 +1,121 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "common/timing.h"
+#include "system/camerad/cameras/image_kernels.h"
+
+// the scalar loops the kernels replaced
+
+static void nv12_to_i420_subsample_ref(const uint8_t *y, const uint8_t *uv, int stride, int downscale, int width, int height,
+                                       uint8_t *y_plane, uint8_t *u_plane, uint8_t *v_plane) {
+  for (int hy = 0; hy < height/2; hy++) {
+    for (int hx = 0; hx < width/2; hx++) {
+      int ix = hx * downscale + (downscale-1)/2;
+      int iy = hy * downscale + (downscale-1)/2;
+      y_plane[(hy*2 + 0)*width + (hx*2 + 0)] = y[(iy*2 + 0) * stride + ix*2 + 0];
+      y_plane[(hy*2 + 0)*width + (hx*2 + 1)] = y[(iy*2 + 0) * stride + ix*2 + 1];
+      y_plane[(hy*2 + 1)*width + (hx*2 + 0)] = y[(iy*2 + 1) * stride + ix*2 + 0];
+      y_plane[(hy*2 + 1)*width + (hx*2 + 1)] = y[(iy*2 + 1) * stride + ix*2 + 1];
+      u_plane[hy*width/2 + hx] = uv[iy*stride + ix*2 + 0];
+      v_plane[hy*width/2 + hx] = uv[iy*stride + ix*2 + 1];
+    }
+  }
+}
+
+static void luma_histogram_ref(const uint8_t *y, int stride, const Rect &rect, int x_skip, int y_skip, uint32_t hist[256]) {
+  for (int row = rect.y; row < rect.y + rect.h; row += y_skip) {
+    for (int x = rect.x; x < rect.x + rect.w; x += x_skip) {
+      hist[y[row * stride + x]]++;
+    }
+  }
+}
+
+struct NV12Frame {
+  NV12Frame(int width, int height, int stride) : width(width), height(height), stride(stride), data(stride * height * 3 / 2) {
+    std::mt19937 rng(width * 31 + height);
+    // smooth gradients with noise, like a camera frame
+    for (int row = 0; row < height * 3 / 2; ++row) {
+      for (int x = 0; x < stride; ++x) {
+        data[row * stride + x] = (uint8_t)((row + x) / 16 + rng() % 4);
+      }
+    }
+  }
+  const uint8_t *y() const { return data.data(); }
+  const uint8_t *uv() const { return data.data() + stride * height; }
+
+  int width, height, stride;
+  std::vector<uint8_t> data;
+};
+
+struct Thumbnail {
+  Thumbnail(int width, int height) : width(width), height(height), data(width * height * 3 / 2) {}
+  uint8_t *y() { return data.data(); }
+  uint8_t *u() { return data.data() + width * height; }
+  uint8_t *v() { return u() + width * height / 4; }
+
+  int width, height;
+  std::vector<uint8_t> data;
+};
+
+TEST_CASE("nv12_to_i420_subsample matches the scalar code") {
+  auto [width, height, stride, downscale] = GENERATE(std::make_tuple(1928, 1208, 2048, 4),
+                                                     std::make_tuple(1344, 760, 1408, 4),
+                                                     std::make_tuple(200, 120, 256, 2),
+                                                     std::make_tuple(216, 120, 256, 3),
+                                                     std::make_tuple(256, 128, 320, 8));
+  NV12Frame frame(width, height, stride);
+  Thumbnail ref(width / downscale, height / downscale), out(width / downscale, height / downscale);
+  nv12_to_i420_subsample_ref(frame.y(), frame.uv(), stride, downscale, ref.width, ref.height, ref.y(), ref.u(), ref.v());
+  nv12_to_i420_subsample(frame.y(), frame.uv(), stride, downscale, out.width, out.height, out.y(), out.u(), out.v());
+  REQUIRE(out.data == ref.data);
+}
+
+TEST_CASE("luma_histogram matches the scalar code") {
+  auto [x_skip, y_skip] = GENERATE(std::make_pair(1, 1), std::make_pair(2, 2), std::make_pair(2, 4), std::make_pair(3, 1));
+  NV12Frame frame(1928, 1208, 2048);
+  for (const Rect &rect : {Rect{96, 160, 1734, 986}, Rect{0, 0, 1928, 1208}, Rect{5, 7, 33, 20}, Rect{100, 100, 1, 1}}) {
+    uint32_t ref[256] = {}, out[256] = {};
+    luma_histogram_ref(frame.y(), frame.stride, rect, x_skip, y_skip, ref);
+    luma_histogram(frame.y(), frame.stride, rect, x_skip, y_skip, out);
+    REQUIRE(memcmp(out, ref, sizeof(ref)) == 0);
+  }
+}
+
+// the fastest of a few batches, to leave out the time the benchmark was preempted
+template <typename F>
+static double time_ms(F f, int batches = 20, int runs = 20) {
+  double best = 1e9;
+  for (int b = 0; b < batches; ++b) {
+    const double start = millis_since_boot();
+    for (int i = 0; i < runs; ++i) f();
+    best = std::min(best, (millis_since_boot() - start) / runs);
+  }
+  return best;
+}
+
+TEST_CASE("image_kernels_benchmark", "[.][benchmark]") {
+  NV12Frame frame(1928, 1208, 2048);
+  Thumbnail thumbnail(1928 / 4, 1208 / 4);
+  const Rect ae_rect = {96, 160, 1734, 986};
+
+  const double thumbnail_ref = time_ms([&] {
+    nv12_to_i420_subsample_ref(frame.y(), frame.uv(), frame.stride, 4, thumbnail.width, thumbnail.height, thumbnail.y(), thumbnail.u(), thumbnail.v());
+  });
+  const double thumbnail_kernel = time_ms([&] {
+    nv12_to_i420_subsample(frame.y(), frame.uv(), frame.stride, 4, thumbnail.width, thumbnail.height, thumbnail.y(), thumbnail.u(), thumbnail.v());
+  });
+  printf("thumbnail %dx%d: scalar %.3f ms, kernel %.3f ms, %.1fx\n", thumbnail.width, thumbnail.height, thumbnail_ref, thumbnail_kernel, thumbnail_ref / thumbnail_kernel);
+
+  for (auto [x_skip, y_skip] : {std::make_pair(2, 2), std::make_pair(2, 4)}) {
+    uint32_t hist[256] = {};
+    const double hist_ref = time_ms([&] { luma_histogram_ref(frame.y(), frame.stride, ae_rect, x_skip, y_skip, hist); });
+    const double hist_kernel = time_ms([&] { luma_histogram(frame.y(), frame.stride, ae_rect, x_skip, y_skip, hist); });
+    printf("histogram skip %d/%d: scalar %.3f ms, kernel %.3f ms, %.1fx\n", x_skip, y_skip, hist_ref, hist_kernel, hist_ref / hist_kernel);
+  }
+}
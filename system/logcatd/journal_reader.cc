@@ -0,0 +1,124 @@
+#include "system/logcatd/journal_reader.h"
+
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+JournalReader::JournalReader(const std::vector<std::string> &files, int max_priority, const std::vector<std::string> &units) {
+  int err;
+  if (files.empty()) {
+    err = sd_journal_open(&journal, 0);
+    assert(err >= 0);
+    err = sd_journal_get_fd(journal); // needed so sd_journal_wait() works properly if files rotate
+    assert(err >= 0);
+  } else {
+    std::vector<const char *> paths;
+    for (const auto &file : files) paths.push_back(file.c_str());
+    paths.push_back(nullptr);
+    err = sd_journal_open_files(&journal, paths.data(), 0);
+    assert(err >= 0);
+  }
+
+  // Matches of the same field are or'ed, of different fields and'ed
+  if (max_priority < LOG_DEBUG) {
+    for (int priority = LOG_EMERG; priority <= max_priority; ++priority) {
+      std::string match = "PRIORITY=" + std::to_string(priority);
+      err = sd_journal_add_match(journal, match.c_str(), 0);
+      assert(err >= 0);
+    }
+  }
+  for (const auto &unit : units) {
+    std::string match = "_SYSTEMD_UNIT=" + unit;
+    err = sd_journal_add_match(journal, match.c_str(), 0);
+    assert(err >= 0);
+  }
+
+  if (files.empty()) {
+    err = sd_journal_seek_tail(journal);
+    assert(err >= 0);
+
+    // workaround for bug https://github.com/systemd/systemd/issues/9934
+    // call sd_journal_previous_skip after sd_journal_seek_tail (like journalctl -f does) to makes things work.
+    sd_journal_previous_skip(journal, 1);
+  }
+}
+
+JournalReader::~JournalReader() {
+  sd_journal_close(journal);
+}
+
+size_t JournalReader::read(size_t max_entries, size_t max_bytes) {
+  size_t count = 0;
+  while (count < max_entries && bytes() < max_bytes) {
+    int err = sd_journal_next(journal);
+    assert(err >= 0);
+    if (err == 0) break;
+
+    Entry &entry = entries.emplace_back();
+    err = sd_journal_get_realtime_usec(journal, &entry.ts);
+    assert(err >= 0);
+
+    entry.fields_begin = fields.size();
+    const void *data;
+    size_t length;
+    SD_JOURNAL_FOREACH_DATA(journal, data, length) {
+      // Split "KEY=VALUE" on "="
+      std::string_view str((const char *)data, length);
+      const size_t found = str.find('=');
+      if (found == std::string_view::npos) continue;
+
+      const std::string_view key = str.substr(0, found), value = str.substr(found + 1);
+      if (key == "MESSAGE") {
+        entry.message = add(value);
+      } else if (key == "SYSLOG_IDENTIFIER") {
+        entry.tag = add(value);
+      } else if (key == "_PID") {
+        std::from_chars(value.data(), value.data() + value.size(), entry.pid);
+      } else if (key == "PRIORITY") {
+        std::from_chars(value.data(), value.data() + value.size(), entry.priority);
+      } else {
+        fields.push_back({add(key), add(value)});
+      }
+    }
+    entry.fields_end = fields.size();
+    ++count;
+  }
+  return count;
+}
+
+void JournalReader::wait(uint64_t timeout_us) {
+  int err = sd_journal_wait(journal, timeout_us);
+  assert(err >= 0);
+}
+
+void JournalReader::build(MessageBuilder &msg) {
+  auto logs = msg.initEvent().initAndroidLogs(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const Entry &entry = entries[i];
+    auto log = logs[i];
+    log.setTs(entry.ts);
+    log.setPid(entry.pid);
+    if (entry.priority >= 0) log.setPriority(entry.priority);
+    if (entry.tag.size > 0) log.setTag(text(entry.tag));
+    if (entry.message.size > 0) log.setMessage(text(entry.message));
+
+    auto log_fields = log.initFields(entry.fields_end - entry.fields_begin);
+    for (uint32_t j = entry.fields_begin; j < entry.fields_end; ++j) {
+      auto field = log_fields[j - entry.fields_begin];
+      field.setKey(text(fields[j].key));
+      field.setValue(text(fields[j].value));
+    }
+  }
+
+  entries.clear();
+  fields.clear();
+  data.clear();
+}
+
+JournalReader::Str JournalReader::add(std::string_view str) {
+  Str s = {(uint32_t)data.size(), (uint32_t)str.size()};
+  data.append(str);
+  data.push_back('\0');
+  return s;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <syslog.h>
+#include <systemd/sd-journal.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+
+// Reads journal entries in batches, and builds them into androidLogs events with their fields
+// as key/value pairs.
+class JournalReader {
+public:
+  // Follows the system journal from its tail, or reads the given journal files from their head.
+  // Only entries with a priority up to max_priority, and of one of the units if any, are read:
+  // the journal matches them, so the others are skipped without looking at their fields.
+  explicit JournalReader(const std::vector<std::string> &files = {}, int max_priority = LOG_DEBUG,
+                         const std::vector<std::string> &units = {});
+  ~JournalReader();
+
+  // Reads the available entries into the batch, until it has max_entries or its event takes
+  // max_bytes, and returns how many were read
+  size_t read(size_t max_entries, size_t max_bytes);
+  // Waits for new entries, up to timeout_us
+  void wait(uint64_t timeout_us);
+
+  // Builds the batch into an androidLogs event and clears it
+  void build(MessageBuilder &msg);
+  size_t size() const { return entries.size(); }
+  // At least the size of the event the batch builds into
+  size_t bytes() const { return data.size() + fields.size() * FIELD_BYTES + entries.size() * ENTRY_BYTES; }
+
+private:
+  // capnp bytes of a field and an entry besides their strings: the structs, the pointers and the padding
+  static constexpr size_t FIELD_BYTES = 40, ENTRY_BYTES = 128;
+
+  // data of the batch, each a null terminated string
+  struct Str {
+    uint32_t offset = 0, size = 0;
+  };
+  struct Field {
+    Str key, value;
+  };
+  struct Entry {
+    uint64_t ts = 0;
+    int pid = 0, priority = -1;
+    Str tag, message;
+    uint32_t fields_begin = 0, fields_end = 0;
+  };
+
+  Str add(std::string_view str);
+  capnp::Text::Reader text(Str str) const { return capnp::Text::Reader(data.data() + str.offset, str.size); }
+
+  sd_journal *journal = nullptr;
+  std::string data;
+  std::vector<Field> fields;
+  std::vector<Entry> entries;
+};
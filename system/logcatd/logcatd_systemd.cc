@@ -1,75 +1,52 @@
-#include <systemd/sd-journal.h>
+#include <unistd.h>
 
-#include <cassert>
-#include <csignal>
-#include <map>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
-
-#include "third_party/json11/json11.hpp"
+#include <vector>
 
 #include "cereal/messaging/messaging.h"
-#include "common/timing.h"
 #include "common/util.h"
+#include "system/logcatd/journal_reader.h"
 
-ExitHandler do_exit;
-int main(int argc, char *argv[]) {
+// Entries of a message at most, a burst of logs goes out in a few messages
+const size_t MAX_BATCH_ENTRIES = 1000;
+// Bytes of a message at most, give or take an entry. Entries carry all their fields, and msgq
+// only takes messages up to a third of its queue.
+const size_t MAX_BATCH_BYTES = 1024 * 1024;
 
-  PubMaster pm({"androidLog"});
+ExitHandler do_exit;
 
-  sd_journal *journal;
-  int err = sd_journal_open(&journal, 0);
-  assert(err >= 0);
-  err = sd_journal_get_fd(journal); // needed so sd_journal_wait() works properly if files rotate
-  assert(err >= 0);
-  err = sd_journal_seek_tail(journal);
-  assert(err >= 0);
+// usage: logcatd [-p max priority] [-u unit]...
+int main(int argc, char *argv[]) {
+  int max_priority = LOG_DEBUG;
+  std::vector<std::string> units;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:u:")) != -1) {
+    if (opt == 'p') {
+      max_priority = std::atoi(optarg);
+    } else if (opt == 'u') {
+      units.push_back(optarg);
+    } else {
+      fprintf(stderr, "usage: %s [-p max priority] [-u unit]...\n", argv[0]);
+      return 1;
+    }
+  }
 
-  // workaround for bug https://github.com/systemd/systemd/issues/9934
-  // call sd_journal_previous_skip after sd_journal_seek_tail (like journalctl -f does) to makes things work.
-  sd_journal_previous_skip(journal, 1);
+  PubMaster pm({"androidLogs"});
+  JournalReader reader({}, max_priority, units);
 
   while (!do_exit) {
-    err = sd_journal_next(journal);
-    assert(err >= 0);
-
-    // Wait for new message if we didn't receive anything
-    if (err == 0) {
-      err = sd_journal_wait(journal, 1000 * 1000);
-      assert(err >= 0);
+    // Wait for new entries if we didn't receive anything
+    if (reader.read(MAX_BATCH_ENTRIES, MAX_BATCH_BYTES) == 0) {
+      reader.wait(1000 * 1000);
       continue; // Try again
     }
 
-    uint64_t timestamp = 0;
-    err = sd_journal_get_realtime_usec(journal, &timestamp);
-    assert(err >= 0);
-
-    const void *data;
-    size_t length;
-    std::map<std::string, std::string> kv;
-
-    SD_JOURNAL_FOREACH_DATA(journal, data, length) {
-      std::string str((char*)data, length);
-
-      // Split "KEY=VALUE"" on "=" and put in map
-      std::size_t found = str.find("=");
-      if (found != std::string::npos) {
-        kv[str.substr(0, found)] = str.substr(found + 1, std::string::npos);
-      }
-    }
-
     MessageBuilder msg;
-
-    // Build message
-    auto androidEntry = msg.initEvent().initAndroidLog();
-    androidEntry.setTs(timestamp);
-    androidEntry.setMessage(json11::Json(kv).dump());
-    if (kv.count("_PID")) androidEntry.setPid(std::atoi(kv["_PID"].c_str()));
-    if (kv.count("PRIORITY")) androidEntry.setPriority(std::atoi(kv["PRIORITY"].c_str()));
-    if (kv.count("SYSLOG_IDENTIFIER")) androidEntry.setTag(kv["SYSLOG_IDENTIFIER"]);
-
-    pm.send("androidLog", msg);
+    reader.build(msg);
+    pm.send("androidLogs", msg);
   }
 
-  sd_journal_close(journal);
   return 0;
 }
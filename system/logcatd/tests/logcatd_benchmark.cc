@@ -0,0 +1,153 @@
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "third_party/json11/json11.hpp"
+
+#include "cereal/messaging/messaging.h"
+#include "common/util.h"
+#include "system/logcatd/journal_reader.h"
+
+// Reads journal files the way logcatd did before, one androidLog message of json per entry,
+// and in batches of androidLogs, and reports the CPU time per thousand entries. With no
+// files, a synthetic journal is written with systemd-journal-remote.
+//
+// usage: logcatd_benchmark [journal file]...
+
+static uint64_t cpu_nanos() {
+  struct timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static std::string synthetic_journal(int entries) {
+  const char *journal_remote = "/lib/systemd/systemd-journal-remote";
+  if (access(journal_remote, X_OK) != 0) {
+    fprintf(stderr, "%s not found, pass journal files instead\n", journal_remote);
+    exit(1);
+  }
+
+  // the export format of journalctl -o export, written into a journal file
+  const std::string path = "/tmp/logcatd_benchmark.journal";
+  unlink(path.c_str());
+  FILE *f = popen((std::string(journal_remote) + " -o " + path + " -").c_str(), "w");
+  assert(f);
+
+  const char *units[] = {"weston.service", "NetworkManager.service", "ModemManager.service", "systemd-journald.service"};
+  const char *idents[] = {"weston", "NetworkManager", "ModemManager", "kernel"};
+  for (int i = 0; i < entries; ++i) {
+    const int u = i % 4;
+    fprintf(f, "__REALTIME_TIMESTAMP=%llu\n", 1700000000000000ULL + i * 100ULL);
+    fprintf(f, "__MONOTONIC_TIMESTAMP=%llu\n", 1000000ULL + i * 100ULL);
+    fprintf(f, "_BOOT_ID=0123456789abcdef0123456789abcdef\n");
+    fprintf(f, "_MACHINE_ID=fedcba9876543210fedcba9876543210\n");
+    fprintf(f, "_HOSTNAME=comma\n");
+    fprintf(f, "_TRANSPORT=%s\n", u == 3 ? "kernel" : "journal");
+    fprintf(f, "PRIORITY=%d\n", (i * 7) % 8);
+    fprintf(f, "SYSLOG_FACILITY=3\n");
+    fprintf(f, "SYSLOG_IDENTIFIER=%s\n", idents[u]);
+    fprintf(f, "_PID=%d\n", 400 + u);
+    fprintf(f, "_UID=0\n_GID=0\n");
+    fprintf(f, "_COMM=%s\n", idents[u]);
+    fprintf(f, "_EXE=/usr/bin/%s\n", idents[u]);
+    fprintf(f, "_CMDLINE=/usr/bin/%s --some-option\n", idents[u]);
+    fprintf(f, "_SYSTEMD_UNIT=%s\n", units[u]);
+    fprintf(f, "_SYSTEMD_CGROUP=/system.slice/%s\n", units[u]);
+    fprintf(f, "CODE_FILE=src/%s.c\nCODE_LINE=%d\n", idents[u], i % 1000);
+    fprintf(f, "MESSAGE=message %d of a burst of system logs, CSID:%d ERROR_CRC\n\n", i, i % 3);
+  }
+  if (pclose(f) != 0) {
+    fprintf(stderr, "failed to write %s\n", path.c_str());
+    exit(1);
+  }
+  return path;
+}
+
+// the loop of logcatd before the reader, with the message serialized instead of sent
+static size_t legacy_read(const std::vector<std::string> &files, size_t *messages) {
+  std::vector<const char *> paths;
+  for (const auto &file : files) paths.push_back(file.c_str());
+  paths.push_back(nullptr);
+  sd_journal *journal;
+  int err = sd_journal_open_files(&journal, paths.data(), 0);
+  assert(err >= 0);
+
+  size_t bytes = 0;
+  while (sd_journal_next(journal) > 0) {
+    uint64_t timestamp = 0;
+    err = sd_journal_get_realtime_usec(journal, &timestamp);
+    assert(err >= 0);
+
+    const void *data;
+    size_t length;
+    std::map<std::string, std::string> kv;
+
+    SD_JOURNAL_FOREACH_DATA(journal, data, length) {
+      std::string str((char*)data, length);
+      std::size_t found = str.find("=");
+      if (found != std::string::npos) {
+        kv[str.substr(0, found)] = str.substr(found + 1, std::string::npos);
+      }
+    }
+
+    MessageBuilder msg;
+    auto androidEntry = msg.initEvent().initAndroidLog();
+    androidEntry.setTs(timestamp);
+    androidEntry.setMessage(json11::Json(kv).dump());
+    if (kv.count("_PID")) androidEntry.setPid(std::atoi(kv["_PID"].c_str()));
+    if (kv.count("PRIORITY")) androidEntry.setPriority(std::atoi(kv["PRIORITY"].c_str()));
+    if (kv.count("SYSLOG_IDENTIFIER")) androidEntry.setTag(kv["SYSLOG_IDENTIFIER"]);
+    bytes += msg.toBytes().size();
+    ++*messages;
+  }
+  sd_journal_close(journal);
+  return bytes;
+}
+
+static size_t batched_read(const std::vector<std::string> &files, int max_priority, size_t *messages, size_t *entries) {
+  JournalReader reader(files, max_priority);
+  size_t bytes = 0, n;
+  while ((n = reader.read(1000, 1024 * 1024)) > 0) {
+    MessageBuilder msg;
+    reader.build(msg);
+    bytes += msg.toBytes().size();
+    *entries += n;
+    ++*messages;
+  }
+  return bytes;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> files(argv + 1, argv + argc);
+  if (files.empty()) {
+    files.push_back(synthetic_journal(100000));
+  }
+
+  size_t legacy_messages = 0;
+  uint64_t start = cpu_nanos();
+  const size_t legacy_bytes = legacy_read(files, &legacy_messages);
+  const uint64_t legacy_ns = cpu_nanos() - start;
+
+  printf("%-22s %9s %9s %11s %12s\n", "", "entries", "messages", "MB", "cpu ms/1k");
+  printf("%-22s %9zu %9zu %11.2f %12.3f\n", "per entry, json", legacy_messages, legacy_messages, legacy_bytes / 1e6,
+         legacy_ns / 1e3 / std::max<size_t>(legacy_messages, 1));
+
+  for (int max_priority : {LOG_DEBUG, LOG_WARNING}) {
+    size_t messages = 0, entries = 0;
+    start = cpu_nanos();
+    const size_t bytes = batched_read(files, max_priority, &messages, &entries);
+    const uint64_t ns = cpu_nanos() - start;
+    // per thousand entries of the journal, read or not
+    std::string name = "batched, priority <= " + std::to_string(max_priority);
+    printf("%-22s %9zu %9zu %11.2f %12.3f\n", name.c_str(), entries, messages, bytes / 1e6,
+           ns / 1e3 / std::max<size_t>(legacy_messages, 1));
+  }
+  return 0;
+}
@@ -7,15 +7,27 @@
 
 ExitHandler do_exit;
 
+// every this many messages has all the processes, the ones between only those that changed
+const int FULL_SAMPLE_INTERVAL = 10;
+
 int main(int argc, char **argv) {
   setpriority(PRIO_PROCESS, 0, -15);
 
+  // the stat file of every process is kept open
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
   RateKeeper rk("proclogd", 0.5);
   PubMaster publisher({"procLog"});
+  ProcSampler sampler;
 
-  while (!do_exit) {
-    MessageBuilder msg;
-    buildProcLogMessage(msg);
+  for (int i = 0; !do_exit; ++i) {
+    MessageBuilder &msg = publisher.builder("procLog");
+    auto procLog = msg.initEvent().initProcLog();
+    sampler.sample(procLog, i % FULL_SAMPLE_INTERVAL != 0);
     publisher.send("procLog", msg);
 
     rk.keepTime();
@@ -1,43 +1,83 @@
 #include "system/proclogd/proclog.h"
 
-#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include <cassert>
-#include <fstream>
-#include <iterator>
-#include <sstream>
+#include <charconv>
+#include <climits>
+#include <cstring>
 
 #include "common/swaglog.h"
 #include "common/util.h"
 
+namespace {
+
+template <typename T>
+bool parse(std::string_view s, T &value) {
+  auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+  return !s.empty() && ec == std::errc() && end == s.data() + s.size();
+}
+
+// returns the first line of s and removes it from s
+std::string_view next_line(std::string_view &s) {
+  size_t end = s.find('\n');
+  std::string_view line = s.substr(0, end);
+  s.remove_prefix(end == std::string_view::npos ? s.size() : end + 1);
+  return line;
+}
+
+// splits a buffer into fields separated by whitespace, without copying it
+class Tokenizer {
+public:
+  Tokenizer(std::string_view s) : s(s) {}
+  std::string_view next() {
+    size_t start = s.find_first_not_of(" \t\n");
+    if (start == std::string_view::npos) return {};
+    size_t end = s.find_first_of(" \t\n", start);
+    std::string_view field = s.substr(start, end - start);
+    s.remove_prefix(end == std::string_view::npos ? s.size() : end);
+    return field;
+  }
+  template <typename T>
+  bool next(T &value) { return parse(next(), value); }
+
+private:
+  std::string_view s;
+};
+
+}  // namespace
+
 namespace Parser {
 
 // parse /proc/stat
-std::vector<CPUTime> cpuTimes(std::istream &stream) {
+std::vector<CPUTime> cpuTimes(std::string_view stat) {
   std::vector<CPUTime> cpu_times;
-  std::string line;
   // skip the first line for cpu total
-  std::getline(stream, line);
-  while (std::getline(stream, line)) {
-    if (line.compare(0, 3, "cpu") != 0) break;
+  next_line(stat);
+  while (!stat.empty()) {
+    std::string_view line = next_line(stat);
+    if (line.substr(0, 3) != "cpu") break;
 
     CPUTime t = {};
-    std::istringstream iss(line);
-    if (iss.ignore(3) >> t.id >> t.utime >> t.ntime >> t.stime >> t.itime >> t.iowtime >> t.irqtime >> t.sirqtime)
+    Tokenizer fields(line.substr(3));
+    if (fields.next(t.id) && fields.next(t.utime) && fields.next(t.ntime) && fields.next(t.stime) && fields.next(t.itime) &&
+        fields.next(t.iowtime) && fields.next(t.irqtime) && fields.next(t.sirqtime))
       cpu_times.push_back(t);
   }
   return cpu_times;
 }
 
 // parse /proc/meminfo
-std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream) {
+std::unordered_map<std::string, uint64_t> memInfo(std::string_view meminfo) {
   std::unordered_map<std::string, uint64_t> mem_info;
-  std::string line, key;
-  while (std::getline(stream, line)) {
+  while (!meminfo.empty()) {
+    Tokenizer fields(next_line(meminfo));
+    std::string_view key = fields.next();
     uint64_t val = 0;
-    std::istringstream iss(line);
-    if (iss >> key >> val) {
-      mem_info[key] = val * 1024;
+    if (!key.empty() && fields.next(val)) {
+      mem_info[std::string(key)] = val * 1024;
     }
   }
   return mem_info;
@@ -63,48 +103,44 @@ enum StatPos {
 };
 
 // parse /proc/pid/stat
-std::optional<ProcStat> procStat(std::string stat) {
+std::optional<ProcStat> procStat(std::string_view stat) {
   // To avoid being fooled by names containing a closing paren, scan backwards.
   auto open_paren = stat.find('(');
   auto close_paren = stat.rfind(')');
-  if (open_paren == std::string::npos || close_paren == std::string::npos || open_paren > close_paren) {
+  if (open_paren == std::string_view::npos || close_paren == std::string_view::npos || open_paren > close_paren) {
     return std::nullopt;
   }
 
-  std::string name = stat.substr(open_paren + 1, close_paren - open_paren - 1);
-  // replace space in name with _
-  std::replace(&stat[open_paren], &stat[close_paren], ' ', '_');
-  std::istringstream iss(stat);
-  std::vector<std::string> v{std::istream_iterator<std::string>(iss),
-                             std::istream_iterator<std::string>()};
-  try {
-    if (v.size() != StatPos::MAX_FIELD) {
-      throw std::invalid_argument("stat");
+  ProcStat p = {};
+  p.name = stat.substr(open_paren + 1, close_paren - open_paren - 1);
+  bool ok = Tokenizer(stat.substr(0, open_paren)).next(p.pid);
+
+  // the fields after the name
+  Tokenizer fields(stat.substr(close_paren + 1));
+  int pos = StatPos::state;
+  for (std::string_view f = fields.next(); ok && !f.empty(); f = fields.next(), ++pos) {
+    switch (pos) {
+      case StatPos::state: p.state = f[0]; break;
+      case StatPos::ppid: ok = parse(f, p.ppid); break;
+      case StatPos::utime: ok = parse(f, p.utime); break;
+      case StatPos::stime: ok = parse(f, p.stime); break;
+      case StatPos::cutime: ok = parse(f, p.cutime); break;
+      case StatPos::cstime: ok = parse(f, p.cstime); break;
+      case StatPos::priority: ok = parse(f, p.priority); break;
+      case StatPos::nice: ok = parse(f, p.nice); break;
+      case StatPos::num_threads: ok = parse(f, p.num_threads); break;
+      case StatPos::starttime: ok = parse(f, p.starttime); break;
+      case StatPos::vsize: ok = parse(f, p.vms); break;
+      case StatPos::rss: ok = parse(f, p.rss); break;
+      case StatPos::processor: ok = parse(f, p.processor); break;
     }
-    ProcStat p = {
-      .name = name,
-      .pid = stoi(v[StatPos::pid - 1]),
-      .state = v[StatPos::state - 1][0],
-      .ppid = stoi(v[StatPos::ppid - 1]),
-      .utime = stoul(v[StatPos::utime - 1]),
-      .stime = stoul(v[StatPos::stime - 1]),
-      .cutime = stol(v[StatPos::cutime - 1]),
-      .cstime = stol(v[StatPos::cstime - 1]),
-      .priority = stol(v[StatPos::priority - 1]),
-      .nice = stol(v[StatPos::nice - 1]),
-      .num_threads = stol(v[StatPos::num_threads - 1]),
-      .starttime = stoull(v[StatPos::starttime - 1]),
-      .vms = stoul(v[StatPos::vsize - 1]),
-      .rss = stol(v[StatPos::rss - 1]),
-      .processor = stoi(v[StatPos::processor - 1]),
-    };
-    return p;
-  } catch (const std::invalid_argument &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  } catch (const std::out_of_range &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  }
-  return std::nullopt;
+  }
+
+  if (!ok || pos != StatPos::MAX_FIELD + 1) {
+    LOGE("failed to parse procStat: %.*s", (int)stat.size(), stat.data());
+    return std::nullopt;
+  }
+  return p;
 }
 
 // return list of PIDs from /proc
@@ -127,39 +163,102 @@ std::vector<int> pids() {
 }
 
 // null-delimited cmdline arguments to vector
-std::vector<std::string> cmdline(std::istream &stream) {
+std::vector<std::string> cmdline(std::string_view cmdline) {
   std::vector<std::string> ret;
-  std::string line;
-  while (std::getline(stream, line, '\0')) {
-    if (!line.empty()) {
-      ret.push_back(line);
+  while (!cmdline.empty()) {
+    size_t end = cmdline.find('\0');
+    if (end != 0) {
+      ret.emplace_back(cmdline.substr(0, end));
     }
+    cmdline.remove_prefix(end == std::string_view::npos ? cmdline.size() : end + 1);
   }
   return ret;
 }
 
-const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
-  static std::unordered_map<pid_t, ProcCache> proc_cache;
-  ProcCache &cache = proc_cache[pid];
-  if (cache.pid != pid || cache.name != name) {
-    cache.pid = pid;
-    cache.name = name;
-    std::string proc_path = "/proc/" + std::to_string(pid);
-    cache.exe = util::readlink(proc_path + "/exe");
-    std::ifstream stream(proc_path + "/cmdline");
-    cache.cmdline = cmdline(stream);
-  }
-  return cache;
-}
-
 }  // namespace Parser
 
 const double jiffy = sysconf(_SC_CLK_TCK);
 const size_t page_size = sysconf(_SC_PAGE_SIZE);
 
-void buildCPUTimes(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/stat");
-  std::vector<CPUTime> stats = Parser::cpuTimes(stream);
+ProcSampler::ProcSampler(const std::string &proc_path) : buf(64 * 1024) {
+  proc_dir = opendir(proc_path.c_str());
+  assert(proc_dir);
+  stat_fd = openat(dirfd(proc_dir), "stat", O_RDONLY | O_CLOEXEC);
+  meminfo_fd = openat(dirfd(proc_dir), "meminfo", O_RDONLY | O_CLOEXEC);
+
+  // leave some fds for the rest of the process
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur > 128) {
+    max_open_fds = limit.rlim_cur - 128;
+  }
+}
+
+ProcSampler::~ProcSampler() {
+  for (auto &[pid, proc] : procs) {
+    if (proc.stat_fd >= 0) close(proc.stat_fd);
+  }
+  if (stat_fd >= 0) close(stat_fd);
+  if (meminfo_fd >= 0) close(meminfo_fd);
+  closedir(proc_dir);
+}
+
+std::string_view ProcSampler::read(int fd) {
+  ssize_t n = fd >= 0 ? pread(fd, buf.data(), buf.size(), 0) : -1;
+  return std::string_view(buf.data(), std::max<ssize_t>(n, 0));
+}
+
+// Reads the stat of a process, and what doesn't change until it execs the first time
+// and after it has. Returns false if the process is gone.
+bool ProcSampler::update(Proc &proc, const char *pid, bool &changed) {
+  const int dir_fd = dirfd(proc_dir);
+  char path[64];
+  snprintf(path, sizeof(path), "%s/stat", pid);
+
+  std::string_view data = read(proc.stat_fd);
+  if (data.empty() && proc.stat_fd >= 0) {
+    // the process we had open is gone, this pid may have been reused since
+    close(proc.stat_fd);
+    proc.stat_fd = -1;
+    proc.sample = 0;
+    open_fds--;
+  }
+  if (proc.stat_fd < 0) {
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    data = read(fd);
+    if (fd >= 0 && open_fds < max_open_fds) {
+      proc.stat_fd = fd;
+      open_fds++;
+    } else if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  std::optional<ProcStat> stat = data.empty() ? std::nullopt : Parser::procStat(data);
+  if (!stat) return false;
+
+  const bool is_new = proc.sample == 0;
+  if (is_new || stat->name != proc.stat.name) {
+    char exe[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/exe", pid);
+    ssize_t len = readlinkat(dir_fd, path, exe, sizeof(exe));
+    proc.exe.assign(exe, std::max<ssize_t>(len, 0));
+
+    snprintf(path, sizeof(path), "%s/cmdline", pid);
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    proc.cmdline = Parser::cmdline(read(fd));
+    if (fd >= 0) close(fd);
+  }
+
+  const ProcStat &last = proc.stat;
+  changed = is_new || stat->state != last.state || stat->utime != last.utime || stat->stime != last.stime ||
+            stat->cutime != last.cutime || stat->cstime != last.cstime || stat->num_threads != last.num_threads ||
+            stat->rss != last.rss || stat->vms != last.vms;
+  proc.stat = std::move(*stat);
+  return true;
+}
+
+void ProcSampler::buildCPUTimes(cereal::ProcLog::Builder &builder) {
+  std::vector<CPUTime> stats = Parser::cpuTimes(read(stat_fd));
 
   auto log_cpu_times = builder.initCpuTimes(stats.size());
   for (int i = 0; i < stats.size(); ++i) {
@@ -176,9 +275,8 @@ void buildCPUTimes(cereal::ProcLog::Builder &builder) {
   }
 }
 
-void buildMemInfo(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/meminfo");
-  auto mem_info = Parser::memInfo(stream);
+void ProcSampler::buildMemInfo(cereal::ProcLog::Builder &builder) {
+  auto mem_info = Parser::memInfo(read(meminfo_fd));
 
   auto mem = builder.initMem();
   mem.setTotal(mem_info["MemTotal:"]);
@@ -191,21 +289,43 @@ void buildMemInfo(cereal::ProcLog::Builder &builder) {
   mem.setShared(mem_info["Shmem:"]);
 }
 
-void buildProcs(cereal::ProcLog::Builder &builder) {
-  auto pids = Parser::pids();
-  std::vector<ProcStat> proc_stats;
-  proc_stats.reserve(pids.size());
-  for (int pid : pids) {
-    std::string path = "/proc/" + std::to_string(pid) + "/stat";
-    if (auto stat = Parser::procStat(util::read_file(path))) {
-      proc_stats.push_back(*stat);
+void ProcSampler::sample(cereal::ProcLog::Builder &builder, bool changed_only) {
+  ++samples;
+  out.clear();
+  rewinddir(proc_dir);
+  while (struct dirent *de = readdir(proc_dir)) {
+    int pid;
+    if ((de->d_type != DT_DIR && de->d_type != DT_UNKNOWN) || !parse(std::string_view(de->d_name), pid)) {
+      continue;
+    }
+
+    Proc &proc = procs[pid];
+    bool changed = false;
+    if (update(proc, de->d_name, changed)) {
+      proc.sample = samples;
+      if (changed || !changed_only) {
+        out.push_back(&proc);
+      }
     }
   }
 
-  auto procs = builder.initProcs(proc_stats.size());
-  for (size_t i = 0; i < proc_stats.size(); i++) {
-    auto l = procs[i];
-    const ProcStat &r = proc_stats[i];
+  // forget the processes that are gone
+  for (auto it = procs.begin(); it != procs.end();) {
+    if (it->second.sample != samples) {
+      if (it->second.stat_fd >= 0) {
+        close(it->second.stat_fd);
+        open_fds--;
+      }
+      it = procs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  auto log_procs = builder.initProcs(out.size());
+  for (size_t i = 0; i < out.size(); i++) {
+    auto l = log_procs[i];
+    const ProcStat &r = out[i]->stat;
     l.setPid(r.pid);
     l.setState(r.state);
     l.setPpid(r.ppid);
@@ -222,18 +342,19 @@ void buildProcs(cereal::ProcLog::Builder &builder) {
     l.setProcessor(r.processor);
     l.setName(r.name);
 
-    const ProcCache &extra_info = Parser::getProcExtraInfo(r.pid, r.name);
-    l.setExe(extra_info.exe);
-    auto lcmdline = l.initCmdline(extra_info.cmdline.size());
+    l.setExe(out[i]->exe);
+    auto lcmdline = l.initCmdline(out[i]->cmdline.size());
     for (size_t j = 0; j < lcmdline.size(); j++) {
-      lcmdline.set(j, extra_info.cmdline[j]);
+      lcmdline.set(j, out[i]->cmdline[j]);
     }
   }
+
+  buildCPUTimes(builder);
+  buildMemInfo(builder);
 }
 
 void buildProcLogMessage(MessageBuilder &msg) {
+  static ProcSampler sampler;
   auto procLog = msg.initEvent().initProcLog();
-  buildProcs(procLog);
-  buildCPUTimes(procLog);
-  buildMemInfo(procLog);
+  sampler.sample(procLog);
 }
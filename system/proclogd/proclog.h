@@ -1,5 +1,8 @@
+#include <dirent.h>
+
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -11,12 +14,6 @@ struct CPUTime {
   unsigned long iowtime, irqtime, sirqtime;
 };
 
-struct ProcCache {
-  int pid;
-  std::string name, exe;
-  std::vector<std::string> cmdline;
-};
-
 struct ProcStat {
   int pid, ppid, processor;
   char state;
@@ -29,12 +26,45 @@ struct ProcStat {
 namespace Parser {
 
 std::vector<int> pids();
-std::optional<ProcStat> procStat(std::string stat);
-std::vector<std::string> cmdline(std::istream &stream);
-std::vector<CPUTime> cpuTimes(std::istream &stream);
-std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream);
-const ProcCache &getProcExtraInfo(int pid, const std::string &name);
+std::optional<ProcStat> procStat(std::string_view stat);
+std::vector<std::string> cmdline(std::string_view cmdline);
+std::vector<CPUTime> cpuTimes(std::string_view stat);
+std::unordered_map<std::string, uint64_t> memInfo(std::string_view meminfo);
 
 };  // namespace Parser
 
+// Samples /proc, or a tree laid out like it, for procLog. The stat file of each process
+// stays open between samples, and its cmdline and exe are read once.
+class ProcSampler {
+public:
+  ProcSampler(const std::string &proc_path = "/proc");
+  ~ProcSampler();
+  // With changed_only, processes that were in the last sample and whose counters
+  // haven't changed since are left out.
+  void sample(cereal::ProcLog::Builder &builder, bool changed_only = false);
+
+private:
+  struct Proc {
+    int stat_fd = -1;
+    uint64_t sample = 0;
+    ProcStat stat;
+    std::string exe;
+    std::vector<std::string> cmdline;
+  };
+
+  std::string_view read(int fd);
+  bool update(Proc &proc, const char *pid, bool &changed);
+  void buildCPUTimes(cereal::ProcLog::Builder &builder);
+  void buildMemInfo(cereal::ProcLog::Builder &builder);
+
+  DIR *proc_dir = nullptr;
+  int stat_fd = -1, meminfo_fd = -1;
+  // stat files of processes past this many are opened every sample
+  size_t max_open_fds = 0, open_fds = 0;
+  uint64_t samples = 0;
+  std::unordered_map<int, Proc> procs;
+  std::vector<const Proc *> out;
+  std::vector<char> buf;
+};
+
 void buildProcLogMessage(MessageBuilder &msg);
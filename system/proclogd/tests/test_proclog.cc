@@ -1,10 +1,42 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch.hpp"
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+#include "common/timing.h"
 #include "common/util.h"
 #include "system/proclogd/proclog.h"
 
 const std::string allowed_states = "RSDTZtWXxKWPI";
 
+// the istream parser Parser::procStat replaced
+static std::optional<ProcStat> procStat_ref(std::string stat) {
+  auto open_paren = stat.find('(');
+  auto close_paren = stat.rfind(')');
+  if (open_paren == std::string::npos || close_paren == std::string::npos || open_paren > close_paren) {
+    return std::nullopt;
+  }
+  std::string name = stat.substr(open_paren + 1, close_paren - open_paren - 1);
+  std::replace(&stat[open_paren], &stat[close_paren], ' ', '_');
+  std::istringstream iss(stat);
+  std::vector<std::string> v{std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>()};
+  if (v.size() != 52) return std::nullopt;
+  return ProcStat{
+    .pid = stoi(v[0]), .ppid = stoi(v[3]), .processor = stoi(v[38]), .state = v[2][0],
+    .cutime = stol(v[15]), .cstime = stol(v[16]), .priority = stol(v[17]), .nice = stol(v[18]),
+    .num_threads = stol(v[19]), .rss = stol(v[23]), .utime = stoul(v[13]), .stime = stoul(v[14]),
+    .vms = stoul(v[22]), .starttime = stoull(v[21]), .name = name,
+  };
+}
+
 TEST_CASE("Parser::procStat") {
   SECTION("from string") {
     const std::string stat_str =
@@ -36,9 +68,17 @@ TEST_CASE("Parser::procStat") {
     for (int pid : pids) {
       std::string stat_path = "/proc/" + std::to_string(pid) + "/stat";
       INFO(stat_path);
-      if (auto stat = Parser::procStat(util::read_file(stat_path))) {
+      const std::string stat_str = util::read_file(stat_path);
+      if (auto stat = Parser::procStat(stat_str)) {
         REQUIRE(stat->pid == pid);
         REQUIRE(allowed_states.find(stat->state) != std::string::npos);
+
+        auto ref = procStat_ref(stat_str);
+        REQUIRE(ref);
+        REQUIRE(std::tie(stat->name, stat->ppid, stat->state, stat->utime, stat->stime, stat->cutime, stat->cstime, stat->priority,
+                         stat->nice, stat->num_threads, stat->starttime, stat->vms, stat->rss, stat->processor) ==
+                std::tie(ref->name, ref->ppid, ref->state, ref->utime, ref->stime, ref->cutime, ref->cstime, ref->priority,
+                         ref->nice, ref->num_threads, ref->starttime, ref->vms, ref->rss, ref->processor));
       } else {
         REQUIRE(util::file_exists(stat_path) == false);
       }
@@ -52,8 +92,7 @@ TEST_CASE("Parser::cpuTimes") {
         "cpu  0 0 0 0 0 0 0 0 0 0\n"
         "cpu0 1 2 3 4 5 6 7 8 9 10\n"
         "cpu1 1 2 3 4 5 6 7 8 9 10\n";
-    std::istringstream stream(stat);
-    auto stats = Parser::cpuTimes(stream);
+    auto stats = Parser::cpuTimes(stat);
     REQUIRE(stats.size() == 2);
     for (int i = 0; i < stats.size(); ++i) {
       REQUIRE(stats[i].id == i);
@@ -67,8 +106,7 @@ TEST_CASE("Parser::cpuTimes") {
     }
   }
   SECTION("all cpus") {
-    std::istringstream stream(util::read_file("/proc/stat"));
-    auto stats = Parser::cpuTimes(stream);
+    auto stats = Parser::cpuTimes(util::read_file("/proc/stat"));
     REQUIRE(stats.size() == sysconf(_SC_NPROCESSORS_ONLN));
     for (int i = 0; i < stats.size(); ++i) {
       REQUIRE(stats[i].id == i);
@@ -78,15 +116,13 @@ TEST_CASE("Parser::cpuTimes") {
 
 TEST_CASE("Parser::memInfo") {
   SECTION("from string") {
-    std::istringstream stream("MemTotal:    1024 kb\nMemFree:    2048 kb\n");
-    auto meminfo = Parser::memInfo(stream);
+    auto meminfo = Parser::memInfo("MemTotal:    1024 kb\nMemFree:    2048 kb\n");
     REQUIRE(meminfo["MemTotal:"] == 1024 * 1024);
     REQUIRE(meminfo["MemFree:"] == 2048 * 1024);
   }
   SECTION("from /proc/meminfo") {
     std::string require_keys[] = {"MemTotal:", "MemFree:", "MemAvailable:", "Buffers:", "Cached:", "Active:", "Inactive:", "Shmem:"};
-    std::istringstream stream(util::read_file("/proc/meminfo"));
-    auto meminfo = Parser::memInfo(stream);
+    auto meminfo = Parser::memInfo(util::read_file("/proc/meminfo"));
     for (auto &key : require_keys) {
       REQUIRE(meminfo.find(key) != meminfo.end());
       REQUIRE(meminfo[key] > 0);
@@ -95,9 +131,7 @@ TEST_CASE("Parser::memInfo") {
 }
 
 void test_cmdline(std::string cmdline, const std::vector<std::string> requires) {
-  std::stringstream ss;
-  ss.write(&cmdline[0], cmdline.size());
-  auto cmds = Parser::cmdline(ss);
+  auto cmds = Parser::cmdline(cmdline);
   REQUIRE(cmds.size() == requires.size());
   for (int i = 0; i < requires.size(); ++i) {
     REQUIRE(cmds[i] == requires[i]);
@@ -140,3 +174,126 @@ TEST_CASE("buildProcLoggerMessage") {
     }
   }
 }
+
+// A directory laid out like /proc, with a process for each pid.
+struct FakeProcfs {
+  FakeProcfs(int num_pids) {
+    char tmp_path[] = "/tmp/fake_proc_XXXXXX";
+    path = mkdtemp(tmp_path);
+    write("stat", "cpu  0 0 0 0 0 0 0 0 0 0\ncpu0 1 2 3 4 5 6 7 8 9 10\ncpu1 1 2 3 4 5 6 7 8 9 10\nintr 0\n");
+    write("meminfo", "MemTotal:    1024 kB\nMemFree:    512 kB\nShmem:    16 kB\n");
+    for (int pid = 1; pid <= num_pids; ++pid) add(pid);
+  }
+  ~FakeProcfs() { system(("rm -rf " + path).c_str()); }
+
+  void write(const std::string &file, const std::string &content) {
+    // truncating keeps the inode, so files that are open see the new content like on procfs
+    std::ofstream(path + "/" + file, std::ios::trunc) << content;
+  }
+  void add(int pid, const std::string &name = "proc") {
+    const std::string dir = path + "/" + std::to_string(pid);
+    mkdir(dir.c_str(), 0755);
+    std::ofstream(dir + "/stat");
+    set_stat(pid, 0, name);
+    std::ofstream(dir + "/cmdline") << "/usr/bin/" << name << '\0' << "--pid" << '\0' << pid << '\0';
+    symlink(("/usr/bin/" + name).c_str(), (dir + "/exe").c_str());
+  }
+  void set_stat(int pid, int utime, const std::string &name = "proc") {
+    write(std::to_string(pid) + "/stat", util::string_format(
+      "%d (%s) S 1 %d %d 0 -1 4194560 100 0 0 0 %d 7 0 0 20 0 1 0 1234 10000000 300 18446744073709551615 "
+      "1 1 0 0 0 0 0 0 0 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0\n", pid, name.c_str(), pid, pid, utime));
+  }
+  void remove(int pid) { system(("rm -rf " + path + "/" + std::to_string(pid)).c_str()); }
+
+  std::string path;
+};
+
+static std::map<int, cereal::ProcLog::Process::Reader> sample(ProcSampler &sampler, MessageBuilder &msg, bool changed_only) {
+  auto procLog = msg.initEvent().initProcLog();
+  sampler.sample(procLog, changed_only);
+  std::map<int, cereal::ProcLog::Process::Reader> procs;
+  for (auto p : procLog.asReader().getProcs()) procs.emplace(p.getPid(), p);
+  return procs;
+}
+
+TEST_CASE("ProcSampler") {
+  FakeProcfs procfs(20);
+  ProcSampler sampler(procfs.path);
+
+  MessageBuilder msg;
+  auto procs = sample(sampler, msg, true);
+  REQUIRE(procs.size() == 20);
+  auto p = procs.at(7);
+  REQUIRE(p.getName() == "proc");
+  REQUIRE(p.getPpid() == 1);
+  REQUIRE(p.getState() == 'S');
+  REQUIRE(p.getMemRss() == 300 * sysconf(_SC_PAGE_SIZE));
+  REQUIRE(p.getExe() == "/usr/bin/proc");
+  REQUIRE(p.getCmdline().size() == 3);
+  REQUIRE(p.getCmdline()[2] == "7");
+  auto log = msg.getRoot<cereal::Event>().asReader().getProcLog();
+  REQUIRE(log.getCpuTimes().size() == 2);
+  REQUIRE(log.getMem().getTotal() == 1024 * 1024);
+
+  SECTION("only the processes that changed") {
+    REQUIRE(sample(sampler, msg, true).empty());
+    procfs.set_stat(3, 100);
+    procfs.add(25);
+    procs = sample(sampler, msg, true);
+    REQUIRE(procs.size() == 2);
+    REQUIRE(procs.at(3).getCpuUser() == Approx(100 / (double)sysconf(_SC_CLK_TCK)));
+    REQUIRE(procs.count(25) == 1);
+    REQUIRE(sample(sampler, msg, false).size() == 21);
+  }
+  SECTION("processes that are gone or exec'd") {
+    procfs.remove(5);
+    procfs.set_stat(6, 0, "other");
+    unlink((procfs.path + "/6/exe").c_str());
+    symlink("/usr/bin/other", (procfs.path + "/6/exe").c_str());
+    procs = sample(sampler, msg, false);
+    REQUIRE(procs.size() == 19);
+    REQUIRE(procs.count(5) == 0);
+    REQUIRE(procs.at(6).getName() == "other");
+    REQUIRE(procs.at(6).getExe() == "/usr/bin/other");
+  }
+}
+
+TEST_CASE("proclog_benchmark", "[.][benchmark]") {
+  // like proclogd, so all the stat files can stay open
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+
+  FakeProcfs procfs(3000);
+  const int samples = 20;
+
+  // what buildProcLogMessage did for the processes before ProcSampler
+  double start = millis_since_boot();
+  for (int i = 0; i < samples; ++i) {
+    std::vector<ProcStat> stats;
+    for (int pid = 1; pid <= 3000; ++pid) {
+      if (auto stat = procStat_ref(util::read_file(procfs.path + "/" + std::to_string(pid) + "/stat"))) {
+        stats.push_back(*stat);
+      }
+    }
+    REQUIRE(stats.size() == 3000);
+  }
+  const double ref_ms = (millis_since_boot() - start) / samples;
+
+  ProcSampler sampler(procfs.path);
+  auto time_samples = [&](bool changed_only) {
+    double start = millis_since_boot();
+    for (int i = 0; i < samples; ++i) {
+      // a few processes are busy
+      for (int pid = 1; pid <= 30; ++pid) procfs.set_stat(pid, i + 1);
+      MessageBuilder msg;
+      auto procLog = msg.initEvent().initProcLog();
+      sampler.sample(procLog, changed_only);
+    }
+    return (millis_since_boot() - start) / samples;
+  };
+  const double full_ms = time_samples(false);
+  const double changed_ms = time_samples(true);
+  printf("3000 processes: reopening and istream parsing %.2f ms, ProcSampler %.2f ms, changed only %.2f ms\n", ref_ms, full_ms, changed_ms);
+}
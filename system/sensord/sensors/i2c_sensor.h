@@ -29,6 +29,7 @@ public:
   ~I2CSensor();
   int read_register(uint register_address, uint8_t *buffer, uint8_t len);
   int set_register(uint register_address, uint8_t data);
+  int read_burst(uint register_address, uint8_t *buffer, size_t len);
   int init_gpio();
   bool has_interrupt_enabled();
   virtual int init() = 0;
@@ -229,12 +229,17 @@ bool LSM6DS3_Accel::get_event(MessageBuilder &msg, uint64_t ts) {
   int len = read_register(LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL, buffer, sizeof(buffer));
   assert(len == sizeof(buffer));
 
+  auto event = msg.initEvent().initAccelerometer();
+  build_event(event, buffer, ts);
+  return true;
+}
+
+void LSM6DS3_Accel::build_event(cereal::SensorEventData::Builder event, const uint8_t *data, uint64_t ts) {
   float scale = 9.81 * 2.0f / (1 << 15);
-  float x = read_16_bit(buffer[0], buffer[1]) * scale;
-  float y = read_16_bit(buffer[2], buffer[3]) * scale;
-  float z = read_16_bit(buffer[4], buffer[5]) * scale;
+  float x = read_16_bit(data[0], data[1]) * scale;
+  float y = read_16_bit(data[2], data[3]) * scale;
+  float z = read_16_bit(data[4], data[5]) * scale;
 
-  auto event = msg.initEvent().initAccelerometer();
   event.setSource(source);
   event.setVersion(1);
   event.setSensor(SENSOR_ACCELEROMETER);
@@ -245,6 +250,4 @@ bool LSM6DS3_Accel::get_event(MessageBuilder &msg, uint64_t ts) {
   auto svec = event.initAcceleration();
   svec.setV(xyz);
   svec.setStatus(true);
-
-  return true;
 }
@@ -46,4 +46,6 @@ public:
   int init();
   bool get_event(MessageBuilder &msg, uint64_t ts = 0);
   int shutdown();
+  // Fills in the event from the 6 bytes of an output sample
+  void build_event(cereal::SensorEventData::Builder event, const uint8_t *data, uint64_t ts);
 };
@@ -0,0 +1,252 @@
+#include "system/sensord/sensors/lsm6ds3_fifo.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/swaglog.h"
+#include "common/timing.h"
+
+LSM6DS3_Fifo::LSM6DS3_Fifo(I2CBus *bus, int gpio_nr, bool shared_gpio) :
+  I2CSensor(bus, gpio_nr, shared_gpio), accel(bus), gyro(bus) {}
+
+int LSM6DS3_Fifo::init() {
+  uint8_t value = 0;
+  const int watermark = LSM6DS3_FIFO_WATERMARK_SETS * LSM6DS3_FIFO_SET_WORDS;
+
+  int chip_id = verify_chip_id(LSM6DS3_FIFO_I2C_REG_ID, {LSM6DS3_FIFO_CHIP_ID, LSM6DS3TRC_FIFO_CHIP_ID});
+  if (chip_id == -1) return -1;
+
+  // self tests, and the outputs at 104 Hz
+  int ret = accel.init();
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = gyro.init();
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = init_gpio();
+  if (ret < 0) {
+    goto fail;
+  }
+
+  // enable the timestamp counter at 25 us, and reset it
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_WAKE_UP_DUR, LSM6DS3_FIFO_TIMER_HR);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  if (chip_id == LSM6DS3TRC_FIFO_CHIP_ID) {
+    ret = read_register(LSM6DS3_FIFO_I2C_REG_CTRL10_C, &value, 1);
+    if (ret < 0) {
+      goto fail;
+    }
+    ret = set_register(LSM6DS3_FIFO_I2C_REG_CTRL10_C, value | LSM6DS3TRC_FIFO_CTRL10_TIMER_EN);
+  } else {
+    ret = read_register(LSM6DS3_FIFO_I2C_REG_TAP_CFG, &value, 1);
+    if (ret < 0) {
+      goto fail;
+    }
+    ret = set_register(LSM6DS3_FIFO_I2C_REG_TAP_CFG, value | LSM6DS3_FIFO_TAP_CFG_TIMER_EN);
+  }
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_TIMESTAMP2, LSM6DS3_FIFO_TIMESTAMP_RESET);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  // empty the FIFO, and store gyro, accel and the counter in each set from now on
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5, LSM6DS3_FIFO_MODE_BYPASS);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL1, watermark & 0xFF);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL2, LSM6DS3_FIFO_TIMER_PEDO_FIFO_EN | ((watermark >> 8) & 0x07));
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL3, LSM6DS3_FIFO_DEC_GYRO_NONE | LSM6DS3_FIFO_DEC_XL_NONE);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL4, LSM6DS3_FIFO_DEC_DS4_NONE);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5, LSM6DS3_FIFO_ODR_104HZ | LSM6DS3_FIFO_MODE_CONTINUOUS);
+  if (ret < 0) {
+    goto fail;
+  }
+
+  // interrupt on INT1 at the watermark only, instead of when each sample is ready
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_INT1_CTRL, LSM6DS3_FIFO_INT1_FTH);
+
+fail:
+  return ret;
+}
+
+int LSM6DS3_Fifo::shutdown() {
+  int ret = set_register(LSM6DS3_FIFO_I2C_REG_INT1_CTRL, 0);
+  if (ret < 0) {
+    LOGE("Could not disable lsm6ds3 FIFO interrupt!");
+  }
+
+  ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5, LSM6DS3_FIFO_MODE_BYPASS);
+  if (ret < 0) {
+    LOGE("Could not disable lsm6ds3 FIFO!");
+  }
+
+  // power-down mode
+  accel.shutdown();
+  gyro.shutdown();
+  return ret;
+}
+
+// Reads the complete sets in the FIFO, up to max_sets, and returns how many were read
+int LSM6DS3_Fifo::read_sets(uint8_t *data, int max_sets, bool *overrun) {
+  uint8_t status[4];
+  int ret = read_register(LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1, status, sizeof(status));
+  if (ret < 0) {
+    return ret;
+  }
+
+  const int words = status[0] | ((status[1] & LSM6DS3_FIFO_STATUS2_DIFF) << 8);
+  const int pattern = status[2] | ((status[3] & LSM6DS3_FIFO_STATUS4_PATTERN) << 8);
+
+  // an overrun drops the oldest words while the FIFO is being read, so the sets can't be
+  // told apart anymore. Empty it, and start over with the next sample.
+  if ((status[1] & LSM6DS3_FIFO_STATUS2_OVER_RUN) || pattern != 0) {
+    *overrun = true;
+    ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5, LSM6DS3_FIFO_MODE_BYPASS);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = set_register(LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5, LSM6DS3_FIFO_ODR_104HZ | LSM6DS3_FIFO_MODE_CONTINUOUS);
+    return ret < 0 ? ret : 0;
+  }
+
+  const int sets = std::min(words / LSM6DS3_FIFO_SET_WORDS, max_sets);
+  if (sets == 0) {
+    return 0;
+  }
+
+  ret = read_burst(LSM6DS3_FIFO_I2C_REG_FIFO_DATA_OUT, data, sets * LSM6DS3_FIFO_SET_SIZE);
+  return ret < 0 ? ret : sets;
+}
+
+void LSM6DS3_Fifo::update_clock(uint64_t t, uint64_t ts) {
+  if (!interrupts.empty()) {
+    const double predicted = anchor_ts + (int64_t)(t - anchor_ticks) * ns_per_tick;
+    if (std::abs((double)ts - predicted) > LSM6DS3_FIFO_CLOCK_RESYNC_NS) {
+      LOGW("lsm6ds3 FIFO counter off by %.1f ms, resyncing", ((double)ts - predicted) / 1e6);
+      interrupts.clear();
+    }
+  }
+  interrupts.push_back({t, ts});
+  if (interrupts.size() > LSM6DS3_FIFO_CLOCK_INTERRUPTS) {
+    interrupts.pop_front();
+  }
+
+  // least squares fit of the interrupt times to the counter, relative to this interrupt
+  const double n = interrupts.size();
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (const auto &[it, its] : interrupts) {
+    const double x = (int64_t)(it - t);
+    const double y = (int64_t)(its - ts);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+
+  ns_per_tick = LSM6DS3_FIFO_TICK_NS;
+  const double det = n * sxx - sx * sx;
+  if (det > 0) {
+    const double slope = (n * sxy - sx * sy) / det;
+    if (std::abs(slope / LSM6DS3_FIFO_TICK_NS - 1.0) < LSM6DS3_FIFO_TICK_TOLERANCE) {
+      ns_per_tick = slope;
+    }
+  }
+
+  anchored = true;
+  anchor_ticks = t;
+  anchor_ts = ts + (int64_t)std::llround((sy - ns_per_tick * sx) / n);
+}
+
+int LSM6DS3_Fifo::read_samples(std::vector<Sample> &out, uint64_t ts) {
+  out.clear();
+  buffer.resize(LSM6DS3_FIFO_MAX_READ_SETS * LSM6DS3_FIFO_SET_SIZE);
+
+  bool overrun = false;
+  int sets = 0;
+  do {
+    sets = read_sets(buffer.data(), LSM6DS3_FIFO_MAX_READ_SETS, &overrun);
+    if (sets < 0) {
+      drained = false;
+      return sets;
+    }
+
+    for (int i = 0; i < sets; ++i) {
+      const uint8_t *set = &buffer[i * LSM6DS3_FIFO_SET_SIZE];
+      const uint8_t *counter = &set[12];
+
+      // 24 bits, in bytes 1, 0 and 3 of the set's timestamp words
+      const uint32_t value = (uint32_t(counter[1]) << 16) | (uint32_t(counter[0]) << 8) | counter[3];
+      ticks += (value - last_counter) & 0xFFFFFF;
+      last_counter = value;
+
+      Sample &sample = out.emplace_back();
+      sample.ts = ticks;
+      std::copy(set, set + 6, sample.gyro);
+      std::copy(set + 6, set + 12, sample.accel);
+    }
+  } while (sets == LSM6DS3_FIFO_MAX_READ_SETS);
+
+  if (overrun) {
+    LOGW("lsm6ds3 FIFO overrun, dropped its samples");
+  }
+
+  // the interrupt came as the set at the watermark was stored, if the FIFO was emptied before
+  const size_t trigger = LSM6DS3_FIFO_WATERMARK_SETS - 1;
+  if (ts != 0 && drained && !overrun && out.size() > trigger) {
+    update_clock(out[trigger].ts, ts);
+  } else if (!anchored && !out.empty()) {
+    // roughly, until the first interrupt
+    anchored = true;
+    anchor_ticks = out.back().ts;
+    anchor_ts = ts != 0 ? ts : nanos_since_boot();
+  }
+  drained = true;
+
+  for (auto &sample : out) {
+    sample.ts = anchor_ts + (int64_t)std::llround((int64_t)(sample.ts - anchor_ticks) * ns_per_tick);
+  }
+  return out.size();
+}
+
+bool LSM6DS3_Fifo::get_event(MessageBuilder &msg, uint64_t ts) {
+  if (read_samples(samples, ts) <= 0) {
+    return false;
+  }
+
+  // gyro and accel of a set are sampled at once
+  auto events = msg.initEvent().initSensorEvents(samples.size() * 2);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    gyro.build_event(events[i * 2], samples[i].gyro, samples[i].ts);
+    accel.build_event(events[i * 2 + 1], samples[i].accel, samples[i].ts);
+  }
+  return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "system/sensord/sensors/i2c_sensor.h"
+#include "system/sensord/sensors/lsm6ds3_accel.h"
+#include "system/sensord/sensors/lsm6ds3_gyro.h"
+
+// Address of the chip on the bus
+#define LSM6DS3_FIFO_I2C_ADDR       0x6A
+
+// Registers of the chip
+#define LSM6DS3_FIFO_I2C_REG_FIFO_CTRL1    0x06
+#define LSM6DS3_FIFO_I2C_REG_FIFO_CTRL2    0x07
+#define LSM6DS3_FIFO_I2C_REG_FIFO_CTRL3    0x08
+#define LSM6DS3_FIFO_I2C_REG_FIFO_CTRL4    0x09
+#define LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5    0x0A
+#define LSM6DS3_FIFO_I2C_REG_INT1_CTRL     0x0D
+#define LSM6DS3_FIFO_I2C_REG_ID            0x0F
+#define LSM6DS3_FIFO_I2C_REG_CTRL10_C      0x19
+#define LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1  0x3A
+#define LSM6DS3_FIFO_I2C_REG_FIFO_DATA_OUT 0x3E
+#define LSM6DS3_FIFO_I2C_REG_TIMESTAMP2    0x42
+#define LSM6DS3_FIFO_I2C_REG_TAP_CFG       0x58
+#define LSM6DS3_FIFO_I2C_REG_WAKE_UP_DUR   0x5C
+
+// Constants
+#define LSM6DS3_FIFO_CHIP_ID             0x69
+#define LSM6DS3TRC_FIFO_CHIP_ID          0x6A
+#define LSM6DS3_FIFO_TIMER_PEDO_FIFO_EN  (1 << 7)
+#define LSM6DS3_FIFO_DEC_GYRO_NONE       (0b001 << 3)
+#define LSM6DS3_FIFO_DEC_XL_NONE         0b001
+#define LSM6DS3_FIFO_DEC_DS4_NONE        (0b001 << 3)
+#define LSM6DS3_FIFO_ODR_104HZ           (0b0100 << 3)
+#define LSM6DS3_FIFO_MODE_BYPASS         0b000
+#define LSM6DS3_FIFO_MODE_CONTINUOUS     0b110
+#define LSM6DS3_FIFO_INT1_FTH            (1 << 3)
+#define LSM6DS3_FIFO_TAP_CFG_TIMER_EN    (1 << 7)
+#define LSM6DS3TRC_FIFO_CTRL10_TIMER_EN  (1 << 5)
+#define LSM6DS3_FIFO_TIMER_HR            (1 << 4)
+#define LSM6DS3_FIFO_TIMESTAMP_RESET     0xAA
+#define LSM6DS3_FIFO_STATUS2_OVER_RUN    (1 << 6)
+#define LSM6DS3_FIFO_STATUS2_DIFF        0x0F
+#define LSM6DS3_FIFO_STATUS4_PATTERN     0x03
+
+// A set of the FIFO is a gyro sample, an accel sample and the timestamp counter, three words each
+#define LSM6DS3_FIFO_SET_WORDS           9
+#define LSM6DS3_FIFO_SET_SIZE            (LSM6DS3_FIFO_SET_WORDS * 2)
+// Interrupt once 4 sets are stored, at 26 Hz
+#define LSM6DS3_FIFO_WATERMARK_SETS      4
+#define LSM6DS3_FIFO_MAX_READ_SETS       32
+// The counter counts 25 us with TIMER_HR, from the chip's oscillator, which is off by a few percent
+#define LSM6DS3_FIFO_TICK_NS             25000.0
+#define LSM6DS3_FIFO_TICK_TOLERANCE      0.05
+// The counter is fitted to the interrupts of the last 2.5 s, and refitted from scratch when it's off by more than 5 ms
+#define LSM6DS3_FIFO_CLOCK_INTERRUPTS    64
+#define LSM6DS3_FIFO_CLOCK_RESYNC_NS     5e6
+
+
+// Reads the accel and gyro in batches from the FIFO of the chip. Each set of samples is
+// timestamped from the chip's counter, mapped to the time of the watermark interrupts.
+class LSM6DS3_Fifo : public I2CSensor {
+  uint8_t get_device_address() {return LSM6DS3_FIFO_I2C_ADDR;}
+
+public:
+  struct Sample {
+    uint64_t ts;
+    uint8_t gyro[6];
+    uint8_t accel[6];
+  };
+
+  LSM6DS3_Fifo(I2CBus *bus, int gpio_nr = 0, bool shared_gpio = false);
+  int init();
+  // Reads all complete sets in the FIFO. ts is the time of the watermark interrupt, or 0 if
+  // there wasn't one. Returns the number of samples, or a negative error. After an overrun the
+  // FIFO is emptied, and its samples are dropped.
+  int read_samples(std::vector<Sample> &out, uint64_t ts);
+  bool get_event(MessageBuilder &msg, uint64_t ts = 0);
+  int shutdown();
+
+  double tick_ns() const { return ns_per_tick; }
+
+private:
+  int read_sets(uint8_t *buffer, int max_sets, bool *overrun);
+  void update_clock(uint64_t ticks, uint64_t ts);
+
+  LSM6DS3_Accel accel;
+  LSM6DS3_Gyro gyro;
+  std::vector<uint8_t> buffer;
+  std::vector<Sample> samples;
+
+  // the counter, unwrapped from 24 bits
+  uint32_t last_counter = 0;
+  uint64_t ticks = 0;
+  // the counter at the recent interrupts, and the fit of the time to it: a tick at a known time
+  // and the length of a tick
+  std::deque<std::pair<uint64_t, uint64_t>> interrupts;
+  bool anchored = false;
+  uint64_t anchor_ticks = 0, anchor_ts = 0;
+  double ns_per_tick = LSM6DS3_FIFO_TICK_NS;
+  // whether the FIFO was emptied by the previous read, so the set at the watermark is known
+  bool drained = true;
+};
@@ -212,12 +212,17 @@ bool LSM6DS3_Gyro::get_event(MessageBuilder &msg, uint64_t ts) {
   int len = read_register(LSM6DS3_GYRO_I2C_REG_OUTX_L_G, buffer, sizeof(buffer));
   assert(len == sizeof(buffer));
 
+  auto event = msg.initEvent().initGyroscope();
+  build_event(event, buffer, ts);
+  return true;
+}
+
+void LSM6DS3_Gyro::build_event(cereal::SensorEventData::Builder event, const uint8_t *data, uint64_t ts) {
   float scale = 8.75 / 1000.0;
-  float x = DEG2RAD(read_16_bit(buffer[0], buffer[1]) * scale);
-  float y = DEG2RAD(read_16_bit(buffer[2], buffer[3]) * scale);
-  float z = DEG2RAD(read_16_bit(buffer[4], buffer[5]) * scale);
+  float x = DEG2RAD(read_16_bit(data[0], data[1]) * scale);
+  float y = DEG2RAD(read_16_bit(data[2], data[3]) * scale);
+  float z = DEG2RAD(read_16_bit(data[4], data[5]) * scale);
 
-  auto event = msg.initEvent().initGyroscope();
   event.setSource(source);
   event.setVersion(2);
   event.setSensor(SENSOR_GYRO_UNCALIBRATED);
@@ -228,6 +233,4 @@ bool LSM6DS3_Gyro::get_event(MessageBuilder &msg, uint64_t ts) {
   auto svec = event.initGyroUncalibrated();
   svec.setV(xyz);
   svec.setStatus(true);
-
-  return true;
 }
@@ -19,8 +19,7 @@
 #include "system/sensord/sensors/bmx055_magn.h"
 #include "system/sensord/sensors/bmx055_temp.h"
 #include "system/sensord/sensors/constants.h"
-#include "system/sensord/sensors/lsm6ds3_accel.h"
-#include "system/sensord/sensors/lsm6ds3_gyro.h"
+#include "system/sensord/sensors/lsm6ds3_fifo.h"
 #include "system/sensord/sensors/lsm6ds3_temp.h"
 #include "system/sensord/sensors/mmc5603nj_magn.h"
 
@@ -29,7 +28,7 @@
 ExitHandler do_exit;
 
 void interrupt_loop(std::vector<std::tuple<Sensor *, std::string>> sensors) {
-  PubMaster pm({"gyroscope", "accelerometer"});
+  PubMaster pm({"sensorEvents"});
 
   int fd = -1;
   for (auto &[sensor, msg_name] : sensors) {
@@ -45,44 +44,58 @@ void interrupt_loop(std::vector<std::tuple<Sensor *, std::string>> sensors) {
 
   while (!do_exit) {
     int err = poll(fd_list, 1, 100);
+    // the time of the interrupt, or 0 if there was none
+    uint64_t ts = 0;
     if (err == -1) {
       if (errno == EINTR) {
         continue;
       }
       return;
     } else if (err == 0) {
+      // the FIFO interrupt stays high until it's read below the watermark, so read it anyway
       LOGE("poll timed out");
-      continue;
-    }
+      if (fd < 0) {
+        continue;
+      }
+    } else {
+      if ((fd_list[0].revents & (POLLIN | POLLPRI)) == 0) {
+        LOGE("no poll events set");
+        continue;
+      }
 
-    if ((fd_list[0].revents & (POLLIN | POLLPRI)) == 0) {
-      LOGE("no poll events set");
-      continue;
-    }
+      // Read all events
+      struct gpioevent_data evdata[16];
+      err = read(fd, evdata, sizeof(evdata));
+      if (err < 0 || err % sizeof(*evdata) != 0) {
+        LOGE("error reading event data %d", err);
+        continue;
+      }
 
-    // Read all events
-    struct gpioevent_data evdata[16];
-    err = read(fd, evdata, sizeof(evdata));
-    if (err < 0 || err % sizeof(*evdata) != 0) {
-      LOGE("error reading event data %d", err);
-      continue;
+      // the last rising edge, the falling edges come from reading the FIFO
+      int num_events = err / sizeof(*evdata);
+      uint64_t offset = nanos_since_epoch() - nanos_since_boot();
+      for (int i = num_events - 1; i >= 0; --i) {
+        if (evdata[i].id == GPIOEVENT_EVENT_RISING_EDGE) {
+          ts = evdata[i].timestamp - offset;
+          break;
+        }
+      }
+      if (ts == 0) {
+        continue;
+      }
     }
 
-    int num_events = err / sizeof(*evdata);
-    uint64_t offset = nanos_since_epoch() - nanos_since_boot();
-    uint64_t ts = evdata[num_events - 1].timestamp - offset;
-
     for (auto &[sensor, msg_name] : sensors) {
       if (!sensor->has_interrupt_enabled()) {
         continue;
       }
 
-      MessageBuilder msg;
+      MessageBuilder &msg = pm.builder(msg_name.c_str());
       if (!sensor->get_event(msg, ts)) {
         continue;
       }
 
-      if (!sensor->is_data_valid(ts)) {
+      if (!sensor->is_data_valid(ts != 0 ? ts : nanos_since_boot())) {
         continue;
       }
 
@@ -95,7 +108,7 @@ void polling_loop(Sensor *sensor, std::string msg_name) {
   PubMaster pm({msg_name.c_str()});
   RateKeeper rk(msg_name, services.at(msg_name).frequency);
   while (!do_exit) {
-    MessageBuilder msg;
+    MessageBuilder &msg = pm.builder(msg_name.c_str());
     if (sensor->get_event(msg) && sensor->is_data_valid(nanos_since_boot())) {
       pm.send(msg_name.c_str(), msg);
     }
@@ -111,8 +124,7 @@ int sensor_loop(I2CBus *i2c_bus_imu) {
     {new BMX055_Magn(i2c_bus_imu), "magnetometer"},
     {new BMX055_Temp(i2c_bus_imu), "temperatureSensor2"},
 
-    {new LSM6DS3_Accel(i2c_bus_imu, GPIO_LSM_INT), "accelerometer"},
-    {new LSM6DS3_Gyro(i2c_bus_imu, GPIO_LSM_INT, true), "gyroscope"},
+    {new LSM6DS3_Fifo(i2c_bus_imu, GPIO_LSM_INT), "sensorEvents"},
     {new LSM6DS3_Temp(i2c_bus_imu), "temperatureSensor"},
 
     {new MMC5603NJ_Magn(i2c_bus_imu), "magnetometer"},
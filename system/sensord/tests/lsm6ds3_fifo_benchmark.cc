@@ -0,0 +1,136 @@
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "system/sensord/sensors/lsm6ds3_accel.h"
+#include "system/sensord/sensors/lsm6ds3_fifo.h"
+#include "system/sensord/sensors/lsm6ds3_gyro.h"
+#include "system/sensord/tests/mock_lsm6ds3.h"
+
+// Reads the accel and gyro of a simulated LSM6DS3 the way sensord did before, a message per
+// sample at each data ready interrupt, and in batches from the FIFO. Reports the wakeups and
+// messages per second, and per sample the I2C transfers, bytes and time on the bus, the CPU
+// time of the driver and the message, including the simulated bus, and the error of the
+// timestamp once the clock has settled.
+//
+// usage: lsm6ds3_fifo_benchmark [seconds]   (60 by default)
+
+// the chip's oscillator runs 2% fast, and the interrupts are timestamped 10-40 us late
+const double DRIFT = 0.02;
+const uint64_t LATENCY_NS = 10000, JITTER_NS = 30000;
+// a byte and its ack at 400 kHz
+const double BYTE_US = 22.5;
+
+static uint64_t cpu_nanos() {
+  struct timespec t;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+struct Result {
+  uint64_t wakeups = 0, messages = 0, samples = 0, transfers = 0, bytes = 0, cpu_ns = 0;
+  uint64_t errors = 0;
+  double sum_error_ns = 0, max_error_ns = 0;
+
+  void add_error(uint64_t ts, uint64_t sample_ts) {
+    const double error = std::abs((double)(int64_t)(ts - sample_ts));
+    max_error_ns = std::max(max_error_ns, error);
+    sum_error_ns += error;
+    errors++;
+  }
+};
+
+static void print(const char *name, const Result &r, double seconds) {
+  printf("%-12s %9.1f %9.1f %11.3f %10.1f %10.1f %10.2f %10.1f %10.1f\n", name, r.wakeups / seconds, r.messages / seconds,
+         (double)r.transfers / r.samples, (double)r.bytes / r.samples, r.bytes * BYTE_US / r.samples,
+         r.cpu_ns / 1e3 / r.samples, r.sum_error_ns / 1e3 / std::max<uint64_t>(r.errors, 1), r.max_error_ns / 1e3);
+}
+
+// the interrupt loop of sensord before, with the messages serialized instead of sent
+static Result data_ready(double seconds) {
+  MockLSM6DS3Bus bus(LSM6DS3_ACCEL_CHIP_ID, DRIFT, LATENCY_NS, JITTER_NS);
+  LSM6DS3_Accel accel(&bus);
+  LSM6DS3_Gyro gyro(&bus);
+  if (accel.init() < 0 || gyro.init() < 0) {
+    fprintf(stderr, "init failed\n");
+    exit(1);
+  }
+  bus.clear_interrupts();
+
+  Result r;
+  const uint64_t transfers = bus.transfers, bytes = bus.bytes, start = bus.now(), end = start + seconds * 1e9;
+  uint64_t ts;
+  while (bus.now() < end && bus.wait_interrupt(&ts, 100e6)) {
+    r.wakeups++;
+    for (Sensor *sensor : {(Sensor *)&gyro, (Sensor *)&accel}) {
+      const uint64_t cpu_start = cpu_nanos();
+      MessageBuilder msg;
+      const bool sent = sensor->get_event(msg, ts) && msg.toBytes().size() > 0;
+      r.cpu_ns += cpu_nanos() - cpu_start;
+      if (sent) {
+        r.messages++;
+        r.samples++;
+        if (bus.now() - start > 3e9) {
+          r.add_error(ts, bus.sample_time());
+        }
+      }
+    }
+  }
+  r.transfers = bus.transfers - transfers;
+  r.bytes = bus.bytes - bytes;
+  return r;
+}
+
+static Result fifo(double seconds) {
+  MockLSM6DS3Bus bus(LSM6DS3_FIFO_CHIP_ID, DRIFT, LATENCY_NS, JITTER_NS);
+  LSM6DS3_Fifo fifo(&bus);
+  if (fifo.init() < 0) {
+    fprintf(stderr, "init failed\n");
+    exit(1);
+  }
+  bus.clear_interrupts();
+
+  Result r;
+  const uint64_t transfers = bus.transfers, bytes = bus.bytes, start = bus.now(), end = start + seconds * 1e9;
+  uint64_t ts;
+  while (bus.now() < end && bus.wait_interrupt(&ts, 100e6)) {
+    r.wakeups++;
+    const uint64_t cpu_start = cpu_nanos();
+    MessageBuilder msg;
+    const bool sent = fifo.get_event(msg, ts) && msg.toBytes().size() > 0;
+    r.cpu_ns += cpu_nanos() - cpu_start;
+    if (sent) {
+      r.messages++;
+      auto events = msg.getRoot<cereal::Event>().asReader().getSensorEvents();
+      r.samples += events.size();
+      if (bus.now() - start > 3e9) {
+        for (auto event : events) {
+          // the x axis is the tag of the sample, scaled and turned into -y
+          const float scale = event.isAcceleration() ? 9.81 * 2.0f / (1 << 15) : 8.75 / 1000.0 * M_PI / 180.0;
+          auto v = event.isAcceleration() ? event.getAcceleration().getV() : event.getGyroUncalibrated().getV();
+          const int tag = std::lround(-v[1] / scale);
+          r.add_error(event.getTimestamp(), bus.sample_time(tag));
+        }
+      }
+    }
+  }
+  r.transfers = bus.transfers - transfers;
+  r.bytes = bus.bytes - bytes;
+  return r;
+}
+
+int main(int argc, char *argv[]) {
+  const double seconds = argc > 1 ? atof(argv[1]) : 60;
+
+  printf("%.0f s of accel and gyro at 104 Hz, per sample:\n", seconds);
+  printf("%-12s %9s %9s %11s %10s %10s %10s %10s %10s\n", "", "wakeups/s", "msgs/s", "transfers", "bus bytes",
+         "bus us", "cpu us", "ts err us", "max us");
+  print("data ready", data_ready(seconds), seconds);
+  print("fifo", fifo(seconds), seconds);
+  return 0;
+}
@@ -0,0 +1,246 @@
+#include "system/sensord/tests/mock_lsm6ds3.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "system/sensord/sensors/lsm6ds3_fifo.h"
+
+// a byte and its ack at 400 kHz
+#define BYTE_NS 22500
+// the address, register and address again of a transfer
+#define TRANSFER_OVERHEAD 3
+// the block limit of SMBus
+#define SMBUS_BLOCK_MAX 32
+// 8 KB, or 4 KB on the LSM6DS3TR-C
+#define FIFO_WORDS 4096
+#define FIFO_WORDS_TRC 2048
+// the counter ticks every 6.4 ms without TIMER_HR
+#define TICK_LOW_RES 256
+
+MockLSM6DS3Bus::MockLSM6DS3Bus(uint8_t chip_id, double drift, uint64_t latency_ns, uint64_t jitter_ns) :
+  I2CBus(), chip_id(chip_id), period_ns(1e9 / 104.0 / (1.0 + drift)), tick_ns(LSM6DS3_FIFO_TICK_NS / (1.0 + drift)),
+  latency_ns(latency_ns), jitter_ns(jitter_ns), gen(0) {}
+
+void MockLSM6DS3Bus::advance_to(uint64_t t) {
+  while (std::llround((samples + 1) * period_ns) <= (int64_t)t) {
+    now_ns = std::max<uint64_t>(now_ns, std::llround((samples + 1) * period_ns));
+    sample(samples + 1);
+  }
+  now_ns = std::max(now_ns, t);
+}
+
+bool MockLSM6DS3Bus::wait_interrupt(uint64_t *ts, uint64_t timeout_ns) {
+  const uint64_t deadline = now_ns + timeout_ns;
+  while (interrupts.empty() || interrupts.front() > now_ns) {
+    if (now_ns >= deadline) {
+      return false;
+    }
+    // the next sample, or the interrupt
+    const uint64_t next = interrupts.empty() ? std::llround((samples + 1) * period_ns) : interrupts.front();
+    advance_to(std::min(deadline, next));
+  }
+  *ts = interrupts.front();
+  interrupts.pop_front();
+  return true;
+}
+
+void MockLSM6DS3Bus::set_counter(uint32_t ticks) {
+  timer_start = now_ns;
+  timer_offset = ticks;
+}
+
+uint64_t MockLSM6DS3Bus::sample_time(uint16_t tag) const {
+  const uint64_t index = samples - ((samples - tag) & 0x7FFF);
+  return std::llround(index * period_ns);
+}
+
+bool MockLSM6DS3Bus::timer_enabled() const {
+  if (chip_id == LSM6DS3TRC_FIFO_CHIP_ID) {
+    return regs[LSM6DS3_FIFO_I2C_REG_CTRL10_C] & LSM6DS3TRC_FIFO_CTRL10_TIMER_EN;
+  }
+  return regs[LSM6DS3_FIFO_I2C_REG_TAP_CFG] & LSM6DS3_FIFO_TAP_CFG_TIMER_EN;
+}
+
+uint32_t MockLSM6DS3Bus::counter(uint64_t t) const {
+  if (!timer_enabled()) {
+    return timer_offset;
+  }
+  double tick = tick_ns;
+  if ((regs[LSM6DS3_FIFO_I2C_REG_WAKE_UP_DUR] & LSM6DS3_FIFO_TIMER_HR) == 0) {
+    tick *= TICK_LOW_RES;
+  }
+  return (timer_offset + (uint64_t)((t - timer_start) / tick)) & 0xFFFFFF;
+}
+
+bool MockLSM6DS3Bus::fth_level() const {
+  const size_t threshold = regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL1] | ((regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL2] & 0x0F) << 8);
+  return (regs[LSM6DS3_FIFO_I2C_REG_INT1_CTRL] & LSM6DS3_FIFO_INT1_FTH) && threshold > 0 && fifo.size() >= threshold;
+}
+
+void MockLSM6DS3Bus::set_int1(bool level, uint64_t t) {
+  if (level && !int1) {
+    interrupts.push_back(t + latency_ns + (jitter_ns > 0 ? gen() % jitter_ns : 0));
+  }
+  int1 = level;
+}
+
+void MockLSM6DS3Bus::sample(uint64_t index) {
+  samples = index;
+  const uint64_t t = std::llround(index * period_ns);
+  const bool xl_on = regs[LSM6DS3_ACCEL_I2C_REG_CTRL1_XL] >> 4;
+  const bool g_on = regs[LSM6DS3_GYRO_I2C_REG_CTRL2_G] >> 4;
+  if (!xl_on && !g_on) {
+    return;
+  }
+
+  // the self tests move the outputs by about 500 mg and 350 dps
+  const uint8_t ctrl5 = regs[LSM6DS3_ACCEL_I2C_REG_CTRL5_C];
+  const int xl_st = (ctrl5 & 0b11) ? 8000 : 0;
+  const int g_st = (ctrl5 & (0b11 << 2)) ? 5000 : 0;
+  const int tag = index & 0x7FFF;
+  auto clamp = [](int v) { return (int16_t)std::clamp(v, -32768, 32767); };
+  gyro = {clamp(tag + g_st), clamp(100 + g_st), clamp(-100 + g_st)};
+  accel = {clamp(tag + xl_st), clamp(xl_st), clamp(16384 + xl_st)};
+  data_ready |= (xl_on ? LSM6DS3_ACCEL_DRDY_XLDA : 0) | (g_on ? LSM6DS3_GYRO_DRDY_GDA : 0);
+
+  const uint8_t ctrl5_fifo = regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5];
+  if ((ctrl5_fifo & 0b111) == LSM6DS3_FIFO_MODE_CONTINUOUS && (ctrl5_fifo >> 3) != 0) {
+    std::vector<uint16_t> words;
+    if (g_on && (regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL3] >> 3) & 0b111) {
+      words.insert(words.end(), gyro.begin(), gyro.end());
+    }
+    if (xl_on && regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL3] & 0b111) {
+      words.insert(words.end(), accel.begin(), accel.end());
+    }
+    if ((regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL2] & LSM6DS3_FIFO_TIMER_PEDO_FIFO_EN) &&
+        (regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL4] >> 3) & 0b111) {
+      // bits 15:8 and 23:16, then 7:0 in the high byte, then the step counter
+      const uint32_t c = counter(t);
+      words.push_back(((c >> 8) & 0xFF) | (((c >> 16) & 0xFF) << 8));
+      words.push_back((c & 0xFF) << 8);
+      words.push_back(0);
+    }
+    set_words = words.size();
+
+    // the oldest words are overwritten once it's full
+    const size_t capacity = chip_id == LSM6DS3TRC_FIFO_CHIP_ID ? FIFO_WORDS_TRC : FIFO_WORDS;
+    for (uint16_t w : words) {
+      if (fifo.size() == capacity) {
+        fifo.pop_front();
+        pattern = (pattern + 1) % set_words;
+        overrun = true;
+      }
+      fifo.push_back(w);
+    }
+  }
+
+  // data ready pulses, and the FIFO watermark
+  const uint8_t int1_ctrl = regs[LSM6DS3_FIFO_I2C_REG_INT1_CTRL];
+  const bool drdy = (xl_on && (int1_ctrl & LSM6DS3_ACCEL_INT1_DRDY_XL)) || (g_on && (int1_ctrl & LSM6DS3_GYRO_INT1_DRDY_G));
+  if (drdy) {
+    set_int1(true, t);
+  }
+  set_int1(fth_level(), t);
+}
+
+uint8_t MockLSM6DS3Bus::read_byte(uint8_t reg) {
+  // the unread words are counted in 12 bits
+  const size_t words = std::min<size_t>(fifo.size(), 0xFFF);
+  switch (reg) {
+    case LSM6DS3_FIFO_I2C_REG_ID:
+      return chip_id;
+    case LSM6DS3_ACCEL_I2C_REG_STAT_REG:
+      return data_ready;
+    case LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1:
+      return words & 0xFF;
+    case LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1 + 1: {
+      const size_t threshold = regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL1] | ((regs[LSM6DS3_FIFO_I2C_REG_FIFO_CTRL2] & 0x0F) << 8);
+      return ((threshold > 0 && words >= threshold) << 7) | (overrun << 6) | ((words == 0) << 4) | ((words >> 8) & 0x0F);
+    }
+    case LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1 + 2:
+      return pattern & 0xFF;
+    case LSM6DS3_FIFO_I2C_REG_FIFO_STATUS1 + 3:
+      return pattern >> 8;
+    case LSM6DS3_FIFO_I2C_REG_TIMESTAMP2 - 2:
+    case LSM6DS3_FIFO_I2C_REG_TIMESTAMP2 - 1:
+    case LSM6DS3_FIFO_I2C_REG_TIMESTAMP2:
+      return counter(now_ns) >> (8 * (reg - (LSM6DS3_FIFO_I2C_REG_TIMESTAMP2 - 2)));
+  }
+  if (reg >= LSM6DS3_GYRO_I2C_REG_OUTX_L_G && reg < LSM6DS3_GYRO_I2C_REG_OUTX_L_G + 6) {
+    const int i = reg - LSM6DS3_GYRO_I2C_REG_OUTX_L_G;
+    return (uint16_t)gyro[i / 2] >> (8 * (i % 2));
+  }
+  if (reg >= LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL && reg < LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL + 6) {
+    const int i = reg - LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL;
+    return (uint16_t)accel[i / 2] >> (8 * (i % 2));
+  }
+  return regs[reg];
+}
+
+void MockLSM6DS3Bus::transfer(size_t len) {
+  transfers++;
+  bytes += TRANSFER_OVERHEAD + len;
+  advance_to(now_ns + (TRANSFER_OVERHEAD + len) * BYTE_NS);
+}
+
+int MockLSM6DS3Bus::read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, size_t len) {
+  if (device_address != LSM6DS3_FIFO_I2C_ADDR) {
+    return -1;
+  }
+  transfer(len);
+
+  if (register_address == LSM6DS3_FIFO_I2C_REG_FIFO_DATA_OUT) {
+    // the address rolls back to the low byte of the output, for the next word
+    for (size_t i = 0; i < len; i += 2) {
+      uint16_t w = 0;
+      if (!fifo.empty()) {
+        w = fifo.front();
+        fifo.pop_front();
+        pattern = (pattern + 1) % set_words;
+        overrun = false;
+      }
+      buffer[i] = w & 0xFF;
+      if (i + 1 < len) {
+        buffer[i + 1] = w >> 8;
+      }
+    }
+    set_int1(fth_level(), now_ns);
+    return len;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t reg = register_address + i;
+    buffer[i] = read_byte(reg);
+    if (reg == LSM6DS3_GYRO_I2C_REG_OUTX_L_G) data_ready &= ~LSM6DS3_GYRO_DRDY_GDA;
+    if (reg == LSM6DS3_ACCEL_I2C_REG_OUTX_L_XL) data_ready &= ~LSM6DS3_ACCEL_DRDY_XLDA;
+  }
+  return len;
+}
+
+int MockLSM6DS3Bus::read_register(uint8_t device_address, uint register_address, uint8_t *buffer, uint8_t len) {
+  if (len > SMBUS_BLOCK_MAX) {
+    return -1;
+  }
+  return read_burst(device_address, register_address, buffer, len);
+}
+
+int MockLSM6DS3Bus::set_register(uint8_t device_address, uint register_address, uint8_t data) {
+  if (device_address != LSM6DS3_FIFO_I2C_ADDR) {
+    return -1;
+  }
+  transfer(1);
+
+  const bool timer = timer_enabled();
+  regs[register_address] = data;
+  if (register_address == LSM6DS3_FIFO_I2C_REG_TIMESTAMP2 && data == LSM6DS3_FIFO_TIMESTAMP_RESET) {
+    set_counter(0);
+  } else if (!timer && timer_enabled()) {
+    timer_start = now_ns;
+  } else if (register_address == LSM6DS3_FIFO_I2C_REG_FIFO_CTRL5 && (data & 0b111) == LSM6DS3_FIFO_MODE_BYPASS) {
+    fifo.clear();
+    pattern = 0;
+    overrun = false;
+  }
+  set_int1(fth_level(), now_ns);
+  return 0;
+}
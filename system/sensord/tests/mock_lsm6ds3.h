@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "common/i2c.h"
+
+// An I2CBus with a simulated LSM6DS3 on it: its registers, the accel and gyro sampled at 104 Hz,
+// the FIFO, the timestamp counter and the interrupts on INT1. Time is simulated too, and each
+// transfer takes as long as it would at 400 kHz. The chip's oscillator, which paces the samples
+// and the counter, runs fast by drift, and the interrupts are timestamped late by latency plus
+// up to jitter.
+//
+// The samples are tagged with their index in the x axis of the gyro and accel, modulo 2^15.
+class MockLSM6DS3Bus : public I2CBus {
+public:
+  MockLSM6DS3Bus(uint8_t chip_id = 0x69, double drift = 0, uint64_t latency_ns = 0, uint64_t jitter_ns = 0);
+
+  int read_register(uint8_t device_address, uint register_address, uint8_t *buffer, uint8_t len) override;
+  int set_register(uint8_t device_address, uint register_address, uint8_t data) override;
+  int read_burst(uint8_t device_address, uint register_address, uint8_t *buffer, size_t len) override;
+
+  uint64_t now() const { return now_ns; }
+  void advance_to(uint64_t t);
+  // Advances to the next rising edge of INT1 as timestamped, up to timeout_ns from now
+  bool wait_interrupt(uint64_t *ts, uint64_t timeout_ns);
+  void clear_interrupts() { interrupts.clear(); }
+  // Sets the timestamp counter, to test it wrapping around
+  void set_counter(uint32_t ticks);
+  // The time the sample with this tag was taken, the newest one if there are several
+  uint64_t sample_time(uint16_t tag) const;
+  // The time the newest sample was taken
+  uint64_t sample_time() const { return sample_time(samples & 0x7FFF); }
+
+  uint64_t transfers = 0, bytes = 0;
+
+private:
+  void sample(uint64_t index);
+  void set_int1(bool level, uint64_t t);
+  bool fth_level() const;
+  uint32_t counter(uint64_t t) const;
+  bool timer_enabled() const;
+  uint8_t read_byte(uint8_t reg);
+  void transfer(size_t len);
+
+  const uint8_t chip_id;
+  const double period_ns, tick_ns;
+  const uint64_t latency_ns, jitter_ns;
+  std::mt19937 gen;
+
+  std::array<uint8_t, 256> regs = {};
+  uint64_t now_ns = 0;
+  // samples taken so far, and the latest
+  uint64_t samples = 0;
+  std::array<int16_t, 3> gyro = {}, accel = {};
+  uint8_t data_ready = 0;
+
+  std::deque<uint16_t> fifo;
+  // the words of a set, and the index in its set of the oldest word
+  int set_words = 1;
+  int pattern = 0;
+  bool overrun = false;
+
+  uint64_t timer_start = 0;
+  uint32_t timer_offset = 0;
+
+  bool int1 = false;
+  std::deque<uint64_t> interrupts;
+};
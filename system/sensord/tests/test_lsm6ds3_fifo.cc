@@ -0,0 +1,126 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "system/sensord/sensors/lsm6ds3_fifo.h"
+#include "system/sensord/tests/mock_lsm6ds3.h"
+
+// the chip's oscillator runs 2% fast, and the interrupts are timestamped 10-40 us late
+const double DRIFT = 0.02;
+const uint64_t LATENCY_NS = 10000, JITTER_NS = 30000;
+
+static int tag(const uint8_t *data) {
+  return read_16_bit(data[0], data[1]);
+}
+
+// Reads the FIFO at each interrupt for a while, and checks the samples are all there, in
+// order, and timestamped within max_error_ns once the clock has settled
+static void run(MockLSM6DS3Bus &bus, LSM6DS3_Fifo &fifo, double seconds, uint64_t max_error_ns, int *last_tag) {
+  std::vector<LSM6DS3_Fifo::Sample> samples;
+  const uint64_t start = bus.now(), end = start + seconds * 1e9;
+  int reads = 0, count = 0;
+  int64_t max_error = 0;
+  uint64_t ts;
+  while (bus.now() < end) {
+    REQUIRE(bus.wait_interrupt(&ts, 100e6));
+    const int n = fifo.read_samples(samples, ts);
+    REQUIRE(n >= LSM6DS3_FIFO_WATERMARK_SETS);
+    reads++;
+    for (const auto &s : samples) {
+      REQUIRE(tag(s.gyro) == tag(s.accel));
+      if (*last_tag >= 0) {
+        REQUIRE(tag(s.gyro) == ((*last_tag + 1) & 0x7FFF));
+      }
+      *last_tag = tag(s.gyro);
+      count++;
+      if (bus.now() - start > 3e9) {
+        max_error = std::max(max_error, std::abs((int64_t)(s.ts - bus.sample_time(tag(s.gyro)))));
+      }
+    }
+  }
+
+  INFO("reads " << reads << " samples " << count << " max error " << max_error << " ns");
+  REQUIRE(std::abs(count - seconds * 104 * (1 + DRIFT)) <= LSM6DS3_FIFO_WATERMARK_SETS + 1);
+  REQUIRE(std::abs(reads - seconds * 26 * (1 + DRIFT)) <= 2);
+  REQUIRE(max_error < max_error_ns);
+}
+
+TEST_CASE("LSM6DS3_Fifo reads batches at the watermark") {
+  const uint8_t chip_id = GENERATE(LSM6DS3_FIFO_CHIP_ID, LSM6DS3TRC_FIFO_CHIP_ID);
+  MockLSM6DS3Bus bus(chip_id, DRIFT, LATENCY_NS, JITTER_NS);
+  LSM6DS3_Fifo fifo(&bus);
+  REQUIRE(fifo.init() == 0);
+
+  // the 24 bit counter wraps around after 5 s
+  bus.set_counter(0xFFFFFF - 5e9 / LSM6DS3_FIFO_TICK_NS);
+  bus.clear_interrupts();
+
+  int last_tag = -1;
+  run(bus, fifo, 10, 100000, &last_tag);
+  REQUIRE(fifo.tick_ns() == Approx(LSM6DS3_FIFO_TICK_NS / (1 + DRIFT)).epsilon(1e-4));
+
+  // a burst of 46 words is more than SMBus reads at once
+  const uint64_t transfers = bus.transfers;
+  run(bus, fifo, 1, 100000, &last_tag);
+  INFO("transfers " << bus.transfers - transfers);
+  REQUIRE(bus.transfers - transfers < 26 * 3);
+}
+
+TEST_CASE("LSM6DS3_Fifo recovers from an overrun") {
+  MockLSM6DS3Bus bus(LSM6DS3_FIFO_CHIP_ID, DRIFT, LATENCY_NS, JITTER_NS);
+  LSM6DS3_Fifo fifo(&bus);
+  REQUIRE(fifo.init() == 0);
+  bus.clear_interrupts();
+
+  int last_tag = -1;
+  run(bus, fifo, 5, 100000, &last_tag);
+
+  // the FIFO fills up in 4.3 s, and keeps the newest words. The interrupt stays high, so it's
+  // read without one, like sensord does after poll times out.
+  bus.advance_to(bus.now() + 20e9);
+  bus.clear_interrupts();
+
+  // the stale samples are dropped with the FIFO
+  std::vector<LSM6DS3_Fifo::Sample> samples;
+  REQUIRE(fifo.read_samples(samples, 0) == 0);
+
+  // and the ones after are timestamped from the clock as before
+  last_tag = -1;
+  run(bus, fifo, 5, 100000, &last_tag);
+}
+
+TEST_CASE("LSM6DS3_Fifo builds sensorEvents") {
+  const uint8_t chip_id = GENERATE(LSM6DS3_FIFO_CHIP_ID, LSM6DS3TRC_FIFO_CHIP_ID);
+  MockLSM6DS3Bus bus(chip_id);
+  LSM6DS3_Fifo fifo(&bus);
+  REQUIRE(fifo.init() == 0);
+  bus.clear_interrupts();
+
+  uint64_t ts;
+  REQUIRE(bus.wait_interrupt(&ts, 100e6));
+  MessageBuilder msg;
+  REQUIRE(fifo.get_event(msg, ts));
+
+  auto source = chip_id == LSM6DS3TRC_FIFO_CHIP_ID ? cereal::SensorEventData::SensorSource::LSM6DS3TRC
+                                                   : cereal::SensorEventData::SensorSource::LSM6DS3;
+  auto events = msg.getRoot<cereal::Event>().asReader().getSensorEvents();
+  REQUIRE(events.size() == LSM6DS3_FIFO_WATERMARK_SETS * 2);
+  for (size_t i = 0; i < events.size(); i += 2) {
+    auto gyro = events[i], accel = events[i + 1];
+    REQUIRE(gyro.isGyroUncalibrated());
+    REQUIRE(gyro.getSensor() == SENSOR_GYRO_UNCALIBRATED);
+    REQUIRE(gyro.getSource() == source);
+    REQUIRE(accel.isAcceleration());
+    REQUIRE(accel.getSensor() == SENSOR_ACCELEROMETER);
+    REQUIRE(accel.getSource() == source);
+    REQUIRE(gyro.getTimestamp() == accel.getTimestamp());
+    if (i > 0) {
+      REQUIRE(gyro.getTimestamp() - events[i - 2].getTimestamp() == Approx(1e9 / 104).margin(LSM6DS3_FIFO_TICK_NS));
+    }
+    // 1 g on z, which is z of the event too
+    REQUIRE(accel.getAcceleration().getV()[2] == Approx(9.81).epsilon(0.01));
+  }
+  // the last sample is the one at the interrupt
+  REQUIRE(events[events.size() - 1].getTimestamp() == Approx(ts).margin(LSM6DS3_FIFO_TICK_NS));
+}
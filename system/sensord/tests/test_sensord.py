@@ -70,7 +70,7 @@ def get_irq_count(irq: int):
     return sum(per_cpu)
 
 def read_sensor_events(duration_sec):
-  sensor_types = ['accelerometer', 'gyroscope', 'magnetometer', 'accelerometer2',
+  sensor_types = ['sensorEvents', 'magnetometer', 'accelerometer2',
                   'gyroscope2', 'temperatureSensor', 'temperatureSensor2']
   socks = {}
   poller = messaging.Poller()
@@ -96,6 +96,14 @@ def read_sensor_events(duration_sec):
 
   return {k: v for k, v in events.items() if len(v) > 0}
 
+def sensor_measurements(events, etypes=None):
+  # (logMonoTime, measurement) of each sample, with the batches of sensorEvents flattened
+  for etype in (etypes or events):
+    for msg in events[etype]:
+      m = getattr(msg, msg.which())
+      for measurement in (m if msg.which() == 'sensorEvents' else [m]):
+        yield msg.logMonoTime, measurement
+
 @pytest.mark.tici
 class TestSensord:
   @classmethod
@@ -126,10 +134,8 @@ class TestSensord:
   def test_sensors_present(self):
     # verify correct sensors configuration
     seen = set()
-    for etype in self.events:
-      for measurement in self.events[etype]:
-        m = getattr(measurement, measurement.which())
-        seen.add((str(m.source), m.which()))
+    for _, m in sensor_measurements(self.events):
+      seen.add((str(m.source), m.which()))
 
     assert seen in SENSOR_CONFIGURATIONS
 
@@ -141,12 +147,7 @@ class TestSensord:
       5: [], # gyro
     }
 
-    for measurement in self.events['accelerometer']:
-      m = getattr(measurement, measurement.which())
-      sensor_t[m.sensor].append(m.timestamp)
-
-    for measurement in self.events['gyroscope']:
-      m = getattr(measurement, measurement.which())
+    for _, m in sensor_measurements(self.events, ['sensorEvents']):
       sensor_t[m.sensor].append(m.timestamp)
 
     for s, vals in sensor_t.items():
@@ -177,12 +178,16 @@ class TestSensord:
     tdiffs = list()
     for etype in self.events:
       for measurement in self.events[etype]:
-        m = getattr(measurement, measurement.which())
-
-        # check if gyro and accel timestamps are before logMonoTime
-        if str(m.source).startswith("lsm6ds3") and m.which() != 'temperature':
-          err_msg = f"Timestamp after logMonoTime: {m.timestamp} > {measurement.logMonoTime}"
-          assert m.timestamp < measurement.logMonoTime, err_msg
+        if measurement.which() == 'sensorEvents':
+          # check if gyro and accel timestamps are before logMonoTime
+          for m in measurement.sensorEvents:
+            err_msg = f"Timestamp after logMonoTime: {m.timestamp} > {measurement.logMonoTime}"
+            assert m.timestamp < measurement.logMonoTime, err_msg
+
+          # the newest sample of the batch is the one at the interrupt
+          m = measurement.sensorEvents[-1]
+        else:
+          m = getattr(measurement, measurement.which())
 
         # negative values might occur, as non interrupt packages created
         # before the sensor is read
@@ -197,20 +202,18 @@ class TestSensord:
 
   def test_sensor_values(self):
     sensor_values = dict()
-    for etype in self.events:
-      for measurement in self.events[etype]:
-        m = getattr(measurement, measurement.which())
-        key = (m.source.raw, m.which())
-        values = getattr(m, m.which())
-
-        if hasattr(values, 'v'):
-          values = values.v
-        values = np.atleast_1d(values)
-
-        if key in sensor_values:
-          sensor_values[key].append(values)
-        else:
-          sensor_values[key] = [values]
+    for _, m in sensor_measurements(self.events):
+      key = (m.source.raw, m.which())
+      values = getattr(m, m.which())
+
+      if hasattr(values, 'v'):
+        values = values.v
+      values = np.atleast_1d(values)
+
+      if key in sensor_values:
+        sensor_values[key].append(values)
+      else:
+        sensor_values[key] = [values]
 
     # Sanity check sensor values
     for sensor, stype in sensor_values:
@@ -6,7 +6,7 @@
 #include <ctime>
 
 #include "catch2/catch.hpp"
-#include "system/ubloxd/generated/glonass.h"
+#include "system/ubloxd/ublox_msg.h"
 
 typedef std::vector<std::pair<int, int64_t>> string_data;
 
@@ -185,176 +185,129 @@ TEST_CASE("parse_string_number_1"){
   string_data data = generate_string_data(1);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST1_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST1_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST1_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST1_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST1_HC_OFF + FRAME_IDX].second);
 
-  kaitai::kstream str1(inp_data);
-  glonass_t str1_data(&str1);
-  glonass_t::string_1_t* s1 = static_cast<glonass_t::string_1_t*>(str1_data.data());
 
-  REQUIRE(s1->not_used() == data[ST1_NU_IDX].second);
-  REQUIRE(s1->p1() == data[ST1_P1_IDX].second);
-  REQUIRE(s1->t_k() == data[ST1_T_K_IDX].second);
+  REQUIRE(gl_string.p1() == data[ST1_P1_IDX].second);
+  REQUIRE(gl_string.t_k() == data[ST1_T_K_IDX].second);
 
-  int mul = s1->x_vel_sign() ? (-1) : 1;
-  REQUIRE(s1->x_vel() == (data[ST1_X_VEL_V_IDX].second * mul));
-  mul = s1->x_accel_sign() ? (-1) : 1;
-  REQUIRE(s1->x_accel() == (data[ST1_X_ACCEL_V_IDX].second * mul));
-  mul = s1->x_sign() ? (-1) : 1;
-  REQUIRE(s1->x() == (data[ST1_X_V_IDX].second * mul));
+  int mul = data[ST1_X_VEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.x_vel() == (data[ST1_X_VEL_V_IDX].second * mul));
+  mul = data[ST1_X_ACCEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.x_accel() == (data[ST1_X_ACCEL_V_IDX].second * mul));
+  mul = data[ST1_X_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.x() == (data[ST1_X_V_IDX].second * mul));
 }
 
 TEST_CASE("parse_string_number_2"){
   string_data data = generate_string_data(2);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST2_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST2_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST2_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST2_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST2_HC_OFF + FRAME_IDX].second);
 
-  kaitai::kstream str2(inp_data);
-  glonass_t str2_data(&str2);
-  glonass_t::string_2_t* s2 = static_cast<glonass_t::string_2_t*>(str2_data.data());
-
-  REQUIRE(s2->b_n() == data[ST2_BN_IDX].second);
-  REQUIRE(s2->not_used() == data[ST2_NU_IDX].second);
-  REQUIRE(s2->p2() == data[ST2_P2_IDX].second);
-  REQUIRE(s2->t_b() == data[ST2_TB_IDX].second);
-  int mul = s2->y_vel_sign() ? (-1) : 1;
-  REQUIRE(s2->y_vel() == (data[ST2_Y_VEL_V_IDX].second * mul));
-  mul = s2->y_accel_sign() ? (-1) : 1;
-  REQUIRE(s2->y_accel() == (data[ST2_Y_ACCEL_V_IDX].second * mul));
-  mul = s2->y_sign() ? (-1) : 1;
-  REQUIRE(s2->y() == (data[ST2_Y_V_IDX].second * mul));
+
+  REQUIRE(gl_string.b_n() == data[ST2_BN_IDX].second);
+  REQUIRE(gl_string.p2() == data[ST2_P2_IDX].second);
+  REQUIRE(gl_string.t_b() == data[ST2_TB_IDX].second);
+  int mul = data[ST2_Y_VEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.y_vel() == (data[ST2_Y_VEL_V_IDX].second * mul));
+  mul = data[ST2_Y_ACCEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.y_accel() == (data[ST2_Y_ACCEL_V_IDX].second * mul));
+  mul = data[ST2_Y_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.y() == (data[ST2_Y_V_IDX].second * mul));
 }
 
 TEST_CASE("parse_string_number_3"){
   string_data data = generate_string_data(3);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST3_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST3_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST3_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST3_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST3_HC_OFF + FRAME_IDX].second);
 
-  kaitai::kstream str3(inp_data);
-  glonass_t str3_data(&str3);
-  glonass_t::string_3_t* s3 = static_cast<glonass_t::string_3_t*>(str3_data.data());
-
-  REQUIRE(s3->p3() == data[ST3_P3_IDX].second);
-  int mul = s3->gamma_n_sign() ? (-1) : 1;
-  REQUIRE(s3->gamma_n() == (data[ST3_GAMMA_N_V_IDX].second * mul));
-  REQUIRE(s3->not_used() == data[ST3_NU_1_IDX].second);
-  REQUIRE(s3->p() == data[ST3_P_IDX].second);
-  REQUIRE(s3->l_n() == data[ST3_L_N_IDX].second);
-  mul = s3->z_vel_sign() ? (-1) : 1;
-  REQUIRE(s3->z_vel() == (data[ST3_Z_VEL_V_IDX].second * mul));
-  mul = s3->z_accel_sign() ? (-1) : 1;
-  REQUIRE(s3->z_accel() == (data[ST3_Z_ACCEL_V_IDX].second * mul));
-  mul = s3->z_sign() ? (-1) : 1;
-  REQUIRE(s3->z() == (data[ST3_Z_V_IDX].second * mul));
+
+  REQUIRE(gl_string.p3() == data[ST3_P3_IDX].second);
+  int mul = data[ST3_GAMMA_N_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.gamma_n() == (data[ST3_GAMMA_N_V_IDX].second * mul));
+  REQUIRE(gl_string.p() == data[ST3_P_IDX].second);
+  REQUIRE(gl_string.l_n() == data[ST3_L_N_IDX].second);
+  mul = data[ST3_Z_VEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.z_vel() == (data[ST3_Z_VEL_V_IDX].second * mul));
+  mul = data[ST3_Z_ACCEL_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.z_accel() == (data[ST3_Z_ACCEL_V_IDX].second * mul));
+  mul = data[ST3_Z_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.z() == (data[ST3_Z_V_IDX].second * mul));
 }
 
 TEST_CASE("parse_string_number_4"){
   string_data data = generate_string_data(4);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST4_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST4_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST4_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST4_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST4_HC_OFF + FRAME_IDX].second);
 
-  kaitai::kstream str4(inp_data);
-  glonass_t str4_data(&str4);
-  glonass_t::string_4_t* s4 = static_cast<glonass_t::string_4_t*>(str4_data.data());
-
-  int mul = s4->tau_n_sign() ? (-1) : 1;
-  REQUIRE(s4->tau_n() == (data[ST4_TAU_N_V_IDX].second * mul));
-  mul = s4->delta_tau_n_sign() ? (-1) : 1;
-  REQUIRE(s4->delta_tau_n() == (data[ST4_DELTA_TAU_N_V_IDX].second * mul));
-  REQUIRE(s4->e_n() == data[ST4_E_N_IDX].second);
-  REQUIRE(s4->not_used_1() == data[ST4_NU_1_IDX].second);
-  REQUIRE(s4->p4() == data[ST4_P4_IDX].second);
-  REQUIRE(s4->f_t() == data[ST4_F_T_IDX].second);
-  REQUIRE(s4->not_used_2() == data[ST4_NU_2_IDX].second);
-  REQUIRE(s4->n_t() == data[ST4_N_T_IDX].second);
-  REQUIRE(s4->n() == data[ST4_N_IDX].second);
-  REQUIRE(s4->m() == data[ST4_M_IDX].second);
+
+  int mul = data[ST4_TAU_N_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.tau_n() == (data[ST4_TAU_N_V_IDX].second * mul));
+  mul = data[ST4_DELTA_TAU_N_S_IDX].second ? (-1) : 1;
+  REQUIRE(gl_string.delta_tau_n() == (data[ST4_DELTA_TAU_N_V_IDX].second * mul));
+  REQUIRE(gl_string.e_n() == data[ST4_E_N_IDX].second);
+  REQUIRE(gl_string.p4() == data[ST4_P4_IDX].second);
+  REQUIRE(gl_string.f_t() == data[ST4_F_T_IDX].second);
+  REQUIRE(gl_string.n_t() == data[ST4_N_T_IDX].second);
+  REQUIRE(gl_string.n() == data[ST4_N_IDX].second);
+  REQUIRE(gl_string.m() == data[ST4_M_IDX].second);
 }
 
 TEST_CASE("parse_string_number_5"){
   string_data data = generate_string_data(5);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST5_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST5_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST5_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST5_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST5_HC_OFF + FRAME_IDX].second);
 
-  kaitai::kstream str5(inp_data);
-  glonass_t str5_data(&str5);
-  glonass_t::string_5_t* s5 = static_cast<glonass_t::string_5_t*>(str5_data.data());
 
-  REQUIRE(s5->n_a() == data[ST5_N_A_IDX].second);
-  REQUIRE(s5->tau_c() == data[ST5_TAU_C_IDX].second);
-  REQUIRE(s5->not_used() == data[ST5_NU_IDX].second);
-  REQUIRE(s5->n_4() == data[ST5_N_4_IDX].second);
-  REQUIRE(s5->tau_gps() == data[ST5_TAU_GPS_IDX].second);
-  REQUIRE(s5->l_n() == data[ST5_L_N_IDX].second);
+  REQUIRE(gl_string.n_a() == data[ST5_N_A_IDX].second);
+  REQUIRE(gl_string.tau_c() == data[ST5_TAU_C_IDX].second);
+  REQUIRE(gl_string.n_4() == data[ST5_N_4_IDX].second);
+  REQUIRE(gl_string.tau_gps() == data[ST5_TAU_GPS_IDX].second);
 }
 
 TEST_CASE("parse_string_number_NI"){
   string_data data = generate_string_data((rand() % 10) +  6);
   std::string inp_data = generate_inp_data(data);
 
-  kaitai::kstream stream(inp_data);
-  glonass_t gl_string(&stream);
+  ublox::GlonassString gl_string((const uint8_t *)inp_data.data());
 
   REQUIRE(gl_string.idle_chip() == data[IDLE_CHIP_IDX].second);
   REQUIRE(gl_string.string_number() == data[STRING_NUMBER_IDX].second);
   REQUIRE(gl_string.hamming_code() == data[ST6_HC_OFF + HC_IDX].second);
-  REQUIRE(gl_string.pad_1() == data[ST6_HC_OFF + PAD1_IDX].second);
   REQUIRE(gl_string.superframe_number() == data[ST6_HC_OFF + SUPERFRAME_IDX].second);
-  REQUIRE(gl_string.pad_2() == data[ST6_HC_OFF + PAD2_IDX].second);
   REQUIRE(gl_string.frame_number() == data[ST6_HC_OFF + FRAME_IDX].second);
-
-  kaitai::kstream strni(inp_data);
-  glonass_t strni_data(&strni);
-  glonass_t::string_non_immediate_t* sni = static_cast<glonass_t::string_non_immediate_t*>(strni_data.data());
-
-  REQUIRE(sni->data_1() == data[ST6_DATA_1_IDX].second);
-  REQUIRE(sni->data_2() == data[ST6_DATA_2_IDX].second);
 }
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "system/ubloxd/ublox_msg.h"
+
+static std::string ubx_frame(uint16_t msg_type, const std::string &payload) {
+  std::string msg = "\xb5\x62"s;
+  msg.push_back(msg_type >> 8);
+  msg.push_back(msg_type & 0xff);
+  msg.push_back(payload.size() & 0xff);
+  msg.push_back(payload.size() >> 8);
+  return ublox::ubx_add_checksum(msg + payload);
+}
+
+template <typename T>
+static std::string as_string(const T &payload) {
+  return std::string((const char *)&payload, sizeof(payload));
+}
+
+static std::string sfrbx_frame(uint8_t gnss_id, uint8_t sv_id, uint8_t freq_id, const std::vector<uint32_t> &words) {
+  ublox::rxm_sfrbx_t sfrbx = {};
+  sfrbx.gnss_id = gnss_id;
+  sfrbx.sv_id = sv_id;
+  sfrbx.freq_id = freq_id;
+  sfrbx.num_words = words.size();
+  return ubx_frame(ublox::RXM_SFRBX, as_string(sfrbx) + std::string((const char *)words.data(), words.size() * sizeof(uint32_t)));
+}
+
+// Feeds stream to the parser like ubloxd does, split into ubloxRaw messages of up to
+// max_chunk bytes (all of it at once for 0), and returns the events built with their
+// logMonoTime cleared.
+static std::vector<std::string> parse(const std::string &stream, std::mt19937 &rng, size_t max_chunk) {
+  auto parser = std::make_unique<UbloxMsgParser>();
+  std::vector<std::string> events;
+  for (size_t pos = 0; pos < stream.size();) {
+    // a buffer of its own for each chunk, so the sanitizers catch reads past its end
+    const size_t len = max_chunk ? std::min<size_t>(stream.size() - pos, 1 + rng() % max_chunk) : stream.size();
+    std::unique_ptr<uint8_t[]> chunk(new uint8_t[len]);
+    memcpy(chunk.get(), stream.data() + pos, len);
+    pos += len;
+
+    size_t consumed = 0;
+    while (consumed < len) {
+      size_t bytes_consumed = 0;
+      if (parser->add_data(0, chunk.get() + consumed, len - consumed, bytes_consumed)) {
+        MessageBuilder msg;
+        if (parser->service() && parser->gen_msg(msg)) {
+          msg.getRoot<cereal::Event>().setLogMonoTime(0);
+          auto bytes = msg.toBytes();
+          events.emplace_back((const char *)bytes.begin(), bytes.size());
+        }
+        parser->reset();
+      }
+      if (bytes_consumed == 0) {
+        FAIL("add_data made no progress");
+      }
+      consumed += bytes_consumed;
+    }
+  }
+  return events;
+}
+
+// A frame of a type ubloxd decodes with a random payload, its length around the fixed part
+static std::string random_frame(std::mt19937 &rng) {
+  static const uint16_t msg_types[] = {ublox::NAV_PVT, ublox::NAV_SAT, ublox::RXM_SFRBX, ublox::RXM_RAWX, ublox::MON_HW, ublox::MON_HW2};
+  static const size_t fixed_sizes[] = {sizeof(ublox::nav_pvt_t), sizeof(ublox::nav_sat_t), sizeof(ublox::rxm_sfrbx_t),
+                                       sizeof(ublox::rxm_rawx_t), sizeof(ublox::mon_hw_t), sizeof(ublox::mon_hw2_t)};
+  const int type = rng() % std::size(msg_types);
+  std::string payload(std::max<int>(0, fixed_sizes[type] + rng() % 400 - 16), '\0');
+  for (char &c : payload) c = rng();
+
+  // mostly with as many repeated blocks as fit
+  if (msg_types[type] == ublox::NAV_SAT && payload.size() >= sizeof(ublox::nav_sat_t) && rng() % 4) {
+    payload[offsetof(ublox::nav_sat_t, num_svs)] = std::min<size_t>(255, (payload.size() - sizeof(ublox::nav_sat_t)) / sizeof(ublox::nav_sat_sv_t));
+  } else if (msg_types[type] == ublox::RXM_RAWX && payload.size() >= sizeof(ublox::rxm_rawx_t) && rng() % 4) {
+    payload[offsetof(ublox::rxm_rawx_t, num_meas)] = (payload.size() - sizeof(ublox::rxm_rawx_t)) / sizeof(ublox::rxm_rawx_meas_t);
+  }
+
+  if (msg_types[type] == ublox::RXM_SFRBX && payload.size() >= sizeof(ublox::rxm_sfrbx_t)) {
+    // mostly GPS and GLONASS navigation data from a few SVs, so ephemerides get completed
+    std::vector<uint32_t> words(rng() % 4 == 0 ? rng() % 16 : (rng() % 2 ? 10 : 4));
+    for (uint32_t &w : words) w = rng();
+    if (words.size() == 10) {
+      words[0] = (words[0] & ~(0xffu << 22)) | (0x8bu << 22);  // preamble
+      words[1] = (words[1] & ~(0x7u << 8)) | ((1 + rng() % 3) << 8);  // subframe id
+    } else if (words.size() == 4) {
+      words[0] = (words[0] & 0x07ffffff) | ((1 + rng() % 5) << 27);  // string number
+    }
+    return sfrbx_frame(words.size() == 4 ? ublox::GNSS_ID_GLONASS : ublox::GNSS_ID_GPS, rng() % 4, rng() % 4, words);
+  }
+  return ubx_frame(msg_types[type], payload);
+}
+
+TEST_CASE("parser survives arbitrary input") {
+  std::mt19937 rng(GENERATE(0, 1, 2, 3));
+
+  std::string stream;
+  for (int i = 0; i < 2000; i++) {
+    if (rng() % 8 == 0) {
+      // garbage, often containing a preamble
+      for (int n = rng() % 32; n > 0; n--) stream.push_back(rng() % 4 == 0 ? ublox::PREAMBLE1 : rng());
+    }
+    std::string frame = random_frame(rng);
+    if (rng() % 16 == 0) {
+      frame[rng() % frame.size()] ^= 1 << (rng() % 8);
+    } else if (rng() % 16 == 0) {
+      frame.resize(rng() % frame.size());
+    }
+    stream += frame;
+  }
+
+  // the events don't depend on how the stream is split into ubloxRaw messages
+  std::vector<std::string> whole = parse(stream, rng, 0);
+  REQUIRE(whole.size() > 1000);
+  for (size_t max_chunk : {1, 7, 64, 1024}) {
+    REQUIRE(parse(stream, rng, max_chunk) == whole);
+  }
+}
+
+TEST_CASE("parser decodes NAV-PVT") {
+  ublox::nav_pvt_t pvt = {};
+  pvt.year = 2023;
+  pvt.month = 6;
+  pvt.day = 1;
+  pvt.hour = 12;
+  pvt.nano = 500000000;
+  pvt.flags = 1;
+  pvt.lat = 377749000;
+  pvt.lon = -1224194000;
+  pvt.height = 16000;
+  pvt.vel_n = 1000;
+  pvt.vel_e = -2000;
+  pvt.vel_d = 30;
+  pvt.g_speed = 2236;
+  pvt.h_acc = 1500;
+
+  // preceded by garbage, and split across two ubloxRaw messages
+  const std::string stream = "\x00\xb5\x13"s + ubx_frame(ublox::NAV_PVT, as_string(pvt));
+  UbloxMsgParser parser;
+  size_t consumed = 0, bytes_consumed = 0;
+  bool valid = false;
+  for (size_t split : {size_t(10), stream.size()}) {
+    while (!valid && consumed < split) {
+      valid = parser.add_data(0, (const uint8_t *)stream.data() + consumed, split - consumed, bytes_consumed);
+      consumed += bytes_consumed;
+    }
+  }
+  REQUIRE(valid);
+  REQUIRE(consumed == stream.size());
+  REQUIRE(parser.msg_type() == ublox::NAV_PVT);
+  REQUIRE(parser.service() == std::string("gpsLocationExternal"));
+
+  MessageBuilder msg;
+  REQUIRE(parser.gen_msg(msg));
+  auto gps = msg.getRoot<cereal::Event>().asReader().getGpsLocationExternal();
+  REQUIRE(gps.getHasFix());
+  REQUIRE(gps.getLatitude() == Approx(37.7749));
+  REQUIRE(gps.getLongitude() == Approx(-122.4194));
+  REQUIRE(gps.getAltitude() == Approx(16.0));
+  REQUIRE(gps.getSpeed() == Approx(2.236));
+  REQUIRE(gps.getHorizontalAccuracy() == Approx(1.5));
+  REQUIRE(gps.getUnixTimestampMillis() == 1685620800500);
+  REQUIRE(gps.getVNED().size() == 3);
+  REQUIRE(gps.getVNED()[1] == Approx(-2.0));
+}
+
+TEST_CASE("parser drops short payloads") {
+  UbloxMsgParser parser;
+  const std::string frame = ubx_frame(ublox::NAV_PVT, std::string(sizeof(ublox::nav_pvt_t) - 1, '\0'));
+  size_t bytes_consumed = 0;
+  REQUIRE(parser.add_data(0, (const uint8_t *)frame.data(), frame.size(), bytes_consumed));
+  MessageBuilder msg;
+  REQUIRE_FALSE(parser.gen_msg(msg));
+}
+
+TEST_CASE("parser collects GLONASS strings into an ephemeris") {
+  UbloxMsgParser parser;
+  const uint8_t sv_id = 5, freq_id = 9;
+  for (uint32_t string_number = 1; string_number <= 5; string_number++) {
+    // string 1 has x = -3 * 2^-11 km, string 4 the slot number
+    std::vector<uint32_t> words = {string_number << 27, 0, 0, 0};
+    if (string_number == 1) {
+      words[1] = 1u << 13;
+      words[2] = 3u << 19;
+    } else if (string_number == 4) {
+      words[2] = sv_id << 21;
+    }
+    const std::string frame = sfrbx_frame(ublox::GNSS_ID_GLONASS, sv_id, freq_id, words);
+    size_t bytes_consumed = 0;
+    REQUIRE(parser.add_data(0, (const uint8_t *)frame.data(), frame.size(), bytes_consumed));
+    REQUIRE(bytes_consumed == frame.size());
+
+    MessageBuilder msg;
+    REQUIRE(parser.gen_msg(msg) == (string_number == 5));
+    if (string_number == 5) {
+      auto eph = msg.getRoot<cereal::Event>().asReader().getUbloxGnss().getGlonassEphemeris();
+      REQUIRE(eph.getSvId() == sv_id);
+      REQUIRE(eph.getFreqNum() == freq_id - 7);
+      REQUIRE(eph.getX() == Approx(-3 * pow(2, -11)));
+    }
+    parser.reset();
+  }
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "system/ubloxd/ublox_msg.h"
+
+// Runs the ubloxRaw stream of a log through the parser as ubloxd does, building each
+// message in memory kept between messages like PubMaster::builder, and reports the
+// throughput and the allocations per frame.
+//
+// usage: ubloxd_benchmark <rlog> [iterations]   (uncompressed)
+
+static std::atomic<uint64_t> allocations = 0;
+
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+
+void *malloc(size_t size) { allocations++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { allocations++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t size) { allocations++; return __libc_realloc(p, size); }
+}
+
+struct Chunk {
+  float log_time;
+  std::string data;
+};
+
+static std::vector<Chunk> read_ublox_raw(const std::string &data) {
+  std::vector<Chunk> chunks;
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)data.data(), data.size() / sizeof(capnp::word));
+  while (words.size() > 0) {
+    capnp::FlatArrayMessageReader reader(words);
+    words = kj::arrayPtr(reader.getEnd(), words.end());
+
+    auto event = reader.getRoot<cereal::Event>();
+    if (event.isUbloxRaw()) {
+      auto raw = event.getUbloxRaw();
+      chunks.push_back({float(1e-9 * event.getLogMonoTime()), std::string((const char *)raw.begin(), raw.size())});
+    }
+  }
+  return chunks;
+}
+
+// PubMaster::builder without the sockets
+class Arenas {
+public:
+  MessageBuilder &builder(const char *name) {
+    auto it = arenas.find(name);
+    if (it == arenas.end()) {
+      it = arenas.try_emplace(name).first;
+      it->second.first = kj::heapArray<capnp::word>(1024);
+      memset(it->second.first.begin(), 0, it->second.first.asBytes().size());
+    }
+    auto &[arena, msg] = it->second;
+    msg.reset();
+    return msg.emplace(arena.asPtr());
+  }
+
+private:
+  std::map<std::string, std::pair<kj::Array<capnp::word>, std::optional<MessageBuilder>>, std::less<>> arenas;
+};
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <rlog> [iterations]\n", argv[0]);
+    return 1;
+  }
+  const int iterations = argc > 2 ? atoi(argv[2]) : 10;
+
+  std::vector<Chunk> chunks = read_ublox_raw(util::read_file(argv[1]));
+  size_t total_bytes = 0;
+  for (const Chunk &c : chunks) total_bytes += c.data.size();
+  if (total_bytes == 0) {
+    fprintf(stderr, "no ubloxRaw in %s\n", argv[1]);
+    return 1;
+  }
+
+  Arenas arenas;
+  for (int i = 0; i < iterations; i++) {
+    auto parser = std::make_unique<UbloxMsgParser>();
+    uint64_t frames = 0, built = 0, serialized_bytes = 0;
+    const uint64_t start_allocations = allocations;
+    const uint64_t start = nanos_since_boot();
+    for (const Chunk &c : chunks) {
+      const uint8_t *data = (const uint8_t *)c.data.data();
+      size_t bytes_consumed = 0;
+      while (bytes_consumed < c.data.size()) {
+        size_t bytes_consumed_this_time = 0;
+        if (parser->add_data(c.log_time, data + bytes_consumed, c.data.size() - bytes_consumed, bytes_consumed_this_time)) {
+          frames++;
+          if (const char *service = parser->service()) {
+            MessageBuilder &msg = arenas.builder(service);
+            if (parser->gen_msg(msg)) {
+              built++;
+              for (auto segment : msg.getSegmentsForOutput()) serialized_bytes += segment.asBytes().size();
+            }
+          }
+          parser->reset();
+        }
+        bytes_consumed += bytes_consumed_this_time;
+      }
+    }
+    const double seconds = (nanos_since_boot() - start) * 1e-9;
+    const uint64_t allocs = allocations - start_allocations;
+    printf("%zu bytes, %lu frames, %lu messages (%lu bytes): %6.2f ns/byte, %8.0f frames/s, %6.1f MB/s, %5.2f allocations/frame\n",
+           total_bytes, frames, built, serialized_bytes, seconds * 1e9 / total_bytes, frames / seconds,
+           total_bytes / seconds * 1e-6, double(allocs) / std::max<uint64_t>(frames, 1));
+  }
+  return 0;
+}
@@ -1,18 +1,14 @@
 #pragma once
 
+#include <array>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <ctime>
-#include <memory>
 #include <string>
-#include <unordered_map>
-#include <utility>
 
 #include "cereal/messaging/messaging.h"
 #include "common/util.h"
-#include "system/ubloxd/generated/gps.h"
-#include "system/ubloxd/generated/glonass.h"
-#include "system/ubloxd/generated/ubx.h"
 
 using namespace std::string_literals;
 
@@ -30,6 +26,285 @@ namespace ublox {
   const int UBLOX_CHECKSUM_SIZE = 2;
   const int UBLOX_MAX_MSG_SIZE = 65536;
 
+  // Message types, class << 8 | id
+  const uint16_t NAV_PVT = 0x0107;
+  const uint16_t NAV_SAT = 0x0135;
+  const uint16_t RXM_SFRBX = 0x0213;
+  const uint16_t RXM_RAWX = 0x0215;
+  const uint16_t MON_HW = 0x0a09;
+  const uint16_t MON_HW2 = 0x0a0b;
+
+  const uint8_t GNSS_ID_GPS = 0;
+  const uint8_t GNSS_ID_GLONASS = 6;
+
+  const int GPS_SUBFRAME_SIZE = 30;
+  const int GLONASS_STRING_SIZE = 16;
+
+  // Payloads, read in place from the message. Fields are little endian like the host.
+  struct nav_pvt_t {
+    uint32_t i_tow;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;
+    uint32_t t_acc;
+    int32_t nano;
+    uint8_t fix_type;
+    uint8_t flags;
+    uint8_t flags2;
+    uint8_t num_sv;
+    int32_t lon;
+    int32_t lat;
+    int32_t height;
+    int32_t h_msl;
+    uint32_t h_acc;
+    uint32_t v_acc;
+    int32_t vel_n;
+    int32_t vel_e;
+    int32_t vel_d;
+    int32_t g_speed;
+    int32_t head_mot;
+    int32_t s_acc;
+    uint32_t head_acc;
+    uint16_t p_dop;
+    uint8_t flags3;
+    uint8_t reserved1[5];
+    int32_t head_veh;
+    int16_t mag_dec;
+    uint16_t mag_acc;
+  } __attribute__((packed));
+  static_assert(sizeof(nav_pvt_t) == 92);
+
+  struct rxm_sfrbx_t {
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t reserved1;
+    uint8_t freq_id;
+    uint8_t num_words;
+    uint8_t reserved2;
+    uint8_t version;
+    uint8_t reserved3;
+    uint32_t words[];
+  } __attribute__((packed));
+  static_assert(sizeof(rxm_sfrbx_t) == 8);
+
+  struct rxm_rawx_meas_t {
+    double pr_mes;
+    double cp_mes;
+    float do_mes;
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t reserved2;
+    uint8_t freq_id;
+    uint16_t lock_time;
+    uint8_t cno;
+    uint8_t pr_stdev;
+    uint8_t cp_stdev;
+    uint8_t do_stdev;
+    uint8_t trk_stat;
+    uint8_t reserved3;
+  } __attribute__((packed));
+  static_assert(sizeof(rxm_rawx_meas_t) == 32);
+
+  struct rxm_rawx_t {
+    double rcv_tow;
+    uint16_t week;
+    int8_t leap_s;
+    uint8_t num_meas;
+    uint8_t rec_stat;
+    uint8_t reserved1[3];
+    rxm_rawx_meas_t meas[];
+  } __attribute__((packed));
+  static_assert(sizeof(rxm_rawx_t) == 16);
+
+  struct nav_sat_sv_t {
+    uint8_t gnss_id;
+    uint8_t sv_id;
+    uint8_t cno;
+    int8_t elev;
+    int16_t azim;
+    int16_t pr_res;
+    uint32_t flags;
+  } __attribute__((packed));
+  static_assert(sizeof(nav_sat_sv_t) == 12);
+
+  struct nav_sat_t {
+    uint32_t itow;
+    uint8_t version;
+    uint8_t num_svs;
+    uint8_t reserved[2];
+    nav_sat_sv_t svs[];
+  } __attribute__((packed));
+  static_assert(sizeof(nav_sat_t) == 8);
+
+  struct mon_hw_t {
+    uint32_t pin_sel;
+    uint32_t pin_bank;
+    uint32_t pin_dir;
+    uint32_t pin_val;
+    uint16_t noise_per_ms;
+    uint16_t agc_cnt;
+    uint8_t a_status;
+    uint8_t a_power;
+    uint8_t flags;
+    uint8_t reserved1;
+    uint32_t used_mask;
+    uint8_t vp[17];
+    uint8_t jam_ind;
+    uint8_t reserved2[2];
+    uint32_t pin_irq;
+    uint32_t pull_h;
+    uint32_t pull_l;
+  } __attribute__((packed));
+  static_assert(sizeof(mon_hw_t) == 60);
+
+  struct mon_hw2_t {
+    int8_t ofs_i;
+    uint8_t mag_i;
+    int8_t ofs_q;
+    uint8_t mag_q;
+    uint8_t cfg_source;
+    uint8_t reserved1[3];
+    uint32_t low_lev_cfg;
+    uint8_t reserved2[8];
+    uint32_t post_status;
+    uint8_t reserved3[4];
+  } __attribute__((packed));
+  static_assert(sizeof(mon_hw2_t) == 28);
+
+  enum class ConfigSource : uint8_t {
+    FLASH = 102,
+    OTP = 111,
+    CONFIG_PINS = 112,
+    ROM = 113,
+  };
+
+  // Big endian bit field of navigation data, count <= 32
+  inline uint32_t bits(const uint8_t *data, int offset, int count) {
+    uint64_t v = 0;
+    for (int i = offset / 8; i <= (offset + count - 1) / 8; i++) {
+      v = (v << 8) | data[i];
+    }
+    int end = ((offset + count - 1) / 8 + 1) * 8;
+    return (v >> (end - offset - count)) & ((1ULL << count) - 1);
+  }
+
+  // A GPS subframe with the parity bits removed, IS-GPS-200E 20.3.3
+  // https://www.gps.gov/technical/icwg/IS-GPS-200E.pdf
+  class GpsSubframe {
+  public:
+    explicit GpsSubframe(const uint8_t *data) : d(data) {}
+
+    // TLM and HOW words
+    uint8_t preamble() const { return d[0]; }
+    uint32_t tow_count() const { return bits(d, 24, 17); }
+    uint8_t subframe_id() const { return bits(d, 43, 3); }
+
+    // subframe 1
+    uint16_t week_no() const { return bits(d, 48, 10); }
+    uint8_t sv_health() const { return bits(d, 64, 6); }
+    int8_t t_gd() const { return d[20]; }
+    uint8_t iodc_lsb() const { return d[21]; }
+    uint16_t t_oc() const { return be16(22); }
+    int8_t af_2() const { return d[24]; }
+    int16_t af_1() const { return be16(25); }
+    int32_t af_0() const { return twos_complement(bits(d, 216, 22), 22); }
+
+    // subframe 2
+    uint8_t iode_2() const { return d[6]; }
+    int16_t c_rs() const { return be16(7); }
+    int16_t delta_n() const { return be16(9); }
+    int32_t m_0() const { return be32(11); }
+    int16_t c_uc() const { return be16(15); }
+    int32_t e() const { return be32(17); }
+    int16_t c_us() const { return be16(21); }
+    uint32_t sqrt_a() const { return be32(23); }
+    uint16_t t_oe() const { return be16(27); }
+
+    // subframe 3
+    int16_t c_ic() const { return be16(6); }
+    int32_t omega_0() const { return be32(8); }
+    int16_t c_is() const { return be16(12); }
+    int32_t i_0() const { return be32(14); }
+    int16_t c_rc() const { return be16(18); }
+    int32_t omega() const { return be32(20); }
+    int32_t omega_dot() const { return twos_complement(bits(d, 192, 24), 24); }
+    uint8_t iode_3() const { return d[27]; }
+    int32_t idot() const { return twos_complement(bits(d, 224, 14), 14); }
+
+  private:
+    uint16_t be16(int i) const { return (d[i] << 8) | d[i + 1]; }
+    uint32_t be32(int i) const { return bits(d, i * 8, 32); }
+    static int32_t twos_complement(uint32_t v, int count) { return v & (1 << (count - 1)) ? (int32_t)v - (1 << count) : (int32_t)v; }
+
+    const uint8_t *d;
+  };
+
+  // A GLONASS navigation string, ICD GLONASS 4.0 section 4.4
+  // http://gauss.gge.unb.ca/GLONASS.ICD.pdf
+  class GlonassString {
+  public:
+    explicit GlonassString(const uint8_t *data) : d(data) {}
+
+    bool idle_chip() const { return bits(d, 0, 1); }
+    uint8_t string_number() const { return bits(d, 1, 4); }
+    uint8_t hamming_code() const { return bits(d, 77, 8); }
+    uint16_t superframe_number() const { return bits(d, 96, 16); }
+    uint8_t frame_number() const { return bits(d, 120, 8); }
+
+    // string 1
+    uint8_t p1() const { return bits(d, 7, 2); }
+    uint16_t t_k() const { return bits(d, 9, 12); }
+    int32_t x_vel() const { return sign_magnitude(21, 23); }
+    int32_t x_accel() const { return sign_magnitude(45, 4); }
+    int32_t x() const { return sign_magnitude(50, 26); }
+
+    // string 2
+    uint8_t b_n() const { return bits(d, 5, 3); }
+    uint8_t p2() const { return bits(d, 8, 1); }
+    uint8_t t_b() const { return bits(d, 9, 7); }
+    int32_t y_vel() const { return sign_magnitude(21, 23); }
+    int32_t y_accel() const { return sign_magnitude(45, 4); }
+    int32_t y() const { return sign_magnitude(50, 26); }
+
+    // string 3
+    uint8_t p3() const { return bits(d, 5, 1); }
+    int32_t gamma_n() const { return sign_magnitude(6, 10); }
+    uint8_t p() const { return bits(d, 18, 2); }
+    uint8_t l_n() const { return bits(d, 20, 1); }
+    int32_t z_vel() const { return sign_magnitude(21, 23); }
+    int32_t z_accel() const { return sign_magnitude(45, 4); }
+    int32_t z() const { return sign_magnitude(50, 26); }
+
+    // string 4
+    int32_t tau_n() const { return sign_magnitude(5, 21); }
+    int32_t delta_tau_n() const { return sign_magnitude(27, 4); }
+    uint8_t e_n() const { return bits(d, 32, 5); }
+    uint8_t p4() const { return bits(d, 51, 1); }
+    uint8_t f_t() const { return bits(d, 52, 4); }
+    uint16_t n_t() const { return bits(d, 59, 11); }
+    uint8_t n() const { return bits(d, 70, 5); }
+    uint8_t m() const { return bits(d, 75, 2); }
+
+    // string 5
+    uint16_t n_a() const { return bits(d, 5, 11); }
+    uint32_t tau_c() const { return bits(d, 16, 32); }
+    uint8_t n_4() const { return bits(d, 49, 5); }
+    uint32_t tau_gps() const { return bits(d, 54, 22); }
+
+  private:
+    // a sign bit followed by count bits of magnitude
+    int32_t sign_magnitude(int offset, int count) const {
+      int32_t v = bits(d, offset + 1, count);
+      return bits(d, offset, 1) ? -v : v;
+    }
+
+    const uint8_t *d;
+  };
+
   struct ubx_mga_ini_time_utc_t {
     uint8_t type;
     uint8_t version;
@@ -93,39 +368,64 @@ namespace ublox {
 class UbloxMsgParser {
   public:
     bool add_data(float log_time, const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed);
-    inline void reset() {bytes_in_parse_buf = 0;}
+    inline void reset() {bytes_in_parse_buf = 0; msg = nullptr; msg_size = 0; ck_a = ck_b = 0; checksum_end = 2;}
     inline int needed_bytes();
-    inline std::string data() {return std::string((const char*)msg_parse_buf, bytes_in_parse_buf);}
+    inline std::string data() {return std::string((const char*)msg, msg_size);}
 
-    std::pair<std::string, kj::Array<capnp::word>> gen_msg();
-    kj::Array<capnp::word> gen_nav_pvt(ubx_t::nav_pvt_t *msg);
-    kj::Array<capnp::word> gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> gen_rxm_rawx(ubx_t::rxm_rawx_t *msg);
-    kj::Array<capnp::word> gen_mon_hw(ubx_t::mon_hw_t *msg);
-    kj::Array<capnp::word> gen_mon_hw2(ubx_t::mon_hw2_t *msg);
-    kj::Array<capnp::word> gen_nav_sat(ubx_t::nav_sat_t *msg);
+    inline uint16_t msg_type() const {return (msg[2] << 8) | msg[3];}
+    // Service the message from add_data is published on, nullptr for unknown message types
+    const char *service() const;
+    // Builds the message from add_data into msg_builder, false if there is nothing to publish
+    bool gen_msg(MessageBuilder &msg_builder);
 
   private:
+    template <typename T>
+    inline const T *payload(size_t size = sizeof(T)) const {
+      return msg_size >= ublox::UBLOX_HEADER_SIZE + size + ublox::UBLOX_CHECKSUM_SIZE ? (const T *)&msg[ublox::UBLOX_HEADER_SIZE] : nullptr;
+    }
+
     inline bool valid_cheksum();
     inline bool valid();
     inline bool valid_so_far();
+    void update_checksum();
+
+    void gen_nav_pvt(MessageBuilder &msg_builder, const ublox::nav_pvt_t *pvt);
+    bool gen_rxm_sfrbx(MessageBuilder &msg_builder, const ublox::rxm_sfrbx_t *sfrbx);
+    void gen_rxm_rawx(MessageBuilder &msg_builder, const ublox::rxm_rawx_t *rawx);
+    void gen_mon_hw(MessageBuilder &msg_builder, const ublox::mon_hw_t *hw);
+    void gen_mon_hw2(MessageBuilder &msg_builder, const ublox::mon_hw2_t *hw2);
+    void gen_nav_sat(MessageBuilder &msg_builder, const ublox::nav_sat_t *sat);
 
-    kj::Array<capnp::word> parse_gps_ephemeris(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> parse_glonass_ephemeris(ubx_t::rxm_sfrbx_t *msg);
+    bool parse_gps_ephemeris(MessageBuilder &msg_builder, const ublox::rxm_sfrbx_t *sfrbx);
+    bool parse_glonass_ephemeris(MessageBuilder &msg_builder, const ublox::rxm_sfrbx_t *sfrbx);
 
-    std::unordered_map<int, std::unordered_map<int, std::string>> gps_subframes;
+    // subframes 1-3 of each GPS SV, by sv id
+    struct GpsSubframes {
+      uint8_t collected = 0;  // bit n is set when subframe n is
+      std::array<std::array<uint8_t, ublox::GPS_SUBFRAME_SIZE>, 3> data;
+    };
+    std::array<GpsSubframes, 256> gps_subframes;
+
+    // strings 1-5 of each GLONASS frequency, by frequency id
+    struct GlonassStrings {
+      uint8_t collected = 0;  // bit n is set when string n is
+      std::array<std::array<uint8_t, ublox::GLONASS_STRING_SIZE>, 5> data;
+      std::array<int, 5> superframes;
+      std::array<long, 5> times;
+    };
+    std::array<GlonassStrings, 256> glonass_strings;
 
     float last_log_time = 0.0;
+    // the message from add_data, either in msg_parse_buf or in place in the incoming data
+    const uint8_t *msg = nullptr;
+    size_t msg_size = 0;
+
     size_t bytes_in_parse_buf = 0;
     uint8_t msg_parse_buf[ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_MAX_MSG_SIZE];
+    // running checksum over msg_parse_buf[2, checksum_end)
+    uint8_t ck_a = 0, ck_b = 0;
+    size_t checksum_end = 2;
 
     // user range accuracy in meters
-    const std::unordered_map<uint8_t, float> glonass_URA_lookup =
-      {{ 0,  1}, { 1,   2}, { 2, 2.5}, { 3,   4}, { 4,  5}, {5, 7},
-       { 6, 10}, { 7,  12}, { 8,  14}, { 9,  16}, {10, 32},
-       {11, 64}, {12, 128}, {13, 256}, {14, 512}, {15, 1024}};
-
-    std::unordered_map<int, std::unordered_map<int, std::string>> glonass_strings;
-    std::unordered_map<int, std::unordered_map<int, long>> glonass_string_times;
-    std::unordered_map<int, std::unordered_map<int, int>> glonass_string_superframes;
+    static constexpr float glonass_URA_lookup[16] = {1, 2, 2.5, 4, 5, 7, 10, 12, 14, 16, 32, 64, 128, 256, 512, 1024};
 };
@@ -1,7 +1,5 @@
 #include <cassert>
 
-#include <kaitai/kaitaistream.h>
-
 #include "cereal/messaging/messaging.h"
 #include "common/swaglog.h"
 #include "common/util.h"
@@ -46,10 +44,13 @@ int main() {
       if (parser.add_data(log_time, data + bytes_consumed, (uint32_t)(len - bytes_consumed), bytes_consumed_this_time)) {
 
         try {
-          auto ublox_msg = parser.gen_msg();
-          if (ublox_msg.second.size() > 0) {
-            auto bytes = ublox_msg.second.asBytes();
-            pm.send(ublox_msg.first.c_str(), bytes.begin(), bytes.size());
+          if (const char *service = parser.service()) {
+            MessageBuilder &msg_builder = pm.builder(service);
+            if (parser.gen_msg(msg_builder)) {
+              pm.send(service, msg_builder);
+            }
+          } else {
+            LOGE("Unknown message type %x", parser.msg_type());
           }
         } catch (const std::exception& e) {
           LOGE("Error parsing ublox message %s", e.what());
@@ -0,0 +1,141 @@
+#include <cstdio>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/utils/export.h"
+#include "tools/replay/logreader.h"
+#include "tools/replay/route.h"
+
+// Loads the CAN events of all segments of a route, without replaying it.
+class RouteStream : public AbstractStream {
+public:
+  RouteStream(QObject *parent) : AbstractStream(parent) {}
+  void start() override { emit streamStarted(); }
+  bool liveStreaming() const override { return false; }
+  QString routeName() const override { return route_name; }
+  double routeStartTime() const override { return route_start_ts / 1e9; }
+
+  bool load(const QString &route_str, const QString &data_dir) {
+    Route route(route_str, data_dir);
+    if (!route.load()) {
+      qWarning() << "failed to load route" << route_str;
+      return false;
+    }
+    route_name = route.name();
+
+    std::vector<bool> filters(cereal::Event::Which::CAN + 1, false);
+    filters[cereal::Event::Which::CAN] = true;
+    for (const auto &[n, files] : route.segments()) {
+      const QString &file = files.rlog.isEmpty() ? files.qlog : files.rlog;
+      LogReader log(filters);
+      if (file.isEmpty() || !log.load(file.toStdString(), nullptr, true, 0, 3)) {
+        qWarning() << "failed to load segment" << n;
+        continue;
+      }
+      if (log.events.empty()) {
+        qWarning() << "no events in segment" << n;
+        continue;
+      }
+      if (route_start_ts == 0) {
+        route_start_ts = log.events.front().mono_time;
+      }
+
+      std::vector<const CanEvent *> new_events;
+      new_events.reserve(log.events.size());
+      for (const Event &e : log.events) {
+        capnp::FlatArrayMessageReader reader(e.data);
+        auto event = reader.getRoot<cereal::Event>();
+        for (const auto &c : event.getCan()) {
+          new_events.push_back(newEvent(e.mono_time, c));
+        }
+      }
+      mergeEvents(new_events);
+      fprintf(stderr, "loaded segment %d, %zu events\n", n, all_events_.size());
+    }
+    return !all_events_.empty();
+  }
+
+private:
+  QString route_name;
+  uint64_t route_start_ts = 0;
+};
+
+std::optional<MessageId> parseMessageId(const QString &str) {
+  auto parts = str.split(':');
+  bool source_ok = false, address_ok = false;
+  if (parts.size() == 2) {
+    MessageId id = {.source = (uint8_t)parts[0].toUInt(&source_ok), .address = parts[1].toUInt(&address_ok, 16)};
+    if (source_ok && address_ok) return id;
+  }
+  return std::nullopt;
+}
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("cabana_export");
+
+  QCommandLineParser cmd_parser;
+  cmd_parser.setApplicationDescription("Export the CAN messages or decoded signals of a route without opening cabana");
+  cmd_parser.addHelpOption();
+  cmd_parser.addPositionalArgument("route", "the drive to export");
+  cmd_parser.addPositionalArgument("output", "the file to write");
+  cmd_parser.addOption({"data_dir", "local directory with routes", "data_dir"});
+  cmd_parser.addOption({"dbc", "dbc file used to decode signals", "dbc"});
+  cmd_parser.addOption({"msg", "export only the message with the given id, e.g. 0:1a0", "msg"});
+  cmd_parser.addOption({"format", "csv (default), or npz for the decoded signals", "format", "csv"});
+  cmd_parser.process(app);
+
+  const QStringList args = cmd_parser.positionalArguments();
+  if (args.size() != 2) {
+    cmd_parser.showHelp(1);
+  }
+
+  std::optional<MessageId> msg_id;
+  if (cmd_parser.isSet("msg") && !(msg_id = parseMessageId(cmd_parser.value("msg")))) {
+    qWarning() << "invalid message id" << cmd_parser.value("msg");
+    return 1;
+  }
+  const QString format = cmd_parser.value("format");
+  const bool decode = msg_id && cmd_parser.isSet("dbc");
+  if (format != "csv" && !(format == "npz" && decode)) {
+    qWarning() << "npz export requires --msg and --dbc";
+    return 1;
+  }
+
+  if (cmd_parser.isSet("dbc")) {
+    QString error;
+    if (!dbc()->open(SOURCE_ALL, cmd_parser.value("dbc"), &error)) {
+      qWarning() << "failed to open dbc:" << error;
+      return 1;
+    }
+  }
+
+  auto stream = new RouteStream(&app);
+  if (!stream->load(args[0], cmd_parser.value("data_dir"))) {
+    return 1;
+  }
+  stream->start();
+
+  const QString &output = args[1];
+  const utils::ExportSource source(msg_id);
+  auto progress = [](size_t done, size_t total) {
+    fprintf(stderr, "\rexported %zu/%zu events", done, total);
+    return true;
+  };
+  bool success = false;
+  if (!decode) {
+    success = utils::exportToCSV(output, source, progress);
+  } else if (format == "npz") {
+    success = utils::exportSignalsToNpz(output, source, progress);
+  } else {
+    success = utils::exportSignalsToCSV(output, source, progress);
+  }
+  fprintf(stderr, "\n");
+  if (!success) {
+    qWarning() << "failed to export to" << output;
+  }
+  return success ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include "tools/cabana/chart/chart.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include <QActionGroup>
@@ -219,6 +220,10 @@ void ChartView::updatePlotArea(int left_pos, bool force) {
     x_label_size += QSizeF{5, 5};
     chart()->setPlotArea(rect().adjusted(align_to + left, adjust_top + top, -x_label_size.width() / 2 - right, -x_label_size.height() - bottom));
     chart()->layout()->invalidate();
+    // the number of points to render depends on the width of the plot area
+    for (auto &s : sigs) {
+      updateSeriesData(s);
+    }
     resetChartCache();
   }
 }
@@ -249,6 +254,9 @@ void ChartView::updatePlot(double cur, double min, double max) {
   cur_sec = cur;
   if (min != axis_x->min() || max != axis_x->max()) {
     axis_x->setRange(min, max);
+    for (auto &s : sigs) {
+      updateSeriesData(s);
+    }
     updateAxisY();
     updateSeriesPoints();
     // update tooltip
@@ -284,19 +292,16 @@ void ChartView::updateSeriesPoints() {
 }
 
 void ChartView::appendCanEvents(const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
-                                std::vector<QPointF> &vals, std::vector<QPointF> &step_vals) {
+                                std::vector<QPointF> &vals) {
   vals.reserve(vals.size() + events.capacity());
-  step_vals.reserve(step_vals.size() + events.capacity() * 2);
 
-  double value = 0;
+  std::vector<double> values(events.size());
+  sig->getValues(events.data(), events.size(), values.data());
   const uint64_t begin_mono_time = can->routeStartTime() * 1e9;
-  for (const CanEvent *e : events) {
-    if (sig->getValue(e->dat, e->size, &value)) {
-      const double ts = (e->mono_time - std::min(e->mono_time, begin_mono_time)) / 1e9;
-      vals.emplace_back(ts, value);
-      if (!step_vals.empty())
-        step_vals.emplace_back(ts, step_vals.back().y());
-      step_vals.emplace_back(ts, value);
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (!std::isnan(values[i])) {
+      const uint64_t mono_time = events[i]->mono_time;
+      vals.emplace_back((mono_time - std::min(mono_time, begin_mono_time)) / 1e9, values[i]);
     }
   }
 }
@@ -306,27 +311,31 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
     if (!sig || s.sig == sig) {
       if (!msg_new_events) {
         s.vals.clear();
-        s.step_vals.clear();
       }
       auto events = msg_new_events ? msg_new_events : &can->eventsMap();
       auto it = events->find(s.msg_id);
-      if (it == events->end() || it->second.empty()) continue;
+      if (it == events->end() || it->second.empty()) {
+        if (!msg_new_events) {
+          s.pyramid.update(s.vals);
+          updateSeriesData(s);
+        }
+        continue;
+      }
 
+      size_t updated_from = s.vals.size();
       if (s.vals.empty() || (it->second.back()->mono_time / 1e9 - can->routeStartTime()) > s.vals.back().x()) {
-        appendCanEvents(s.sig, it->second, s.vals, s.step_vals);
+        appendCanEvents(s.sig, it->second, s.vals);
       } else {
-        std::vector<QPointF> vals, step_vals;
-        appendCanEvents(s.sig, it->second, vals, step_vals);
-        s.vals.insert(std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan),
-                      vals.begin(), vals.end());
-        s.step_vals.insert(std::lower_bound(s.step_vals.begin(), s.step_vals.end(), step_vals.front().x(), xLessThan),
-                           step_vals.begin(), step_vals.end());
+        std::vector<QPointF> vals;
+        appendCanEvents(s.sig, it->second, vals);
+        auto pos = std::lower_bound(s.vals.begin(), s.vals.end(), vals.front().x(), xLessThan);
+        updated_from = std::distance(s.vals.begin(), pos);
+        s.vals.insert(pos, vals.begin(), vals.end());
       }
 
-      if (!can->liveStreaming()) {
-        s.segment_tree.build(s.vals);
-      }
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      // only the part of the pyramid covering the new points is rebuilt
+      s.pyramid.update(s.vals, updated_from);
+      updateSeriesData(s);
     }
   }
   updateAxisY();
@@ -334,6 +343,59 @@ void ChartView::updateSeries(const cabana::Signal *sig, const MessageEventsMap *
   QMetaObject::invokeMethod(this, &ChartView::resetChartCache, Qt::QueuedConnection);
 }
 
+void ChartView::trimSeries(const MonoTimeRanges &ranges) {
+  const uint64_t begin_mono_time = can->routeStartTime() * 1e9;
+  auto to_sec = [=](uint64_t mono_time) { return (mono_time - std::min(mono_time, begin_mono_time)) / 1e9; };
+  for (auto &s : sigs) {
+    const auto &events = can->events(s.msg_id);
+    size_t updated_from = SIZE_MAX;
+    for (const auto &[begin_ts, end_ts] : ranges) {
+      auto first = std::lower_bound(s.vals.begin(), s.vals.end(), to_sec(begin_ts), [](const QPointF &p, double x) { return p.x() < x; });
+      auto last = std::upper_bound(first, s.vals.end(), to_sec(end_ts), [](double x, const QPointF &p) { return x < p.x(); });
+      if (first == last) continue;
+
+      // events of the range that weren't evicted, e.g. sent at the same time as an evicted one
+      auto kept_first = std::lower_bound(events.cbegin(), events.cend(), begin_ts, CompareCanEvent());
+      auto kept_last = std::upper_bound(kept_first, events.cend(), end_ts, CompareCanEvent());
+      std::vector<QPointF> kept;
+      appendCanEvents(s.sig, std::vector<const CanEvent *>(kept_first, kept_last), kept);
+      updated_from = std::min<size_t>(updated_from, std::distance(s.vals.begin(), first));
+      s.vals.insert(s.vals.erase(first, last), kept.begin(), kept.end());
+    }
+    if (updated_from != SIZE_MAX) {
+      s.pyramid.update(s.vals, updated_from);
+      updateSeriesData(s);
+    }
+  }
+  updateAxisY();
+  QMetaObject::invokeMethod(this, &ChartView::resetChartCache, Qt::QueuedConnection);
+}
+
+// Feed QtCharts with the visible points only, decimated to about two points per pixel.
+void ChartView::updateSeriesData(SigItem &s) {
+  auto first = std::lower_bound(s.vals.cbegin(), s.vals.cend(), axis_x->min(), xLessThan);
+  auto last = std::lower_bound(first, s.vals.cend(), axis_x->max(), xLessThan);
+  // include the adjacent points so that the lines extend to the edges of the plot area
+  size_t begin = std::max<int>(std::distance(s.vals.cbegin(), first) - 1, 0);
+  size_t end = std::min<size_t>(std::distance(s.vals.cbegin(), last) + 1, s.vals.size());
+
+  std::vector<QPointF> points;
+  const int plot_width = chart()->plotArea().isEmpty() ? width() : chart()->plotArea().width();
+  const size_t max_points = std::max(plot_width, 1) * 2;
+  s.pyramid.decimate(s.vals, begin, end, max_points, points);
+  if (series_type == SeriesType::StepLine) {
+    std::vector<QPointF> step_points;
+    step_points.reserve(points.size() * 2);
+    for (const auto &pt : points) {
+      if (!step_points.empty())
+        step_points.emplace_back(pt.x(), step_points.back().y());
+      step_points.push_back(pt);
+    }
+    points.swap(step_points);
+  }
+  s.series->replace(QVector<QPointF>::fromStdVector(points));
+}
+
 // auto zoom on yaxis
 void ChartView::updateAxisY() {
   if (sigs.empty()) return;
@@ -352,16 +414,7 @@ void ChartView::updateAxisY() {
 
     auto first = std::lower_bound(s.vals.cbegin(), s.vals.cend(), axis_x->min(), xLessThan);
     auto last = std::lower_bound(first, s.vals.cend(), axis_x->max(), xLessThan);
-    s.min = std::numeric_limits<double>::max();
-    s.max = std::numeric_limits<double>::lowest();
-    if (can->liveStreaming()) {
-      for (auto it = first; it != last; ++it) {
-        if (it->y() < s.min) s.min = it->y();
-        if (it->y() > s.max) s.max = it->y();
-      }
-    } else {
-      std::tie(s.min, s.max) = s.segment_tree.minmax(std::distance(s.vals.cbegin(), first), std::distance(s.vals.cbegin(), last));
-    }
+    std::tie(s.min, s.max) = s.pyramid.minmax(s.vals, std::distance(s.vals.cbegin(), first), std::distance(s.vals.cbegin(), last));
     min = std::min(min, s.min);
     max = std::max(max, s.max);
   }
@@ -848,7 +901,7 @@ void ChartView::setSeriesType(SeriesType type) {
     }
     for (auto &s : sigs) {
       s.series = createSeries(series_type, s.sig->color);
-      s.series->replace(QVector<QPointF>::fromStdVector(series_type == SeriesType::StepLine ? s.step_vals : s.vals));
+      updateSeriesData(s);
     }
     updateSeriesPoints();
     updateTitle();
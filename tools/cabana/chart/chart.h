@@ -33,6 +33,8 @@ public:
   void addSignal(const MessageId &msg_id, const cabana::Signal *sig);
   bool hasSignal(const MessageId &msg_id, const cabana::Signal *sig) const;
   void updateSeries(const cabana::Signal *sig = nullptr, const MessageEventsMap *msg_new_events = nullptr);
+  // Remove the points of evicted events, keeping the points of the events in the ranges that are left.
+  void trimSeries(const MonoTimeRanges &ranges);
   void updatePlot(double cur, double min, double max);
   void setSeriesType(SeriesType type);
   void updatePlotArea(int left, bool force = false);
@@ -45,9 +47,8 @@ public:
     const cabana::Signal *sig = nullptr;
     QXYSeries *series = nullptr;
     std::vector<QPointF> vals;
-    std::vector<QPointF> step_vals;
     QPointF track_pt{};
-    SegmentTree segment_tree;
+    MinMaxPyramid pyramid;
     double min = 0;
     double max = 0;
   };
@@ -65,7 +66,8 @@ private slots:
 
 private:
   void appendCanEvents(const cabana::Signal *sig, const std::vector<const CanEvent *> &events,
-                       std::vector<QPointF> &vals, std::vector<QPointF> &step_vals);
+                       std::vector<QPointF> &vals);
+  void updateSeriesData(SigItem &s);
   void createToolButtons();
   void addSeries(QXYSeries *series);
   void contextMenuEvent(QContextMenuEvent *event) override;
@@ -64,6 +64,7 @@ private:
   void splitChart(ChartView *chart);
   QRect chartVisibleRect(ChartView *chart);
   void eventsMerged(const MessageEventsMap &new_events);
+  void eventsEvicted(const MonoTimeRanges &ranges);
   void updateState();
   void zoomReset();
   void startAutoScroll();
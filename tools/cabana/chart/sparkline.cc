@@ -1,6 +1,7 @@
 #include "tools/cabana/chart/sparkline.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <QPainter>
 
@@ -19,10 +20,11 @@ void Sparkline::update(const MessageId &msg_id, const cabana::Signal *sig, doubl
   }
 
   points.clear();
-  double value = 0;
-  for (auto it = first; it != last; ++it) {
-    if (sig->getValue((*it)->dat, (*it)->size, &value)) {
-      points.emplace_back(((*it)->mono_time - (*first)->mono_time) / 1e9, value);
+  values.resize(last - first);
+  sig->getValues(&*first, values.size(), values.data());
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (!std::isnan(values[i])) {
+      points.emplace_back((first[i]->mono_time - (*first)->mono_time) / 1e9, values[i]);
     }
   }
 
@@ -20,5 +20,6 @@ private:
   void render(const QColor &color, int range, QSize size);
 
   std::vector<QPointF> points;
+  std::vector<double> values;
   double freq_ = 0;
 };
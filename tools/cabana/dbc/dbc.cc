@@ -1,7 +1,10 @@
 #include "tools/cabana/dbc/dbc.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
+#include "tools/cabana/streams/abstractstream.h"
 #include "tools/cabana/utils/util.h"
 
 uint qHash(const MessageId &item) {
@@ -166,6 +169,52 @@ bool cabana::Signal::getValue(const uint8_t *data, size_t data_size, double *val
   return true;
 }
 
+void cabana::Signal::getValues(const CanEvent *const *events, size_t count, double *values) const {
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = getRawValue(events[i]->dat, events[i]->size);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = values[i] * factor + offset;
+  }
+  if (multiplexor) {
+    for (size_t i = 0; i < count; ++i) {
+      if (get_raw_value(events[i]->dat, events[i]->size, *multiplexor) != multiplex_value) {
+        values[i] = NAN;
+      }
+    }
+  }
+}
+
+int64_t cabana::Signal::getRawValue(const uint8_t *data, size_t data_size) const {
+  int64_t val = 0;
+  if (last_byte < data_size) {
+    uint64_t word = 0;
+    memcpy(&word, data, std::min<size_t>(data_size, 8));
+    if (!is_little_endian) {
+      word = __builtin_bswap64(word);
+    }
+    val = (word >> word_shift) & word_mask;
+  } else {
+    int i = msb / 8;
+    int bits = size;
+    while (i >= 0 && i < data_size && bits > 0) {
+      int lsb_ = (int)(lsb / 8) == i ? lsb : i * 8;
+      int msb_ = (int)(msb / 8) == i ? msb : (i + 1) * 8 - 1;
+      int size_ = msb_ - lsb_ + 1;
+
+      uint64_t d = (data[i] >> (lsb_ - (i * 8))) & ((1ULL << size_) - 1);
+      val |= d << (bits - size_);
+
+      bits -= size_;
+      i = is_little_endian ? i - 1 : i + 1;
+    }
+  }
+  if (is_signed && size < 64) {
+    val -= ((val >> (size - 1)) & 0x1) ? (1ULL << size) : 0;
+  }
+  return val;
+}
+
 bool cabana::Signal::operator==(const cabana::Signal &other) const {
   return name == other.name && size == other.size &&
          start_bit == other.start_bit &&
@@ -179,25 +228,7 @@ bool cabana::Signal::operator==(const cabana::Signal &other) const {
 // helper functions
 
 double get_raw_value(const uint8_t *data, size_t data_size, const cabana::Signal &sig) {
-  int64_t val = 0;
-
-  int i = sig.msb / 8;
-  int bits = sig.size;
-  while (i >= 0 && i < data_size && bits > 0) {
-    int lsb = (int)(sig.lsb / 8) == i ? sig.lsb : i * 8;
-    int msb = (int)(sig.msb / 8) == i ? sig.msb : (i + 1) * 8 - 1;
-    int size = msb - lsb + 1;
-
-    uint64_t d = (data[i] >> (lsb - (i * 8))) & ((1ULL << size) - 1);
-    val |= d << (bits - size);
-
-    bits -= size;
-    i = sig.is_little_endian ? i - 1 : i + 1;
-  }
-  if (sig.is_signed) {
-    val -= ((val >> (sig.size - 1)) & 0x1) ? (1ULL << sig.size) : 0;
-  }
-  return val * sig.factor + sig.offset;
+  return sig.getRawValue(data, data_size) * sig.factor + sig.offset;
 }
 
 void updateMsbLsb(cabana::Signal &s) {
@@ -208,4 +239,13 @@ void updateMsbLsb(cabana::Signal &s) {
     s.lsb = flipBitPos(flipBitPos(s.start_bit) + s.size - 1);
     s.msb = s.start_bit;
   }
+
+  // position of the lsb in the little endian or the byte swapped word
+  if (s.size > 0 && s.size <= 64 && s.lsb >= 0 && s.lsb < 64 && s.msb < 64) {
+    s.last_byte = s.is_little_endian ? s.msb / 8 : s.lsb / 8;
+    s.word_shift = s.is_little_endian ? s.lsb : (7 - s.lsb / 8) * 8 + s.lsb % 8;
+    s.word_mask = s.size == 64 ? ~0ULL : (1ULL << s.size) - 1;
+  } else {
+    s.last_byte = INT_MAX;
+  }
 }
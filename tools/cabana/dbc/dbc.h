@@ -1,5 +1,6 @@
 #pragma once
 
+#include <climits>
 #include <limits>
 #include <utility>
 #include <vector>
@@ -47,6 +48,8 @@ struct std::hash<MessageId> {
 
 typedef std::vector<std::pair<double, QString>> ValueDescription;
 
+struct CanEvent;
+
 namespace cabana {
 
 class Signal {
@@ -55,6 +58,9 @@ public:
   Signal(const Signal &other) = default;
   void update();
   bool getValue(const uint8_t *data, size_t data_size, double *val) const;
+  // Decodes the signal from each of events into values, NaN where the multiplexor selects another signal.
+  void getValues(const CanEvent *const *events, size_t count, double *values) const;
+  int64_t getRawValue(const uint8_t *data, size_t data_size) const;
   QString formatValue(double value, bool with_unit = true) const;
   bool operator==(const cabana::Signal &other) const;
   inline bool operator!=(const cabana::Signal &other) const { return !(*this == other); }
@@ -83,6 +89,12 @@ public:
   // Multiplexed
   int multiplex_value = 0;
   Signal *multiplexor = nullptr;
+
+  // Set by updateMsbLsb. A signal within the first 8 bytes is read with one shift and mask of
+  // them loaded as a 64-bit word, byte swapped for big endian, if the data has its last byte.
+  int last_byte = INT_MAX;
+  int word_shift = 0;
+  uint64_t word_mask = 0;
 };
 
 class Msg {
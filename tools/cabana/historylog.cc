@@ -1,5 +1,7 @@
 #include "tools/cabana/historylog.h"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
 
 #include <QFileDialog>
@@ -14,7 +16,11 @@ QVariant HistoryLogModel::data(const QModelIndex &index, int role) const {
   const int col = index.column();
   if (role == Qt::DisplayRole) {
     if (col == 0) return QString::number((m.mono_time / (double)1e9) - can->routeStartTime(), 'f', 3);
-    if (!isHexMode()) return sigs[col - 1]->formatValue(m.sig_values[col - 1], false);
+    if (!isHexMode()) {
+      // NaN where the multiplexor selects another signal
+      const double value = m.sig_values[col - 1];
+      return std::isnan(value) ? QString() : sigs[col - 1]->formatValue(value, false);
+    }
   } else if (role == Qt::TextAlignmentRole) {
     return (uint32_t)(Qt::AlignRight | Qt::AlignVCenter);
   }
@@ -100,20 +106,33 @@ void HistoryLogModel::fetchData(std::deque<Message>::iterator insert_pos, uint64
     return ts > e->mono_time;
   });
 
+  auto last = std::partition_point(first, events.rend(), [min_time](auto e) { return e->mono_time > min_time; });
+
   std::vector<HistoryLogModel::Message> msgs;
   std::vector<double> values(sigs.size());
+  std::vector<std::vector<double>> columns(sigs.size());
   msgs.reserve(batch_size);
-  for (; first != events.rend() && (*first)->mono_time > min_time; ++first) {
-    const CanEvent *e = *first;
+  bool done = false;
+  while (first != last && !done) {
+    // the signals are decoded a batch of events at a time. the events of a batch are
+    // contiguous in events, from the oldest at chunk[0] to the newest at chunk[n - 1].
+    const size_t n = std::min<size_t>(std::distance(first, last), batch_size);
+    const CanEvent *const *chunk = &*(first + n - 1);
     for (int i = 0; i < sigs.size(); ++i) {
-      sigs[i]->getValue(e->dat, e->size, &values[i]);
+      columns[i].resize(n);
+      sigs[i]->getValues(chunk, n, columns[i].data());
     }
-    if (!filter_cmp || filter_cmp(values[filter_sig_idx], filter_value)) {
-       msgs.emplace_back(Message{e->mono_time, values, {e->dat, e->dat + e->size}});
-      if (msgs.size() >= batch_size && min_time == 0) {
-        break;
+    for (size_t j = n; j-- > 0 && !done;) {
+      const CanEvent *e = chunk[j];
+      for (int i = 0; i < sigs.size(); ++i) {
+        values[i] = columns[i][j];
+      }
+      if (!filter_cmp || filter_cmp(values[filter_sig_idx], filter_value)) {
+        msgs.emplace_back(Message{e->mono_time, values, {e->dat, e->dat + e->size}});
+        done = msgs.size() >= batch_size && min_time == 0;
       }
     }
+    first += n;
   }
 
   if (!msgs.empty()) {
@@ -239,10 +258,17 @@ void LogsWidget::filterChanged() {
 
 void LogsWidget::exportToCSV() {
   QString dir = QString("%1/%2_%3.csv").arg(settings.last_dir).arg(can->routeName()).arg(msgName(model->msg_id));
+  QString filter = model->isHexMode() ? tr("csv (*.csv)") : tr("csv (*.csv);;NumPy (*.npz)");
   QString fn = QFileDialog::getSaveFileName(this, QString("Export %1 to CSV file").arg(msgName(model->msg_id)),
-                                            dir, tr("csv (*.csv)"));
-  if (!fn.isEmpty()) {
-    model->isHexMode() ? utils::exportToCSV(fn, model->msg_id)
-                       : utils::exportSignalsToCSV(fn, model->msg_id);
+                                            dir, filter);
+  if (fn.isEmpty()) return;
+
+  utils::ExportSource source(model->msg_id);
+  if (model->isHexMode()) {
+    utils::exportInBackground(this, fn, [=](const auto &progress) { return utils::exportToCSV(fn, source, progress); });
+  } else if (fn.endsWith(".npz", Qt::CaseInsensitive)) {
+    utils::exportInBackground(this, fn, [=](const auto &progress) { return utils::exportSignalsToNpz(fn, source, progress); });
+  } else {
+    utils::exportInBackground(this, fn, [=](const auto &progress) { return utils::exportSignalsToCSV(fn, source, progress); });
   }
 }
@@ -281,7 +281,9 @@ void MainWindow::exportToCSV() {
   QString dir = QString("%1/%2.csv").arg(settings.last_dir).arg(can->routeName());
   QString fn = QFileDialog::getSaveFileName(this, "Export stream to CSV file", dir, tr("csv (*.csv)"));
   if (!fn.isEmpty()) {
-    utils::exportToCSV(fn);
+    utils::exportInBackground(this, fn, [fn, source = utils::ExportSource()](const auto &progress) {
+      return utils::exportToCSV(fn, source, progress);
+    });
   }
 }
 
@@ -23,6 +23,8 @@ void settings_op(SettingOperation op) {
   op(s, "absolute_time", settings.absolute_time);
   op(s, "fps", settings.fps);
   op(s, "max_cached_minutes", settings.max_cached_minutes);
+  op(s, "max_live_cache_mb", settings.max_live_cache_mb);
+  op(s, "max_spill_mb", settings.max_spill_mb);
   op(s, "chart_height", settings.chart_height);
   op(s, "chart_range", settings.chart_range);
   op(s, "chart_column_count", settings.chart_column_count);
@@ -78,6 +80,18 @@ SettingsDlg::SettingsDlg(QWidget *parent) : QDialog(parent) {
   cached_minutes->setRange(MIN_CACHE_MINIUTES, MAX_CACHE_MINIUTES);
   cached_minutes->setSingleStep(1);
   cached_minutes->setValue(settings.max_cached_minutes);
+
+  form_layout->addRow(tr("Max Live Stream Memory (MB)"), live_cache_mb = new QSpinBox(this));
+  live_cache_mb->setToolTip(tr("Older live stream events are moved to disk and loaded back on demand"));
+  live_cache_mb->setRange(128, 16 * 1024);
+  live_cache_mb->setSingleStep(128);
+  live_cache_mb->setValue(settings.max_live_cache_mb);
+
+  form_layout->addRow(tr("Max Live Stream Disk Cache (MB)"), spill_mb = new QSpinBox(this));
+  spill_mb->setToolTip(tr("The oldest events moved to disk are dropped beyond this size"));
+  spill_mb->setRange(256, 64 * 1024);
+  spill_mb->setSingleStep(256);
+  spill_mb->setValue(settings.max_spill_mb);
   main_layout->addWidget(groupbox);
 
   groupbox = new QGroupBox("New Signal Settings");
@@ -132,6 +146,8 @@ void SettingsDlg::save() {
   }
   settings.fps = fps->value();
   settings.max_cached_minutes = cached_minutes->value();
+  settings.max_live_cache_mb = live_cache_mb->value();
+  settings.max_spill_mb = spill_mb->value();
   settings.chart_series_type = chart_series_type->currentIndex();
   settings.chart_height = chart_height->value();
   settings.log_livestream = log_livestream->isChecked();
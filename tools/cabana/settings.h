@@ -27,6 +27,8 @@ public:
   bool absolute_time = false;
   int fps = 10;
   int max_cached_minutes = 30;
+  int max_live_cache_mb = 1024;
+  int max_spill_mb = 4 * 1024;
   int chart_height = 200;
   int chart_column_count = 1;
   int chart_range = 3 * 60; // 3 minutes
@@ -56,6 +58,8 @@ public:
   void save();
   QSpinBox *fps;
   QSpinBox *cached_minutes;
+  QSpinBox *live_cache_mb;
+  QSpinBox *spill_mb;
   QSpinBox *chart_height;
   QComboBox *chart_series_type;
   QComboBox *theme;
@@ -7,8 +7,6 @@
 #include "common/timing.h"
 #include "tools/cabana/settings.h"
 
-static const int EVENT_NEXT_BUFFER_SIZE = 6 * 1024 * 1024;  // 6MB
-
 AbstractStream *can = nullptr;
 
 StreamNotifier *StreamNotifier::instance() {
@@ -18,7 +16,6 @@ StreamNotifier *StreamNotifier::instance() {
 
 AbstractStream::AbstractStream(QObject *parent) : QObject(parent) {
   assert(parent != nullptr);
-  event_buffer_ = std::make_unique<MonotonicBuffer>(EVENT_NEXT_BUFFER_SIZE);
 
   QObject::connect(QApplication::instance(), &QCoreApplication::aboutToQuit, this, &AbstractStream::stop);
   QObject::connect(this, &AbstractStream::privateUpdateLastMsgsSignal, this, &AbstractStream::updateLastMessages, Qt::QueuedConnection);
@@ -163,17 +160,105 @@ void AbstractStream::updateLastMsgsTo(double sec) {
   emit msgsReceived(nullptr, id_changed);
 }
 
+CanEvent *AbstractStream::allocEvent(uint64_t mono_time, uint8_t size, bool paged_in) {
+  constexpr size_t alignment = alignof(CanEvent);
+  const size_t bytes = (sizeof(CanEvent) + size + alignment - 1) & ~(alignment - 1);
+  // paged in events never share a chunk with live events, so they can be evicted separately.
+  if (chunks_.empty() || chunks_.back().paged_in != paged_in || chunks_.back().used + bytes > EVENT_CHUNK_SIZE) {
+    auto &chunk = chunks_.emplace_back();
+    chunk.data.reset(new uint8_t[EVENT_CHUNK_SIZE]);
+    chunk.paged_in = paged_in;
+  }
+  auto &chunk = chunks_.back();
+  CanEvent *e = (CanEvent *)(chunk.data.get() + chunk.used);
+  chunk.used += bytes;
+  chunk.min_mono_time = std::min(chunk.min_mono_time, mono_time);
+  chunk.max_mono_time = std::max(chunk.max_mono_time, mono_time);
+  return e;
+}
+
 const CanEvent *AbstractStream::newEvent(uint64_t mono_time, const cereal::CanData::Reader &c) {
   auto dat = c.getDat();
-  CanEvent *e = (CanEvent *)event_buffer_->allocate(sizeof(CanEvent) + sizeof(uint8_t) * dat.size());
-  e->src = c.getSrc();
-  e->address = c.getAddress();
+  return newEvent(mono_time, c.getSrc(), c.getAddress(), (const uint8_t *)dat.begin(), dat.size());
+}
+
+const CanEvent *AbstractStream::newEvent(uint64_t mono_time, uint8_t src, uint32_t address, const uint8_t *dat,
+                                         uint8_t size, bool paged_in) {
+  CanEvent *e = allocEvent(mono_time, size, paged_in);
+  e->src = src;
+  e->address = address;
   e->mono_time = mono_time;
-  e->size = dat.size();
-  memcpy(e->dat, (uint8_t *)dat.begin(), e->size);
+  e->size = size;
+  memcpy(e->dat, dat, size);
   return e;
 }
 
+std::shared_ptr<void> AbstractStream::pinEvents() {
+  ++*event_pins_;
+  // the counter is shared, in case the stream is gone when a job releases its handle
+  return std::shared_ptr<void>(nullptr, [pins = event_pins_](void *) { --*pins; });
+}
+
+size_t AbstractStream::evictEvents(uint64_t min_mono_time, size_t max_bytes, bool keep_paged_in,
+                                   const std::function<void(const std::vector<const CanEvent *> &)> &spill) {
+  if (*event_pins_ > 0) return 0;
+
+  size_t memory_usage = std::count_if(chunks_.cbegin(), chunks_.cend(), [](auto &c) { return !c.paged_in; }) * EVENT_CHUNK_SIZE;
+  std::vector<size_t> evict;
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    const auto &c = chunks_[i];
+    if (c.paged_in) {
+      if (!keep_paged_in) evict.push_back(i);
+    } else if (i + 1 < chunks_.size() && (c.max_mono_time < min_mono_time || memory_usage > max_bytes)) {
+      // the newest chunk is never evicted
+      evict.push_back(i);
+      memory_usage -= EVENT_CHUNK_SIZE;
+    }
+  }
+  if (evict.empty()) return 0;
+
+  auto is_evicted = [&](const CanEvent *e) {
+    return std::any_of(evict.cbegin(), evict.cend(), [&](size_t i) { return chunks_[i].contains(e); });
+  };
+  auto is_paged_in = [&](const CanEvent *e) {
+    return std::any_of(evict.cbegin(), evict.cend(), [&](size_t i) { return chunks_[i].paged_in && chunks_[i].contains(e); });
+  };
+
+  // paged in events are already on disk, only spill the live ones.
+  std::vector<const CanEvent *> evicted;
+  auto first = std::stable_partition(all_events_.begin(), all_events_.end(), [&](auto e) { return !is_evicted(e); });
+  std::copy_if(first, all_events_.end(), std::back_inserter(evicted), [&](auto e) { return !is_paged_in(e); });
+  all_events_.erase(first, all_events_.end());
+  if (!evicted.empty() && spill) {
+    spill(evicted);
+  }
+
+  for (auto &[_, e] : events_) {
+    e.erase(std::remove_if(e.begin(), e.end(), is_evicted), e.end());
+  }
+  MonoTimeRanges ranges;
+  for (size_t i : evict) {
+    ranges.emplace_back(chunks_[i].min_mono_time, chunks_[i].max_mono_time);
+  }
+  std::sort(ranges.begin(), ranges.end());
+  size_t merged = 0;
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    if (ranges[i].first <= ranges[merged].second) {
+      ranges[merged].second = std::max(ranges[merged].second, ranges[i].second);
+    } else {
+      ranges[++merged] = ranges[i];
+    }
+  }
+  ranges.resize(merged + 1);
+
+  for (auto i = evict.rbegin(); i != evict.rend(); ++i) {
+    chunks_.erase(chunks_.begin() + *i);
+  }
+  lastest_event_ts = all_events_.empty() ? 0 : all_events_.back()->mono_time;
+  emit eventsEvicted(ranges);
+  return evict.size();
+}
+
 void AbstractStream::mergeEvents(const std::vector<const CanEvent *> &events) {
   static MessageEventsMap msg_events;
   std::for_each(msg_events.begin(), msg_events.end(), [](auto &e) { e.second.clear(); });
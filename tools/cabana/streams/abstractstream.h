@@ -1,6 +1,9 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -56,6 +59,8 @@ struct BusConfig {
 };
 
 typedef std::unordered_map<MessageId, std::vector<const CanEvent *>> MessageEventsMap;
+// sorted, non overlapping [begin, end] mono time ranges
+typedef std::vector<std::pair<uint64_t, uint64_t>> MonoTimeRanges;
 
 class AbstractStream : public QObject {
   Q_OBJECT
@@ -83,6 +88,9 @@ public:
   inline const std::vector<const CanEvent *> &allEvents() const { return all_events_; }
   const CanData &lastMessage(const MessageId &id);
   const std::vector<const CanEvent *> &events(const MessageId &id) const;
+  // Keeps the events from being freed while the returned handle is alive, for background
+  // jobs holding pointers to them. Eviction is put off until all the handles are released.
+  std::shared_ptr<void> pinEvents();
 
   size_t suppressHighlighted();
   void clearSuppressed();
@@ -98,6 +106,8 @@ signals:
   void msgsReceived(const std::set<MessageId> *new_msgs, bool has_new_ids);
   void sourcesUpdated(const SourceSet &s);
   void privateUpdateLastMsgsSignal();
+  // the events in the ranges were evicted, except those still in eventsMap()
+  void eventsEvicted(const MonoTimeRanges &ranges);
 
 public:
   SourceSet sources;
@@ -105,6 +115,14 @@ public:
 protected:
   void mergeEvents(const std::vector<const CanEvent *> &events);
   const CanEvent *newEvent(uint64_t mono_time, const cereal::CanData::Reader &c);
+  const CanEvent *newEvent(uint64_t mono_time, uint8_t src, uint32_t address, const uint8_t *dat, uint8_t size,
+                           bool paged_in = false);
+  // Free the oldest storage chunks while their events are older than min_mono_time or while
+  // the live events use more than max_bytes, and drop the paged in chunks unless keep_paged_in is set.
+  // Evicted live events are passed to spill in time order before they are freed. Nothing is
+  // evicted while the events are pinned.
+  size_t evictEvents(uint64_t min_mono_time, size_t max_bytes, bool keep_paged_in,
+                     const std::function<void(const std::vector<const CanEvent *> &)> &spill = nullptr);
   void updateEvent(const MessageId &id, double sec, const uint8_t *data, uint8_t size);
   uint64_t lastEventMonoTime() const { return lastest_event_ts; }
 
@@ -117,9 +135,26 @@ private:
   void updateLastMsgsTo(double sec);
   void updateMasks();
 
+  // Events are allocated from fixed size chunks so that storage can be released
+  // in bulk once the events fall out of the retention window.
+  static constexpr size_t EVENT_CHUNK_SIZE = 6 * 1024 * 1024;  // 6MB
+  struct EventChunk {
+    std::unique_ptr<uint8_t[]> data;
+    size_t used = 0;
+    uint64_t min_mono_time = UINT64_MAX;
+    uint64_t max_mono_time = 0;
+    bool paged_in = false;
+    inline bool contains(const CanEvent *e) const {
+      return (const uint8_t *)e >= data.get() && (const uint8_t *)e < data.get() + EVENT_CHUNK_SIZE;
+    }
+  };
+  CanEvent *allocEvent(uint64_t mono_time, uint8_t size, bool paged_in);
+
   MessageEventsMap events_;
   std::unordered_map<MessageId, CanData> last_msgs;
-  std::unique_ptr<MonotonicBuffer> event_buffer_;
+  std::deque<EventChunk> chunks_;
+  // handles of pinEvents() alive, released in the threads of the jobs
+  std::shared_ptr<std::atomic<int>> event_pins_ = std::make_shared<std::atomic<int>>(0);
 
   // Members accessed in multiple threads. (mutex protected)
   std::mutex mutex_;
@@ -1,7 +1,11 @@
 #include "tools/cabana/streams/livestream.h"
 
+#include <QDebug>
+#include <QDir>
+#include <QTemporaryFile>
 #include <QThread>
 #include <algorithm>
+#include <deque>
 #include <fstream>
 #include <memory>
 
@@ -31,10 +35,87 @@ struct LiveStream::Logger {
   uint64_t start_ts;
 };
 
+// Events evicted from memory are appended to temporary files in blocks, and read back
+// when the user seeks to a time before the retention window. Each file holds about a
+// quarter of max_bytes, the oldest one is deleted once together they take more.
+struct LiveStream::SpillFile {
+  struct Record {
+    uint64_t mono_time;
+    uint32_t address;
+    uint8_t src;
+    uint8_t size;
+  } __attribute__((packed));
+
+  struct Block {
+    uint64_t begin_ts;
+    uint64_t end_ts;
+    qint64 offset;
+    qint64 size;
+  };
+
+  struct Segment {
+    std::unique_ptr<QTemporaryFile> file;
+    std::vector<Block> blocks;
+  };
+  static constexpr int NUM_SEGMENTS = 4;
+
+  void write(const std::vector<const CanEvent *> &events, qint64 max_bytes) {
+    QByteArray buf;
+    buf.reserve(events.size() * (sizeof(Record) + 8));
+    for (const CanEvent *e : events) {
+      Record r = {.mono_time = e->mono_time, .address = e->address, .src = e->src, .size = e->size};
+      buf.append((const char *)&r, sizeof(r));
+      buf.append((const char *)e->dat, e->size);
+    }
+
+    if (segments.empty() || segments.back().file->size() + buf.size() > max_bytes / NUM_SEGMENTS) {
+      auto file = std::make_unique<QTemporaryFile>(QDir::temp().filePath("cabana_spill_XXXXXX"));
+      if (!file->open()) {
+        qWarning() << "failed to create spill file" << file->fileName();
+        return;
+      }
+      segments.push_back({std::move(file), {}});
+    }
+    auto &seg = segments.back();
+    qint64 offset = seg.file->size();
+    if (seg.file->seek(offset) && seg.file->write(buf) == buf.size()) {
+      seg.blocks.push_back({events.front()->mono_time, events.back()->mono_time, offset, buf.size()});
+    }
+
+    qint64 total_size = 0;
+    for (const auto &s : segments) total_size += s.file->size();
+    while (segments.size() > 1 && total_size > max_bytes) {
+      total_size -= segments.front().file->size();
+      segments.pop_front();
+    }
+  }
+
+  QByteArray read(uint64_t begin_ts, uint64_t end_ts) {
+    QByteArray buf;
+    for (auto &seg : segments) {
+      for (const auto &b : seg.blocks) {
+        if (b.end_ts >= begin_ts && b.begin_ts <= end_ts && seg.file->seek(b.offset)) {
+          buf += seg.file->read(b.size);
+        }
+      }
+    }
+    return buf;
+  }
+
+  inline bool contains(uint64_t begin_ts, uint64_t end_ts) const {
+    return std::any_of(segments.cbegin(), segments.cend(), [&](auto &seg) {
+      return !seg.blocks.empty() && seg.blocks.front().begin_ts <= end_ts && seg.blocks.back().end_ts >= begin_ts;
+    });
+  }
+
+  std::deque<Segment> segments;
+};
+
 LiveStream::LiveStream(QObject *parent) : AbstractStream(parent) {
   if (settings.log_livestream) {
     logger = std::make_unique<Logger>();
   }
+  spill = std::make_unique<SpillFile>();
   stream_thread = new QThread(this);
 
   QObject::connect(&settings, &Settings::changed, this, &LiveStream::startUpdateTimer);
@@ -93,9 +174,12 @@ void LiveStream::timerEvent(QTimerEvent *event) {
       std::lock_guard lk(lock);
       mergeEvents(received_events_);
       received_events_.clear();
+      trimEvents();
     }
     if (!all_events_.empty()) {
-      begin_event_ts = all_events_.front()->mono_time;
+      if (begin_event_ts == 0) {
+        begin_event_ts = all_events_.front()->mono_time;
+      }
       updateEvents();
       return;
     }
@@ -133,8 +217,49 @@ void LiveStream::updateEvents() {
   emit privateUpdateLastMsgsSignal();
 }
 
+// must be called with the lock held
+void LiveStream::trimEvents() {
+  const uint64_t retention = settings.max_cached_minutes * 60 * 1e9;
+  const uint64_t min_mono_time = lastEventMonoTime() > retention ? lastEventMonoTime() - retention : 0;
+  const size_t max_bytes = (size_t)settings.max_live_cache_mb * 1024 * 1024;
+  evictEvents(min_mono_time, max_bytes, true, [this](const std::vector<const CanEvent *> &events) {
+    // the paged in range now misses the events spilled into it
+    if (events.front()->mono_time <= paged_in_end_ts) paged_in_end_ts = 0;
+    spill->write(events, (qint64)settings.max_spill_mb * 1024 * 1024);
+  });
+}
+
+void LiveStream::pageIn(uint64_t mono_time) {
+  const uint64_t range = settings.chart_range * 1e9;
+  const uint64_t begin_ts = mono_time > range ? mono_time - range : 0;
+  const uint64_t end_ts = mono_time + range;
+
+  std::lock_guard lk(lock);
+  // the events paged in for a nearby seek are still in memory
+  if (paged_in_begin_ts <= begin_ts && end_ts <= paged_in_end_ts) return;
+
+  // drop the previously paged in events, and load twice the chart range so that
+  // seeking around the same time doesn't read the spill files again.
+  evictEvents(0, SIZE_MAX, false);
+  paged_in_begin_ts = mono_time > range * 2 ? mono_time - range * 2 : 0;
+  paged_in_end_ts = mono_time + range * 2;
+  if (!spill->contains(paged_in_begin_ts, paged_in_end_ts)) return;
+
+  QByteArray buf = spill->read(paged_in_begin_ts, paged_in_end_ts);
+  std::vector<const CanEvent *> events;
+  for (const char *p = buf.cbegin(); p + sizeof(SpillFile::Record) <= buf.cend(); /**/) {
+    SpillFile::Record r;
+    memcpy(&r, p, sizeof(r));
+    p += sizeof(r);
+    events.push_back(newEvent(r.mono_time, r.src, r.address, (const uint8_t *)p, r.size, true));
+    p += r.size;
+  }
+  mergeEvents(events);
+}
+
 void LiveStream::seekTo(double sec) {
   sec = std::max(0.0, sec);
+  pageIn(sec * 1e9 + begin_event_ts);
   first_update_ts = nanos_since_boot();
   current_event_ts = first_event_ts = std::min<uint64_t>(sec * 1e9 + begin_event_ts, lastEventMonoTime());
   post_last_event = (first_event_ts == lastEventMonoTime());
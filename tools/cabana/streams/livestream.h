@@ -31,6 +31,8 @@ private:
   void startUpdateTimer();
   void timerEvent(QTimerEvent *event) override;
   void updateEvents();
+  void trimEvents();
+  void pageIn(uint64_t mono_time);
 
   std::mutex lock;
   QThread *stream_thread;
@@ -50,4 +52,9 @@ private:
 
   struct Logger;
   std::unique_ptr<Logger> logger;
+  struct SpillFile;
+  std::unique_ptr<SpillFile> spill;
+  // the spilled range that is paged in
+  uint64_t paged_in_begin_ts = 0;
+  uint64_t paged_in_end_ts = 0;
 };
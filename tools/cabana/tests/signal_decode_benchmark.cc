@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+#include "common/timing.h"
+#include "common/util.h"
+#include "tools/cabana/dbc/dbcfile.h"
+#include "tools/cabana/streams/abstractstream.h"
+#include "tools/replay/util.h"
+
+// Decodes every signal of a dbc over all the CAN events of a route, the way the charts and the
+// export do it, with the bit by bit decode signals had before, one event at a time with their
+// extraction plan, and in batches with getValues.
+//
+// usage: signal_decode_benchmark <dbc name> <rlog>...   (rlog or rlog.bz2)
+
+// get_raw_value from before signals carried an extraction plan
+static double legacy_raw_value(const uint8_t *data, size_t data_size, const cabana::Signal &sig) {
+  int64_t val = 0;
+
+  int i = sig.msb / 8;
+  int bits = sig.size;
+  while (i >= 0 && i < data_size && bits > 0) {
+    int lsb = (int)(sig.lsb / 8) == i ? sig.lsb : i * 8;
+    int msb = (int)(sig.msb / 8) == i ? sig.msb : (i + 1) * 8 - 1;
+    int size = msb - lsb + 1;
+
+    uint64_t d = (data[i] >> (lsb - (i * 8))) & ((1ULL << size) - 1);
+    val |= d << (bits - size);
+
+    bits -= size;
+    i = sig.is_little_endian ? i - 1 : i + 1;
+  }
+  if (sig.is_signed && sig.size < 64) {
+    val -= ((val >> (sig.size - 1)) & 0x1) ? (1ULL << sig.size) : 0;
+  }
+  return val * sig.factor + sig.offset;
+}
+
+static bool legacy_value(const cabana::Signal &sig, const uint8_t *data, size_t data_size, double *val) {
+  if (sig.multiplexor && legacy_raw_value(data, data_size, *sig.multiplexor) != sig.multiplex_value) {
+    return false;
+  }
+  *val = legacy_raw_value(data, data_size, sig);
+  return true;
+}
+
+// CAN events packed one after another like the stream's event memory
+class Events {
+public:
+  void add(uint64_t mono_time, const cereal::CanData::Reader &c) {
+    auto dat = c.getDat();
+    const size_t size = (sizeof(CanEvent) + dat.size() + 7) & ~7;
+    if (blocks.empty() || used + size > BLOCK_SIZE) {
+      blocks.emplace_back(new uint8_t[BLOCK_SIZE]);
+      used = 0;
+    }
+    CanEvent *e = (CanEvent *)(blocks.back().get() + used);
+    used += size;
+    e->src = c.getSrc();
+    e->address = c.getAddress();
+    e->mono_time = mono_time;
+    e->size = dat.size();
+    memcpy(e->dat, dat.begin(), dat.size());
+    events[e->address].push_back(e);
+    ++count;
+  }
+
+  static constexpr size_t BLOCK_SIZE = 1 << 20;
+  std::vector<std::unique_ptr<uint8_t[]>> blocks;
+  size_t used = 0, count = 0;
+  std::map<uint32_t, std::vector<const CanEvent *>> events;
+};
+
+static void read_can(Events &events, const std::string &file) {
+  std::string data = util::read_file(file);
+  if (util::ends_with(file, ".bz2")) {
+    data = decompressBZ2(data);
+  }
+  kj::ArrayPtr<const capnp::word> words((const capnp::word *)data.data(), data.size() / sizeof(capnp::word));
+  while (words.size() > 0) {
+    capnp::FlatArrayMessageReader reader(words);
+    words = kj::arrayPtr(reader.getEnd(), words.end());
+
+    auto event = reader.getRoot<cereal::Event>();
+    if (event.isCan()) {
+      for (const auto &c : event.getCan()) {
+        events.add(event.getLogMonoTime(), c);
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <dbc name> <rlog>...\n", argv[0]);
+    return 1;
+  }
+
+  DBCFile dbc(QString("%1/%2.dbc").arg(OPENDBC_FILE_PATH, argv[1]));
+  Events events;
+  for (int i = 2; i < argc; ++i) {
+    read_can(events, argv[i]);
+  }
+
+  // the signals with events, and room for the values of the largest message
+  std::vector<std::pair<const cabana::Signal *, const std::vector<const CanEvent *> *>> sigs;
+  size_t max_events = 0;
+  for (const auto &[address, msg] : dbc.getMessages()) {
+    auto it = events.events.find(address);
+    if (it == events.events.end()) continue;
+    for (const cabana::Signal *sig : msg.getSignals()) {
+      sigs.push_back({sig, &it->second});
+    }
+    max_events = std::max(max_events, it->second.size());
+  }
+  if (sigs.empty()) {
+    fprintf(stderr, "no events of messages in %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<double> before(max_events), per_event(max_events), batch(max_events);
+  uint64_t decodes = 0, before_ns = 0, per_event_ns = 0, batch_ns = 0;
+  for (auto &[sig, sig_events] : sigs) {
+    const size_t n = sig_events->size();
+    decodes += n;
+
+    uint64_t start = nanos_since_boot();
+    for (size_t i = 0; i < n; ++i) {
+      const CanEvent *e = (*sig_events)[i];
+      if (!legacy_value(*sig, e->dat, e->size, &before[i])) before[i] = NAN;
+    }
+    before_ns += nanos_since_boot() - start;
+
+    start = nanos_since_boot();
+    for (size_t i = 0; i < n; ++i) {
+      const CanEvent *e = (*sig_events)[i];
+      if (!sig->getValue(e->dat, e->size, &per_event[i])) per_event[i] = NAN;
+    }
+    per_event_ns += nanos_since_boot() - start;
+
+    start = nanos_since_boot();
+    sig->getValues(sig_events->data(), n, batch.data());
+    batch_ns += nanos_since_boot() - start;
+
+    for (size_t i = 0; i < n; ++i) {
+      if (!(before[i] == per_event[i] && before[i] == batch[i]) && !(std::isnan(before[i]) && std::isnan(per_event[i]) && std::isnan(batch[i]))) {
+        fprintf(stderr, "%s: %f, %f and %f differ at event %zu\n", qPrintable(sig->name), before[i], per_event[i], batch[i], i);
+        return 1;
+      }
+    }
+  }
+
+  printf("%zu events, %zu signals, %lu decodes\n", events.count, sigs.size(), decodes);
+  const std::pair<const char *, uint64_t> results[] = {{"bit by bit", before_ns}, {"per event", per_event_ns}, {"batch", batch_ns}};
+  for (auto &[name, ns] : results) {
+    printf("%-10s %8.1f ms %6.2f ns/decode\n", name, ns * 1e-6, double(ns) / decodes);
+  }
+  return 0;
+}
@@ -1,9 +1,16 @@
 
 #undef INFO
+#include <cmath>
+#include <memory>
+#include <random>
+
 #include <QDir>
 
 #include "catch2/catch.hpp"
 #include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/streams/abstractstream.h"
+#include "tools/cabana/tools/bitplanes.h"
+#include "tools/cabana/utils/util.h"
 
 const std::string TEST_RLOG_URL = "https://commadataci.blob.core.windows.net/openpilotci/0c94aa1e1296d7c6/2021-05-05--19-48-37/0/rlog.bz2";
 
@@ -155,3 +162,115 @@ TEST_CASE("parse_opendbc") {
   INFO(errors.join("\n").toStdString());
   REQUIRE(errors.empty());
 }
+
+TEST_CASE("MinMaxPyramid") {
+  std::vector<QPointF> vals;
+  MinMaxPyramid pyramid;
+  for (int i = 0; i < 10000; ++i) {
+    vals.emplace_back(i, (i * 7919) % 1000);
+    // build incrementally as the events are merged
+    if (i % 100 == 99) pyramid.update(vals, i - 99);
+  }
+
+  auto [first, last] = GENERATE(std::make_pair(0, 10000), std::make_pair(5, 7), std::make_pair(13, 9001), std::make_pair(4096, 8192));
+  auto [min, max] = pyramid.minmax(vals, first, last);
+  auto [min_it, max_it] = std::minmax_element(vals.begin() + first, vals.begin() + last,
+                                              [](auto &l, auto &r) { return l.y() < r.y(); });
+  REQUIRE(min == min_it->y());
+  REQUIRE(max == max_it->y());
+
+  std::vector<QPointF> points;
+  pyramid.decimate(vals, first, last, 200, points);
+  REQUIRE(points.size() <= 200);
+  REQUIRE(std::is_sorted(points.begin(), points.end(), [](auto &l, auto &r) { return l.x() < r.x(); }));
+  REQUIRE(std::any_of(points.begin(), points.end(), [&](auto &p) { return p.y() == min; }));
+  REQUIRE(std::any_of(points.begin(), points.end(), [&](auto &p) { return p.y() == max; }));
+}
+
+TEST_CASE("Signal::getRawValue") {
+  std::mt19937 gen(0);
+  for (int i = 0; i < 100000; ++i) {
+    cabana::Signal sig = {};
+    sig.is_little_endian = gen() % 2;
+    sig.is_signed = gen() % 2;
+    sig.size = 1 + gen() % 64;
+    sig.start_bit = gen() % 512;
+    updateMsbLsb(sig);
+    if (sig.lsb < 0 || sig.msb >= 512) continue;
+
+    uint8_t dat[64];
+    std::generate(std::begin(dat), std::end(dat), [&]() { return gen(); });
+    const size_t size = 1 + gen() % 64;
+    cabana::Signal bytewise = sig;
+    bytewise.last_byte = INT_MAX;
+    REQUIRE(sig.getRawValue(dat, size) == bytewise.getRawValue(dat, size));
+  }
+}
+
+TEST_CASE("Signal::getValues") {
+  DBCFile file("", R"(
+BO_ 162 message_1: 8 XXX
+  SG_ mux M : 0|2@1+ (1,0) [0|3] "" XXX
+  SG_ little m1 : 4|12@1- (0.5,3) [0|4095] "" XXX
+  SG_ big : 23|20@0+ (1,-7) [0|65535] "" XXX
+)");
+  const cabana::Msg *msg = file.msg(162);
+  REQUIRE(msg != nullptr);
+
+  std::mt19937 gen(0);
+  std::vector<std::unique_ptr<uint8_t[]>> storage;
+  std::vector<const CanEvent *> events;
+  for (int i = 0; i < 1000; ++i) {
+    const uint8_t size = gen() % 9;
+    auto &buf = storage.emplace_back(new uint8_t[sizeof(CanEvent) + size]);
+    CanEvent *e = (CanEvent *)buf.get();
+    e->size = size;
+    std::generate(e->dat, e->dat + size, [&]() { return gen(); });
+    events.push_back(e);
+  }
+
+  std::vector<double> values(events.size());
+  for (const cabana::Signal *sig : msg->getSignals()) {
+    sig->getValues(events.data(), events.size(), values.data());
+    for (size_t i = 0; i < events.size(); ++i) {
+      double value = 0;
+      if (sig->getValue(events[i]->dat, events[i]->size, &value)) {
+        REQUIRE(values[i] == value);
+      } else {
+        REQUIRE(std::isnan(values[i]));
+      }
+    }
+  }
+}
+
+TEST_CASE("findSimilarBits") {
+  std::vector<std::vector<uint8_t>> storage;
+  auto make_events = [&](uint64_t begin, uint64_t end, auto dat) {
+    std::vector<const CanEvent *> events;
+    for (uint64_t t = begin; t < end; ++t) {
+      auto &buf = storage.emplace_back(sizeof(CanEvent) + 1);
+      CanEvent *e = (CanEvent *)buf.data();
+      e->src = 0;
+      e->address = 0x100;
+      e->mono_time = t;
+      e->size = 1;
+      e->dat[0] = dat(t);
+      events.push_back(e);
+    }
+    return events;
+  };
+  auto src = make_events(100, 200, [](uint64_t t) { return t % 2 ? 0x80 : 0; });
+
+  // bit 0 of byte 0 follows the source bit, the others don't
+  auto target = make_events(0, 200, [](uint64_t t) { return t % 2 ? 0x80 : 0x7F; });
+  auto result = findSimilarBits(src, 0, 0, {.source = 0, .address = 0x200}, target, true, 10);
+  REQUIRE(result.size() == 1);
+  REQUIRE(result[0].bit_idx == 0);
+  REQUIRE(result[0].mismatches == 0);
+  // only the events after the source bit was seen are compared
+  REQUIRE(result[0].total == 100);
+
+  // a target with no events after the source's first is not similar
+  auto before = make_events(0, 100, [](uint64_t t) { return 0; });
+  REQUIRE(findSimilarBits(src, 0, 0, {.source = 0, .address = 0x300}, before, true, 10).empty());
+}
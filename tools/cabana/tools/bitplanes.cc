@@ -0,0 +1,139 @@
+#include "tools/cabana/tools/bitplanes.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct CacheEntry {
+  size_t count = 0;
+  uint64_t first_mono_time = 0;
+  uint64_t last_mono_time = 0;
+  std::shared_ptr<const BitPlanes> planes;
+};
+
+std::mutex cache_lock;
+std::unordered_map<MessageId, CacheEntry> cache;
+
+// Transpose an 8x8 bit matrix where byte r is row r and bit c is column c.
+inline uint64_t transpose8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+  return x;
+}
+
+std::shared_ptr<const BitPlanes> buildBitPlanes(const std::vector<const CanEvent *> &events) {
+  auto p = std::make_shared<BitPlanes>();
+  p->count = events.size();
+  for (const CanEvent *e : events) {
+    p->size = std::max<int>(p->size, e->size);
+  }
+  p->bits.assign(p->size * 8, std::vector<uint64_t>(p->words(), 0));
+  p->present.assign(p->size, std::vector<uint64_t>(p->words(), 0));
+
+  // Gather one byte of 8 consecutive events into a word and transpose it,
+  // which turns it into the 8 bits of the byte for those events.
+  for (size_t k = 0; k < p->count; k += 8) {
+    const size_t n = std::min<size_t>(8, p->count - k);
+    const size_t word = k / 64, shift = k % 64;
+    for (int i = 0; i < p->size; ++i) {
+      uint64_t rows = 0, present = 0;
+      for (size_t r = 0; r < n; ++r) {
+        const CanEvent *e = events[k + r];
+        if (i < e->size) {
+          rows |= (uint64_t)e->dat[i] << (r * 8);
+          present |= 1ULL << r;
+        }
+      }
+      p->present[i][word] |= present << shift;
+      const uint64_t cols = transpose8(rows);
+      for (int j = 0; j < 8; ++j) {
+        p->bits[i * 8 + j][word] |= ((cols >> ((7 - j) * 8)) & 0xFF) << shift;
+      }
+    }
+  }
+  return p;
+}
+
+}  // namespace
+
+std::shared_ptr<const BitPlanes> BitPlanes::get(const MessageId &id, const std::vector<const CanEvent *> &events) {
+  {
+    std::lock_guard lk(cache_lock);
+    auto it = cache.find(id);
+    if (it != cache.end() && it->second.count == events.size() &&
+        (events.empty() || (it->second.first_mono_time == events.front()->mono_time &&
+                            it->second.last_mono_time == events.back()->mono_time))) {
+      return it->second.planes;
+    }
+  }
+
+  auto planes = buildBitPlanes(events);
+  std::lock_guard lk(cache_lock);
+  cache[id] = {.count = events.size(),
+               .first_mono_time = events.empty() ? 0 : events.front()->mono_time,
+               .last_mono_time = events.empty() ? 0 : events.back()->mono_time,
+               .planes = planes};
+  return planes;
+}
+
+void BitPlanes::clearCache() {
+  std::lock_guard lk(cache_lock);
+  cache.clear();
+}
+
+std::vector<SimilarBit> findSimilarBits(const std::vector<const CanEvent *> &src_events, int byte_idx, int bit_idx,
+                                        const MessageId &target, const std::vector<const CanEvent *> &target_events,
+                                        bool equal, int min_msgs_cnt) {
+  if (target_events.size() <= min_msgs_cnt) return {};
+
+  // The value of the source bit at the time of each target event, and whether it was seen yet.
+  const size_t words = (target_events.size() + 63) / 64;
+  std::vector<uint64_t> ref(words, 0), has_ref(words, 0);
+  auto src_it = src_events.cbegin();
+  int bit_to_find = -1;
+  for (size_t k = 0; k < target_events.size(); ++k) {
+    for (; src_it != src_events.cend() && (*src_it)->mono_time <= target_events[k]->mono_time; ++src_it) {
+      if ((*src_it)->size > byte_idx) {
+        bit_to_find = ((*src_it)->dat[byte_idx] >> (7 - bit_idx)) & 1;
+      }
+    }
+    if (bit_to_find != -1) {
+      has_ref[k / 64] |= 1ULL << (k % 64);
+      ref[k / 64] |= (uint64_t)bit_to_find << (k % 64);
+    }
+  }
+
+  auto planes = BitPlanes::get(target, target_events);
+  if (planes->count != target_events.size()) return {};
+
+  std::vector<SimilarBit> result;
+  for (int i = 0; i < planes->size; ++i) {
+    // only the events having the byte, after the source bit was seen, are compared
+    const auto &present = planes->present[i];
+    uint32_t cnt = 0;
+    for (size_t w = 0; w < words; ++w) {
+      cnt += __builtin_popcountll(present[w] & has_ref[w]);
+    }
+    if (cnt == 0) continue;
+
+    for (int j = 0; j < 8; ++j) {
+      const auto &bits = planes->bits[i * 8 + j];
+      uint32_t mismatches = 0;
+      for (size_t w = 0; w < words; ++w) {
+        const uint64_t diff = bits[w] ^ ref[w];
+        mismatches += __builtin_popcountll((equal ? diff : ~diff) & present[w] & has_ref[w]);
+      }
+      if (float perc = (mismatches / (double)cnt) * 100; perc < 50) {
+        result.push_back({target.address, (uint32_t)i, (uint32_t)j, mismatches, cnt, perc});
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "tools/cabana/dbc/dbc.h"
+#include "tools/cabana/streams/abstractstream.h"
+
+// The bits of a message over time. Plane (byte, bit) holds that bit of every event packed
+// into 64-bit words, so that a bit can be compared against all events at once with popcount.
+// Bits are indexed MSB first within a byte, the same as the bit index shown in cabana.
+struct BitPlanes {
+  size_t count = 0;
+  int size = 0;
+  std::vector<std::vector<uint64_t>> bits;     // [byte * 8 + bit]
+  std::vector<std::vector<uint64_t>> present;  // [byte], set if the event is long enough to have the byte
+  inline size_t words() const { return (count + 63) / 64; }
+
+  // Returns the planes of a message, building them if its events changed since the last call.
+  static std::shared_ptr<const BitPlanes> get(const MessageId &id, const std::vector<const CanEvent *> &events);
+  static void clearCache();
+};
+
+struct SimilarBit {
+  uint32_t address, byte_idx, bit_idx, mismatches, total;
+  float perc;
+};
+
+// Compare every bit of |target| with the bit (byte_idx, bit_idx) of |src|, holding the last seen
+// value of the source bit. Bits mismatching (or matching, if !equal) in less than half of
+// the events compared are returned, which are the events having the byte after the source
+// bit was first seen. Messages with no more than min_msgs_cnt events are skipped.
+std::vector<SimilarBit> findSimilarBits(const std::vector<const CanEvent *> &src_events, int byte_idx, int bit_idx,
+                                        const MessageId &target, const std::vector<const CanEvent *> &target_events,
+                                        bool equal, int min_msgs_cnt);
@@ -1,11 +1,13 @@
 #include "tools/cabana/tools/findsignal.h"
 
+#include <map>
+#include <numeric>
+
 #include <QFormLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
 #include <QMenu>
 #include <QtConcurrent>
-#include <QTimer>
 #include <QVBoxLayout>
 
 // FindSignalModel
@@ -28,31 +30,71 @@ QVariant FindSignalModel::data(const QModelIndex &index, int role) const {
   return {};
 }
 
-void FindSignalModel::search(std::function<bool(double)> cmp) {
-  beginResetModel();
-
-  std::mutex lock;
+QFuture<void> FindSignalModel::search(std::function<bool(double)> cmp) {
   const auto prev_sigs = !histories.isEmpty() ? histories.back() : initial_signals;
-  filtered_signals.clear();
-  filtered_signals.reserve(prev_sigs.size());
-  QtConcurrent::blockingMap(prev_sigs, [&](auto &s) {
-    const auto &events = can->events(s.id);
-    auto first = std::upper_bound(events.cbegin(), events.cend(), s.mono_time, CompareCanEvent());
+  std::map<MessageId, size_t> job_index;
+  jobs.clear();
+  events_pin = can->pinEvents();
+  for (const auto &s : prev_sigs) {
+    auto [it, inserted] = job_index.try_emplace(s.id, jobs.size());
+    if (inserted) {
+      jobs.push_back({.id = s.id, .events = can->events(s.id)});
+    }
+    jobs[it->second].sigs.push_back(s);
+  }
+
+  const double route_start_time = can->routeStartTime();
+  return QtConcurrent::map(jobs, [=, last_time = last_time](SearchJob &job) {
+    const auto &events = job.events;
+    const auto &sigs = job.sigs;
     auto last = events.cend();
     if (last_time < std::numeric_limits<uint64_t>::max()) {
       last = std::upper_bound(events.cbegin(), events.cend(), last_time, CompareCanEvent());
     }
 
-    auto it = std::find_if(first, last, [&](const CanEvent *e) { return cmp(get_raw_value(e->dat, e->size, s.sig)); });
-    if (it != last) {
-      auto values = s.values;
-      values += QString("(%1, %2)").arg((*it)->mono_time / 1e9 - can->routeStartTime(), 0, 'f', 2).arg(get_raw_value((*it)->dat, (*it)->size, s.sig));
-      std::lock_guard lk(lock);
-      filtered_signals.push_back({.id = s.id, .mono_time = (*it)->mono_time, .sig = s.sig, .values = values});
+    uint64_t first_time = std::numeric_limits<uint64_t>::max();
+    for (const auto &s : sigs) {
+      first_time = std::min(first_time, s.mono_time);
+    }
+
+    // each candidate matches at the first event after its previous match
+    std::vector<int> pending(sigs.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    std::vector<const CanEvent *> matched(sigs.size(), nullptr);
+    auto first = std::upper_bound(events.cbegin(), last, first_time, CompareCanEvent());
+    for (auto it = first; it != last && !pending.empty(); ++it) {
+      const CanEvent *e = *it;
+      pending.erase(std::remove_if(pending.begin(), pending.end(), [&](int i) {
+        if (e->mono_time > sigs[i].mono_time && cmp(get_raw_value(e->dat, e->size, sigs[i].sig))) {
+          matched[i] = e;
+          return true;
+        }
+        return false;
+      }), pending.end());
+    }
+
+    for (int i = 0; i < sigs.size(); ++i) {
+      if (const CanEvent *e = matched[i]) {
+        const auto &s = sigs[i];
+        auto values = s.values;
+        values += QString("(%1, %2)").arg(e->mono_time / 1e9 - route_start_time, 0, 'f', 2).arg(get_raw_value(e->dat, e->size, s.sig));
+        job.matches.push_back({.id = s.id, .mono_time = e->mono_time, .sig = s.sig, .values = values});
+      }
     }
   });
-  histories.push_back(filtered_signals);
+}
 
+void FindSignalModel::searchFinished(bool canceled) {
+  beginResetModel();
+  if (!canceled) {
+    filtered_signals.clear();
+    for (const auto &job : jobs) {
+      filtered_signals += job.matches;
+    }
+    histories.push_back(filtered_signals);
+  }
+  jobs.clear();
+  events_pin.reset();
   endResetModel();
 }
 
@@ -155,9 +197,14 @@ FindSignalDlg::FindSignalDlg(QWidget *parent) : QDialog(parent, Qt::WindowFlags(
   main_layout->addLayout(hlayout);
   main_layout->addWidget(find_group);
   main_layout->addWidget(stats_label = new QLabel());
+  main_layout->addWidget(progress_bar = new QProgressBar());
+  progress_bar->setVisible(false);
 
   setMinimumSize({700, 650});
   QObject::connect(search_btn, &QPushButton::clicked, this, &FindSignalDlg::search);
+  QObject::connect(&watcher, &QFutureWatcher<void>::progressRangeChanged, progress_bar, &QProgressBar::setRange);
+  QObject::connect(&watcher, &QFutureWatcher<void>::progressValueChanged, progress_bar, &QProgressBar::setValue);
+  QObject::connect(&watcher, &QFutureWatcher<void>::finished, this, &FindSignalDlg::searchFinished);
   QObject::connect(undo_btn, &QPushButton::clicked, model, &FindSignalModel::undo);
   QObject::connect(model, &QAbstractItemModel::modelReset, this, &FindSignalDlg::modelReset);
   QObject::connect(reset_btn, &QPushButton::clicked, model, &FindSignalModel::reset);
@@ -171,7 +218,16 @@ FindSignalDlg::FindSignalDlg(QWidget *parent) : QDialog(parent, Qt::WindowFlags(
   });
 }
 
+FindSignalDlg::~FindSignalDlg() {
+  watcher.cancel();
+  watcher.waitForFinished();
+}
+
 void FindSignalDlg::search() {
+  if (watcher.isRunning()) {
+    watcher.cancel();
+    return;
+  }
   if (model->histories.isEmpty()) {
     setInitialSignals();
   }
@@ -189,10 +245,17 @@ void FindSignalDlg::search() {
   }
   properties_group->setEnabled(false);
   message_group->setEnabled(false);
-  search_btn->setEnabled(false);
+  undo_btn->setEnabled(false);
+  reset_btn->setEnabled(false);
   stats_label->setVisible(false);
-  search_btn->setText("Finding ....");
-  QTimer::singleShot(0, this, [=]() { model->search(cmp); });
+  progress_bar->setVisible(true);
+  search_btn->setText(tr("Cancel"));
+  watcher.setFuture(model->search(cmp));
+}
+
+void FindSignalDlg::searchFinished() {
+  progress_bar->setVisible(false);
+  model->searchFinished(watcher.isCanceled());
 }
 
 void FindSignalDlg::setInitialSignals() {
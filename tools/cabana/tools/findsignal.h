@@ -3,14 +3,19 @@
 #include <algorithm>
 #include <limits>
 
+#include <vector>
+
 #include <QAbstractTableModel>
 #include <QCheckBox>
+#include <QFutureWatcher>
 #include <QLabel>
+#include <QProgressBar>
 #include <QPushButton>
 #include <QTableView>
 
 #include "tools/cabana/commands.h"
 #include "tools/cabana/settings.h"
+#include "tools/cabana/streams/abstractstream.h"
 
 class FindSignalModel : public QAbstractTableModel {
 public:
@@ -27,7 +32,8 @@ public:
   QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override { return 3; }
   int rowCount(const QModelIndex &parent = QModelIndex()) const override { return std::min(filtered_signals.size(), 300); }
-  void search(std::function<bool(double)> cmp);
+  QFuture<void> search(std::function<bool(double)> cmp);
+  void searchFinished(bool canceled);
   void reset();
   void undo();
 
@@ -35,18 +41,31 @@ public:
   QList<SearchSignal> initial_signals;
   QList<QList<SearchSignal>> histories;
   uint64_t last_time = std::numeric_limits<uint64_t>::max();
+
+private:
+  // candidates of the same message are searched together in one pass over its events
+  struct SearchJob {
+    MessageId id;
+    std::vector<const CanEvent *> events;
+    QList<SearchSignal> sigs;
+    QList<SearchSignal> matches;
+  };
+  std::vector<SearchJob> jobs;
+  std::shared_ptr<void> events_pin;
 };
 
 class FindSignalDlg : public QDialog {
   Q_OBJECT
 public:
   FindSignalDlg(QWidget *parent);
+  ~FindSignalDlg();
 
 signals:
   void openMessage(const MessageId &id);
 
 private:
   void search();
+  void searchFinished();
   void modelReset();
   void setInitialSignals();
   void customMenuRequested(const QPoint &pos);
@@ -60,5 +79,7 @@ private:
   QGroupBox *properties_group, *message_group;
   QTableView *view;
   QLabel *to_label, *stats_label;
+  QProgressBar *progress_bar;
   FindSignalModel *model;
+  QFutureWatcher<void> watcher;
 };
@@ -1,34 +1,47 @@
 #pragma once
 
+#include <vector>
+
 #include <QComboBox>
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QLineEdit>
+#include <QProgressBar>
 #include <QSpinBox>
 #include <QTableWidget>
 
 #include "tools/cabana/dbc/dbcmanager.h"
+#include "tools/cabana/tools/bitplanes.h"
 
 class FindSimilarBitsDlg : public QDialog {
   Q_OBJECT
 
 public:
   FindSimilarBitsDlg(QWidget *parent);
+  ~FindSimilarBitsDlg();
 
 signals:
   void openMessage(const MessageId &msg_id);
 
 private:
-  struct mismatched_struct {
-    uint32_t address, byte_idx, bit_idx, mismatches, total;
-    float perc;
+  struct SearchJob {
+    MessageId id;
+    std::vector<const CanEvent *> events;
+    std::vector<SimilarBit> result;
   };
-  QList<mismatched_struct> calcBits(uint8_t bus, uint32_t selected_address, int byte_idx, int bit_idx, uint8_t find_bus,
-                                    bool equal, int min_msgs_cnt);
   void find();
+  void searchFinished();
 
   QTableWidget *table;
   QComboBox *src_bus_combo, *find_bus_combo, *msg_cb, *equal_combo;
   QSpinBox *byte_idx_sb, *bit_idx_sb;
   QPushButton *search_btn;
   QLineEdit *min_msgs;
+  QProgressBar *progress_bar;
+
+  // the events are copied so that the search doesn't race with events merged by the stream
+  std::vector<const CanEvent *> src_events;
+  std::vector<SearchJob> jobs;
+  std::shared_ptr<void> events_pin;
+  QFutureWatcher<void> watcher;
 };
@@ -1,47 +1,340 @@
 #include "tools/cabana/utils/export.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
 #include <QFile>
-#include <QTextStream>
+#include <QFutureWatcher>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QThread>
+#include <QtConcurrent>
 
 #include "tools/cabana/streams/abstractstream.h"
 
 namespace utils {
 
-void exportToCSV(const QString &file_name, std::optional<MessageId> msg_id) {
-  QFile file(file_name);
-  if (file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
-    const uint64_t start_time = can->routeStartTime();
-    QTextStream stream(&file);
-    stream << "time,addr,bus,data\n";
-    for (auto e : msg_id ? can->events(*msg_id) : can->allEvents()) {
-      stream << QString::number((e->mono_time / 1e9) - start_time, 'f', 2) << ","
-             << "0x" << QString::number(e->address, 16) << "," << e->src << ","
-             << "0x" << QByteArray::fromRawData((const char *)e->dat, e->size).toHex().toUpper() << "\n";
+namespace {
+
+constexpr size_t EXPORT_CHUNK_SIZE = 16 * 1024;  // events
+
+struct Chunk {
+  size_t begin, end;
+  std::string out;
+};
+
+std::vector<Chunk> makeChunks(size_t begin, size_t end, size_t max_chunks) {
+  std::vector<Chunk> chunks;
+  for (size_t b = begin; b < end && chunks.size() < max_chunks; b += EXPORT_CHUNK_SIZE) {
+    chunks.push_back({b, std::min(b + EXPORT_CHUNK_SIZE, end)});
+  }
+  return chunks;
+}
+
+inline size_t batchSize() { return std::max(1, QThread::idealThreadCount()) * 2; }
+
+inline void appendFixed(std::string &s, double val, int precision) {
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf), "%.*f", precision, val);
+  s.append(buf, std::clamp<int>(n, 0, sizeof(buf) - 1));
+}
+
+template <class T>
+inline void appendInt(std::string &s, T val, int base = 10) {
+  char buf[32];
+  auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val, base);
+  s.append(buf, end);
+}
+
+inline void appendEventColumns(std::string &s, const CanEvent *e, double start_time) {
+  appendFixed(s, (e->mono_time / 1e9) - start_time, 2);
+  s += ",0x";
+  appendInt(s, e->address, 16);
+  s += ',';
+  appendInt(s, e->src);
+}
+
+inline void appendHex(std::string &s, const uint8_t *dat, int size) {
+  static constexpr char digits[] = "0123456789ABCDEF";
+  for (int i = 0; i < size; ++i) {
+    s += digits[dat[i] >> 4];
+    s += digits[dat[i] & 0xF];
+  }
+}
+
+// Formats the events in chunks on the thread pool and writes the chunks in order.
+// The next batch of chunks is formatted while the current one is being written.
+bool writeChunks(QFile &file, const std::vector<const CanEvent *> &events,
+                 const std::function<void(Chunk &)> &format_chunk, const ExportProgress &progress) {
+  std::array<std::vector<Chunk>, 2> batches;
+  int cur = 0;
+  batches[cur] = makeChunks(0, events.size(), batchSize());
+  QFuture<void> future = QtConcurrent::map(batches[cur], format_chunk);
+  while (!batches[cur].empty()) {
+    future.waitForFinished();
+    const int next = cur ^ 1;
+    batches[next] = makeChunks(batches[cur].back().end, events.size(), batchSize());
+    future = QtConcurrent::map(batches[next], format_chunk);
+
+    bool ok = true;
+    for (const auto &c : batches[cur]) {
+      ok = ok && file.write(c.out.data(), c.out.size()) == (qint64)c.out.size();
     }
+    if (!ok || (progress && !progress(batches[cur].back().end, events.size()))) {
+      future.cancel();
+      future.waitForFinished();
+      return false;
+    }
+    cur = next;
+  }
+  return true;
+}
+
+// Decodes the signals into one column per signal, after the time column.
+bool decodeColumns(const ExportSource &source, std::vector<std::vector<double>> &columns, const ExportProgress &progress) {
+  const auto &events = source.events;
+  const auto &sigs = source.msg->sigs;
+  columns.assign(sigs.size() + 1, std::vector<double>(events.size()));
+  auto decode_chunk = [&](Chunk &c) {
+    for (size_t i = c.begin; i < c.end; ++i) {
+      columns[0][i] = (events[i]->mono_time / 1e9) - source.route_start_time;
+    }
+    for (size_t j = 0; j < sigs.size(); ++j) {
+      sigs[j]->getValues(events.data() + c.begin, c.end - c.begin, columns[j + 1].data() + c.begin);
+    }
+  };
+
+  for (size_t begin = 0; begin < events.size();) {
+    auto chunks = makeChunks(begin, events.size(), batchSize());
+    QtConcurrent::blockingMap(chunks, decode_chunk);
+    begin = chunks.back().end;
+    if (progress && !progress(begin, events.size())) return false;
+  }
+  return true;
+}
+
+uint32_t crc32(uint32_t crc, const char *data, size_t size) {
+  static const auto table = []() {
+    std::array<uint32_t, 256> t;
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
   }
+  return ~crc;
 }
 
-void exportSignalsToCSV(const QString &file_name, const MessageId &msg_id) {
+template <class T>
+inline void putLE(std::string &s, T val) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    s += char((val >> (i * 8)) & 0xFF);
+  }
+}
+
+// Writes .npy arrays into an uncompressed zip archive, the same layout as numpy.savez.
+class NpzWriter {
+public:
+  NpzWriter(QFile &file) : file(file) {}
+
+  bool add(const QString &name, const std::vector<double> &values) {
+    std::string header = "{'descr': '<f8', 'fortran_order': False, 'shape': (" + std::to_string(values.size()) + ",), }";
+    // magic, version and header length take 10 bytes, the header ends with '\n' at a multiple of 64
+    header.append((64 - (10 + header.size() + 1) % 64) % 64, ' ');
+    header += '\n';
+    std::string npy("\x93NUMPY\x01\x00", 8);
+    putLE<uint16_t>(npy, header.size());
+    npy += header;
+
+    const char *data = (const char *)values.data();
+    const uint64_t data_size = values.size() * sizeof(double);
+    const uint64_t size = npy.size() + data_size;
+    const uint64_t offset = file.pos();
+    if (size > UINT32_MAX || offset > UINT32_MAX) return false;  // would require zip64
+
+    const uint32_t crc = crc32(crc32(0, npy.data(), npy.size()), data, data_size);
+    const QByteArray file_name = (name + ".npy").toUtf8();
+    auto put_entry_header = [&](std::string &s) {
+      putLE<uint16_t>(s, 0x0800);  // flags: utf-8 file name
+      putLE<uint16_t>(s, 0);       // method: stored
+      putLE<uint16_t>(s, 0);       // time
+      putLE<uint16_t>(s, 0x21);    // date: 1980-01-01
+      putLE<uint32_t>(s, crc);
+      putLE<uint32_t>(s, size);    // compressed size
+      putLE<uint32_t>(s, size);    // uncompressed size
+      putLE<uint16_t>(s, file_name.size());
+      putLE<uint16_t>(s, 0);       // extra field length
+    };
+
+    std::string local;
+    putLE<uint32_t>(local, 0x04034b50);
+    putLE<uint16_t>(local, 20);  // version needed
+    put_entry_header(local);
+    local.append(file_name.constData(), file_name.size());
+    local += npy;
+    if (file.write(local.data(), local.size()) != (qint64)local.size() ||
+        file.write(data, data_size) != (qint64)data_size) {
+      return false;
+    }
+
+    putLE<uint32_t>(central_dir, 0x02014b50);
+    putLE<uint16_t>(central_dir, 20);  // version made by
+    putLE<uint16_t>(central_dir, 20);  // version needed
+    put_entry_header(central_dir);
+    putLE<uint16_t>(central_dir, 0);  // comment length
+    putLE<uint16_t>(central_dir, 0);  // disk number
+    putLE<uint16_t>(central_dir, 0);  // internal attributes
+    putLE<uint32_t>(central_dir, 0);  // external attributes
+    putLE<uint32_t>(central_dir, offset);
+    central_dir.append(file_name.constData(), file_name.size());
+    ++entries;
+    return true;
+  }
+
+  bool finish() {
+    const uint64_t offset = file.pos();
+    if (offset > UINT32_MAX || entries > UINT16_MAX) return false;
+
+    std::string end = central_dir;
+    putLE<uint32_t>(end, 0x06054b50);
+    putLE<uint16_t>(end, 0);  // disk number
+    putLE<uint16_t>(end, 0);  // disk with the central directory
+    putLE<uint16_t>(end, entries);
+    putLE<uint16_t>(end, entries);
+    putLE<uint32_t>(end, central_dir.size());
+    putLE<uint32_t>(end, offset);
+    putLE<uint16_t>(end, 0);  // comment length
+    return file.write(end.data(), end.size()) == (qint64)end.size();
+  }
+
+private:
+  QFile &file;
+  std::string central_dir;
+  size_t entries = 0;
+};
+
+}  // namespace
+
+ExportSource::ExportSource(std::optional<MessageId> msg_id) : msg_id(msg_id) {
+  events_pin = can->pinEvents();
+  events = msg_id ? can->events(*msg_id) : can->allEvents();
+  if (msg_id) {
+    if (auto m = dbc()->msg(*msg_id)) {
+      msg = std::make_shared<cabana::Msg>(*m);
+    }
+  }
+  route_start_time = can->routeStartTime();
+}
+
+bool exportToCSV(const QString &file_name, const ExportSource &source, const ExportProgress &progress) {
+  QFile file(file_name);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+  file.write("time,addr,bus,data\n");
+  const auto &events = source.events;
+  return writeChunks(file, events, [&](Chunk &c) {
+    c.out.reserve((c.end - c.begin) * 64);
+    for (size_t i = c.begin; i < c.end; ++i) {
+      appendEventColumns(c.out, events[i], source.route_start_time);
+      c.out += ",0x";
+      appendHex(c.out, events[i]->dat, events[i]->size);
+      c.out += '\n';
+    }
+  }, progress);
+}
+
+bool exportSignalsToCSV(const QString &file_name, const ExportSource &source, const ExportProgress &progress) {
+  if (!source.msg || source.msg->sigs.empty()) return false;
+
   QFile file(file_name);
-  if (auto msg = dbc()->msg(msg_id); msg && msg->sigs.size() && file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
-    QTextStream stream(&file);
-    stream << "time,addr,bus";
-    for (auto s : msg->sigs)
-      stream << "," << s->name;
-    stream << "\n";
-
-    const uint64_t start_time = can->routeStartTime();
-    for (auto e : can->events(msg_id)) {
-      stream << QString::number((e->mono_time / 1e9) - start_time, 'f', 2) << ","
-             << "0x" << QString::number(e->address, 16) << "," << e->src;
-      for (auto s : msg->sigs) {
-        double value = 0;
-        s->getValue(e->dat, e->size, &value);
-        stream << "," << QString::number(value, 'f', s->precision);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+  std::string header = "time,addr,bus";
+  for (auto s : source.msg->sigs) {
+    header += "," + s->name.toStdString();
+  }
+  header += '\n';
+  file.write(header.data(), header.size());
+
+  const auto &events = source.events;
+  const auto &sigs = source.msg->sigs;
+  return writeChunks(file, events, [&](Chunk &c) {
+    // decode a column per signal, a multiplexed signal that isn't present is an empty cell
+    const size_t count = c.end - c.begin;
+    std::vector<double> values(sigs.size() * count);
+    for (size_t j = 0; j < sigs.size(); ++j) {
+      sigs[j]->getValues(events.data() + c.begin, count, values.data() + j * count);
+    }
+    c.out.reserve(count * (32 + sigs.size() * 8));
+    for (size_t i = 0; i < count; ++i) {
+      appendEventColumns(c.out, events[c.begin + i], source.route_start_time);
+      for (size_t j = 0; j < sigs.size(); ++j) {
+        c.out += ',';
+        if (double value = values[j * count + i]; !std::isnan(value)) {
+          appendFixed(c.out, value, sigs[j]->precision);
+        }
       }
-      stream << "\n";
+      c.out += '\n';
     }
+  }, progress);
+}
+
+bool exportSignalsToNpz(const QString &file_name, const ExportSource &source, const ExportProgress &progress) {
+  if (!source.msg || source.msg->sigs.empty()) return false;
+
+  std::vector<std::vector<double>> columns;
+  if (!decodeColumns(source, columns, progress)) return false;
+
+  QFile file(file_name);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+  NpzWriter npz(file);
+  bool ok = npz.add("time", columns[0]);
+  for (size_t i = 0; ok && i < source.msg->sigs.size(); ++i) {
+    ok = npz.add(source.msg->sigs[i]->name, columns[i + 1]);
   }
+  return ok && npz.finish();
+}
+
+void exportInBackground(QWidget *parent, const QString &file_name, std::function<bool(const ExportProgress &)> export_fn) {
+  // the dialog is modal so that the stream can't be closed while its events are being exported,
+  // and export_fn holds an ExportSource, which keeps them from being evicted.
+  auto dlg = new QProgressDialog(QObject::tr("Exporting to %1...").arg(file_name), QObject::tr("&Cancel"), 0, 100, parent);
+  dlg->setWindowModality(Qt::WindowModal);
+  dlg->setMinimumDuration(0);
+  dlg->setAutoClose(false);
+  dlg->setValue(0);
+
+  auto canceled = std::make_shared<std::atomic<bool>>(false);
+  QObject::connect(dlg, &QProgressDialog::canceled, [canceled]() { *canceled = true; });
+
+  auto watcher = new QFutureWatcher<bool>(dlg);
+  QObject::connect(watcher, &QFutureWatcher<bool>::finished, dlg, [=]() {
+    const bool success = watcher->result();
+    dlg->deleteLater();
+    if (!success && !*canceled) {
+      QMessageBox::warning(parent, QObject::tr("Export"), QObject::tr("Failed to export to %1").arg(file_name));
+    }
+  });
+  watcher->setFuture(QtConcurrent::run([=]() {
+    return export_fn([=](size_t done, size_t total) {
+      QMetaObject::invokeMethod(dlg, [=]() { dlg->setValue(total > 0 ? done * 100 / total : 100); }, Qt::QueuedConnection);
+      return !*canceled;
+    });
+  }));
 }
 
 }  // namespace utils
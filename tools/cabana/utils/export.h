@@ -1,10 +1,39 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <optional>
+#include <vector>
+
+#include <QWidget>
 
 #include "tools/cabana/dbc/dbcmanager.h"
 
+struct CanEvent;
+
 namespace utils {
-void exportToCSV(const QString &file_name, std::optional<MessageId> msg_id = std::nullopt);
-void exportSignalsToCSV(const QString &file_name, const MessageId &msg_id);
+
+// Called from the exporting thread with the number of events done. Return false to cancel the export.
+using ExportProgress = std::function<bool(size_t done, size_t total)>;
+
+// A snapshot of the events and the message definition to export. It must be taken in the
+// thread owning the stream, after which the export can run in any thread. The events are
+// pinned in the stream as long as the snapshot or a copy of it is alive.
+struct ExportSource {
+  ExportSource(std::optional<MessageId> msg_id = std::nullopt);
+  std::optional<MessageId> msg_id;
+  std::vector<const CanEvent *> events;
+  std::shared_ptr<void> events_pin;
+  std::shared_ptr<const cabana::Msg> msg;
+  double route_start_time = 0;
+};
+
+bool exportToCSV(const QString &file_name, const ExportSource &source, const ExportProgress &progress = nullptr);
+bool exportSignalsToCSV(const QString &file_name, const ExportSource &source, const ExportProgress &progress = nullptr);
+// Writes a NumPy .npz archive with a "time" column and one float64 column per signal.
+// Values of multiplexed signals are NaN in the events where they are not present.
+bool exportSignalsToNpz(const QString &file_name, const ExportSource &source, const ExportProgress &progress = nullptr);
+
+// Runs export_fn in a background thread with a cancellable progress dialog.
+void exportInBackground(QWidget *parent, const QString &file_name, std::function<bool(const ExportProgress &)> export_fn);
 }  // namespace utils
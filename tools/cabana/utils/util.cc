@@ -16,37 +16,92 @@
 
 #include "selfdrive/ui/qt/util.h"
 
-// SegmentTree
-
-void SegmentTree::build(const std::vector<QPointF> &arr) {
-  size = arr.size();
-  tree.resize(4 * size);  // size of the tree is 4 times the size of the array
-  if (size > 0) {
-    build_tree(arr, 1, 0, size - 1);
+// MinMaxPyramid
+
+void MinMaxPyramid::update(const std::vector<QPointF> &vals, size_t from) {
+  auto merge = [](Bucket &b, const Bucket &child, bool first) {
+    if (first || child.min.y() < b.min.y()) b.min = child.min;
+    if (first || child.max.y() > b.max.y()) b.max = child.max;
+  };
+
+  size_t size = vals.size();
+  for (size_t n = 0; size > 1; ++n) {
+    const size_t level_size = (size + FACTOR - 1) / FACTOR;
+    if (levels_.size() <= n) levels_.emplace_back();
+    auto &level = levels_[n];
+    level.resize(level_size);
+
+    from /= FACTOR;
+    for (size_t i = from; i < level_size; ++i) {
+      const size_t end = std::min(size, (i + 1) * FACTOR);
+      for (size_t j = i * FACTOR; j < end; ++j) {
+        merge(level[i], n == 0 ? Bucket{vals[j], vals[j]} : levels_[n - 1][j], j == i * FACTOR);
+      }
+    }
+    size = level_size;
   }
+  // drop levels left over from a longer series
+  size_t num_levels = 0;
+  for (size_t n = vals.size(); n > 1; n = (n + FACTOR - 1) / FACTOR) ++num_levels;
+  levels_.resize(num_levels);
 }
 
-void SegmentTree::build_tree(const std::vector<QPointF> &arr, int n, int left, int right) {
-  if (left == right) {
-    const double y = arr[left].y();
-    tree[n] = {y, y};
-  } else {
-    const int mid = (left + right) >> 1;
-    build_tree(arr, 2 * n, left, mid);
-    build_tree(arr, 2 * n + 1, mid + 1, right);
-    tree[n] = {std::min(tree[2 * n].first, tree[2 * n + 1].first), std::max(tree[2 * n].second, tree[2 * n + 1].second)};
+std::pair<double, double> MinMaxPyramid::minmax(const std::vector<QPointF> &vals, size_t first, size_t last) const {
+  double min = std::numeric_limits<double>::max();
+  double max = std::numeric_limits<double>::lowest();
+  auto take = [&](size_t n, size_t i) {
+    const Bucket &b = n == 0 ? Bucket{vals[i], vals[i]} : levels_[n - 1][i];
+    min = std::min(min, b.min.y());
+    max = std::max(max, b.max.y());
+  };
+
+  last = std::min(last, vals.size());
+  for (size_t n = 0; first < last; ++n) {
+    // walk the unaligned ends at this level, then continue one level up
+    if (n == levels_.size() || last - first < FACTOR * 2) {
+      for (size_t i = first; i < last; ++i) take(n, i);
+      break;
+    }
+    for (; first % FACTOR != 0; ++first) take(n, first);
+    for (; last % FACTOR != 0; --last) take(n, last - 1);
+    first /= FACTOR;
+    last /= FACTOR;
   }
+  return {min, max};
 }
 
-std::pair<double, double> SegmentTree::get_minmax(int n, int left, int right, int range_left, int range_right) const {
-  if (range_left > right || range_right < left)
-    return {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
-  if (range_left <= left && range_right >= right)
-    return tree[n];
-  int mid = (left + right) >> 1;
-  auto l = get_minmax(2 * n, left, mid, range_left, range_right);
-  auto r = get_minmax(2 * n + 1, mid + 1, right, range_left, range_right);
-  return {std::min(l.first, r.first), std::max(l.second, r.second)};
+void MinMaxPyramid::decimate(const std::vector<QPointF> &vals, size_t first, size_t last, size_t max_points,
+                             std::vector<QPointF> &out) const {
+  last = std::min(last, vals.size());
+  if (first >= last) return;
+
+  // raw points are emitted as is, buckets emit two points each
+  size_t n = 0, scale = 1;
+  while (n < levels_.size() && (last - first) * (n == 0 ? 1 : 2) / scale > max_points) {
+    ++n;
+    scale *= FACTOR;
+  }
+
+  if (n == 0) {
+    out.insert(out.end(), vals.begin() + first, vals.begin() + last);
+    return;
+  }
+
+  const auto &level = levels_[n - 1];
+  const size_t end = std::min(level.size(), (last + scale - 1) / scale);
+  out.reserve(out.size() + (end - first / scale) * 2);
+  for (size_t i = first / scale; i < end; ++i) {
+    const auto &b = level[i];
+    if (b.min == b.max) {
+      out.push_back(b.min);
+    } else if (b.min.x() < b.max.x()) {
+      out.push_back(b.min);
+      out.push_back(b.max);
+    } else {
+      out.push_back(b.max);
+      out.push_back(b.min);
+    }
+  }
 }
 
 // MessageBytesDelegate
@@ -52,17 +52,27 @@ enum {
   BytesRole = Qt::UserRole + 2
 };
 
-class SegmentTree {
+// Multi-resolution min/max summary of a series sorted by x. Each level groups FACTOR
+// entries of the level below and keeps the points with the lowest and the highest y.
+class MinMaxPyramid {
 public:
-  SegmentTree() = default;
-  void build(const std::vector<QPointF> &arr);
-  inline std::pair<double, double> minmax(int left, int right) const { return get_minmax(1, 0, size - 1, left, right); }
+  MinMaxPyramid() = default;
+  // Rebuild the summary of the points from index |from| to the end of |vals|.
+  void update(const std::vector<QPointF> &vals, size_t from = 0);
+  // The min and max y value of the points in [first, last).
+  std::pair<double, double> minmax(const std::vector<QPointF> &vals, size_t first, size_t last) const;
+  // Append the points in [first, last) to |out|, reduced to about |max_points| points
+  // by picking the coarsest level that still has enough resolution.
+  void decimate(const std::vector<QPointF> &vals, size_t first, size_t last, size_t max_points, std::vector<QPointF> &out) const;
 
 private:
-  std::pair<double, double> get_minmax(int n, int left, int right, int range_left, int range_right) const;
-  void build_tree(const std::vector<QPointF> &arr, int n, int left, int right);
-  std::vector<std::pair<double, double>> tree;
-  int size = 0;
+  struct Bucket {
+    QPointF min;
+    QPointF max;
+  };
+  static constexpr size_t FACTOR = 4;
+  // levels_[n] has one bucket for every FACTOR^(n+1) points.
+  std::vector<std::vector<Bucket>> levels_;
 };
 
 class MessageBytesDelegate : public QStyledItemDelegate {
@@ -2,6 +2,7 @@
 #include <QCommandLineParser>
 
 #include "common/prefix.h"
+#include "msgq/ipc.h"
 #include "tools/replay/consoleui.h"
 #include "tools/replay/replay.h"
 
@@ -22,7 +23,9 @@ int main(int argc, char *argv[]) {
       {"no-hw-decoder", REPLAY_FLAG_NO_HW_DECODER, "disable HW video decoding"},
       {"no-vipc", REPLAY_FLAG_NO_VIPC, "do not output video"},
       {"all", REPLAY_FLAG_ALL_SERVICES, "do output all messages including uiDebug, userFlag"
-                                        ". this may causes issues when used along with UI"}
+                                        ". this may causes issues when used along with UI"},
+      {"lockstep", REPLAY_FLAG_LOCKSTEP, "publish each message once all subscribers have read the previous one"
+                                         ", as fast as possible and without video. exits at the end of the route"}
   };
 
   QCommandLineParser parser;
@@ -58,6 +61,14 @@ int main(int argc, char *argv[]) {
       replay_flags |= flag;
     }
   }
+  if (replay_flags & REPLAY_FLAG_LOCKSTEP) {
+    // waiting for the readers needs the reader count of msgq
+    if (messaging_use_zmq()) {
+      rError("--lockstep is not supported with the ZMQ backend");
+      return 1;
+    }
+    replay_flags |= REPLAY_FLAG_NO_VIPC | REPLAY_FLAG_NO_LOOP;
+  }
 
   std::unique_ptr<OpenpilotPrefix> op_prefix;
   auto prefix = parser.value("prefix");
@@ -77,6 +88,16 @@ int main(int argc, char *argv[]) {
     return 0;
   }
 
+  if (replay_flags & REPLAY_FLAG_LOCKSTEP) {
+    LockstepStats stats;
+    bool ret = replay->runLockstep(parser.value("start").toInt(), &stats);
+    rInfo("published %lu messages in %.2f s: %.0f msgs/s, %.1fx realtime, %lu reader stalls",
+          stats.messages, stats.wall_seconds, stats.messages / std::max(stats.wall_seconds, 1e-9),
+          stats.route_seconds / std::max(stats.wall_seconds, 1e-9), stats.stalls);
+    delete replay;
+    return ret ? 0 : 1;
+  }
+
   ConsoleUI console_ui(replay);
   replay->start(parser.value("start").toInt());
   return app.exec();
@@ -4,6 +4,8 @@
 #include <QtConcurrent>
 #include <capnp/dynamic.h>
 #include <csignal>
+#include <future>
+#include <thread>
 #include "cereal/services.h"
 #include "common/params.h"
 #include "common/timing.h"
@@ -345,21 +347,7 @@ void Replay::startStream(const Segment *cur_segment) {
     }
   }
 
-  // write CarParams
-  it = std::find_if(events.begin(), events.end(), [](const Event &e) { return e.which == cereal::Event::Which::CAR_PARAMS; });
-  if (it != events.end()) {
-    capnp::FlatArrayMessageReader reader(it->data);
-    auto event = reader.getRoot<cereal::Event>();
-    car_fingerprint_ = event.getCarParams().getCarFingerprint();
-    capnp::MallocMessageBuilder builder;
-    builder.setRoot(event.getCarParams());
-    auto words = capnp::messageToFlatArray(builder);
-    auto bytes = words.asBytes();
-    Params().put("CarParams", (const char *)bytes.begin(), bytes.size());
-    Params().put("CarParamsPersistent", (const char *)bytes.begin(), bytes.size());
-  } else {
-    rWarning("failed to read CarParams from current segment");
-  }
+  writeCarParams(events);
 
   // start camera server
   if (!hasFlag(REPLAY_FLAG_NO_VIPC)) {
@@ -381,6 +369,23 @@ void Replay::startStream(const Segment *cur_segment) {
   timeline_future = QtConcurrent::run(this, &Replay::buildTimeline);
 }
 
+void Replay::writeCarParams(const std::vector<Event> &events) {
+  auto it = std::find_if(events.begin(), events.end(), [](const Event &e) { return e.which == cereal::Event::Which::CAR_PARAMS; });
+  if (it != events.end()) {
+    capnp::FlatArrayMessageReader reader(it->data);
+    auto event = reader.getRoot<cereal::Event>();
+    car_fingerprint_ = event.getCarParams().getCarFingerprint();
+    capnp::MallocMessageBuilder builder;
+    builder.setRoot(event.getCarParams());
+    auto words = capnp::messageToFlatArray(builder);
+    auto bytes = words.asBytes();
+    Params().put("CarParams", (const char *)bytes.begin(), bytes.size());
+    Params().put("CarParamsPersistent", (const char *)bytes.begin(), bytes.size());
+  } else {
+    rWarning("failed to read CarParams from current segment");
+  }
+}
+
 void Replay::publishMessage(const Event *e) {
   if (event_filter && event_filter(e, filter_opaque)) return;
 
@@ -502,3 +507,102 @@ std::vector<Event>::const_iterator Replay::publishEvents(std::vector<Event>::con
 
   return first;
 }
+
+// lock-step replay
+
+bool Replay::runLockstep(int seconds, LockstepStats *stats) {
+  if (!pm) {
+    rError("lock-step replay requires publishing to sockets");
+    return false;
+  }
+
+  auto it = segments_.lower_bound(route_->identifier().begin_segment + seconds / 60);
+  if (it == segments_.end()) {
+    rError("no valid segments after %d s", seconds);
+    return false;
+  }
+
+  // the next segment is loaded in the background while the current one is being published
+  auto load_log = [this](int n) {
+    const auto &files = route_->at(n);
+    auto log = std::make_unique<LogReader>(filters_);
+    const QString &file = files.rlog.isEmpty() ? files.qlog : files.rlog;
+    if (!log->load(file.toStdString(), &exit_, !hasFlag(REPLAY_FLAG_NO_FILE_CACHE), 0, 3)) {
+      log.reset();
+    }
+    return log;
+  };
+
+  bool in_lockstep = true;
+  uint64_t skip_until = 0;
+  uint64_t first_mono_time = 0;
+  const uint64_t loop_start_ts = nanos_since_boot();
+  auto next = std::async(std::launch::async, load_log, it->first);
+  while (it != segments_.end() && in_lockstep && !exit_) {
+    const int seg_num = it->first;
+    std::unique_ptr<LogReader> log = next.get();
+    if (++it != segments_.end()) {
+      next = std::async(std::launch::async, load_log, it->first);
+    }
+    if (!log || log->events.empty()) {
+      rWarning("failed to load segment %d, skipping it", seg_num);
+      continue;
+    }
+
+    if (route_start_ts_ == 0) {
+      route_start_ts_ = log->events.front().mono_time;
+      skip_until = route_start_ts_ + (seconds % 60) * 1e9;
+      writeCarParams(log->events);
+    }
+
+    for (const Event &evt : log->events) {
+      if (exit_) break;
+      if (evt.mono_time < skip_until || evt.eidx_segnum != -1 || !sockets_[evt.which]) continue;
+
+      if (first_mono_time == 0) first_mono_time = evt.mono_time;
+      cur_mono_time_ = evt.mono_time;
+      publishMessage(&evt);
+      ++stats->messages;
+      // publishMessage drops the socket if it has multiple publishers
+      if (sockets_[evt.which] && !waitForReaders(&evt, stats)) {
+        in_lockstep = false;
+        break;
+      }
+    }
+    rInfo("segment %d: %lu messages published", seg_num, stats->messages);
+  }
+
+  stats->wall_seconds = (nanos_since_boot() - loop_start_ts) / 1e9;
+  stats->route_seconds = (cur_mono_time_ - first_mono_time) / 1e9;
+  return in_lockstep && !exit_;
+}
+
+bool Replay::waitForReaders(const Event *e, LockstepStats *stats) {
+  // all_readers_updated() is false for a service without any subscriber, there is nothing to wait for.
+  // checked for every message since a subscriber may connect in the middle of the route.
+  const char *name = sockets_[e->which];
+  if (pm->numReaders(name) == 0) return true;
+
+  const uint64_t start_ts = nanos_since_boot();
+  uint64_t warn_ts = start_ts + LOCKSTEP_STALL_WARN_MS * 1e6;
+  bool stalled = false;
+  while (!pm->allReadersUpdated(name)) {
+    if (exit_) return false;
+    const uint64_t ts = nanos_since_boot();
+    if (ts > start_ts + LOCKSTEP_READER_TIMEOUT_MS * 1e6) {
+      rError("readers of %s did not catch up in %d ms, giving up lock-step replay",
+             name, LOCKSTEP_READER_TIMEOUT_MS);
+      return false;
+    }
+    if (ts > warn_ts) {
+      if (!stalled) {
+        stalled = true;
+        ++stats->stalls;
+      }
+      rWarning("still waiting for the readers of %s after %.1f s", name, (ts - start_ts) / 1e9);
+      warn_ts = ts + LOCKSTEP_STALL_WARN_MS * 1e6;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
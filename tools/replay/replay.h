@@ -19,6 +19,10 @@ const QString DEMO_ROUTE = "a2a0ccea32023010|2023-07-27--13-01-19";
 
 // one segment uses about 100M of memory
 constexpr int MIN_SEGMENTS_CACHE = 5;
+// lock-step replay warns about subscribers that take longer than this to read a message
+constexpr int LOCKSTEP_STALL_WARN_MS = 1000;
+// and fails once they fall this far behind, rather than publishing out of lock-step
+constexpr int LOCKSTEP_READER_TIMEOUT_MS = 30000;
 
 enum REPLAY_FLAGS {
   REPLAY_FLAG_NONE = 0x0000,
@@ -30,6 +34,14 @@ enum REPLAY_FLAGS {
   REPLAY_FLAG_NO_HW_DECODER = 0x0100,
   REPLAY_FLAG_NO_VIPC = 0x0400,
   REPLAY_FLAG_ALL_SERVICES = 0x0800,
+  REPLAY_FLAG_LOCKSTEP = 0x1000,
+};
+
+struct LockstepStats {
+  uint64_t messages = 0;
+  uint64_t stalls = 0;
+  double wall_seconds = 0;
+  double route_seconds = 0;
 };
 
 enum class FindFlag {
@@ -54,6 +66,9 @@ public:
   ~Replay();
   bool load();
   void start(int seconds = 0);
+  // publish all events from <seconds> to the end of the route as fast as the subscribers can consume them.
+  // runs on the calling thread and does not require an event loop.
+  bool runLockstep(int seconds, LockstepStats *stats);
   void stop();
   void pause(bool pause);
   void seekToFlag(FindFlag flag);
@@ -111,6 +126,8 @@ protected:
                                                    std::vector<Event>::const_iterator last);
   void publishMessage(const Event *e);
   void publishFrame(const Event *e);
+  bool waitForReaders(const Event *e, LockstepStats *stats);
+  void writeCarParams(const std::vector<Event> &events);
   void buildTimeline();
   inline bool isSegmentMerged(int n) const { return merged_segments_.count(n) > 0; }
 